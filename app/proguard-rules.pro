@@ -32,3 +32,4 @@
 -keep class com.opendevelopment.opensensor.GravityService$GravityConfig { *; }
 -keep class com.opendevelopment.opensensor.LightSensorService$LightSensorConfig { *; }
 -keep class com.opendevelopment.opensensor.TemperatureSensorService$TemperatureSensorConfig { *; }
+-keep class com.opendevelopment.opensensor.ChangeDetectionConfig { *; }
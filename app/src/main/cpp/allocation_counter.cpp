@@ -0,0 +1,53 @@
+#include "allocation_counter.h"
+
+#ifdef OPENSENSOR_COUNT_ALLOCATIONS
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+thread_local uint64_t allocations = 0;
+}
+
+void* operator new(std::size_t size) {
+    ++allocations;
+    if (void* pointer = std::malloc(size != 0 ? size : 1)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    ++allocations;
+    return std::malloc(size != 0 ? size : 1);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+    std::free(pointer);
+}
+
+namespace allocation_counter {
+
+bool enabled() { return true; }
+uint64_t thread_allocations() { return allocations; }
+
+}
+
+#else
+
+namespace allocation_counter {
+
+bool enabled() { return false; }
+uint64_t thread_allocations() { return 0; }
+
+}
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef OPEN_SENSOR_ALLOCATION_COUNTER_H
+#define OPEN_SENSOR_ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+// Per-thread count of global operator new calls. Counting is only compiled in when the
+// library is built with OPENSENSOR_COUNT_ALLOCATIONS, which replaces the global allocation
+// functions; otherwise the counter always reads 0.
+//
+// A single sample published through a feed allocates nothing on the sensor thread once the
+// processor has warmed up, which test/allocation_test.cpp checks. What still allocates, per
+// message:
+// - on the io_context thread, the topic and payload std::string made from each drained
+//   sample, which the Boost.MQTT5 client's async_publish takes by value and keeps until the
+//   message is written, and the client's own encoding of the PUBLISH packet;
+// - on the sensor thread, batches, aggregation windows and spectra, which go through
+//   publish(topic, payload) with std::string arguments: a few allocations per message,
+//   spread over the samples the message carries.
+namespace allocation_counter {
+
+bool enabled();
+uint64_t thread_allocations();
+
+}
+
+#endif //OPEN_SENSOR_ALLOCATION_COUNTER_H
@@ -0,0 +1,200 @@
+#include "android_sensor_source.h"
+#include <android/log.h>
+#include <algorithm>
+
+#define LOG_TAG "AndroidSensorSource"
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+// Indexed by SensorKind; the same sensor types the Kotlin services use
+constexpr int SENSOR_TYPES[SENSOR_KIND_COUNT] = {
+    ASENSOR_TYPE_LINEAR_ACCELERATION,
+    ASENSOR_TYPE_GYROSCOPE,
+    ASENSOR_TYPE_GRAVITY,
+    ASENSOR_TYPE_LIGHT,
+    ASENSOR_TYPE_AMBIENT_TEMPERATURE,
+};
+
+int kindIndexForType(int32_t type) {
+    for (int i = 0; i < SENSOR_KIND_COUNT; ++i) {
+        if (SENSOR_TYPES[i] == type) return i;
+    }
+    return -1;
+}
+
+ASensorManager* getSensorManager(const std::string& packageName) {
+#if __ANDROID_API__ >= 26
+    return ASensorManager_getInstanceForPackage(packageName.c_str());
+#else
+    return ASensorManager_getInstance();
+#endif
+}
+
+}
+
+AndroidSensorSource::AndroidSensorSource(const std::string& packageName)
+        : manager_(getSensorManager(packageName)) {
+    if (manager_ == nullptr) {
+        LOGE("Sensor manager not available.");
+        return;
+    }
+    for (int i = 0; i < SENSOR_KIND_COUNT; ++i) {
+        sensors_[i] = ASensorManager_getDefaultSensor(manager_, SENSOR_TYPES[i]);
+    }
+}
+
+AndroidSensorSource::~AndroidSensorSource() {
+    stop();
+}
+
+bool AndroidSensorSource::start(sample_callback callback) {
+    if (manager_ == nullptr) return false;
+    if (running()) return true;
+
+    callback_ = std::move(callback);
+    stopRequested_ = false;
+    // Registrations do not survive the event queue, so reapply every enabled sensor
+    std::fill(std::begin(registeredPeriodUs_), std::end(registeredPeriodUs_), 0);
+    registrationsChanged_ = true;
+
+    std::promise<ALooper*> ready;
+    std::future<ALooper*> looper = ready.get_future();
+    thread_ = std::thread([this, &ready] { run(ready); });
+    looper_ = looper.get();
+    if (looper_.load() == nullptr) {
+        thread_.join();
+        return false;
+    }
+    LOGD("Native sensor ingestion started.");
+    return true;
+}
+
+void AndroidSensorSource::stop() {
+    if (!running()) return;
+
+    stopRequested_ = true;
+    ALooper_wake(looper_);
+    thread_.join();
+    ALooper_release(looper_.exchange(nullptr));
+    callback_ = nullptr;
+    LOGD("Native sensor ingestion stopped.");
+}
+
+bool AndroidSensorSource::enable(SensorKind kind, int32_t samplingPeriodUs) {
+    int index = static_cast<int>(kind);
+    if (index < 0 || index >= SENSOR_KIND_COUNT || sensors_[index] == nullptr) return false;
+
+    // The framework treats 0 as "as fast as possible", which is what SENSOR_DELAY_FASTEST means
+    int32_t periodUs = std::max(samplingPeriodUs, ASensor_getMinDelay(sensors_[index]));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requestedPeriodUs_[index] = std::max<int32_t>(periodUs, 1);
+    }
+    registrationsChanged_ = true;
+    if (ALooper* looper = looper_.load()) ALooper_wake(looper);
+    return true;
+}
+
+void AndroidSensorSource::disable(SensorKind kind) {
+    int index = static_cast<int>(kind);
+    if (index < 0 || index >= SENSOR_KIND_COUNT) return;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        requestedPeriodUs_[index] = 0;
+    }
+    registrationsChanged_ = true;
+    if (ALooper* looper = looper_.load()) ALooper_wake(looper);
+}
+
+void AndroidSensorSource::run(std::promise<ALooper*>& ready) {
+    ALooper* looper = ALooper_prepare(ALOOPER_PREPARE_ALLOW_NON_CALLBACKS);
+    ASensorEventQueue* queue = ASensorManager_createEventQueue(manager_, looper, LOOPER_ID_SENSORS, nullptr, nullptr);
+    if (queue == nullptr) {
+        LOGE("Failed to create sensor event queue.");
+        ready.set_value(nullptr);
+        return;
+    }
+    // Held until stop() so that ALooper_wake stays valid after this thread exits
+    ALooper_acquire(looper);
+    ready.set_value(looper);
+
+    while (!stopRequested_) {
+        if (registrationsChanged_.exchange(false)) {
+            applyRegistrations(queue);
+        }
+
+        int ident = ALooper_pollOnce(-1, nullptr, nullptr, nullptr);
+        if (ident == LOOPER_ID_SENSORS) {
+            readEvents(queue);
+        } else if (ident == ALOOPER_POLL_ERROR) {
+            LOGE("Sensor looper failed.");
+            break;
+        }
+    }
+
+    for (int i = 0; i < SENSOR_KIND_COUNT; ++i) {
+        if (registeredPeriodUs_[i] != 0) {
+            ASensorEventQueue_disableSensor(queue, sensors_[i]);
+            registeredPeriodUs_[i] = 0;
+        }
+    }
+    ASensorManager_destroyEventQueue(manager_, queue);
+}
+
+void AndroidSensorSource::applyRegistrations(ASensorEventQueue* queue) {
+    int32_t requested[SENSOR_KIND_COUNT];
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::copy(std::begin(requestedPeriodUs_), std::end(requestedPeriodUs_), requested);
+    }
+
+    for (int i = 0; i < SENSOR_KIND_COUNT; ++i) {
+        if (requested[i] == registeredPeriodUs_[i] || sensors_[i] == nullptr) continue;
+
+        if (registeredPeriodUs_[i] != 0) {
+            ASensorEventQueue_disableSensor(queue, sensors_[i]);
+        }
+        if (requested[i] != 0) {
+#if __ANDROID_API__ >= 26
+            int result = ASensorEventQueue_registerSensor(queue, sensors_[i], requested[i], MAX_REPORT_LATENCY_US);
+#else
+            int result = ASensorEventQueue_enableSensor(queue, sensors_[i]);
+            if (result >= 0) result = ASensorEventQueue_setEventRate(queue, sensors_[i], requested[i]);
+#endif
+            if (result < 0) {
+                LOGE("Failed to enable sensor type %d (%d).", SENSOR_TYPES[i], result);
+                registeredPeriodUs_[i] = 0;
+                continue;
+            }
+        }
+        registeredPeriodUs_[i] = requested[i];
+    }
+}
+
+void AndroidSensorSource::readEvents(ASensorEventQueue* queue) {
+    ASensorEvent events[EVENT_BATCH];
+    SensorSample samples[EVENT_BATCH];
+
+    ssize_t count;
+    while ((count = ASensorEventQueue_getEvents(queue, events, EVENT_BATCH)) > 0) {
+        size_t sampleCount = 0;
+        for (ssize_t i = 0; i < count; ++i) {
+            const ASensorEvent& event = events[i];
+            int index = kindIndexForType(event.type);
+            // Events can still arrive briefly after a sensor was disabled
+            if (index < 0 || registeredPeriodUs_[index] == 0) continue;
+
+            SensorSample& sample = samples[sampleCount++];
+            sample.kind = static_cast<SensorKind>(index);
+            sample.timestamp = event.timestamp;
+            sample.values[0] = event.data[0];
+            sample.values[1] = event.data[1];
+            sample.values[2] = event.data[2];
+        }
+        if (sampleCount > 0) {
+            callback_(samples, sampleCount);
+        }
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef OPEN_SENSOR_ANDROID_SENSOR_SOURCE_H
+#define OPEN_SENSOR_ANDROID_SENSOR_SOURCE_H
+
+#include "sensor_source.h"
+#include <android/looper.h>
+#include <android/sensor.h>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Reads sensors through an ASensorEventQueue attached to a looper on a dedicated thread, so
+// samples reach the processors without passing through the JVM.
+//
+// The event queue is only touched on the looper thread. enable() and disable() record the
+// requested state and wake the looper, which applies it before reading more events.
+class AndroidSensorSource : public SensorSource {
+public:
+    explicit AndroidSensorSource(const std::string& packageName);
+    ~AndroidSensorSource() override;
+
+    bool start(sample_callback callback) override;
+    void stop() override;
+    bool running() const override { return thread_.joinable(); }
+
+    bool enable(SensorKind kind, int32_t samplingPeriodUs) override;
+    void disable(SensorKind kind) override;
+
+private:
+    void run(std::promise<ALooper*>& ready);
+    void applyRegistrations(ASensorEventQueue* queue);
+    void readEvents(ASensorEventQueue* queue);
+
+    // Looper identifier returned by ALooper_pollOnce when sensor events are pending
+    static constexpr int LOOPER_ID_SENSORS = 1;
+    // Events read from the queue per ASensorEventQueue_getEvents call
+    static constexpr size_t EVENT_BATCH = 32;
+    // How long the sensor hub may hold events back to deliver them together (API 26+)
+    static constexpr int64_t MAX_REPORT_LATENCY_US = 20000;
+
+    ASensorManager* manager_;
+    const ASensor* sensors_[SENSOR_KIND_COUNT] = {};
+
+    std::mutex mutex_;
+    int32_t requestedPeriodUs_[SENSOR_KIND_COUNT] = {}; // 0 = disabled, guarded by mutex_
+    std::atomic<bool> registrationsChanged_{false};
+
+    // Looper thread state
+    int32_t registeredPeriodUs_[SENSOR_KIND_COUNT] = {};
+    sample_callback callback_;
+
+    std::thread thread_;
+    std::atomic<ALooper*> looper_{nullptr};
+    std::atomic<bool> stopRequested_{false};
+};
+
+#endif //OPEN_SENSOR_ANDROID_SENSOR_SOURCE_H
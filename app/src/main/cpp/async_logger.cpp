@@ -0,0 +1,297 @@
+#include "async_logger.h"
+#include "platform_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "AsyncLogger"
+
+struct AsyncLogger::file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    // Bytes whose text is complete. The text at position p is at p % capacity in the ring.
+    std::atomic<uint64_t> written;
+    // Raised before the writer overwrites anything, so a reader can tell which part of what
+    // it copied may have changed underneath it
+    std::atomic<uint64_t> writing;
+};
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x314C534F; // "OSL1"
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 4096;
+constexpr auto IDLE_WAIT = std::chrono::milliseconds(250);
+// "2024-01-31 12:34:56 | "
+constexpr size_t PREFIX_LENGTH = 22;
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+AsyncLogger::AsyncLogger(const std::string& path, size_t capacity) {
+    if (path.empty() || !open(path, capacity)) return;
+
+    entries_ = std::make_unique<entry[]>(RING_SIZE);
+    for (size_t i = 0; i < RING_SIZE; ++i) {
+        entries_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    writer_ = std::thread([this] { run(); });
+}
+
+AsyncLogger::~AsyncLogger() {
+    if (writer_.joinable()) {
+        stopping_.store(true);
+        {
+            std::lock_guard<std::mutex> lock(wake_mutex_);
+            wake_.notify_one();
+        }
+        writer_.join();
+    }
+    close();
+}
+
+bool AsyncLogger::open(const std::string& path, size_t capacity) {
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    capacity = align_up(capacity > 0 ? capacity : page, page);
+    size_t file_size = HEADER_SIZE + capacity;
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd_ < 0) {
+        LOGW("Cannot open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat st {};
+    bool fresh = fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) != file_size;
+    if (fresh && ftruncate(fd_, static_cast<off_t>(file_size)) != 0) {
+        LOGW("Cannot size %s to %zu bytes: %s", path.c_str(), file_size, strerror(errno));
+        close();
+        return false;
+    }
+
+    mapping_ = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        LOGW("Cannot map %s: %s", path.c_str(), strerror(errno));
+        mapping_ = nullptr;
+        close();
+        return false;
+    }
+    mapping_size_ = file_size;
+    header_ = static_cast<file_header*>(mapping_);
+    ring_ = static_cast<char*>(mapping_) + HEADER_SIZE;
+    capacity_ = capacity;
+
+    // The text of a previous run is kept. If it died while appending, writing stays ahead of
+    // written, so readers keep skipping the oldest text it may have overwritten.
+    if (fresh || header_->magic != MAGIC || header_->version != VERSION || header_->capacity != capacity ||
+        header_->writing.load(std::memory_order_relaxed) < header_->written.load(std::memory_order_relaxed)) {
+        std::memset(static_cast<void*>(header_), 0, sizeof(file_header));
+        header_->capacity = capacity;
+        header_->version = VERSION;
+        header_->magic = MAGIC;
+    }
+    return true;
+}
+
+void AsyncLogger::close() {
+    if (mapping_ != nullptr) {
+        msync(mapping_, mapping_size_, MS_ASYNC);
+        munmap(mapping_, mapping_size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = -1;
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    header_ = nullptr;
+    ring_ = nullptr;
+    capacity_ = 0;
+}
+
+// Bounded multi-producer queue after Dmitry Vyukov: an entry is free for the producer that
+// claims position p when its sequence is p, and holds a line for the consumer when it is p + 1.
+bool AsyncLogger::log(std::string_view message) {
+    if (!entries_) return false;
+
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    entry* e;
+    for (;;) {
+        e = &entries_[position & (RING_SIZE - 1)];
+        size_t sequence = e->sequence.load(std::memory_order_acquire);
+        auto difference = static_cast<std::ptrdiff_t>(sequence - position);
+        if (difference == 0) {
+            if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        } else {
+            position = enqueue_position_.load(std::memory_order_relaxed);
+        }
+    }
+
+    e->time = static_cast<int64_t>(std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()));
+    size_t length = std::min(message.size(), MAX_MESSAGE);
+    for (size_t i = 0; i < length; ++i) {
+        char c = message[i];
+        // Every entry in the file has to stay a single line
+        e->text[i] = c == '\n' || c == '\r' ? ' ' : c;
+    }
+    e->length = static_cast<uint16_t>(length);
+    e->sequence.store(position + 1, std::memory_order_release);
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_.notify_one();
+    }
+    return true;
+}
+
+void AsyncLogger::run() {
+    std::string batch;
+    batch.reserve(RING_SIZE * (PREFIX_LENGTH + MAX_MESSAGE + 1));
+    int64_t cached_time = -1;
+    char prefix[PREFIX_LENGTH + 8];
+    size_t prefix_length = 0;
+    uint64_t reported_drops = 0;
+
+    auto ready = [this] {
+        const entry& e = entries_[dequeue_position_ & (RING_SIZE - 1)];
+        return e.sequence.load(std::memory_order_acquire) == dequeue_position_ + 1;
+    };
+
+    for (;;) {
+        batch.clear();
+        while (ready()) {
+            entry& e = entries_[dequeue_position_ & (RING_SIZE - 1)];
+            // Lines arrive a few per second at most, so the formatted time is reused
+            if (e.time != cached_time) {
+                cached_time = e.time;
+                auto t = static_cast<std::time_t>(e.time);
+                std::tm local {};
+                localtime_r(&t, &local);
+                prefix_length = std::strftime(prefix, sizeof(prefix), "%F %T | ", &local);
+            }
+            batch.append(prefix, prefix_length);
+            batch.append(e.text, e.length);
+            batch.push_back('\n');
+            e.sequence.store(dequeue_position_ + RING_SIZE, std::memory_order_release);
+            ++dequeue_position_;
+        }
+
+        uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+        if (dropped != reported_drops) {
+            batch.append(prefix, prefix_length);
+            batch.append(std::to_string(dropped - reported_drops) + " log lines dropped\n");
+            reported_drops = dropped;
+        }
+
+        if (!batch.empty()) {
+            append(batch.data(), batch.size());
+            continue;
+        }
+        if (stopping_.load()) break;
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        sleeping_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake_.wait_for(lock, IDLE_WAIT, [&] { return stopping_.load() || ready(); });
+        sleeping_.store(false, std::memory_order_relaxed);
+    }
+}
+
+void AsyncLogger::append(const char* data, size_t length) {
+    // Only the newest lines of a burst larger than the ring would survive anyway. The text
+    // written always starts at a line, which readers rely on at position 0.
+    if (length > capacity_) {
+        const char* cut = data + (length - capacity_);
+        const char* newline = static_cast<const char*>(std::memchr(cut, '\n', capacity_));
+        if (newline == nullptr) return;
+        length -= static_cast<size_t>(newline + 1 - data);
+        data = newline + 1;
+    }
+    uint64_t position = header_->written.load(std::memory_order_relaxed);
+    uint64_t writing = header_->writing.load(std::memory_order_relaxed);
+    header_->writing.store(std::max(writing, position + length), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    size_t offset = position % capacity_;
+    size_t first = std::min(length, capacity_ - offset);
+    std::memcpy(ring_ + offset, data, first);
+    std::memcpy(ring_, data + first, length - first);
+
+    header_->written.store(position + length, std::memory_order_release);
+}
+
+bool AsyncLogger::read_since(const std::string& path, uint64_t since, size_t max_bytes,
+                             std::string& out, uint64_t& next) {
+    next = since;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) <= HEADER_SIZE) {
+        ::close(fd);
+        return false;
+    }
+    size_t file_size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) return false;
+
+    auto* header = static_cast<const file_header*>(mapping);
+    const char* ring = static_cast<const char*>(mapping) + HEADER_SIZE;
+    size_t capacity = file_size - HEADER_SIZE;
+    if (header->magic != MAGIC || header->version != VERSION || header->capacity != capacity) {
+        munmap(mapping, file_size);
+        return false;
+    }
+
+    uint64_t end = header->written.load(std::memory_order_acquire);
+    uint64_t oldest = end > capacity ? end - capacity : 0;
+    uint64_t start = since <= end ? std::max(since, oldest) : oldest;
+    // A position returned by an earlier call is always the start of a line
+    bool line_start = start == 0 || (start == since && since <= end);
+    if (end - start > max_bytes) {
+        start = end - max_bytes;
+        line_start = false;
+    }
+
+    std::string text(static_cast<size_t>(end - start), '\0');
+    size_t offset = start % capacity;
+    size_t first = std::min(text.size(), capacity - offset);
+    std::memcpy(text.data(), ring + offset, first);
+    std::memcpy(text.data() + first, ring, text.size() - first);
+
+    // Whatever the writer started overwriting while the text was copied is discarded
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t writing = header->writing.load(std::memory_order_relaxed);
+    munmap(mapping, file_size);
+    if (writing > capacity && writing - capacity > start) {
+        text.erase(0, std::min<uint64_t>(writing - capacity - start, text.size()));
+        line_start = false;
+    }
+
+    size_t from = 0;
+    if (!line_start) {
+        size_t newline = text.find('\n');
+        from = newline == std::string::npos ? text.size() : newline + 1;
+    }
+    out.append(text, from, std::string::npos);
+    next = end;
+    return true;
+}
@@ -0,0 +1,92 @@
+#ifndef OPEN_SENSOR_ASYNC_LOGGER_H
+#define OPEN_SENSOR_ASYNC_LOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Connection log shown on the MQTT screen.
+//
+// log() never touches the file system: it copies the line and its timestamp into a bounded
+// lock-free ring that any number of threads may push to. A background thread formats the
+// lines and appends them to a fixed-size memory-mapped circular file, overwriting the oldest
+// text once it is full, so the file never has to be read back and trimmed.
+//
+// The file is a header page holding the total number of bytes ever written, followed by the
+// ring of text. Positions are byte counts since the file was created; read_since() returns
+// the complete lines after a position together with the position to continue from, so the
+// UI only reads what was appended since its last poll. The reader does not need a logger
+// instance and works while the service is stopped.
+class AsyncLogger {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64 * 1024;
+    // Longer messages are cut; the timestamp is added by the writer
+    static constexpr size_t MAX_MESSAGE = 236;
+
+    // An empty path gives a logger that discards everything
+    explicit AsyncLogger(const std::string& path, size_t capacity = DEFAULT_CAPACITY);
+    // Writes the lines still in the ring before returning
+    ~AsyncLogger();
+
+    AsyncLogger(const AsyncLogger&) = delete;
+    AsyncLogger& operator=(const AsyncLogger&) = delete;
+
+    // Safe to call from any thread and does not block. Returns false, and counts the line as
+    // dropped, if the ring is full.
+    bool log(std::string_view message);
+
+    uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+    // Appends to out the complete lines of the log file at path that start at or after
+    // position since, at most max_bytes of them (the newest), and stores the position after
+    // the last one in next. If since is older than the oldest text still in the file, reading
+    // starts at the oldest complete line. next is smaller than since if the file was
+    // recreated in the meantime. Returns false if the file does not exist or is not a log.
+    static bool read_since(const std::string& path, uint64_t since, size_t max_bytes,
+                           std::string& out, uint64_t& next);
+
+private:
+    struct file_header;
+
+    struct alignas(64) entry {
+        std::atomic<size_t> sequence;
+        int64_t time; // std::time_t of the call
+        uint16_t length;
+        char text[MAX_MESSAGE];
+    };
+
+    static constexpr size_t RING_SIZE = 256;
+
+    bool open(const std::string& path, size_t capacity);
+    void close();
+    void run();
+    bool try_pop(std::string& line);
+    void append(const char* data, size_t length);
+
+    std::unique_ptr<entry[]> entries_;
+    alignas(64) std::atomic<size_t> enqueue_position_{0};
+    alignas(64) size_t dequeue_position_ = 0;
+    std::atomic<uint64_t> dropped_{0};
+
+    int fd_ = -1;
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    file_header* header_ = nullptr;
+    char* ring_ = nullptr;
+    size_t capacity_ = 0;
+
+    // Only used to wake the writer; producers take the mutex only when it is asleep
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> sleeping_{false};
+    std::atomic<bool> stopping_{false};
+    std::thread writer_;
+};
+
+#endif //OPEN_SENSOR_ASYNC_LOGGER_H
@@ -0,0 +1,372 @@
+// Google Benchmark suite of the native core, for tracking its cost across releases:
+// processData of every processor layout in each single-sample encoding and batched, payload
+// formatting, orientation fusion, the cost of handing a message to MqttClientWrapper, the
+// connection log and the metrics registry.
+//
+// The processors and publishes go to a connected MqttClientWrapper. The broker stand-in of
+// loopback_broker.h discards what it receives, so the numbers cover the whole path to the
+// socket without depending on a real broker. The io_context thread drains the feeds
+// concurrently; the benchmarks time the calling thread.
+//
+// Built by the host CMake build as opensensor_benchmark. For results to compare:
+//
+//     opensensor_benchmark --benchmark_out=results.json --benchmark_out_format=json
+
+#include "allocation_counter.h"
+#include "async_logger.h"
+#include "binary_payload.h"
+#include "loopback_broker.h"
+#include "metrics.h"
+#include "mqtt_client_wrapper.h"
+#include "orientation_filter.h"
+#include "orientation_fusion.h"
+#include "payload_format.h"
+#include "pipeline_trace.h"
+#include "platform_log.h"
+#include "sensor_processor.h"
+#include <benchmark/benchmark.h>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr size_t SAMPLES = 1024;
+constexpr PayloadEncoding SINGLE_SAMPLE_ENCODINGS[] = {PayloadEncoding::json, PayloadEncoding::cbor,
+                                                        PayloadEncoding::packed};
+
+// Slowly varying values, so that no sample is suppressed as unchanged
+template<size_t N>
+const std::array<std::array<float, N>, SAMPLES>& samples() {
+    static const auto table = [] {
+        std::array<std::array<float, N>, SAMPLES> values{};
+        for (size_t i = 0; i < SAMPLES; ++i) {
+            for (size_t c = 0; c < N; ++c) {
+                values[i][c] = 9.81f * std::sin(0.013f * static_cast<float>(i) + static_cast<float>(c));
+            }
+        }
+        return values;
+    }();
+    return table;
+}
+
+// A wrapper connected to the stand-in, with the processors of every layout and a feed of its
+// own. Built on first use and shared by all benchmarks, as a wrapper has a fixed number of feeds.
+struct Harness {
+    Harness() {
+        wrapper = std::make_unique<MqttClientWrapper>("");
+        // Never refuse on the calling thread; what the io_context thread cannot keep up with is
+        // dropped there
+        wrapper->set_feed_options(4096, MqttClientWrapper::overflow_policy::drop_oldest);
+        wrapper->set_in_flight_window(4096, 64, MqttClientWrapper::window_policy::drop_oldest);
+        wrapper->set_status_callback([this](const std::string& status, const std::string&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            connected = status == "CONNECTED";
+            changed.notify_all();
+        });
+        scalar = std::make_unique<ScalarSensorProcessor>(wrapper.get(), "bench.scalar", "bench/scalar");
+        threeAxis = std::make_unique<ThreeAxisSensorProcessor>(wrapper.get(), "bench.three_axis", "bench/three_axis");
+        rotation = std::make_unique<RotationVectorSensorProcessor>(wrapper.get(), "bench.rotation", "bench/rotation");
+        fusion = std::make_unique<OrientationFusion>(wrapper.get(), "bench/orientation");
+        feed = wrapper->register_feed("bench/feed");
+
+        wrapper->connect(broker.url(), "bench", "", "");
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!changed.wait_for(lock, std::chrono::seconds(10), [this] { return connected; })) {
+            std::fprintf(stderr, "No connection to the loopback broker\n");
+            std::exit(1);
+        }
+    }
+
+    ~Harness() {
+        // The processors publish through the wrapper, so they go first
+        wrapper->disconnect();
+        scalar.reset();
+        threeAxis.reset();
+        rotation.reset();
+        fusion.reset();
+        wrapper.reset();
+    }
+
+    LoopbackBroker broker;
+    std::unique_ptr<MqttClientWrapper> wrapper;
+    std::unique_ptr<ScalarSensorProcessor> scalar;
+    std::unique_ptr<ThreeAxisSensorProcessor> threeAxis;
+    std::unique_ptr<RotationVectorSensorProcessor> rotation;
+    std::unique_ptr<OrientationFusion> fusion;
+    MqttClientWrapper::feed_id feed = MqttClientWrapper::invalid_feed;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool connected = false;
+};
+
+Harness& harness() {
+    static Harness instance;
+    return instance;
+}
+
+template<typename Processor>
+Processor& processor();
+template<>
+ScalarSensorProcessor& processor() { return *harness().scalar; }
+template<>
+ThreeAxisSensorProcessor& processor() { return *harness().threeAxis; }
+template<>
+RotationVectorSensorProcessor& processor() { return *harness().rotation; }
+
+void reportAllocations(benchmark::State& state, uint64_t before) {
+    if (allocation_counter::enabled()) {
+        state.counters["allocs"] = benchmark::Counter(
+                static_cast<double>(allocation_counter::thread_allocations() - before),
+                benchmark::Counter::kAvgIterations);
+    }
+}
+
+// Args: encoding, batch size (0 for one message per sample)
+template<typename Processor, size_t N>
+void BM_ProcessData(benchmark::State& state) {
+    Processor& p = processor<Processor>();
+    auto encoding = static_cast<PayloadEncoding>(state.range(0));
+    int batchMaxSamples = static_cast<int>(state.range(1));
+    p.updateSettings(2, batchMaxSamples > 0 ? 60000 : 0, batchMaxSamples, ChangeDetectionSettings{}, 0, 0, encoding,
+                     MqttClientWrapper::feed_mode::stream);
+    const auto& values = samples<N>();
+    size_t i = 0;
+    int64_t timestamp = pipeline_trace::now_ns();
+    uint64_t allocations = allocation_counter::thread_allocations();
+    for (auto _ : state) {
+        p.processData(values[i++ % SAMPLES], timestamp);
+    }
+    reportAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(std::string(contentType(encoding)) + (batchMaxSamples > 0 ? ", batched" : ""));
+}
+
+void processDataArgs(benchmark::internal::Benchmark* b) {
+    for (PayloadEncoding encoding : SINGLE_SAMPLE_ENCODINGS) {
+        b->Args({static_cast<int64_t>(encoding), 0});
+    }
+    b->Args({static_cast<int64_t>(PayloadEncoding::json), 50});
+    b->Args({static_cast<int64_t>(PayloadEncoding::series), 50});
+}
+
+BENCHMARK_TEMPLATE(BM_ProcessData, ScalarSensorProcessor, 1)->Apply(processDataArgs);
+BENCHMARK_TEMPLATE(BM_ProcessData, ThreeAxisSensorProcessor, 3)->Apply(processDataArgs);
+BENCHMARK_TEMPLATE(BM_ProcessData, RotationVectorSensorProcessor, 4)->Apply(processDataArgs);
+
+// One filter step from a gyroscope and a gravity sample. Arg: FusionAlgorithm
+void BM_OrientationFilterUpdate(benchmark::State& state) {
+    auto algorithm = static_cast<FusionAlgorithm>(state.range(0));
+    OrientationFilter filter;
+    filter.configure(algorithm, 0.0f, algorithm == FusionAlgorithm::mahony ? 0.1f : 0.0f);
+    const auto& gyro = samples<3>();
+    const float gravity[3] = {0.3f, 2.1f, 9.5f};
+    size_t i = 0;
+    for (auto _ : state) {
+        filter.update(gyro[i++ % SAMPLES].data(), gravity, 0.0025f);
+        benchmark::DoNotOptimize(filter.orientation());
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(algorithm == FusionAlgorithm::madgwick ? "Madgwick" : "Mahony");
+}
+BENCHMARK(BM_OrientationFilterUpdate)->Arg(static_cast<int64_t>(FusionAlgorithm::madgwick))
+                                     ->Arg(static_cast<int64_t>(FusionAlgorithm::mahony));
+
+// The fusion stage fed a 400 Hz gyroscope and a 100 Hz gravity sensor, publishing the
+// orientation at 50 Hz of sample time; items are filter updates
+void BM_OrientationFusion(benchmark::State& state) {
+    OrientationFusion& fusion = *harness().fusion;
+    fusion.configure(static_cast<FusionAlgorithm>(state.range(0)), 0.0f, 50.0f);
+    const auto& gyro = samples<3>();
+    const float gravity[3] = {0.3f, 2.1f, 9.5f};
+    constexpr int64_t GYROSCOPE_PERIOD_NS = 2500000;
+    int64_t timestamp = pipeline_trace::now_ns();
+    size_t i = 0;
+    uint64_t allocations = allocation_counter::thread_allocations();
+    for (auto _ : state) {
+        if (i % 4 == 0) {
+            fusion.addGravity(gravity, timestamp);
+        }
+        fusion.addGyroscope(gyro[i++ % SAMPLES].data(), timestamp);
+        timestamp += GYROSCOPE_PERIOD_NS;
+    }
+    reportAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(state.range(0) == static_cast<int64_t>(FusionAlgorithm::madgwick) ? "Madgwick" : "Mahony");
+}
+BENCHMARK(BM_OrientationFusion)->Arg(static_cast<int64_t>(FusionAlgorithm::madgwick))
+                               ->Arg(static_cast<int64_t>(FusionAlgorithm::mahony));
+
+// Arg: precision
+void BM_FormatJson(benchmark::State& state) {
+    static constexpr const char* KEYS[] = {"x", "y", "z"};
+    FixedPointFormat format;
+    format.setPrecision(static_cast<int>(state.range(0)));
+    const auto& values = samples<3>();
+    char buffer[256];
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(format.formatJson(buffer, sizeof(buffer), KEYS, values[i++ % SAMPLES].data(), 3));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatJson)->Arg(0)->Arg(2)->Arg(6);
+
+// Baseline for BM_FormatJson: truncating with std::pow and formatting with snprintf, as
+// before FixedPointFormat. Includes the truncation, which BM_FormatJson leaves to the
+// processor's vector path. Arg: precision
+void BM_FormatJsonSnprintf(benchmark::State& state) {
+    int precision = static_cast<int>(state.range(0));
+    float scale = static_cast<float>(std::pow(10, precision));
+    const auto& values = samples<3>();
+    char buffer[256];
+    size_t i = 0;
+    for (auto _ : state) {
+        const auto& v = values[i++ % SAMPLES];
+        float x = std::trunc(v[0] * scale) / scale;
+        float y = std::trunc(v[1] * scale) / scale;
+        float z = std::trunc(v[2] * scale) / scale;
+        benchmark::DoNotOptimize(std::snprintf(buffer, sizeof(buffer), "{\"x\":%.*f,\"y\":%.*f,\"z\":%.*f}",
+                                               precision, x, precision, y, precision, z));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FormatJsonSnprintf)->Arg(0)->Arg(2)->Arg(6);
+
+void BM_EncodeCbor(benchmark::State& state) {
+    static constexpr const char* KEYS[] = {"x", "y", "z"};
+    const auto& values = samples<3>();
+    char buffer[256];
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(encodeCbor(buffer, sizeof(buffer), KEYS, values[i++ % SAMPLES].data(), 3));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodeCbor);
+
+void BM_EncodePacked(benchmark::State& state) {
+    const auto& values = samples<3>();
+    char buffer[256];
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(encodePacked(buffer, sizeof(buffer), values[i++ % SAMPLES].data(), 3, true, 0));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_EncodePacked);
+
+// Through a feed, as the processors publish single samples
+void BM_PublishFeed(benchmark::State& state) {
+    Harness& h = harness();
+    const char payload[] = "{\"x\":0.12,\"y\":-0.03,\"z\":9.81}";
+    uint64_t allocations = allocation_counter::thread_allocations();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(h.wrapper->publish(h.feed, payload, sizeof(payload) - 1));
+    }
+    reportAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PublishFeed);
+
+// By topic, as batches, windows and messages from Kotlin are published
+void BM_PublishTopic(benchmark::State& state) {
+    Harness& h = harness();
+    const std::string topic = "bench/topic";
+    const std::string payload(static_cast<size_t>(state.range(0)), 'x');
+    uint64_t allocations = allocation_counter::thread_allocations();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(h.wrapper->publish(topic, payload, false, 0));
+    }
+    reportAllocations(state, allocations);
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_PublishTopic)->Arg(32)->Arg(1024);
+
+// Lines offered to the connection log, from one or more threads; those the writer cannot
+// keep up with are dropped and counted
+void BM_AsyncLoggerLog(benchmark::State& state) {
+    static std::unique_ptr<AsyncLogger> logger;
+    static std::string path;
+    if (state.thread_index() == 0) {
+        char directory[] = "/tmp/opensensor-bench-XXXXXX";
+        if (mkdtemp(directory) == nullptr) {
+            state.SkipWithError("mkdtemp failed");
+            return;
+        }
+        path = std::string(directory) + "/log.ring";
+        logger = std::make_unique<AsyncLogger>(path);
+    }
+    const std::string line = "TCP connect: 192.168.1.20:8883 - Success, thread " + std::to_string(state.thread_index());
+    uint64_t accepted = 0;
+    for (auto _ : state) {
+        accepted += logger->log(line) ? 1 : 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.counters["accepted"] = benchmark::Counter(static_cast<double>(accepted), benchmark::Counter::kIsRate);
+    if (state.thread_index() == 0) {
+        logger.reset();
+        std::remove(path.c_str());
+        std::remove(path.substr(0, path.rfind('/')).c_str());
+    }
+}
+BENCHMARK(BM_AsyncLoggerLog)->ThreadRange(1, 4)->UseRealTime();
+
+void BM_MetricsCounter(benchmark::State& state) {
+    static const metrics::Counter counter = metrics::counter("bench.counter");
+    for (auto _ : state) {
+        counter.add();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MetricsCounter)->ThreadRange(1, 4);
+
+void BM_MetricsHistogram(benchmark::State& state) {
+    static const metrics::Histogram histogram = metrics::histogram("bench.histogram_us");
+    uint64_t value = 1;
+    for (auto _ : state) {
+        histogram.record(value);
+        value = value * 7 % 100003;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MetricsHistogram)->ThreadRange(1, 4);
+
+// Taking a trace id and recording a span per sample, with 1 in 1 traced
+void BM_PipelineTraceSpan(benchmark::State& state) {
+    if (state.thread_index() == 0) {
+        pipeline_trace::start(1);
+    }
+    int64_t begin = pipeline_trace::now_ns();
+    for (auto _ : state) {
+        pipeline_trace::span("bench", pipeline_trace::sample(), begin, begin + 1000);
+    }
+    if (state.thread_index() == 0) {
+        pipeline_trace::stop();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PipelineTraceSpan)->ThreadRange(1, 4);
+
+}
+
+int main(int argc, char** argv) {
+    platform_log::set_min_level(platform_log::level::error);
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::AddCustomContext("allocation_counting", allocation_counter::enabled() ? "on" : "off");
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
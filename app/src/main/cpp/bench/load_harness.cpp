@@ -0,0 +1,508 @@
+// Sustained-load harness for the native pipeline on a development machine. Synthetic sensor
+// streams at fixed rates go through the real processors and MqttClientWrapper to the broker
+// stand-in of loopback_broker.h, over plain TCP or TLS and at QoS 0 or 1, optionally with a
+// slow broker or dropped connections. Each run reports the rate published, the latency from
+// sample timestamp to the broker reading the message (QoS 0) or acknowledging it (QoS 1),
+// samples lost at each stage, the backlog left when the sensors stopped and the memory
+// high-water mark.
+//
+// Without --rates, the rate per sensor doubles from 100/s until a run is not sustained: the
+// source fell behind, some sample was lost, or the backlog at the end exceeded a tenth of a
+// second of samples. The last sustained rate is the capacity of that configuration.
+//
+// Built by the host CMake build as load_harness:
+//
+//     load_harness [--sensors accelerometer,gyroscope,gravity] [--transport tcp|tls|both]
+//                  [--qos 0|1|both] [--rates 100,200,...] [--max-rate 102400] [--seconds 5]
+//                  [--queue 256] [--window0 128] [--window1 32] [--read-delay-us 0]
+//                  [--ack-delay-us 0] [--disconnect-every-ms 0] [--trace file.json]
+//                  [--trace-every 100] [--json]
+//
+// --trace records the stages of 1 in --trace-every samples (pipeline_trace.h) and writes the
+// latest of them as a Chrome trace when done, for Perfetto or chrome://tracing.
+// Queue and window sizes default to the app's. Each sample carries a sequence number in place
+// of its first value, by which the broker side finds the sample's timestamp.
+
+#include "loopback_broker.h"
+#include "metrics.h"
+#include "mqtt_client_wrapper.h"
+#include "pipeline_trace.h"
+#include "platform_log.h"
+#include "sensor_processor.h"
+#include "synthetic_sensor_source.h"
+#include <sys/resource.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr const char* SENSOR_NAMES[SENSOR_KIND_COUNT] = {"accelerometer", "gyroscope", "gravity", "light",
+                                                         "temperature"};
+// Sequence numbers wrap where floats stop holding integers exactly
+constexpr uint32_t SEQUENCE_WRAP = 1u << 24;
+// Samples whose timestamp is kept per stream; older ones arriving are counted as untimed
+constexpr size_t TIMED_SAMPLES = 1 << 16;
+
+struct config {
+    std::vector<SensorKind> sensors{SensorKind::accelerometer, SensorKind::gyroscope, SensorKind::gravity};
+    std::vector<bool> tls{false, true};
+    std::vector<int> qos{0, 1};
+    std::vector<int> rates;
+    int max_rate = 102400;
+    int seconds = 5;
+    size_t queue = 256;
+    size_t window0 = 128;
+    size_t window1 = 32;
+    LoopbackBroker::options broker;
+    std::string trace_path;
+    uint32_t trace_every = 100;
+    bool json = false;
+};
+
+struct result {
+    bool tls;
+    int qos;
+    int rate; // Per sensor
+    size_t sensors;
+    double seconds;
+    uint64_t offered;
+    uint64_t received;
+    uint64_t duplicates;
+    uint64_t untimed;
+    // Lost on the way, by where
+    uint64_t refused;      // Processor could not hand the sample over
+    uint64_t feed_drops;   // Feed queue full
+    uint64_t window_drops; // Rejected, dropped or coalesced by the in-flight window
+    uint64_t publish_errors;
+    // Generated but not yet received when the sensors stopped, and the time to clear it
+    uint64_t backlog;
+    double drain_s;
+    int64_t max_queue_depth;
+    uint64_t reconnects;
+    uint32_t p50_us, p90_us, p99_us, p999_us, max_us;
+    double rss_start_mb, rss_peak_mb;
+
+    uint64_t lost() const { return offered > received - duplicates ? offered - (received - duplicates) : 0; }
+    // Within 5% of the rate asked for, nothing lost and at most a tenth of a second queued
+    bool sustained() const {
+        double per_second = static_cast<double>(rate) * static_cast<double>(sensors);
+        return static_cast<double>(offered) >= 0.95 * per_second * seconds && lost() == 0 &&
+               static_cast<double>(backlog) <= std::max(0.1 * per_second, 10.0);
+    }
+};
+
+// Timestamps of recent samples of one sensor, written by the source thread and read by the
+// broker thread. The sequence number is stored after the timestamp and checked on both sides
+// of reading it, so an entry overwritten meanwhile is not used.
+struct timed_stream {
+    std::string topic;
+    uint32_t next = 0; // Source thread only
+    std::unique_ptr<std::atomic<int64_t>[]> timestamps{new std::atomic<int64_t>[TIMED_SAMPLES]()};
+    std::unique_ptr<std::atomic<uint32_t>[]> sequences{new std::atomic<uint32_t>[TIMED_SAMPLES]()};
+    // Sequence number + 1 of the last message received in each slot; broker thread only
+    std::vector<uint32_t> received = std::vector<uint32_t>(TIMED_SAMPLES);
+};
+
+struct receipts {
+    std::mutex mutex;
+    std::vector<uint32_t> latency_us;
+    uint64_t received = 0;
+    uint64_t duplicates = 0;
+    uint64_t untimed = 0;
+};
+
+double resident_mb() {
+    std::FILE* statm = std::fopen("/proc/self/statm", "r");
+    long pages = 0, resident = 0;
+    if (statm != nullptr) {
+        if (std::fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = 0;
+        std::fclose(statm);
+    }
+    return static_cast<double>(resident) * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1024.0 * 1024.0);
+}
+
+uint64_t counter_value(const std::string& name) {
+    return metrics::counter(name).value();
+}
+
+// Sum of the counters the run affects, read before and after it
+struct loss_counters {
+    uint64_t refused = 0, feed_drops = 0, window_drops = 0, publish_errors = 0;
+
+    static loss_counters read(const config& cfg) {
+        loss_counters c;
+        for (SensorKind kind : cfg.sensors) {
+            c.refused += counter_value(std::string("load.") + SENSOR_NAMES[static_cast<int>(kind)] + ".publish_failed");
+        }
+        c.feed_drops = counter_value("mqtt.feed_drops");
+        c.window_drops = counter_value("mqtt.window_rejected") + counter_value("mqtt.window_dropped") +
+                         counter_value("mqtt.window_coalesced");
+        c.publish_errors = counter_value("mqtt.publish_errors");
+        return c;
+    }
+};
+
+uint32_t percentile(const std::vector<uint32_t>& sorted, double p) {
+    if (sorted.empty()) return 0;
+    auto rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+result run(const config& cfg, bool tls, int qos, int rate) {
+    std::vector<std::unique_ptr<timed_stream>> streams(SENSOR_KIND_COUNT);
+    for (SensorKind kind : cfg.sensors) {
+        auto& stream = streams[static_cast<int>(kind)];
+        stream = std::make_unique<timed_stream>();
+        stream->topic = std::string("load/") + SENSOR_NAMES[static_cast<int>(kind)];
+    }
+
+    receipts got;
+    LoopbackBroker::options broker_options = cfg.broker;
+    broker_options.tls = tls;
+    LoopbackBroker broker(broker_options, [&](std::string_view topic, std::string_view payload, int) {
+        auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now().time_since_epoch()).count();
+        timed_stream* stream = nullptr;
+        for (auto& s : streams) {
+            if (s && s->topic == topic) stream = s.get();
+        }
+        // {"x":<sequence>,...} or {"value":<sequence>}
+        size_t colon = payload.find(':');
+        if (stream == nullptr || colon == std::string_view::npos) return;
+        auto sequence = static_cast<uint32_t>(std::strtoul(std::string(payload.substr(colon + 1, 10)).c_str(),
+                                                           nullptr, 10));
+        size_t slot = sequence % TIMED_SAMPLES;
+
+        std::lock_guard<std::mutex> lock(got.mutex);
+        ++got.received;
+        if (stream->received[slot] == sequence + 1) {
+            ++got.duplicates;
+            return;
+        }
+        stream->received[slot] = sequence + 1;
+        uint32_t written = stream->sequences[slot].load(std::memory_order_acquire);
+        int64_t sent = stream->timestamps[slot].load(std::memory_order_acquire);
+        if (written != sequence || stream->sequences[slot].load(std::memory_order_acquire) != sequence) {
+            ++got.untimed;
+            return;
+        }
+        got.latency_us.push_back(static_cast<uint32_t>(std::clamp<int64_t>((now - sent) / 1000, 0, UINT32_MAX)));
+    });
+
+    // Declared after the broker and before the processors, which publish through it
+    MqttClientWrapper wrapper("");
+    wrapper.set_feed_options(cfg.queue, MqttClientWrapper::overflow_policy::drop_newest);
+    wrapper.set_in_flight_window(cfg.window0, cfg.window1, MqttClientWrapper::window_policy::reject);
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool connected = false;
+    wrapper.set_status_callback([&](const std::string& status, const std::string&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        connected = status == "CONNECTED";
+        changed.notify_all();
+    });
+
+    std::unique_ptr<ThreeAxisSensorProcessor> three_axis[3];
+    std::unique_ptr<ScalarSensorProcessor> scalar[2];
+    for (SensorKind kind : cfg.sensors) {
+        int index = static_cast<int>(kind);
+        std::string name = std::string("load.") + SENSOR_NAMES[index];
+        // Whole numbers, every sample published as JSON
+        if (index < 3) {
+            three_axis[index] = std::make_unique<ThreeAxisSensorProcessor>(&wrapper, name, streams[index]->topic);
+            three_axis[index]->updateSettings({1.0f, 1.0f, 1.0f}, 0, 0, 0, ChangeDetectionSettings{}, 0, 0,
+                                              PayloadEncoding::json, MqttClientWrapper::feed_mode::stream);
+            three_axis[index]->setQos(qos);
+        } else {
+            scalar[index - 3] = std::make_unique<ScalarSensorProcessor>(&wrapper, name, streams[index]->topic);
+            scalar[index - 3]->updateSettings({1.0f}, 0, 0, 0, ChangeDetectionSettings{}, 0, 0,
+                                              PayloadEncoding::json, MqttClientWrapper::feed_mode::stream);
+            scalar[index - 3]->setQos(qos);
+        }
+    }
+
+    wrapper.connect(broker.url(), "load_harness", "", "");
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!changed.wait_for(lock, std::chrono::seconds(10), [&] { return connected; })) {
+            std::fprintf(stderr, "No connection to the loopback broker\n");
+            std::exit(1);
+        }
+    }
+
+    result r{};
+    r.tls = tls;
+    r.qos = qos;
+    r.rate = rate;
+    r.sensors = cfg.sensors.size();
+    r.rss_start_mb = resident_mb();
+    r.rss_peak_mb = r.rss_start_mb;
+    loss_counters before = loss_counters::read(cfg);
+    metrics::Gauge queue_depth = metrics::gauge("mqtt.feed_queue_depth");
+    metrics::Gauge held[2] = {metrics::gauge("mqtt.held.qos0"), metrics::gauge("mqtt.held.qos1")};
+
+    SyntheticSensorSource source(true);
+    for (SensorKind kind : cfg.sensors) {
+        source.enable(kind, std::max(1, 1000000 / rate));
+    }
+    auto started = clock_type::now();
+    source.start([&](const SensorSample* samples, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            const SensorSample& sample = samples[i];
+            int index = static_cast<int>(sample.kind);
+            timed_stream& stream = *streams[index];
+            uint32_t sequence = stream.next;
+            stream.next = (stream.next + 1) % SEQUENCE_WRAP;
+            size_t slot = sequence % TIMED_SAMPLES;
+            stream.sequences[slot].store(UINT32_MAX, std::memory_order_release);
+            stream.timestamps[slot].store(sample.timestamp, std::memory_order_release);
+            stream.sequences[slot].store(sequence, std::memory_order_release);
+
+            auto value = static_cast<float>(sequence);
+            if (index < 3) {
+                three_axis[index]->processData({value, sample.values[1], sample.values[2]}, sample.timestamp);
+            } else {
+                scalar[index - 3]->processData({value}, sample.timestamp);
+            }
+        }
+    });
+
+    auto deadline = started + std::chrono::seconds(cfg.seconds);
+    while (clock_type::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        r.rss_peak_mb = std::max(r.rss_peak_mb, resident_mb());
+        r.max_queue_depth = std::max(r.max_queue_depth, queue_depth.value() + held[0].value() + held[1].value());
+    }
+    source.stop();
+    r.seconds = std::chrono::duration<double>(clock_type::now() - started).count();
+    r.offered = source.samplesDelivered();
+    {
+        std::lock_guard<std::mutex> lock(got.mutex);
+        uint64_t unique = got.received - got.duplicates;
+        r.backlog = r.offered > unique ? r.offered - unique : 0;
+    }
+
+    // Wait for what is still queued, until nothing arrives for half a second
+    auto drain_started = clock_type::now();
+    uint64_t last = UINT64_MAX;
+    auto quiet_since = drain_started;
+    while (clock_type::now() - drain_started < std::chrono::seconds(10)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        uint64_t now_received;
+        {
+            std::lock_guard<std::mutex> lock(got.mutex);
+            now_received = got.received - got.duplicates;
+        }
+        if (now_received >= r.offered) {
+            quiet_since = clock_type::now();
+            break;
+        }
+        if (now_received != last) {
+            last = now_received;
+            quiet_since = clock_type::now();
+        } else if (clock_type::now() - quiet_since > std::chrono::milliseconds(500)) {
+            break;
+        }
+    }
+    r.drain_s = std::chrono::duration<double>(quiet_since - drain_started).count();
+    r.rss_peak_mb = std::max(r.rss_peak_mb, resident_mb());
+
+    loss_counters after = loss_counters::read(cfg);
+    r.refused = after.refused - before.refused;
+    r.feed_drops = after.feed_drops - before.feed_drops;
+    r.window_drops = after.window_drops - before.window_drops;
+    r.publish_errors = after.publish_errors - before.publish_errors;
+    r.reconnects = broker.connections() > 0 ? broker.connections() - 1 : 0;
+
+    wrapper.disconnect();
+    for (auto& p : three_axis) p.reset();
+    for (auto& p : scalar) p.reset();
+
+    std::lock_guard<std::mutex> lock(got.mutex);
+    r.received = got.received;
+    r.duplicates = got.duplicates;
+    r.untimed = got.untimed;
+    std::sort(got.latency_us.begin(), got.latency_us.end());
+    r.p50_us = percentile(got.latency_us, 0.50);
+    r.p90_us = percentile(got.latency_us, 0.90);
+    r.p99_us = percentile(got.latency_us, 0.99);
+    r.p999_us = percentile(got.latency_us, 0.999);
+    r.max_us = got.latency_us.empty() ? 0 : got.latency_us.back();
+    return r;
+}
+
+void print_header() {
+    std::printf("%-4s %3s %8s %10s %10s %8s %8s %8s %8s %8s %8s %8s %8s %8s %6s %8s  %s\n",
+                "link", "qos", "rate/s", "offered/s", "publish/s", "lost", "refused", "feed", "window",
+                "p50 ms", "p99 ms", "p99.9 ms", "max ms", "backlog", "reconn", "rss MB", "result");
+}
+
+void print(const result& r, size_t sensors) {
+    double ms = 1e-3;
+    std::printf("%-4s %3d %8d %10.0f %10.0f %8llu %8llu %8llu %8llu %8.2f %8.2f %8.2f %8.2f %8llu %6llu %8.1f  %s\n",
+                r.tls ? "tls" : "tcp", r.qos, r.rate * static_cast<int>(sensors),
+                static_cast<double>(r.offered) / r.seconds,
+                static_cast<double>(r.received - r.duplicates) / r.seconds,
+                static_cast<unsigned long long>(r.lost()), static_cast<unsigned long long>(r.refused),
+                static_cast<unsigned long long>(r.feed_drops), static_cast<unsigned long long>(r.window_drops),
+                r.p50_us * ms, r.p99_us * ms, r.p999_us * ms, r.max_us * ms,
+                static_cast<unsigned long long>(r.backlog), static_cast<unsigned long long>(r.reconnects),
+                r.rss_peak_mb, r.sustained() ? "sustained" : "saturated");
+    std::fflush(stdout);
+}
+
+void print_json(const result& r, size_t sensors) {
+    std::printf("{\"transport\":\"%s\",\"qos\":%d,\"sensors\":%zu,\"rate_per_sensor\":%d,\"seconds\":%.3f,"
+                "\"offered\":%llu,\"received\":%llu,\"duplicates\":%llu,\"untimed\":%llu,\"lost\":%llu,"
+                "\"refused\":%llu,\"feed_drops\":%llu,\"window_drops\":%llu,\"publish_errors\":%llu,"
+                "\"backlog\":%llu,\"drain_s\":%.3f,\"max_queue_depth\":%lld,\"reconnects\":%llu,"
+                "\"latency_us\":{\"p50\":%u,\"p90\":%u,\"p99\":%u,\"p999\":%u,\"max\":%u},"
+                "\"rss_start_mb\":%.1f,\"rss_peak_mb\":%.1f,\"sustained\":%s}\n",
+                r.tls ? "tls" : "tcp", r.qos, sensors, r.rate, r.seconds,
+                static_cast<unsigned long long>(r.offered), static_cast<unsigned long long>(r.received),
+                static_cast<unsigned long long>(r.duplicates), static_cast<unsigned long long>(r.untimed),
+                static_cast<unsigned long long>(r.lost()), static_cast<unsigned long long>(r.refused),
+                static_cast<unsigned long long>(r.feed_drops), static_cast<unsigned long long>(r.window_drops),
+                static_cast<unsigned long long>(r.publish_errors), static_cast<unsigned long long>(r.backlog),
+                r.drain_s, static_cast<long long>(r.max_queue_depth), static_cast<unsigned long long>(r.reconnects),
+                r.p50_us, r.p90_us, r.p99_us, r.p999_us, r.max_us, r.rss_start_mb, r.rss_peak_mb,
+                r.sustained() ? "true" : "false");
+    std::fflush(stdout);
+}
+
+std::vector<std::string> split(const std::string& list) {
+    std::vector<std::string> items;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) comma = list.size();
+        if (comma > start) items.push_back(list.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return items;
+}
+
+[[noreturn]] void usage(const char* message) {
+    std::fprintf(stderr, "%s\nSee the comment at the top of bench/load_harness.cpp for the options.\n", message);
+    std::exit(2);
+}
+
+config parse(int argc, char** argv) {
+    config cfg;
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--json") {
+            cfg.json = true;
+            continue;
+        }
+        if (i + 1 >= argc) usage(("Missing value for " + option).c_str());
+        std::string value = argv[++i];
+        if (option == "--sensors") {
+            cfg.sensors.clear();
+            for (const std::string& name : split(value)) {
+                auto found = std::find_if(std::begin(SENSOR_NAMES), std::end(SENSOR_NAMES),
+                                          [&](const char* n) { return name == n; });
+                if (found == std::end(SENSOR_NAMES)) usage(("Unknown sensor " + name).c_str());
+                cfg.sensors.push_back(static_cast<SensorKind>(found - std::begin(SENSOR_NAMES)));
+            }
+        } else if (option == "--transport") {
+            cfg.tls = value == "tcp" ? std::vector<bool>{false} : value == "tls" ? std::vector<bool>{true}
+                                                                                   : std::vector<bool>{false, true};
+        } else if (option == "--qos") {
+            cfg.qos = value == "0" ? std::vector<int>{0} : value == "1" ? std::vector<int>{1} : std::vector<int>{0, 1};
+        } else if (option == "--rates") {
+            for (const std::string& rate : split(value)) {
+                cfg.rates.push_back(std::max(1, std::atoi(rate.c_str())));
+            }
+        } else if (option == "--max-rate") {
+            cfg.max_rate = std::max(1, std::atoi(value.c_str()));
+        } else if (option == "--seconds") {
+            cfg.seconds = std::max(1, std::atoi(value.c_str()));
+        } else if (option == "--queue") {
+            cfg.queue = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+        } else if (option == "--window0") {
+            cfg.window0 = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+        } else if (option == "--window1") {
+            cfg.window1 = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+        } else if (option == "--read-delay-us") {
+            cfg.broker.read_delay = std::chrono::microseconds(std::atoi(value.c_str()));
+        } else if (option == "--ack-delay-us") {
+            cfg.broker.ack_delay = std::chrono::microseconds(std::atoi(value.c_str()));
+        } else if (option == "--trace") {
+            cfg.trace_path = value;
+        } else if (option == "--trace-every") {
+            cfg.trace_every = static_cast<uint32_t>(std::max(1, std::atoi(value.c_str())));
+        } else if (option == "--disconnect-every-ms") {
+            cfg.broker.disconnect_every = std::chrono::milliseconds(std::atoi(value.c_str()));
+        } else {
+            usage(("Unknown option " + option).c_str());
+        }
+    }
+    if (cfg.sensors.empty()) usage("No sensors");
+    return cfg;
+}
+
+}
+
+int main(int argc, char** argv) {
+    config cfg = parse(argc, argv);
+    // Injected disconnects would otherwise fill the terminal
+    platform_log::set_min_level(platform_log::level::error);
+
+    if (!cfg.trace_path.empty()) {
+        pipeline_trace::start(cfg.trace_every);
+    }
+    if (!cfg.json) {
+        std::printf("%zu sensors, %d s per run; rates are totals over all sensors\n", cfg.sensors.size(), cfg.seconds);
+        print_header();
+    }
+    for (bool tls : cfg.tls) {
+        for (int qos : cfg.qos) {
+            int capacity = 0;
+            std::vector<int> rates = cfg.rates;
+            bool sweep = rates.empty();
+            if (sweep) {
+                for (int rate = 100; rate <= cfg.max_rate; rate *= 2) rates.push_back(rate);
+            }
+            for (int rate : rates) {
+                result r = run(cfg, tls, qos, rate);
+                if (cfg.json) {
+                    print_json(r, cfg.sensors.size());
+                } else {
+                    print(r, cfg.sensors.size());
+                }
+                if (r.sustained()) {
+                    capacity = std::max(capacity, rate);
+                } else if (sweep) {
+                    break;
+                }
+            }
+            if (!cfg.json) {
+                std::printf("%s QoS %d: sustained up to %d samples/s per sensor\n", tls ? "TLS" : "TCP", qos,
+                            capacity);
+            }
+        }
+    }
+
+    if (!cfg.trace_path.empty() && !pipeline_trace::write_chrome_json(cfg.trace_path)) {
+        std::fprintf(stderr, "Cannot write %s\n", cfg.trace_path.c_str());
+    }
+
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    if (!cfg.json) {
+        std::printf("Peak resident memory of the process: %.1f MB\n", static_cast<double>(usage.ru_maxrss) / 1024.0);
+    }
+    return 0;
+}
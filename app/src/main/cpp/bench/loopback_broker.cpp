@@ -0,0 +1,359 @@
+#include "loopback_broker.h"
+#include <boost/asio/ip/address_v4.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/asio/write.hpp>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <type_traits>
+
+namespace {
+
+// Mosquitto's default
+constexpr uint16_t TOPIC_ALIAS_MAXIMUM = 10;
+
+// CONNACK: no session present, success, Topic Alias Maximum property
+constexpr char CONNACK[] = {0x20, 0x06, 0x00, 0x00, 0x03, 0x22, 0x00, static_cast<char>(TOPIC_ALIAS_MAXIMUM)};
+constexpr char PINGRESP[] = {static_cast<char>(0xd0), 0x00};
+
+// Certificate for 127.0.0.1, valid for a day; the client does not verify it
+void use_self_signed_certificate(SSL_CTX* ctx) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* certificate = X509_new();
+    bool ok = key != nullptr && certificate != nullptr;
+    if (ok) {
+        X509_set_version(certificate, 2);
+        ASN1_INTEGER_set(X509_get_serialNumber(certificate), 1);
+        X509_gmtime_adj(X509_getm_notBefore(certificate), 0);
+        X509_gmtime_adj(X509_getm_notAfter(certificate), 24 * 60 * 60);
+        X509_set_pubkey(certificate, key);
+        X509_NAME* name = X509_get_subject_name(certificate);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("127.0.0.1"),
+                                   -1, -1, 0);
+        X509_set_issuer_name(certificate, name);
+        ok = X509_sign(certificate, key, EVP_sha256()) > 0 && SSL_CTX_use_certificate(ctx, certificate) == 1 &&
+             SSL_CTX_use_PrivateKey(ctx, key) == 1;
+    }
+    X509_free(certificate);
+    EVP_PKEY_free(key);
+    if (!ok) {
+        std::fprintf(stderr, "loopback broker: cannot create a certificate\n");
+        std::exit(1);
+    }
+}
+
+// Reads a Variable Byte Integer; returns its length in bytes, or 0 if it is incomplete
+size_t read_varint(const std::string& buffer, size_t at, size_t& value) {
+    value = 0;
+    for (size_t i = 0; i < 4 && at + i < buffer.size(); ++i) {
+        auto byte = static_cast<uint8_t>(buffer[at + i]);
+        value |= static_cast<size_t>(byte & 0x7f) << (7 * i);
+        if ((byte & 0x80) == 0) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+uint16_t read_u16(const std::string& buffer, size_t at) {
+    return static_cast<uint16_t>(static_cast<uint8_t>(buffer[at]) << 8 | static_cast<uint8_t>(buffer[at + 1]));
+}
+
+// Topic Alias of the properties of a PUBLISH, or 0. Only properties allowed in PUBLISH occur.
+uint16_t find_topic_alias(const std::string& buffer, size_t at, size_t end) {
+    while (at < end) {
+        uint8_t id = static_cast<uint8_t>(buffer[at++]);
+        size_t length;
+        switch (id) {
+            case 0x01: // Payload Format Indicator
+                at += 1;
+                break;
+            case 0x02: // Message Expiry Interval
+                at += 4;
+                break;
+            case 0x23: // Topic Alias
+                return at + 2 <= end ? read_u16(buffer, at) : 0;
+            case 0x03: // Content Type
+            case 0x08: // Response Topic
+            case 0x09: // Correlation Data
+                if (at + 2 > end) return 0;
+                at += 2 + read_u16(buffer, at);
+                break;
+            case 0x0b: // Subscription Identifier
+                at += read_varint(buffer, at, length);
+                break;
+            case 0x26: // User Property
+                for (int i = 0; i < 2 && at + 2 <= end; ++i) {
+                    at += 2 + read_u16(buffer, at);
+                }
+                break;
+            default:
+                return 0;
+        }
+    }
+    return 0;
+}
+
+}
+
+class LoopbackBroker::session {
+public:
+    virtual ~session() = default;
+    // False if it was closed already
+    virtual bool close() = 0;
+};
+
+template<typename Stream>
+class LoopbackBroker::stream_session : public LoopbackBroker::session,
+                                       public std::enable_shared_from_this<stream_session<Stream>> {
+public:
+    template<typename... Args>
+    explicit stream_session(LoopbackBroker& broker, Args&&... args)
+        : broker_(broker), stream_(std::forward<Args>(args)...), read_timer_(broker.ioc_) {}
+
+    void start() {
+        if constexpr (std::is_same_v<Stream, boost::asio::ssl::stream<boost::asio::ip::tcp::socket>>) {
+            stream_.async_handshake(boost::asio::ssl::stream_base::server,
+                                    [self = this->shared_from_this()](boost::system::error_code ec) {
+                                        if (ec) {
+                                            self->close();
+                                        } else {
+                                            self->read();
+                                        }
+                                    });
+        } else {
+            read();
+        }
+    }
+
+    bool close() override {
+        if (closed_) return false;
+        closed_ = true;
+        boost::system::error_code ignored;
+        stream_.lowest_layer().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        stream_.lowest_layer().close(ignored);
+        read_timer_.cancel();
+        return true;
+    }
+
+private:
+    struct delayed_ack {
+        std::string topic;
+        std::string payload;
+        uint16_t packet_id;
+    };
+
+    void read() {
+        stream_.async_read_some(boost::asio::buffer(chunk_),
+                                [self = this->shared_from_this()](boost::system::error_code ec, size_t n) {
+                                    if (ec || self->closed_) {
+                                        self->close();
+                                        return;
+                                    }
+                                    self->broker_.reads_.fetch_add(1, std::memory_order_relaxed);
+                                    self->buffer_.append(self->chunk_.data(), n);
+                                    size_t publishes = self->handle();
+                                    auto delay = self->broker_.options_.read_delay;
+                                    if (publishes > 0 && delay.count() > 0) {
+                                        self->read_timer_.expires_after(delay * publishes);
+                                        self->read_timer_.async_wait([self](boost::system::error_code ec) {
+                                            if (!ec && !self->closed_) self->read();
+                                        });
+                                    } else {
+                                        self->read();
+                                    }
+                                });
+    }
+
+    // Handles the complete packets in buffer_; returns the number of PUBLISH packets
+    size_t handle() {
+        size_t at = 0;
+        size_t publishes = 0;
+        std::vector<delayed_ack> delayed;
+        while (at + 2 <= buffer_.size()) {
+            size_t remaining;
+            size_t length_bytes = read_varint(buffer_, at + 1, remaining);
+            if (length_bytes == 0 || at + 1 + length_bytes + remaining > buffer_.size()) break;
+            size_t body = at + 1 + length_bytes;
+            size_t end = body + remaining;
+            auto first = static_cast<uint8_t>(buffer_[at]);
+            switch (first >> 4) {
+                case 1: // CONNECT
+                    send(std::string_view(CONNACK, sizeof(CONNACK)));
+                    break;
+                case 3: { // PUBLISH
+                    ++publishes;
+                    int qos = (first >> 1) & 3;
+                    size_t p = body + 2 + read_u16(buffer_, body);
+                    std::string topic(buffer_, body + 2, p - body - 2);
+                    uint16_t packet_id = 0;
+                    if (qos > 0) {
+                        packet_id = read_u16(buffer_, p);
+                        p += 2;
+                    }
+                    size_t properties;
+                    p += read_varint(buffer_, p, properties);
+                    uint16_t alias = find_topic_alias(buffer_, p, p + properties);
+                    p += properties;
+                    if (alias != 0 && alias <= TOPIC_ALIAS_MAXIMUM) {
+                        if (topic.empty()) {
+                            topic = aliases_[alias];
+                        } else {
+                            aliases_[alias] = topic;
+                        }
+                    }
+                    std::string_view payload(buffer_.data() + p, end - p);
+                    broker_.publishes_.fetch_add(1, std::memory_order_relaxed);
+                    if (qos == 0 || broker_.options_.ack_delay.count() == 0) {
+                        if (qos > 0) send_puback(packet_id);
+                        if (broker_.on_publish_) broker_.on_publish_(topic, payload, qos);
+                    } else {
+                        delayed.push_back({std::move(topic), std::string(payload), packet_id});
+                    }
+                    break;
+                }
+                case 12: // PINGREQ
+                    send(std::string_view(PINGRESP, sizeof(PINGRESP)));
+                    break;
+                case 14: // DISCONNECT
+                    close();
+                    return publishes;
+                default:
+                    break;
+            }
+            at = end;
+        }
+        buffer_.erase(0, at);
+
+        if (!delayed.empty()) {
+            auto timer = std::make_shared<boost::asio::steady_timer>(broker_.ioc_, broker_.options_.ack_delay);
+            timer->async_wait([self = this->shared_from_this(), timer, acks = std::move(delayed)](
+                    boost::system::error_code) {
+                if (self->closed_) return;
+                for (const delayed_ack& ack : acks) {
+                    self->send_puback(ack.packet_id);
+                    if (self->broker_.on_publish_) self->broker_.on_publish_(ack.topic, ack.payload, 1);
+                }
+            });
+        }
+        return publishes;
+    }
+
+    void send_puback(uint16_t packet_id) {
+        const char puback[] = {0x40, 0x02, static_cast<char>(packet_id >> 8), static_cast<char>(packet_id & 0xff)};
+        send(std::string_view(puback, sizeof(puback)));
+    }
+
+    void send(std::string_view bytes) {
+        outbox_.append(bytes);
+        write();
+    }
+
+    void write() {
+        if (writing_ || closed_ || outbox_.empty()) return;
+        writing_ = true;
+        sending_.swap(outbox_);
+        boost::asio::async_write(stream_, boost::asio::buffer(sending_),
+                                 [self = this->shared_from_this()](boost::system::error_code ec, size_t) {
+                                     self->writing_ = false;
+                                     self->sending_.clear();
+                                     if (ec) {
+                                         self->close();
+                                     } else {
+                                         self->write();
+                                     }
+                                 });
+    }
+
+    LoopbackBroker& broker_;
+    Stream stream_;
+    boost::asio::steady_timer read_timer_;
+    std::array<char, 16384> chunk_{};
+    std::string buffer_;
+    std::string outbox_;
+    std::string sending_;
+    bool writing_ = false;
+    bool closed_ = false;
+    std::array<std::string, TOPIC_ALIAS_MAXIMUM + 1> aliases_;
+};
+
+LoopbackBroker::LoopbackBroker() : LoopbackBroker(options{}) {}
+
+LoopbackBroker::LoopbackBroker(const options& opts, publish_handler on_publish)
+    : options_(opts), on_publish_(std::move(on_publish)) {
+    using boost::asio::ip::tcp;
+    if (options_.tls) {
+        use_self_signed_certificate(tls_context_.native_handle());
+    }
+    acceptor_.open(tcp::v4());
+    acceptor_.set_option(tcp::acceptor::reuse_address(true));
+    acceptor_.bind(tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    acceptor_.listen();
+    port_ = acceptor_.local_endpoint().port();
+
+    accept();
+    schedule_disconnect();
+    thread_ = std::thread([this] { ioc_.run(); });
+}
+
+LoopbackBroker::~LoopbackBroker() {
+    // Runs out of work once nothing is open, which ends the thread
+    boost::asio::post(ioc_, [this] {
+        boost::system::error_code ignored;
+        acceptor_.close(ignored);
+        disconnect_timer_.cancel();
+        for (auto& weak : sessions_) {
+            if (auto s = weak.lock()) s->close();
+        }
+    });
+    thread_.join();
+}
+
+std::string LoopbackBroker::url() const {
+    return std::string(options_.tls ? "mqtts" : "mqtt") + "://127.0.0.1:" + std::to_string(port_);
+}
+
+void LoopbackBroker::accept() {
+    acceptor_.async_accept([this](boost::system::error_code ec, boost::asio::ip::tcp::socket socket) {
+        if (ec) return; // Closed
+        boost::system::error_code ignored;
+        socket.set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+        connections_.fetch_add(1, std::memory_order_relaxed);
+
+        std::shared_ptr<session> opened;
+        if (options_.tls) {
+            auto s = std::make_shared<stream_session<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>>>(
+                    *this, std::move(socket), tls_context_);
+            s->start();
+            opened = s;
+        } else {
+            auto s = std::make_shared<stream_session<boost::asio::ip::tcp::socket>>(*this, std::move(socket));
+            s->start();
+            opened = s;
+        }
+        sessions_.erase(std::remove_if(sessions_.begin(), sessions_.end(),
+                                       [](const std::weak_ptr<session>& s) { return s.expired(); }),
+                        sessions_.end());
+        sessions_.push_back(opened);
+        accept();
+    });
+}
+
+void LoopbackBroker::schedule_disconnect() {
+    if (options_.disconnect_every.count() <= 0) return;
+    disconnect_timer_.expires_after(options_.disconnect_every);
+    disconnect_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        for (auto& weak : sessions_) {
+            auto s = weak.lock();
+            if (s && s->close()) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        schedule_disconnect();
+    });
+}
@@ -0,0 +1,87 @@
+#ifndef OPEN_SENSOR_LOOPBACK_BROKER_H
+#define OPEN_SENSOR_LOOPBACK_BROKER_H
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// MQTT 5 broker stand-in on a loopback port, for the host benchmarks and the load harness.
+// Accepts plain TCP, or TLS with a self-signed certificate made at startup, answers CONNECT
+// (offering topic aliases), PINGREQ and QoS 1 PUBLISH, and passes every PUBLISH to a handler.
+// It keeps no sessions and routes nothing.
+//
+// A slow consumer and a flaky link can be imitated: reading pauses after each PUBLISH, so the
+// client's socket and queues back up, PUBACKs can be held back, and the connection can be
+// dropped at an interval, after which the client reconnects.
+class LoopbackBroker {
+public:
+    struct options {
+        bool tls = false;
+        // Pause in reading after each PUBLISH, which caps the rate taken at 1 / read_delay
+        std::chrono::microseconds read_delay{0};
+        // Time from receiving a QoS 1 PUBLISH to acknowledging it
+        std::chrono::microseconds ack_delay{0};
+        // Drops every connection this often; 0 never
+        std::chrono::milliseconds disconnect_every{0};
+    };
+
+    // Called on the broker's thread for each PUBLISH: as it is read at QoS 0 and as its
+    // PUBACK is written at QoS 1. Topic aliases are resolved.
+    using publish_handler = std::function<void(std::string_view topic, std::string_view payload, int qos)>;
+
+    LoopbackBroker();
+    explicit LoopbackBroker(const options& opts, publish_handler on_publish = {});
+    ~LoopbackBroker();
+
+    LoopbackBroker(const LoopbackBroker&) = delete;
+    LoopbackBroker& operator=(const LoopbackBroker&) = delete;
+
+    uint16_t port() const { return port_; }
+    // mqtt:// or mqtts:// URL for MqttClientWrapper::connect
+    std::string url() const;
+
+    uint64_t connections() const { return connections_.load(std::memory_order_relaxed); }
+    uint64_t publishes() const { return publishes_.load(std::memory_order_relaxed); }
+    // Socket reads that returned data, over all connections; with TLS, reads of records
+    uint64_t reads() const { return reads_.load(std::memory_order_relaxed); }
+    // Connections dropped by disconnect_every
+    uint64_t dropped_connections() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    class session;
+    template<typename Stream>
+    class stream_session;
+
+    void accept();
+    void schedule_disconnect();
+
+    const options options_;
+    const publish_handler on_publish_;
+
+    boost::asio::io_context ioc_;
+    boost::asio::ssl::context tls_context_{boost::asio::ssl::context::tls_server};
+    boost::asio::ip::tcp::acceptor acceptor_{ioc_};
+    boost::asio::steady_timer disconnect_timer_{ioc_};
+    uint16_t port_ = 0;
+    // Open connections; broker thread only
+    std::vector<std::weak_ptr<session>> sessions_;
+
+    std::atomic<uint64_t> connections_{0};
+    std::atomic<uint64_t> publishes_{0};
+    std::atomic<uint64_t> reads_{0};
+    std::atomic<uint64_t> dropped_{0};
+
+    std::thread thread_;
+};
+
+#endif //OPEN_SENSOR_LOOPBACK_BROKER_H
@@ -0,0 +1,157 @@
+// Host benchmark for the payload encodings: bytes per sample, both the payload alone and the
+// whole MQTT 5 PUBLISH packet, and encoding time, for a three-axis and a scalar sensor at a
+// few rounding precisions. Every encoded sample is decoded again with the reference decoder
+// and checked against its input.
+//
+// Not part of the Android build; the host CMake build makes a target of the same name.
+// By hand, from app/src/main/cpp:
+//
+//     g++ -std=c++17 -O2 -I. bench/payload_benchmark.cpp binary_payload.cpp payload_format.cpp series_codec.cpp -o payload_benchmark
+//     ./payload_benchmark [samples]
+
+#include "binary_payload.h"
+#include "payload_format.h"
+#include "series_codec.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr const char* TOPIC = "opensensor/phone/accelerometer";
+
+size_t varintLength(size_t value) {
+    size_t length = 1;
+    while (value >= 128) {
+        value >>= 7;
+        ++length;
+    }
+    return length;
+}
+
+// QoS 0 PUBLISH with the content type and payload format indicator the client sends
+size_t packetLength(PayloadEncoding encoding, size_t payload) {
+    size_t properties = 1 + 2 + std::strlen(contentType(encoding)) + 2;
+    size_t remaining = 2 + std::strlen(TOPIC) + varintLength(properties) + properties + payload;
+    return 1 + varintLength(remaining) + remaining;
+}
+
+struct Result {
+    double payloadBytes = 0.0;
+    double packetBytes = 0.0;
+    double nsPerSample = 0.0;
+    bool roundTrip = true;
+};
+
+Result run(PayloadEncoding encoding, const char* const keys[], size_t channels, int precision,
+           const std::vector<float>& samples) {
+    FixedPointFormat format;
+    format.setPrecision(precision);
+    size_t count = samples.size() / channels;
+
+    // Round as the processors do, outside the timed loop
+    std::vector<float> rounded(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) rounded[i] = format.truncate(samples[i]);
+
+    auto encode = [&](size_t i, char* out) {
+        const float* values = rounded.data() + i * channels;
+        switch (encoding) {
+            case PayloadEncoding::cbor:
+                return encodeCbor(out, 256, keys, values, channels);
+            case PayloadEncoding::packed:
+            case PayloadEncoding::packedTimestamped:
+                return encodePacked(out, 256, values, channels, encoding == PayloadEncoding::packedTimestamped,
+                                    1700000000000 + static_cast<int64_t>(i));
+            case PayloadEncoding::series:
+                return encodeSeriesSample(out, 256, values, channels, precision, 1700000000000 + static_cast<int64_t>(i));
+            case PayloadEncoding::json:
+                break;
+        }
+        return format.formatJson(out, 256, keys, values, channels);
+    };
+
+    // Timed on a buffer that stays in the cache, as in the processors
+    char buffer[256];
+    long total = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        total += encode(i, buffer);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    Result result;
+    result.nsPerSample = std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(count);
+    result.payloadBytes = static_cast<double>(total);
+    std::vector<DecodedSample> decoded;
+    for (size_t i = 0; i < count; ++i) {
+        int length = encode(i, buffer);
+        result.packetBytes += static_cast<double>(packetLength(encoding, static_cast<size_t>(length)));
+        if (encoding == PayloadEncoding::json) continue;
+
+        decoded.clear();
+        if (!decodePayload(encoding, std::string_view(buffer, length), decoded) ||
+            decoded.size() != 1 || decoded[0].values.size() != channels) {
+            result.roundTrip = false;
+            continue;
+        }
+        for (size_t c = 0; c < channels; ++c) {
+            result.roundTrip = result.roundTrip && decoded[0].values[c] == rounded[i * channels + c];
+        }
+    }
+    result.payloadBytes /= static_cast<double>(count);
+    result.packetBytes /= static_cast<double>(count);
+    return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t count = argc > 1 ? static_cast<size_t>(std::atol(argv[1])) : 100000;
+
+    // A vibrating phone lying on a table, and a slowly varying light level
+    std::vector<float> threeAxis(count * 3);
+    std::vector<float> scalar(count);
+    uint32_t noise = 12345;
+    for (size_t i = 0; i < count; ++i) {
+        float t = static_cast<float>(i) / 200.0f;
+        noise = noise * 1664525u + 1013904223u;
+        float n = static_cast<float>(noise >> 8) / 16777216.0f - 0.5f;
+        threeAxis[i * 3] = 0.3f * std::sin(2.0f * static_cast<float>(M_PI) * 23.3f * t) + 0.05f * n;
+        threeAxis[i * 3 + 1] = -0.2f * std::sin(2.0f * static_cast<float>(M_PI) * 11.0f * t) + 0.05f * n;
+        threeAxis[i * 3 + 2] = 9.81f + 0.05f * n;
+        scalar[i] = 250.0f + 40.0f * std::sin(t / 30.0f) + n;
+    }
+
+    static constexpr const char* XYZ[] = {"x", "y", "z"};
+    static constexpr const char* VALUE[] = {"value"};
+    struct Encoding {
+        PayloadEncoding encoding;
+        const char* name;
+    };
+    const Encoding encodings[] = {
+            {PayloadEncoding::json, "json"},
+            {PayloadEncoding::cbor, "cbor"},
+            {PayloadEncoding::packed, "packed"},
+            {PayloadEncoding::packedTimestamped, "packed+t"},
+            {PayloadEncoding::series, "series"},
+    };
+
+    std::printf("%-8s %9s %-9s %12s %12s %10s %6s\n", "sensor", "decimals", "encoding", "payload B", "packet B",
+                "ns/sample", "check");
+    for (int precision : {0, 2, 4}) {
+        for (const auto& e : encodings) {
+            Result r = run(e.encoding, XYZ, 3, precision, threeAxis);
+            std::printf("%-8s %9d %-9s %12.2f %12.2f %10.1f %6s\n", "xyz", precision, e.name, r.payloadBytes,
+                        r.packetBytes, r.nsPerSample, r.roundTrip ? "ok" : "FAIL");
+        }
+        for (const auto& e : encodings) {
+            Result r = run(e.encoding, VALUE, 1, precision, scalar);
+            std::printf("%-8s %9d %-9s %12.2f %12.2f %10.1f %6s\n", "scalar", precision, e.name, r.payloadBytes,
+                        r.packetBytes, r.nsPerSample, r.roundTrip ? "ok" : "FAIL");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,217 @@
+// Host benchmark for compressed series batches: bytes per sample against the other batch
+// encodings, and encoding and decoding throughput, for an accelerometer trace cut into
+// batches. Every batch is decoded again and checked against its input.
+//
+// The trace is a file in the ReplaySensorSource format, of which the accelerometer samples
+// are used; without one, a synthetic trace of a phone carried while walking is generated.
+//
+// Not part of the Android build; the host CMake build makes a target of the same name.
+// By hand, from app/src/main/cpp:
+//
+//     g++ -std=c++17 -O2 -I. bench/series_benchmark.cpp series_codec.cpp binary_payload.cpp payload_format.cpp
+//         replay_sensor_source.cpp -lpthread -o series_benchmark
+//     ./series_benchmark [trace file or -] [samples per batch]
+
+#include "binary_payload.h"
+#include "payload_format.h"
+#include "replay_sensor_source.h"
+#include "series_codec.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int64_t EPOCH_MS = 1700000000000;
+constexpr size_t CHANNELS = 3;
+
+struct Trace {
+    std::vector<int64_t> timestampsMs;
+    std::vector<float> values; // CHANNELS per sample
+};
+
+bool loadTrace(const char* path, Trace& trace) {
+    ReplaySensorSource source(path, false);
+    source.enable(SensorKind::accelerometer, 0);
+    source.start([&trace](const SensorSample* samples, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            trace.timestampsMs.push_back(EPOCH_MS + samples[i].timestamp / 1000000);
+            trace.values.insert(trace.values.end(), samples[i].values, samples[i].values + CHANNELS);
+        }
+    });
+    while (!source.finished()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    source.stop();
+    return !trace.timestampsMs.empty();
+}
+
+// Five minutes at 200 Hz with the timestamp jitter of a busy device: steps at 1.8 Hz on top
+// of gravity-free noise, with the phone at rest every other 30 s
+void synthesizeTrace(Trace& trace) {
+    constexpr int RATE_HZ = 200;
+    uint32_t noise = 12345;
+    auto random = [&noise] {
+        noise = noise * 1664525u + 1013904223u;
+        return static_cast<float>(noise >> 8) / 16777216.0f - 0.5f;
+    };
+    int64_t t = EPOCH_MS;
+    for (int i = 0; i < 300 * RATE_HZ; ++i) {
+        t += 5 + (random() > 0.4f ? 1 : 0) - (random() > 0.4f ? 1 : 0);
+        float s = static_cast<float>(i) / RATE_HZ;
+        float walking = static_cast<int>(s / 30.0f) % 2 == 0 ? 1.0f : 0.0f;
+        float step = std::sin(2.0f * static_cast<float>(M_PI) * 1.8f * s);
+        trace.timestampsMs.push_back(t);
+        trace.values.push_back(walking * 1.2f * step + 0.02f * random());
+        trace.values.push_back(walking * 0.6f * std::sin(2.0f * static_cast<float>(M_PI) * 0.9f * s) + 0.02f * random());
+        trace.values.push_back(walking * 2.5f * step * step + 0.02f * random());
+    }
+}
+
+// Batches as SampleBatch builds them, for the size comparison
+size_t jsonBatch(const FixedPointFormat& format, const int64_t* timestamps, const float* values, size_t count,
+                 std::string& out) {
+    static constexpr const char* KEYS[] = {"x", "y", "z"};
+    out.assign("{\"samples\":[");
+    char sample[256];
+    for (size_t i = 0; i < count; ++i) {
+        int length = format.formatJson(sample, sizeof(sample), KEYS, values + i * CHANNELS, CHANNELS);
+        if (i > 0) out += ',';
+        out += "{\"t\":";
+        out += std::to_string(timestamps[i]);
+        out += ',';
+        out.append(sample + 1, static_cast<size_t>(length - 1));
+    }
+    out += "]}";
+    return out.size();
+}
+
+size_t cborBatchSize(const float* values, size_t count) {
+    static constexpr const char* KEYS[] = {"x", "y", "z"};
+    size_t size = 10 + 1;
+    char sample[256];
+    for (size_t i = 0; i < count; ++i) {
+        // One more map entry: "t" and a 64-bit timestamp
+        size += static_cast<size_t>(encodeCbor(sample, sizeof(sample), KEYS, values + i * CHANNELS, CHANNELS)) + 10;
+    }
+    return size;
+}
+
+size_t packedBatchSize(size_t count) {
+    return 1 + count * (8 + 4 * CHANNELS);
+}
+
+struct SeriesResult {
+    size_t bytes = 0;
+    double encodeNs = 0.0;
+    double decodeNs = 0.0;
+    bool roundTrip = true;
+};
+
+SeriesResult runSeries(const Trace& trace, const std::vector<float>& rounded, int decimals, SeriesCoding coding,
+                       size_t batchSize) {
+    size_t samples = trace.timestampsMs.size();
+    std::vector<std::string> payloads;
+    SeriesEncoder encoder;
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t first = 0; first < samples; first += batchSize) {
+        encoder.reset(CHANNELS, decimals, coding);
+        size_t last = std::min(samples, first + batchSize);
+        for (size_t i = first; i < last; ++i) {
+            encoder.add(trace.timestampsMs[i], rounded.data() + i * CHANNELS);
+        }
+        payloads.push_back(encoder.finish());
+    }
+    auto encoded = std::chrono::steady_clock::now();
+
+    std::vector<DecodedSample> decoded;
+    decoded.reserve(samples);
+    bool complete = true;
+    for (const auto& payload : payloads) {
+        complete = decodeSeries(payload, decoded) && complete;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    SeriesResult result;
+    for (const auto& payload : payloads) result.bytes += payload.size();
+    result.encodeNs = std::chrono::duration<double, std::nano>(encoded - start).count() / static_cast<double>(samples);
+    result.decodeNs = std::chrono::duration<double, std::nano>(end - encoded).count() / static_cast<double>(samples);
+    result.roundTrip = complete && decoded.size() == samples;
+    for (size_t i = 0; result.roundTrip && i < samples; ++i) {
+        result.roundTrip = decoded[i].timestampMs == trace.timestampsMs[i] &&
+                           std::memcmp(decoded[i].values.data(), rounded.data() + i * CHANNELS,
+                                       CHANNELS * sizeof(float)) == 0;
+    }
+    return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+    Trace trace;
+    if (argc > 1 && std::strcmp(argv[1], "-") != 0) {
+        if (!loadTrace(argv[1], trace)) {
+            std::fprintf(stderr, "No accelerometer samples in %s\n", argv[1]);
+            return 1;
+        }
+    } else {
+        synthesizeTrace(trace);
+    }
+    size_t batchSize = argc > 2 ? static_cast<size_t>(std::atol(argv[2])) : 200;
+    if (batchSize == 0) batchSize = 1;
+    size_t samples = trace.timestampsMs.size();
+    double count = static_cast<double>(samples);
+    std::printf("%zu samples over %.1f s, %zu per batch\n\n", samples,
+                static_cast<double>(trace.timestampsMs.back() - trace.timestampsMs.front()) / 1000.0, batchSize);
+
+    std::printf("%9s %-14s %10s %8s %12s %12s %6s\n", "decimals", "encoding", "B/sample", "vs json",
+                "encode ns", "decode ns", "check");
+    for (int decimals : {1, 2, 3}) {
+        FixedPointFormat format;
+        format.setPrecision(decimals);
+        std::vector<float> rounded(trace.values.size());
+        for (size_t i = 0; i < rounded.size(); ++i) rounded[i] = format.truncate(trace.values[i]);
+
+        size_t json = 0, cbor = 0, packed = 0;
+        std::string batch;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t first = 0; first < samples; first += batchSize) {
+            size_t n = std::min(batchSize, samples - first);
+            json += jsonBatch(format, trace.timestampsMs.data() + first, rounded.data() + first * CHANNELS, n, batch);
+            cbor += cborBatchSize(rounded.data() + first * CHANNELS, n);
+            packed += packedBatchSize(n);
+        }
+        double jsonNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                        count;
+
+        // Times of 0 are not measured
+        auto row = [&](const char* name, size_t bytes, double encodeNs, double decodeNs, const char* check) {
+            char encodeTime[32] = "-", decodeTime[32] = "-";
+            if (encodeNs > 0.0) std::snprintf(encodeTime, sizeof(encodeTime), "%.1f", encodeNs);
+            if (decodeNs > 0.0) std::snprintf(decodeTime, sizeof(decodeTime), "%.1f", decodeNs);
+            std::printf("%9d %-14s %10.2f %7.1fx %12s %12s %6s\n", decimals, name,
+                        static_cast<double>(bytes) / count, static_cast<double>(json) / static_cast<double>(bytes),
+                        encodeTime, decodeTime, check);
+        };
+        row("json", json, jsonNs, 0.0, "-");
+        row("cbor", cbor, 0.0, 0.0, "-");
+        row("packed+t", packed, 0.0, 0.0, "-");
+        SeriesResult fixed = runSeries(trace, rounded, decimals, SeriesCoding::fixedPoint, batchSize);
+        row("series", fixed.bytes, fixed.encodeNs, fixed.decodeNs, fixed.roundTrip ? "ok" : "FAIL");
+        SeriesResult xorFloat = runSeries(trace, rounded, decimals, SeriesCoding::xorFloat, batchSize);
+        row("series xor", xorFloat.bytes, xorFloat.encodeNs, xorFloat.decodeNs, xorFloat.roundTrip ? "ok" : "FAIL");
+    }
+
+    // The unrounded values, where only the XOR coding applies
+    SeriesResult raw = runSeries(trace, trace.values, -1, SeriesCoding::xorFloat, batchSize);
+    std::printf("%9s %-14s %10.2f %8s %12.1f %12.1f %6s\n", "-", "series xor", static_cast<double>(raw.bytes) / count,
+                "", raw.encodeNs, raw.decodeNs, raw.roundTrip ? "ok" : "FAIL");
+    return 0;
+}
@@ -0,0 +1,61 @@
+// Host benchmark for the spectral stage: throughput of SpectrumAnalyzer in blocks per second
+// for a three-axis stream, over the supported range of block sizes.
+//
+// Not part of the Android build; the host CMake build makes a target of the same name.
+// By hand, from app/src/main/cpp:
+//
+//     g++ -std=c++17 -O2 -I. bench/spectrum_benchmark.cpp spectrum_analyzer.cpp -o spectrum_benchmark
+//     ./spectrum_benchmark [seconds per size]
+
+#include "spectrum_analyzer.h"
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+int main(int argc, char** argv) {
+    double secondsPerSize = argc > 1 ? std::atof(argv[1]) : 1.0;
+    constexpr float SAMPLE_RATE_HZ = 400.0f;
+
+    std::printf("%8s %14s %14s %12s\n", "block", "blocks/s", "samples/s", "us/block");
+    for (int blockSize = SpectrumAnalyzer<3>::MIN_BLOCK; blockSize <= SpectrumAnalyzer<3>::MAX_BLOCK; blockSize *= 2) {
+        SpectrumAnalyzer<3> analyzer;
+        analyzer.configure(blockSize, 8, SAMPLE_RATE_HZ);
+
+        // A few tones plus a cheap deterministic noise term, precomputed so that only the
+        // analyzer is timed
+        std::vector<float> samples(static_cast<size_t>(blockSize) * 3);
+        uint32_t noise = 12345;
+        for (int i = 0; i < blockSize; ++i) {
+            float t = static_cast<float>(i) / SAMPLE_RATE_HZ;
+            noise = noise * 1664525u + 1013904223u;
+            float n = static_cast<float>(noise >> 8) / 16777216.0f - 0.5f;
+            samples[i * 3] = 1.5f * std::sin(2.0f * static_cast<float>(M_PI) * 23.3f * t) + 0.1f * n;
+            samples[i * 3 + 1] = 0.4f * std::sin(2.0f * static_cast<float>(M_PI) * 61.7f * t) + 0.1f * n;
+            samples[i * 3 + 2] = 9.81f + 0.1f * n;
+        }
+
+        SpectrumAnalyzer<3>::result_type result;
+        uint64_t blocks = 0;
+        float sink = 0.0f;
+        auto start = std::chrono::steady_clock::now();
+        auto deadline = start + std::chrono::duration<double>(secondsPerSize);
+        std::chrono::steady_clock::time_point now;
+        do {
+            for (int i = 0; i < blockSize; ++i) {
+                if (analyzer.add(&samples[i * 3], result)) {
+                    ++blocks;
+                    sink += result[0].peakAmplitude;
+                }
+            }
+            now = std::chrono::steady_clock::now();
+        } while (now < deadline);
+
+        double elapsed = std::chrono::duration<double>(now - start).count();
+        std::printf("%8d %14.0f %14.0f %12.2f\n", blockSize, blocks / elapsed,
+                    blocks * static_cast<double>(blockSize) / elapsed, elapsed * 1e6 / blocks);
+        if (sink < 0.0f) std::printf("%g\n", sink); // Keeps the results observable
+    }
+    return 0;
+}
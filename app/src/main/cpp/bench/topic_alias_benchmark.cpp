@@ -0,0 +1,280 @@
+// Host benchmark for MQTT 5 topic aliases: PUBLISH header bytes per message with and without
+// TopicAliasTable, for a minute of the app's sensor traffic on long Home Assistant style
+// topics, with two reconnects.
+//
+// The packets are encoded as the client sends them and written over a loopback TCP connection
+// to a broker stand-in, which parses them, resolves the aliases as a broker does (forgetting
+// them when the connection closes) and checks every resolved topic against the schedule.
+//
+// Not part of the Android build; the host CMake build makes a target of the same name.
+// By hand, from app/src/main/cpp:
+//
+//     g++ -std=c++17 -O2 -I. bench/topic_alias_benchmark.cpp topic_alias_table.cpp -lpthread -o topic_alias_benchmark
+//     ./topic_alias_benchmark [topic alias maximum]
+
+#include "topic_alias_table.h"
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr const char* CONTENT_TYPE = "application/json";
+constexpr int SECONDS = 60;
+constexpr int CONNECTIONS = 3;
+
+struct Stream {
+    std::string topic;
+    int rateHz;
+    const char* payload;
+};
+
+// Home Assistant discovery configs and availability are sent once per connection
+struct Schedule {
+    std::vector<std::string> topics;
+    std::vector<size_t> events; // topic index per message, in order
+    std::vector<size_t> connectionStarts;
+    std::vector<const char*> payloads;
+};
+
+Schedule makeSchedule() {
+    const std::string device = "homeassistant/sensor/pixel-7-3f9c2a0d";
+    std::vector<Stream> streams = {
+        {device + "/accel", 200, "{\"x\":0.12,\"y\":-0.03,\"z\":0.41}"},
+        {device + "/gyro", 200, "{\"x\":0.002,\"y\":-0.011,\"z\":0.004}"},
+        {device + "/gravity", 50, "{\"x\":0.08,\"y\":9.79,\"z\":0.52}"},
+        {device + "/light", 5, "{\"lux\":312.5}"},
+        {device + "/temperature", 1, "{\"celsius\":23.4}"},
+    };
+    Schedule schedule;
+    for (const Stream& s : streams) {
+        schedule.topics.push_back(s.topic);
+        schedule.payloads.push_back(s.payload);
+    }
+    size_t oneOff = schedule.topics.size();
+    for (const Stream& s : streams) {
+        schedule.topics.push_back(s.topic + "/config");
+        schedule.payloads.push_back("{\"name\":\"Open Sensor\",\"state_topic\":\"...\",\"unique_id\":\"...\"}");
+    }
+    schedule.topics.push_back(device + "/status");
+    schedule.payloads.push_back("online");
+
+    // Merged in time order, at 1 ms resolution
+    for (int ms = 0; ms < SECONDS * 1000; ++ms) {
+        if (ms % (SECONDS * 1000 / CONNECTIONS) == 0) {
+            schedule.connectionStarts.push_back(schedule.events.size());
+            for (size_t i = oneOff; i < schedule.topics.size(); ++i) schedule.events.push_back(i);
+        }
+        for (size_t i = 0; i < streams.size(); ++i) {
+            int period = 1000 / streams[i].rateHz;
+            if (ms % period == period / 2) schedule.events.push_back(i);
+        }
+    }
+    return schedule;
+}
+
+void putVarint(std::string& out, size_t value) {
+    do {
+        auto byte = static_cast<uint8_t>(value & 0x7f);
+        value >>= 7;
+        out += static_cast<char>(value > 0 ? byte | 0x80 : byte);
+    } while (value > 0);
+}
+
+void putString(std::string& out, const std::string& s) {
+    out += static_cast<char>(s.size() >> 8);
+    out += static_cast<char>(s.size() & 0xff);
+    out += s;
+}
+
+// QoS 0 PUBLISH with the properties the client sends. Returns the header size.
+size_t encodePublish(std::string& out, const std::string& topic, uint16_t alias, const char* payload) {
+    std::string properties;
+    properties += '\x01'; // Payload format indicator
+    properties += '\x01';
+    properties += '\x03'; // Content type
+    putString(properties, CONTENT_TYPE);
+    if (alias != 0) {
+        properties += '\x23';
+        properties += static_cast<char>(alias >> 8);
+        properties += static_cast<char>(alias & 0xff);
+    }
+    std::string variable;
+    putString(variable, topic);
+    putVarint(variable, properties.size());
+    variable += properties;
+
+    size_t payloadLength = std::char_traits<char>::length(payload);
+    size_t start = out.size();
+    out += '\x30';
+    putVarint(out, variable.size() + payloadLength);
+    out += variable;
+    size_t header = out.size() - start;
+    out += payload;
+    return header;
+}
+
+struct BrokerResult {
+    size_t messages = 0;
+    size_t headerBytes = 0;
+    size_t totalBytes = 0;
+    size_t aliased = 0;
+    bool valid = true;
+};
+
+// Reads one connection to the end, resolving aliases against the expected topics
+void serveConnection(int fd, const Schedule& schedule, size_t& next, BrokerResult& result) {
+    std::string buffer;
+    char chunk[65536];
+    for (ssize_t n; (n = read(fd, chunk, sizeof(chunk))) > 0;) buffer.append(chunk, static_cast<size_t>(n));
+    result.totalBytes += buffer.size();
+
+    std::unordered_map<uint16_t, std::string> aliases;
+    auto u8 = [&buffer](size_t at) { return static_cast<uint8_t>(buffer[at]); };
+    size_t at = 0;
+    while (at < buffer.size() && result.valid) {
+        size_t start = at++;
+        size_t remaining = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t byte = u8(at++);
+            remaining |= static_cast<size_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+        size_t end = at + remaining;
+        size_t topicLength = static_cast<size_t>(u8(at)) << 8 | u8(at + 1);
+        std::string topic = buffer.substr(at + 2, topicLength);
+        at += 2 + topicLength;
+        size_t propertiesLength = 0;
+        for (int shift = 0;; shift += 7) {
+            uint8_t byte = u8(at++);
+            propertiesLength |= static_cast<size_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+        uint16_t alias = 0;
+        for (size_t p = at; p < at + propertiesLength;) {
+            uint8_t id = u8(p++);
+            if (id == 0x01) {
+                p += 1;
+            } else if (id == 0x03) {
+                p += 2 + (static_cast<size_t>(u8(p)) << 8 | u8(p + 1));
+            } else if (id == 0x23) {
+                alias = static_cast<uint16_t>(u8(p) << 8 | u8(p + 1));
+                p += 2;
+            } else {
+                result.valid = false;
+                break;
+            }
+        }
+        at += propertiesLength;
+        result.headerBytes += at - start;
+
+        if (alias != 0) {
+            ++result.aliased;
+            if (topic.empty()) {
+                auto known = aliases.find(alias);
+                result.valid = result.valid && known != aliases.end();
+                if (known != aliases.end()) topic = known->second;
+            } else {
+                aliases[alias] = topic;
+            }
+        }
+        result.valid = result.valid && next < schedule.events.size() && topic == schedule.topics[schedule.events[next]];
+        ++next;
+        ++result.messages;
+        at = end;
+    }
+    result.valid = result.valid && at == buffer.size();
+}
+
+BrokerResult run(const Schedule& schedule, uint16_t aliasMaximum, size_t& clientHeaderBytes) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), length) != 0 || listen(listener, 1) != 0 ||
+        getsockname(listener, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+        std::perror("listen");
+        std::exit(1);
+    }
+
+    BrokerResult result;
+    std::thread broker([&] {
+        size_t next = 0;
+        for (int c = 0; c < CONNECTIONS; ++c) {
+            int fd = accept(listener, nullptr, nullptr);
+            serveConnection(fd, schedule, next, result);
+            close(fd);
+        }
+        result.valid = result.valid && next == schedule.events.size();
+    });
+
+    TopicAliasTable table;
+    clientHeaderBytes = 0;
+    std::string out;
+    for (size_t c = 0; c < schedule.connectionStarts.size(); ++c) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            std::perror("connect");
+            std::exit(1);
+        }
+        table.reset(aliasMaximum);
+        size_t last = c + 1 < schedule.connectionStarts.size() ? schedule.connectionStarts[c + 1] : schedule.events.size();
+        for (size_t e = schedule.connectionStarts[c]; e < last; ++e) {
+            const std::string& topic = schedule.topics[schedule.events[e]];
+            bool withTopic = false;
+            uint16_t alias = table.lookup(topic, withTopic);
+            clientHeaderBytes += encodePublish(out, alias != 0 && !withTopic ? std::string() : topic, alias,
+                                               schedule.payloads[schedule.events[e]]);
+            if (out.size() >= 60000 || e + 1 == last) {
+                for (size_t sent = 0; sent < out.size();) {
+                    ssize_t n = write(fd, out.data() + sent, out.size() - sent);
+                    if (n <= 0) {
+                        std::perror("write");
+                        std::exit(1);
+                    }
+                    sent += static_cast<size_t>(n);
+                }
+                out.clear();
+            }
+        }
+        close(fd);
+    }
+    broker.join();
+    close(listener);
+    return result;
+}
+
+}
+
+int main(int argc, char** argv) {
+    auto aliasMaximum = static_cast<uint16_t>(argc > 1 ? std::atoi(argv[1]) : 10);
+    Schedule schedule = makeSchedule();
+    std::printf("%zu messages on %zu topics over %d s in %d connections, topic alias maximum %u\n\n",
+                schedule.events.size(), schedule.topics.size(), SECONDS, CONNECTIONS, aliasMaximum);
+
+    size_t plainClient = 0, aliasedClient = 0;
+    BrokerResult plain = run(schedule, 0, plainClient);
+    BrokerResult aliased = run(schedule, aliasMaximum, aliasedClient);
+
+    auto perMessage = [](size_t bytes, size_t messages) { return static_cast<double>(bytes) / static_cast<double>(messages); };
+    std::printf("%-10s %12s %12s %10s %6s\n", "", "header B/msg", "packet B/msg", "aliased", "check");
+    std::printf("%-10s %12.2f %12.2f %10zu %6s\n", "plain", perMessage(plain.headerBytes, plain.messages),
+                perMessage(plain.totalBytes, plain.messages), plain.aliased,
+                plain.valid && plainClient == plain.headerBytes ? "ok" : "FAIL");
+    std::printf("%-10s %12.2f %12.2f %10zu %6s\n", "aliases", perMessage(aliased.headerBytes, aliased.messages),
+                perMessage(aliased.totalBytes, aliased.messages), aliased.aliased,
+                aliased.valid && aliasedClient == aliased.headerBytes ? "ok" : "FAIL");
+    std::printf("\n%.2f header bytes saved per message (%.1f%% of the packet bytes)\n",
+                perMessage(plain.headerBytes - aliased.headerBytes, plain.messages),
+                100.0 * static_cast<double>(plain.totalBytes - aliased.totalBytes) / static_cast<double>(plain.totalBytes));
+    return plain.valid && aliased.valid ? 0 : 1;
+}
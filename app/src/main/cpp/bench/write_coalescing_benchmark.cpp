@@ -0,0 +1,218 @@
+// Host benchmark for write coalescing: client socket writes per second, MQTT packets per
+// broker read and the latency added, for three sensors publishing at 1 kHz each through
+// MqttClientWrapper to the broker stand-in of loopback_broker.h, with coalescing off and at a
+// few windows and byte budgets.
+//
+// Three threads publish QoS 0 samples to a stream feed each, as the sensor processors do.
+// The client's writes are counted as the TCP segments its socket sent (TCP_INFO): on
+// loopback each write of a connected socket goes out at once, so a segment per write, and
+// with coalescing a batch larger than a segment would count more than once. The broker side
+// counts its reads. For the exact system calls, run it under
+//
+//     strace -f -c -e trace=write,writev,sendmsg,sendto ./write_coalescing_benchmark
+//
+// Built by the host CMake build as write_coalescing_benchmark:
+//
+//     write_coalescing_benchmark [seconds per run]
+
+#include "loopback_broker.h"
+#include "mqtt_client_wrapper.h"
+#include <dirent.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr int RATE_HZ = 1000;
+constexpr const char* TOPICS[] = {"opensensor/sensor/accelerometer", "opensensor/sensor/gyroscope",
+                                  "opensensor/sensor/gravity"};
+
+struct Result {
+    uint64_t published = 0;
+    uint64_t received = 0;
+    uint64_t segments = 0;
+    uint64_t reads = 0;
+    uint64_t batches = 0;
+    uint64_t batched = 0;
+    // From the sample's timestamp to the broker reading its PUBLISH
+    std::vector<double> latencyUs;
+};
+
+// glibc's tcp_info stops before the segment counters the kernel reports since Linux 4.2
+struct TcpInfo : tcp_info {
+    uint64_t pacingRate;
+    uint64_t maxPacingRate;
+    uint64_t bytesAcked;
+    uint64_t bytesReceived;
+    uint32_t segmentsOut;
+    uint32_t segmentsIn;
+};
+
+uint64_t segmentsOut(int fd) {
+    TcpInfo info{};
+    socklen_t length = sizeof(info);
+    return getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &length) == 0 && length >= sizeof(info) ? info.segmentsOut : 0;
+}
+
+// The client's socket is private to it; found among the process's descriptors by its peer
+int clientSocket(uint16_t brokerPort) {
+    int found = -1;
+    DIR* fds = opendir("/proc/self/fd");
+    if (fds == nullptr) return -1;
+    while (dirent* entry = readdir(fds)) {
+        int fd = std::atoi(entry->d_name);
+        sockaddr_in peer{};
+        socklen_t length = sizeof(peer);
+        if (fd > 2 && getpeername(fd, reinterpret_cast<sockaddr*>(&peer), &length) == 0 &&
+            peer.sin_family == AF_INET && ntohs(peer.sin_port) == brokerPort) {
+            found = fd;
+        }
+    }
+    closedir(fds);
+    return found;
+}
+
+int64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(clock_type::now().time_since_epoch()).count();
+}
+
+Result run(std::chrono::microseconds window, size_t budget, std::chrono::seconds duration) {
+    Result result;
+    std::mutex mutex;
+    // {"t":<ns>,...}
+    LoopbackBroker broker(LoopbackBroker::options{}, [&](std::string_view, std::string_view payload, int) {
+        int64_t received = nowNs();
+        size_t colon = payload.find(':');
+        if (colon == std::string_view::npos) return;
+        int64_t sampled = std::strtoll(std::string(payload.substr(colon + 1, 20)).c_str(), nullptr, 10);
+        std::lock_guard<std::mutex> lock(mutex);
+        ++result.received;
+        result.latencyUs.push_back(static_cast<double>(received - sampled) / 1000.0);
+    });
+
+    MqttClientWrapper wrapper("");
+    wrapper.set_write_coalescing(window, budget);
+    std::condition_variable changed;
+    bool connected = false;
+    wrapper.set_status_callback([&](const std::string& status, const std::string&) {
+        std::lock_guard<std::mutex> lock(mutex);
+        connected = status == "CONNECTED";
+        changed.notify_all();
+    });
+    std::vector<MqttClientWrapper::feed_id> feeds;
+    for (const char* topic : TOPICS) feeds.push_back(wrapper.register_feed(topic));
+
+    wrapper.connect(broker.url(), "write_coalescing_benchmark", "", "");
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!changed.wait_for(lock, std::chrono::seconds(10), [&] { return connected; })) {
+            std::fprintf(stderr, "No connection to the loopback broker\n");
+            std::exit(1);
+        }
+    }
+    int fd = clientSocket(broker.port());
+    if (fd < 0) {
+        std::fprintf(stderr, "Client socket not found\n");
+        std::exit(1);
+    }
+
+    // Past the CONNECT
+    uint64_t segmentsBefore = segmentsOut(fd);
+    uint64_t readsBefore = broker.reads();
+    MqttClientWrapper::publish_stats statsBefore = wrapper.stats();
+
+    std::atomic<bool> running{true};
+    std::atomic<uint64_t> published{0};
+    std::vector<std::thread> sensors;
+    for (MqttClientWrapper::feed_id feed : feeds) {
+        sensors.emplace_back([&, feed] {
+            auto next = clock_type::now();
+            char payload[96];
+            for (int i = 0; running.load(std::memory_order_relaxed); ++i) {
+                next += std::chrono::microseconds(1000000 / RATE_HZ);
+                std::this_thread::sleep_until(next);
+                int length = std::snprintf(payload, sizeof(payload), "{\"t\":%lld,\"x\":%d.12,\"y\":-0.03,\"z\":9.81}",
+                                           static_cast<long long>(nowNs()), i % 100);
+                if (wrapper.publish(feed, payload, static_cast<size_t>(length))) {
+                    published.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    std::this_thread::sleep_for(duration);
+    running = false;
+    for (auto& t : sensors) t.join();
+    result.published = published.load();
+
+    // What is still queued goes out within a window
+    auto deadline = clock_type::now() + std::chrono::seconds(2);
+    while (clock_type::now() < deadline && broker.publishes() < result.published) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    result.segments = segmentsOut(fd) - segmentsBefore;
+    result.reads = broker.reads() - readsBefore;
+    MqttClientWrapper::publish_stats stats = wrapper.stats();
+    result.batches = stats.write_batches - statsBefore.write_batches;
+    result.batched = stats.batched_publishes - statsBefore.batched_publishes;
+    wrapper.disconnect();
+
+    // The broker's thread is still running
+    std::lock_guard<std::mutex> lock(mutex);
+    Result copy = result;
+    return copy;
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::chrono::seconds duration(argc > 1 ? std::atoi(argv[1]) : 3);
+    std::printf("%zu sensors at %d Hz, %lld s per run\n\n", std::size(TOPICS), RATE_HZ,
+                static_cast<long long>(duration.count()));
+    std::printf("%9s %8s %10s %11s %10s %11s %11s %11s %11s %6s\n", "window", "budget", "writes/s", "packets/wr",
+                "reads/s", "packets/rd", "batch size", "latency p50", "latency p99", "check");
+
+    struct Config {
+        int windowUs;
+        size_t budget;
+    };
+    auto percentile = [](std::vector<double>& values, double p) {
+        if (values.empty()) return 0.0;
+        std::sort(values.begin(), values.end());
+        return values[std::min(values.size() - 1, static_cast<size_t>(p * static_cast<double>(values.size())))];
+    };
+    bool ok = true;
+    for (Config config : {Config{0, 0}, Config{500, 1400}, Config{1000, 1400}, Config{2000, 1400},
+                          Config{5000, 1400}, Config{5000, 16384}}) {
+        Result r = run(std::chrono::microseconds(config.windowUs), config.budget, duration);
+        bool check = r.published > 0 && r.received == r.published;
+        ok = ok && check;
+        double seconds = static_cast<double>(duration.count());
+        char window[16];
+        std::snprintf(window, sizeof(window), "%.1f ms", config.windowUs / 1000.0);
+        std::printf("%9s %8zu %10.0f %11.2f %10.0f %11.2f %11.2f %8.0f us %8.0f us %6s\n",
+                    config.windowUs > 0 ? window : "off", config.budget,
+                    static_cast<double>(r.segments) / seconds,
+                    static_cast<double>(r.received) / static_cast<double>(std::max<uint64_t>(r.segments, 1)),
+                    static_cast<double>(r.reads) / seconds,
+                    static_cast<double>(r.received) / static_cast<double>(std::max<uint64_t>(r.reads, 1)),
+                    static_cast<double>(r.batched) / static_cast<double>(std::max<uint64_t>(r.batches, 1)),
+                    percentile(r.latencyUs, 0.5), percentile(r.latencyUs, 0.99), check ? "ok" : "FAIL");
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,381 @@
+#include "binary_payload.h"
+#include "series_codec.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// Short enough for the small-string buffer, so the publish properties do not allocate
+constexpr const char* JSON_CONTENT_TYPE = "application/json";
+constexpr const char* CBOR_CONTENT_TYPE = "application/cbor";
+constexpr const char* PACKED_CONTENT_TYPE = "application/x-packed";
+constexpr const char* SERIES_CONTENT_TYPE = "application/x-series";
+
+constexpr uint8_t CBOR_UNSIGNED = 0;
+constexpr uint8_t CBOR_NEGATIVE = 1;
+constexpr uint8_t CBOR_TEXT = 3;
+constexpr uint8_t CBOR_ARRAY = 4;
+constexpr uint8_t CBOR_MAP = 5;
+constexpr uint8_t CBOR_SIMPLE = 7;
+constexpr uint8_t CBOR_INDEFINITE = 31;
+constexpr uint8_t CBOR_BREAK = 0xFF;
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsToFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+float halfToFloat(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    int exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    if (exponent == 0x1F) {
+        return bitsToFloat(sign | 0x7F800000 | (mantissa << 13));
+    }
+    if (exponent == 0) {
+        // Subnormal: mantissa * 2^-24, exact in a float
+        float magnitude = static_cast<float>(mantissa) * 5.9604645e-8f;
+        return sign ? -magnitude : magnitude;
+    }
+    return bitsToFloat(sign | static_cast<uint32_t>(exponent - 15 + 127) << 23 | mantissa << 13);
+}
+
+// The half-precision value closest to value, truncating; only used when it is exact
+uint16_t floatToHalf(float value) {
+    uint32_t bits = floatBits(value);
+    auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    int biased = static_cast<int>((bits >> 23) & 0xFF);
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (biased == 0xFF) {
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0));
+    }
+    int exponent = biased - 127 + 15;
+    if (biased == 0 || exponent < -10) return sign;
+    if (exponent >= 0x1F) return static_cast<uint16_t>(sign | 0x7C00);
+    if (exponent <= 0) {
+        return static_cast<uint16_t>(sign | ((mantissa | 0x800000) >> (14 - exponent)));
+    }
+    return static_cast<uint16_t>(sign | (exponent << 10) | (mantissa >> 13));
+}
+
+class CborWriter {
+public:
+    CborWriter(char* out, size_t size) : out_(reinterpret_cast<uint8_t*>(out)), size_(size) {}
+
+    void head(uint8_t major, uint64_t value) {
+        uint8_t initial = static_cast<uint8_t>(major << 5);
+        if (value < 24) {
+            byte(initial | static_cast<uint8_t>(value));
+        } else if (value <= UINT8_MAX) {
+            byte(initial | 24);
+            bigEndian(value, 1);
+        } else if (value <= UINT16_MAX) {
+            byte(initial | 25);
+            bigEndian(value, 2);
+        } else if (value <= UINT32_MAX) {
+            byte(initial | 26);
+            bigEndian(value, 4);
+        } else {
+            byte(initial | 27);
+            bigEndian(value, 8);
+        }
+    }
+
+    void text(const char* value) {
+        size_t length = std::strlen(value);
+        head(CBOR_TEXT, length);
+        if (length_ + length > size_) {
+            overflow_ = true;
+            return;
+        }
+        std::memcpy(out_ + length_, value, length);
+        length_ += length;
+    }
+
+    void number(float value) {
+        uint16_t half = floatToHalf(value);
+        if (floatBits(halfToFloat(half)) == floatBits(value) || std::isnan(value)) {
+            byte(CBOR_SIMPLE << 5 | 25);
+            bigEndian(std::isnan(value) ? 0x7E00 : half, 2);
+        } else {
+            byte(CBOR_SIMPLE << 5 | 26);
+            bigEndian(floatBits(value), 4);
+        }
+    }
+
+    int length() const { return overflow_ ? -1 : static_cast<int>(length_); }
+
+private:
+    void byte(uint8_t value) {
+        if (length_ >= size_) {
+            overflow_ = true;
+            return;
+        }
+        out_[length_++] = value;
+    }
+
+    void bigEndian(uint64_t value, int bytes) {
+        for (int i = bytes - 1; i >= 0; --i) {
+            byte(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    uint8_t* out_;
+    size_t size_;
+    size_t length_ = 0;
+    bool overflow_ = false;
+};
+
+class CborReader {
+public:
+    explicit CborReader(std::string_view data)
+        : p_(reinterpret_cast<const uint8_t*>(data.data())), end_(p_ + data.size()) {}
+
+    bool atEnd() const { return p_ == end_; }
+    bool atBreak() const { return p_ < end_ && *p_ == CBOR_BREAK; }
+    void skipBreak() { ++p_; }
+
+    // An indefinite length is reported as info 31
+    bool head(uint8_t& major, uint8_t& info, uint64_t& value) {
+        if (p_ >= end_) return false;
+        major = *p_ >> 5;
+        info = *p_ & 0x1F;
+        ++p_;
+        if (info < 24 || info == CBOR_INDEFINITE) {
+            value = info < 24 ? info : 0;
+            return true;
+        }
+        if (info > 27) return false;
+        size_t bytes = size_t{1} << (info - 24);
+        if (static_cast<size_t>(end_ - p_) < bytes) return false;
+        value = 0;
+        for (size_t i = 0; i < bytes; ++i) value = value << 8 | *p_++;
+        return true;
+    }
+
+    bool text(std::string& out) {
+        uint8_t major, info;
+        uint64_t length;
+        if (!head(major, info, length) || major != CBOR_TEXT || info == CBOR_INDEFINITE ||
+            length > static_cast<uint64_t>(end_ - p_)) {
+            return false;
+        }
+        out.assign(reinterpret_cast<const char*>(p_), static_cast<size_t>(length));
+        p_ += length;
+        return true;
+    }
+
+    bool integer(int64_t& out) {
+        uint8_t major, info;
+        uint64_t value;
+        if (!head(major, info, value) || info == CBOR_INDEFINITE || value > INT64_MAX) return false;
+        if (major == CBOR_UNSIGNED) {
+            out = static_cast<int64_t>(value);
+        } else if (major == CBOR_NEGATIVE) {
+            out = -1 - static_cast<int64_t>(value);
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool number(float& out) {
+        if (p_ < end_ && (*p_ >> 5) != CBOR_SIMPLE) {
+            int64_t value;
+            if (!integer(value)) return false;
+            out = static_cast<float>(value);
+            return true;
+        }
+        uint8_t major, info;
+        uint64_t bits;
+        if (!head(major, info, bits)) return false;
+        switch (info) {
+            case 25: out = halfToFloat(static_cast<uint16_t>(bits)); return true;
+            case 26: out = bitsToFloat(static_cast<uint32_t>(bits)); return true;
+            case 27: {
+                double value;
+                std::memcpy(&value, &bits, sizeof(value));
+                out = static_cast<float>(value);
+                return true;
+            }
+            default: return false;
+        }
+    }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+};
+
+// The entries of a sample map whose head has been read, the first key included
+bool readSampleEntries(CborReader& reader, uint8_t info, uint64_t entries, std::string key, DecodedSample& sample) {
+    bool indefinite = info == CBOR_INDEFINITE;
+    for (uint64_t i = 0; indefinite || i < entries; ++i) {
+        if (i > 0) {
+            if (indefinite && reader.atBreak()) {
+                reader.skipBreak();
+                return true;
+            }
+            if (!reader.text(key)) return false;
+        }
+        if (key == "t") {
+            if (!reader.integer(sample.timestampMs)) return false;
+            sample.hasTimestamp = true;
+        } else {
+            float value;
+            if (!reader.number(value)) return false;
+            sample.keys.push_back(std::move(key));
+            sample.values.push_back(value);
+        }
+    }
+    return true;
+}
+
+bool readSample(CborReader& reader, DecodedSample& sample) {
+    uint8_t major, info;
+    uint64_t entries;
+    if (!reader.head(major, info, entries) || major != CBOR_MAP) return false;
+    if (info != CBOR_INDEFINITE && entries == 0) return true;
+    if (info == CBOR_INDEFINITE && reader.atBreak()) {
+        reader.skipBreak();
+        return true;
+    }
+    std::string key;
+    return reader.text(key) && readSampleEntries(reader, info, entries, std::move(key), sample);
+}
+
+bool decodeCbor(std::string_view payload, std::vector<DecodedSample>& out) {
+    CborReader reader(payload);
+    uint8_t major, info;
+    uint64_t entries;
+    if (!reader.head(major, info, entries) || major != CBOR_MAP) return false;
+
+    std::string key;
+    if ((info == CBOR_INDEFINITE && reader.atBreak()) || (info != CBOR_INDEFINITE && entries == 0)) {
+        out.emplace_back();
+        return true;
+    }
+    if (!reader.text(key)) return false;
+
+    if (key != "samples") {
+        DecodedSample sample;
+        bool ok = readSampleEntries(reader, info, entries, std::move(key), sample);
+        if (ok) out.push_back(std::move(sample));
+        return ok && reader.atEnd();
+    }
+
+    uint8_t arrayInfo;
+    uint64_t count;
+    if (!reader.head(major, arrayInfo, count) || major != CBOR_ARRAY) return false;
+    bool indefinite = arrayInfo == CBOR_INDEFINITE;
+    for (uint64_t i = 0; indefinite || i < count; ++i) {
+        if (indefinite && reader.atBreak()) {
+            reader.skipBreak();
+            break;
+        }
+        DecodedSample sample;
+        if (!readSample(reader, sample)) return false;
+        out.push_back(std::move(sample));
+    }
+    return true;
+}
+
+bool decodePacked(std::string_view payload, std::vector<DecodedSample>& out) {
+    if (payload.empty()) return false;
+    auto header = static_cast<uint8_t>(payload[0]);
+    size_t channels = header & packed_format::CHANNEL_MASK;
+    bool timestamped = header & packed_format::TIMESTAMP;
+    size_t recordSize = (timestamped ? 8 : 0) + 4 * channels;
+    if (channels == 0 || (payload.size() - 1) % recordSize != 0) return false;
+
+    auto* p = reinterpret_cast<const uint8_t*>(payload.data()) + 1;
+    auto* end = reinterpret_cast<const uint8_t*>(payload.data()) + payload.size();
+    while (p < end) {
+        DecodedSample sample;
+        if (timestamped) {
+            uint64_t t = 0;
+            for (int i = 7; i >= 0; --i) t = t << 8 | p[i];
+            sample.hasTimestamp = true;
+            sample.timestampMs = static_cast<int64_t>(t);
+            p += 8;
+        }
+        for (size_t c = 0; c < channels; ++c, p += 4) {
+            uint32_t bits = static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 |
+                            static_cast<uint32_t>(p[2]) << 16 | static_cast<uint32_t>(p[3]) << 24;
+            sample.values.push_back(bitsToFloat(bits));
+        }
+        out.push_back(std::move(sample));
+    }
+    return true;
+}
+
+}
+
+PayloadEncoding payloadEncodingFromInt(int value) {
+    switch (value) {
+        case 1: return PayloadEncoding::cbor;
+        case 2: return PayloadEncoding::packed;
+        case 3: return PayloadEncoding::packedTimestamped;
+        case 4: return PayloadEncoding::series;
+        default: return PayloadEncoding::json;
+    }
+}
+
+const char* contentType(PayloadEncoding encoding) {
+    switch (encoding) {
+        case PayloadEncoding::cbor: return CBOR_CONTENT_TYPE;
+        case PayloadEncoding::packed:
+        case PayloadEncoding::packedTimestamped: return PACKED_CONTENT_TYPE;
+        case PayloadEncoding::series: return SERIES_CONTENT_TYPE;
+        default: return JSON_CONTENT_TYPE;
+    }
+}
+
+bool isTextEncoding(PayloadEncoding encoding) {
+    return encoding == PayloadEncoding::json;
+}
+
+int encodeCbor(char* out, size_t size, const char* const keys[], const float values[], size_t count) {
+    CborWriter writer(out, size);
+    writer.head(CBOR_MAP, count);
+    for (size_t i = 0; i < count; ++i) {
+        writer.text(keys[i]);
+        writer.number(values[i]);
+    }
+    return writer.length();
+}
+
+int encodePacked(char* out, size_t size, const float values[], size_t count, bool timestamp, int64_t timestampMs) {
+    size_t length = 1 + (timestamp ? 8 : 0) + 4 * count;
+    if (count == 0 || count > packed_format::CHANNEL_MASK || length > size) {
+        return -1;
+    }
+    auto* p = reinterpret_cast<uint8_t*>(out);
+    *p++ = static_cast<uint8_t>(count | (timestamp ? packed_format::TIMESTAMP : 0));
+    if (timestamp) {
+        auto t = static_cast<uint64_t>(timestampMs);
+        for (int i = 0; i < 8; ++i) *p++ = static_cast<uint8_t>(t >> (8 * i));
+    }
+    for (size_t c = 0; c < count; ++c) {
+        uint32_t bits = floatBits(values[c]);
+        for (int i = 0; i < 4; ++i) *p++ = static_cast<uint8_t>(bits >> (8 * i));
+    }
+    return static_cast<int>(length);
+}
+
+bool decodePayload(PayloadEncoding encoding, std::string_view payload, std::vector<DecodedSample>& out) {
+    switch (encoding) {
+        case PayloadEncoding::cbor: return decodeCbor(payload, out);
+        case PayloadEncoding::packed:
+        case PayloadEncoding::packedTimestamped: return decodePacked(payload, out);
+        case PayloadEncoding::series: return decodeSeries(payload, out);
+        default: return false;
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef OPEN_SENSOR_BINARY_PAYLOAD_H
+#define OPEN_SENSOR_BINARY_PAYLOAD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// How the samples of a topic are serialised. Every publish carries the MQTT 5 content type
+// and payload format indicator of its encoding, so consumers can tell them apart.
+//
+// CBOR (RFC 8949) mirrors the JSON payloads: a map from the channel keys to the values, and
+// for batches {"samples":[{"t":<ms>,...},...]}. Floats use the shortest of half and single
+// precision that holds the value exactly.
+//
+// Packed payloads are one header byte followed by fixed-size records, all little-endian:
+//
+//     header:  bits 0-2 channel count, bit 7 set if each record starts with a timestamp
+//     record:  [int64 milliseconds since the epoch] float32 * channel count
+//
+// A single sample is one record; a batch is as many records as fit the payload, always
+// timestamped. For three channels that is 13 bytes per sample, or 20 with the timestamp.
+//
+// Series payloads code each sample against the previous one (series_codec.h), which pays off
+// for batches.
+enum class PayloadEncoding : uint8_t {
+    json = 0,
+    cbor = 1,
+    packed = 2,
+    packedTimestamped = 3,
+    series = 4,
+};
+
+namespace packed_format {
+constexpr uint8_t CHANNEL_MASK = 0x07;
+constexpr uint8_t TIMESTAMP = 0x80;
+}
+
+// Out-of-range values select JSON
+PayloadEncoding payloadEncodingFromInt(int value);
+const char* contentType(PayloadEncoding encoding);
+// Whether the payload is UTF-8 text, for the payload format indicator
+bool isTextEncoding(PayloadEncoding encoding);
+
+// Write one sample and return its length, or -1 if it does not fit in size bytes.
+int encodeCbor(char* out, size_t size, const char* const keys[], const float values[], size_t count);
+int encodePacked(char* out, size_t size, const float values[], size_t count, bool timestamp, int64_t timestampMs);
+
+// Reference decoder for the binary encodings, single samples and batches alike. Keys are
+// empty for packed payloads, whose channels are in the order of the JSON keys.
+struct DecodedSample {
+    bool hasTimestamp = false;
+    int64_t timestampMs = 0;
+    std::vector<std::string> keys;
+    std::vector<float> values;
+};
+
+// Appends the samples in payload to out. Returns false if the payload is malformed; the
+// samples decoded up to that point are kept.
+bool decodePayload(PayloadEncoding encoding, std::string_view payload, std::vector<DecodedSample>& out);
+
+#endif //OPEN_SENSOR_BINARY_PAYLOAD_H
@@ -0,0 +1,116 @@
+#ifndef OPEN_SENSOR_CHANGE_DETECTOR_H
+#define OPEN_SENSOR_CHANGE_DETECTOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+// All zero reproduces the plain behaviour: publish whenever a rounded value changes.
+struct ChangeDetectionSettings {
+    float deadband = 0.0f;         // Absolute change needed on some channel, in sensor units
+    float relativeDeadband = 0.0f; // Same as a fraction of the channel's last published magnitude
+    float hysteresis = 0.0f;       // Extra fraction of the deadband needed to reverse direction
+    int minIntervalMs = 0;         // Changes arriving sooner after a publish are held back
+    int heartbeatMs = 0;           // Republish unchanged values after this much silence; 0 = never
+};
+
+// Decides which samples of an N-channel sensor are worth publishing.
+//
+// A sample is published when any channel has moved from its last published value by more than
+// max(deadband, relativeDeadband * |last|). A channel that reverses the direction of its last
+// published move must also clear the hysteresis margin, which keeps noise around a threshold
+// from publishing on every wiggle. The minimum interval and heartbeat bound the publish rate
+// from both sides; heartbeats are sent with the next sample once the silence has lasted long
+// enough.
+//
+// shouldPublish() and commit() are called from the thread that processes samples;
+// suppressed() may be read from any thread.
+template<size_t N>
+class ChangeDetector {
+public:
+    using clock = std::chrono::steady_clock;
+
+    ChangeDetector() { reset(); }
+
+    void configure(const ChangeDetectionSettings& settings) {
+        settings_ = settings;
+        minInterval_ = std::chrono::milliseconds(settings.minIntervalMs > 0 ? settings.minIntervalMs : 0);
+        heartbeat_ = std::chrono::milliseconds(settings.heartbeatMs > 0 ? settings.heartbeatMs : 0);
+        timed_ = minInterval_.count() > 0 || heartbeat_.count() > 0;
+        reset();
+    }
+
+    // The next sample is published unconditionally.
+    void reset() {
+        published_ = false;
+        for (size_t i = 0; i < N; ++i) {
+            last_[i] = std::numeric_limits<float>::quiet_NaN();
+            direction_[i] = 0;
+        }
+    }
+
+    // Counts the sample as suppressed when it returns false.
+    bool shouldPublish(const float values[]) {
+        // The clock is only read when a time-based option is in use
+        now_ = timed_ ? clock::now() : clock::time_point{};
+
+        bool publish = !published_ || changed(values);
+        if (published_ && timed_) {
+            auto silence = now_ - lastPublish_;
+            if (publish && silence < minInterval_) publish = false;
+            if (!publish && heartbeat_.count() > 0 && silence >= heartbeat_) publish = true;
+        }
+
+        if (!publish) suppressed_.fetch_add(1, std::memory_order_relaxed);
+        return publish;
+    }
+
+    // Records values that shouldPublish() accepted and that were actually published.
+    void commit(const float values[]) {
+        for (size_t i = 0; i < N; ++i) {
+            float delta = values[i] - last_[i];
+            if (published_ && std::fabs(delta) >= EPSILON) direction_[i] = delta > 0.0f ? 1 : -1;
+            last_[i] = values[i];
+        }
+        lastPublish_ = now_;
+        published_ = true;
+    }
+
+    uint64_t suppressed() const { return suppressed_.load(std::memory_order_relaxed); }
+
+private:
+    // Changes below this are float noise and never published
+    static constexpr float EPSILON = std::numeric_limits<float>::epsilon();
+
+    bool changed(const float values[]) const {
+        for (size_t i = 0; i < N; ++i) {
+            float threshold = std::fmax(settings_.deadband, settings_.relativeDeadband * std::fabs(last_[i]));
+            float delta = values[i] - last_[i];
+            if (direction_[i] != 0 && (delta > 0.0f) != (direction_[i] > 0)) {
+                threshold += threshold * settings_.hysteresis;
+            }
+            // Written so that NaN counts as a change
+            float magnitude = std::fabs(delta);
+            if (!(magnitude <= threshold) && !(magnitude < EPSILON)) return true;
+        }
+        return false;
+    }
+
+    ChangeDetectionSettings settings_;
+    clock::duration minInterval_{};
+    clock::duration heartbeat_{};
+    bool timed_ = false;
+
+    float last_[N];
+    int8_t direction_[N]; // Sign of the last published move per channel, 0 if none yet
+    bool published_ = false;
+    clock::time_point lastPublish_;
+    clock::time_point now_;
+
+    std::atomic<uint64_t> suppressed_{0};
+};
+
+#endif //OPEN_SENSOR_CHANGE_DETECTOR_H
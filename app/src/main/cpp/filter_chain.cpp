@@ -0,0 +1,288 @@
+#include "filter_chain.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Four-lane operations used by the kernel
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+using vec4 = float32x4_t;
+inline vec4 load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, vec4 v) { vst1q_f32(p, v); }
+inline vec4 splat(float x) { return vdupq_n_f32(x); }
+inline vec4 add(vec4 a, vec4 b) { return vaddq_f32(a, b); }
+inline vec4 sub(vec4 a, vec4 b) { return vsubq_f32(a, b); }
+inline vec4 mul(vec4 a, vec4 b) { return vmulq_f32(a, b); }
+inline vec4 min(vec4 a, vec4 b) { return vminq_f32(a, b); }
+inline vec4 max(vec4 a, vec4 b) { return vmaxq_f32(a, b); }
+
+#elif defined(__SSE2__)
+
+using vec4 = __m128;
+inline vec4 load(const float* p) { return _mm_load_ps(p); }
+inline void store(float* p, vec4 v) { _mm_store_ps(p, v); }
+inline vec4 splat(float x) { return _mm_set1_ps(x); }
+inline vec4 add(vec4 a, vec4 b) { return _mm_add_ps(a, b); }
+inline vec4 sub(vec4 a, vec4 b) { return _mm_sub_ps(a, b); }
+inline vec4 mul(vec4 a, vec4 b) { return _mm_mul_ps(a, b); }
+inline vec4 min(vec4 a, vec4 b) { return _mm_min_ps(a, b); }
+inline vec4 max(vec4 a, vec4 b) { return _mm_max_ps(a, b); }
+
+#else
+
+struct vec4 { float lane[4]; };
+inline vec4 load(const float* p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void store(float* p, vec4 v) { std::memcpy(p, v.lane, sizeof(v.lane)); }
+inline vec4 splat(float x) { return {{x, x, x, x}}; }
+template<typename Op>
+inline vec4 lanewise(vec4 a, vec4 b, Op op) {
+    return {{op(a.lane[0], b.lane[0]), op(a.lane[1], b.lane[1]), op(a.lane[2], b.lane[2]), op(a.lane[3], b.lane[3])}};
+}
+inline vec4 add(vec4 a, vec4 b) { return lanewise(a, b, [](float x, float y) { return x + y; }); }
+inline vec4 sub(vec4 a, vec4 b) { return lanewise(a, b, [](float x, float y) { return x - y; }); }
+inline vec4 mul(vec4 a, vec4 b) { return lanewise(a, b, [](float x, float y) { return x * y; }); }
+inline vec4 min(vec4 a, vec4 b) { return lanewise(a, b, [](float x, float y) { return std::min(x, y); }); }
+inline vec4 max(vec4 a, vec4 b) { return lanewise(a, b, [](float x, float y) { return std::max(x, y); }); }
+
+#endif
+
+bool isBiquad(FilterType type) {
+    return type == FilterType::lowPass || type == FilterType::highPass || type == FilterType::bandPass;
+}
+
+bool isValid(const FilterStageSettings& stage, float sampleRateHz) {
+    switch (stage.type) {
+        case FilterType::ema:
+            return stage.parameter > 0.0f && stage.parameter <= 1.0f;
+        case FilterType::median: {
+            int length = static_cast<int>(stage.parameter);
+            return static_cast<float>(length) == stage.parameter && length >= 1 && length % 2 == 1 &&
+                   length <= FilterChain::MAX_MEDIAN;
+        }
+        default:
+            // Written so that NaN is rejected
+            return sampleRateHz > 0.0f && stage.parameter > 0.0f && stage.parameter < sampleRateHz / 2.0f &&
+                   stage.q > 0.0f && std::isfinite(stage.q);
+    }
+}
+
+// RBJ audio EQ cookbook designs, normalised by a0: {b0, b1, b2, a1, a2}
+void designBiquad(const FilterStageSettings& stage, float sampleRateHz, double coefficients[5]) {
+    double w0 = 2.0 * M_PI * stage.parameter / sampleRateHz;
+    double cosW0 = std::cos(w0);
+    double alpha = std::sin(w0) / (2.0 * stage.q);
+    double a0 = 1.0 + alpha;
+
+    double b0, b1, b2;
+    switch (stage.type) {
+        case FilterType::lowPass:
+            b0 = b2 = (1.0 - cosW0) / 2.0;
+            b1 = 1.0 - cosW0;
+            break;
+        case FilterType::highPass:
+            b0 = b2 = (1.0 + cosW0) / 2.0;
+            b1 = -(1.0 + cosW0);
+            break;
+        default: // Band-pass with 0 dB peak gain
+            b0 = alpha;
+            b1 = 0.0;
+            b2 = -alpha;
+            break;
+    }
+    coefficients[0] = b0 / a0;
+    coefficients[1] = b1 / a0;
+    coefficients[2] = b2 / a0;
+    coefficients[3] = -2.0 * cosW0 / a0;
+    coefficients[4] = (1.0 - alpha) / a0;
+}
+
+const char* skipSpaces(const char* p) {
+    while (*p == ' ' || *p == '\t') ++p;
+    return p;
+}
+
+}
+
+bool FilterChainSettings::operator==(const FilterChainSettings& other) const {
+    if (count != other.count || sampleRateHz != other.sampleRateHz) return false;
+    for (size_t i = 0; i < count; ++i) {
+        if (!(stages[i] == other.stages[i])) return false;
+    }
+    return true;
+}
+
+bool parseFilterChain(const char* spec, float sampleRateHz, FilterChainSettings& settings) {
+    static constexpr struct {
+        const char* name;
+        FilterType type;
+    } NAMES[] = {
+        {"ema", FilterType::ema},
+        {"lowpass", FilterType::lowPass},
+        {"highpass", FilterType::highPass},
+        {"bandpass", FilterType::bandPass},
+        {"median", FilterType::median},
+    };
+
+    FilterChainSettings parsed;
+    parsed.sampleRateHz = sampleRateHz;
+
+    const char* p = skipSpaces(spec);
+    while (*p != '\0') {
+        if (parsed.count == FilterChainSettings::MAX_STAGES) return false;
+        FilterStageSettings& stage = parsed.stages[parsed.count++];
+
+        size_t nameLength = std::strcspn(p, ":, \t");
+        bool known = false;
+        for (const auto& entry : NAMES) {
+            if (std::strlen(entry.name) == nameLength && std::strncmp(p, entry.name, nameLength) == 0) {
+                stage.type = entry.type;
+                known = true;
+                break;
+            }
+        }
+        if (!known) return false;
+        p = skipSpaces(p + nameLength);
+
+        // Frequency or length, then Q for the biquads
+        float* fields[] = {&stage.parameter, &stage.q};
+        size_t fieldCount = isBiquad(stage.type) ? 2 : 1;
+        for (size_t i = 0; i < fieldCount && *p == ':'; ++i) {
+            char* end;
+            *fields[i] = std::strtof(p + 1, &end);
+            if (end == p + 1) return false;
+            p = skipSpaces(end);
+        }
+        if (!isValid(stage, sampleRateHz)) return false;
+
+        if (*p == ',') {
+            p = skipSpaces(p + 1);
+            if (*p == '\0') return false; // Trailing comma
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+
+    settings = parsed;
+    return true;
+}
+
+bool FilterChain::configure(const FilterChainSettings& settings) {
+    settings_ = FilterChainSettings{};
+    primed_ = false;
+    if (settings.count > FilterChainSettings::MAX_STAGES) return false;
+
+    for (size_t i = 0; i < settings.count; ++i) {
+        const FilterStageSettings& config = settings.stages[i];
+        if (!isValid(config, settings.sampleRateHz)) return false;
+
+        Stage& stage = stages_[i];
+        stage = Stage{};
+        stage.type = config.type;
+        stage.dcGain = 1.0f;
+        if (config.type == FilterType::ema) {
+            stage.b0 = config.parameter;
+        } else if (config.type == FilterType::median) {
+            stage.length = static_cast<int>(config.parameter);
+        } else {
+            double c[5];
+            designBiquad(config, settings.sampleRateHz, c);
+            stage.b0 = static_cast<float>(c[0]);
+            stage.b1 = static_cast<float>(c[1]);
+            stage.b2 = static_cast<float>(c[2]);
+            stage.a1 = static_cast<float>(c[3]);
+            stage.a2 = static_cast<float>(c[4]);
+            stage.dcGain = static_cast<float>((c[0] + c[1] + c[2]) / (1.0 + c[3] + c[4]));
+        }
+    }
+    settings_ = settings;
+    return true;
+}
+
+// Sets each stage to the state it would settle in if its input had always been the current
+// one, so that processing that input returns dcGain times it.
+void FilterChain::prime(const float values[4]) {
+    alignas(16) float input[4];
+    std::copy(values, values + 4, input);
+
+    for (size_t i = 0; i < settings_.count; ++i) {
+        Stage& stage = stages_[i];
+        for (int lane = 0; lane < 4; ++lane) {
+            float x = input[lane];
+            float y = stage.dcGain * x;
+            switch (stage.type) {
+                case FilterType::ema:
+                    stage.z1[lane] = x;
+                    break;
+                case FilterType::median:
+                    for (int j = 0; j < stage.length; ++j) stage.history[j][lane] = x;
+                    break;
+                default:
+                    stage.z2[lane] = stage.b2 * x - stage.a2 * y;
+                    stage.z1[lane] = stage.b1 * x - stage.a1 * y + stage.z2[lane];
+                    break;
+            }
+            input[lane] = y;
+        }
+        stage.next = 0;
+    }
+    primed_ = true;
+}
+
+void FilterChain::process(float values[4]) {
+    if (!primed_) prime(values);
+
+    alignas(16) float in[4];
+    std::copy(values, values + 4, in);
+    vec4 x = load(in);
+
+    for (size_t i = 0; i < settings_.count; ++i) {
+        Stage& stage = stages_[i];
+        switch (stage.type) {
+            case FilterType::ema: {
+                vec4 y = load(stage.z1);
+                y = add(y, mul(splat(stage.b0), sub(x, y)));
+                store(stage.z1, y);
+                x = y;
+                break;
+            }
+            case FilterType::median: {
+                store(stage.history[stage.next], x);
+                stage.next = stage.next + 1 == stage.length ? 0 : stage.next + 1;
+
+                // Odd-even transposition sort of the window; min/max keep it branch-free
+                vec4 window[MAX_MEDIAN];
+                for (int j = 0; j < stage.length; ++j) window[j] = load(stage.history[j]);
+                for (int pass = 0; pass < stage.length; ++pass) {
+                    for (int j = pass & 1; j + 1 < stage.length; j += 2) {
+                        vec4 low = min(window[j], window[j + 1]);
+                        window[j + 1] = max(window[j], window[j + 1]);
+                        window[j] = low;
+                    }
+                }
+                x = window[stage.length / 2];
+                break;
+            }
+            default: {
+                vec4 z1 = load(stage.z1);
+                vec4 z2 = load(stage.z2);
+                vec4 y = add(mul(splat(stage.b0), x), z1);
+                store(stage.z1, add(sub(mul(splat(stage.b1), x), mul(splat(stage.a1), y)), z2));
+                store(stage.z2, sub(mul(splat(stage.b2), x), mul(splat(stage.a2), y)));
+                x = y;
+                break;
+            }
+        }
+    }
+
+    store(in, x);
+    std::copy(in, in + 4, values);
+}
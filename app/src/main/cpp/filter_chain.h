@@ -0,0 +1,90 @@
+#ifndef OPEN_SENSOR_FILTER_CHAIN_H
+#define OPEN_SENSOR_FILTER_CHAIN_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+enum class FilterType : uint8_t {
+    ema,      // Exponential moving average, parameter = smoothing factor in (0, 1]
+    lowPass,  // Second-order Butterworth-style biquads, parameter = cutoff or centre in Hz
+    highPass,
+    bandPass,
+    median,   // Median of the last parameter samples, odd and at most FilterChain::MAX_MEDIAN
+};
+
+struct FilterStageSettings {
+    static constexpr float DEFAULT_Q = 0.70710678f; // Maximally flat
+
+    FilterType type = FilterType::ema;
+    float parameter = 0.0f;
+    float q = DEFAULT_Q; // Biquads only
+
+    bool operator==(const FilterStageSettings& other) const {
+        return type == other.type && parameter == other.parameter && q == other.q;
+    }
+};
+
+struct FilterChainSettings {
+    static constexpr size_t MAX_STAGES = 4;
+
+    std::array<FilterStageSettings, MAX_STAGES> stages{};
+    size_t count = 0;          // No stages means no filtering
+    float sampleRateHz = 0.0f; // Nominal rate the biquad frequencies are relative to
+
+    bool operator==(const FilterChainSettings& other) const;
+    bool operator!=(const FilterChainSettings& other) const { return !(*this == other); }
+};
+
+// Parses a comma-separated list of stages, each a name followed by colon-separated numbers:
+//
+//     ema:<alpha>  lowpass:<hz>[:<q>]  highpass:<hz>[:<q>]  bandpass:<hz>[:<q>]  median:<n>
+//
+// e.g. "median:5,lowpass:2". An empty string is a chain without stages. Returns false, leaving
+// settings untouched, if the list is malformed or a stage cannot be realised at sampleRateHz.
+bool parseFilterChain(const char* spec, float sampleRateHz, FilterChainSettings& settings);
+
+// Filters the samples of a sensor with up to four channels before they are rounded.
+//
+// Stages run in order, each with fixed-size state and precomputed coefficients, so nothing is
+// allocated per sample. All channels are processed together in one four-lane NEON or SSE
+// vector; the state of unused lanes is simply ignored. The first sample after configure() or
+// reset() primes every stage with its steady state for that input, so a chain starts without
+// a transient instead of ramping up from zero.
+class FilterChain {
+public:
+    static constexpr int MAX_MEDIAN = 9;
+
+    // Returns false and disables filtering if a stage cannot be realised (see parseFilterChain).
+    bool configure(const FilterChainSettings& settings);
+    const FilterChainSettings& settings() const { return settings_; }
+    bool enabled() const { return settings_.count > 0; }
+
+    // The next sample primes the stages again
+    void reset() { primed_ = false; }
+
+    // Filters one sample of four lanes in place
+    void process(float values[4]);
+
+private:
+    struct Stage {
+        FilterType type;
+        // Biquad coefficients normalised by a0, transposed direct form II. The EMA uses b0 as
+        // its smoothing factor and z1 as its output.
+        float b0, b1, b2, a1, a2;
+        float dcGain;
+        int length; // Median window
+        int next;   // Median ring position
+        alignas(16) float z1[4];
+        alignas(16) float z2[4];
+        alignas(16) float history[MAX_MEDIAN][4];
+    };
+
+    void prime(const float values[4]);
+
+    FilterChainSettings settings_;
+    std::array<Stage, FilterChainSettings::MAX_STAGES> stages_{};
+    bool primed_ = false;
+};
+
+#endif //OPEN_SENSOR_FILTER_CHAIN_H
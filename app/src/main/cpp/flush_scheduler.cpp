@@ -0,0 +1,45 @@
+#include "flush_scheduler.h"
+
+FlushScheduler::FlushScheduler(boost::asio::io_context& ioc, std::function<void()> flush)
+    : timer_(ioc), flush_(std::move(flush)) {}
+
+void FlushScheduler::configure(std::chrono::microseconds window, size_t byte_budget) {
+    flush();
+    window_ = window.count() > 0 ? window : std::chrono::microseconds{0};
+    byte_budget_ = byte_budget;
+}
+
+void FlushScheduler::add(size_t bytes) {
+    pending_bytes_ += bytes;
+    ++pending_messages_;
+    if (!enabled() || (byte_budget_ > 0 && pending_bytes_ >= byte_budget_)) {
+        flush();
+        return;
+    }
+    if (armed_) {
+        return;
+    }
+    armed_ = true;
+    timer_.expires_after(window_);
+    timer_.async_wait([this, batch = batch_](boost::system::error_code ec) {
+        if (!ec && batch == batch_) {
+            flush();
+        }
+    });
+}
+
+void FlushScheduler::flush() {
+    if (armed_) {
+        armed_ = false;
+        timer_.cancel();
+    }
+    ++batch_;
+    if (pending_messages_ == 0) {
+        return;
+    }
+    flushes_.fetch_add(1, std::memory_order_relaxed);
+    messages_.fetch_add(pending_messages_, std::memory_order_relaxed);
+    pending_bytes_ = 0;
+    pending_messages_ = 0;
+    flush_();
+}
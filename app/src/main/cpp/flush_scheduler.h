@@ -0,0 +1,55 @@
+#ifndef OPEN_SENSOR_FLUSH_SCHEDULER_H
+#define OPEN_SENSOR_FLUSH_SCHEDULER_H
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Decides when a queue of small outgoing messages is written, so that those queued within a
+// short window go to the transport together rather than one write each.
+//
+// The owner keeps the queue and reports each message added to it; the flush function is
+// called, on the io_context thread, once the window has passed since the first message of
+// the batch or once the batch reaches the byte budget, whichever comes first. A message
+// therefore waits at most the window. With a window of 0 the owner is expected to write
+// directly; add() then flushes every message.
+//
+// Not thread-safe apart from the counters; used on the io_context thread only.
+class FlushScheduler {
+public:
+    FlushScheduler(boost::asio::io_context& ioc, std::function<void()> flush);
+
+    FlushScheduler(const FlushScheduler&) = delete;
+    FlushScheduler& operator=(const FlushScheduler&) = delete;
+
+    // Flushes what is queued under the previous settings
+    void configure(std::chrono::microseconds window, size_t byte_budget);
+    bool enabled() const { return window_.count() > 0; }
+
+    void add(size_t bytes);
+    // Writes the batch now, e.g. before the transport goes away
+    void flush();
+
+    // Batches written, and the messages in them
+    uint64_t flushes() const { return flushes_.load(std::memory_order_relaxed); }
+    uint64_t messages() const { return messages_.load(std::memory_order_relaxed); }
+
+private:
+    boost::asio::steady_timer timer_;
+    std::function<void()> flush_;
+    std::chrono::microseconds window_{0};
+    size_t byte_budget_ = 0;
+    size_t pending_bytes_ = 0;
+    size_t pending_messages_ = 0;
+    // Tells a timer that expired before its batch was flushed by the budget from the current one
+    uint64_t batch_ = 0;
+    bool armed_ = false;
+    std::atomic<uint64_t> flushes_{0};
+    std::atomic<uint64_t> messages_{0};
+};
+
+#endif //OPEN_SENSOR_FLUSH_SCHEDULER_H
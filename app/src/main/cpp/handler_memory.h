@@ -0,0 +1,89 @@
+#ifndef OPEN_SENSOR_HANDLER_MEMORY_H
+#define OPEN_SENSOR_HANDLER_MEMORY_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+// Recycles fixed-size blocks for asynchronous operation handlers, so that steady-state
+// publishing does not go to the heap. Requests that do not fit a block, or arrive while all
+// blocks are in use, fall back to operator new.
+// Not thread-safe: an instance must only be used by one thread at a time.
+class handler_memory {
+public:
+    static constexpr size_t BLOCK_SIZE = 512;
+
+    explicit handler_memory(size_t blocks)
+        : storage_(new std::byte[blocks * BLOCK_SIZE]), end_(storage_.get() + blocks * BLOCK_SIZE) {
+        free_.reserve(blocks);
+        for (size_t i = blocks; i > 0; --i) {
+            free_.push_back(storage_.get() + (i - 1) * BLOCK_SIZE);
+        }
+    }
+
+    handler_memory(const handler_memory&) = delete;
+    handler_memory& operator=(const handler_memory&) = delete;
+
+    void* allocate(size_t size) {
+        if (size <= BLOCK_SIZE && !free_.empty()) {
+            void* block = free_.back();
+            free_.pop_back();
+            return block;
+        }
+        ++fallback_allocations_;
+        return ::operator new(size);
+    }
+
+    void deallocate(void* pointer) {
+        auto* block = static_cast<std::byte*>(pointer);
+        if (block >= storage_.get() && block < end_) {
+            free_.push_back(block); // Capacity was reserved up front, so this never allocates
+        } else {
+            ::operator delete(pointer);
+        }
+    }
+
+    // Allocations that could not be served from the recycled blocks.
+    size_t fallback_allocations() const { return fallback_allocations_; }
+
+private:
+    std::unique_ptr<std::byte[]> storage_;
+    std::byte* end_;
+    std::vector<std::byte*> free_;
+    size_t fallback_allocations_ = 0;
+};
+
+// Standard allocator over handler_memory, to be associated with completion handlers
+// through boost::asio::bind_allocator.
+template<typename T>
+class handler_allocator {
+public:
+    using value_type = T;
+
+    explicit handler_allocator(handler_memory& memory) : memory_(&memory) {}
+
+    template<typename U>
+    handler_allocator(const handler_allocator<U>& other) noexcept : memory_(other.memory_) {}
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(memory_->allocate(sizeof(T) * n));
+    }
+
+    void deallocate(T* pointer, size_t /* n */) {
+        memory_->deallocate(pointer);
+    }
+
+    template<typename U>
+    bool operator==(const handler_allocator<U>& other) const noexcept { return memory_ == other.memory_; }
+
+    template<typename U>
+    bool operator!=(const handler_allocator<U>& other) const noexcept { return memory_ != other.memory_; }
+
+private:
+    template<typename> friend class handler_allocator;
+
+    handler_memory* memory_;
+};
+
+#endif //OPEN_SENSOR_HANDLER_MEMORY_H
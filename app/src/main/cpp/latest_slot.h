@@ -0,0 +1,57 @@
+#ifndef OPEN_SENSOR_LATEST_SLOT_H
+#define OPEN_SENSOR_LATEST_SLOT_H
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+// Holds the most recent value written by one producer thread until one consumer thread takes
+// it; a newer value replaces one that was not taken yet. Triple-buffered, so neither side
+// ever waits for the other: the producer writes into its own buffer and swaps it with the
+// shared one, and the consumer swaps the shared buffer with its own to read it.
+template<typename T>
+class LatestSlot {
+    static_assert(std::is_trivially_copyable_v<T>, "LatestSlot values must be trivially copyable");
+
+public:
+    LatestSlot() = default;
+    LatestSlot(const LatestSlot&) = delete;
+    LatestSlot& operator=(const LatestSlot&) = delete;
+
+    // Producer side. Returns false if an untaken value was replaced.
+    bool store(const T& value) {
+        buffers_[back_] = value;
+        uint8_t previous = shared_.exchange(static_cast<uint8_t>(back_ | FRESH), std::memory_order_acq_rel);
+        back_ = previous & INDEX;
+        return (previous & FRESH) == 0;
+    }
+
+    // Either side. True if a value is waiting to be taken.
+    bool pending() const {
+        return (shared_.load(std::memory_order_acquire) & FRESH) != 0;
+    }
+
+    // Consumer side. Copies out the latest value, if there is one that was not taken yet.
+    bool take(T& out) {
+        if (!pending()) {
+            return false;
+        }
+        // Only the producer sets FRESH, so the buffer handed back here is always a fresh one
+        uint8_t previous = shared_.exchange(front_, std::memory_order_acq_rel);
+        front_ = previous & INDEX;
+        out = buffers_[front_];
+        return true;
+    }
+
+private:
+    static constexpr uint8_t INDEX = 0x03;
+    static constexpr uint8_t FRESH = 0x04;
+
+    T buffers_[3];
+    // Index of the buffer between the two sides, with FRESH set if it holds an untaken value
+    std::atomic<uint8_t> shared_{1};
+    uint8_t back_ = 0;  // Producer only
+    uint8_t front_ = 2; // Consumer only
+};
+
+#endif //OPEN_SENSOR_LATEST_SLOT_H
@@ -0,0 +1,226 @@
+#include "metrics.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+namespace metrics {
+
+namespace detail {
+std::atomic<int64_t> gauges[MAX_GAUGES] = {};
+}
+
+namespace {
+
+// Index 0 of each kind is the unreported slot that default handles and names past the
+// limit record into
+struct Names {
+    std::mutex mutex;
+    std::vector<std::string> counters{""};
+    std::vector<std::string> gauges{""};
+    std::vector<std::string> histograms{""};
+};
+
+Names& names() {
+    static Names instance;
+    return instance;
+}
+
+// Allocated by the threads that record, as they first do, and kept for the process; a
+// private shard given back by an exiting thread goes to the next thread that attaches
+std::atomic<detail::Shard*> shards[MAX_THREADS + 1] = {};
+
+uint16_t index_of(std::vector<std::string>& list, const std::string& name, size_t limit) {
+    auto found = std::find(list.begin(), list.end(), name);
+    if (found != list.end()) {
+        return static_cast<uint16_t>(found - list.begin());
+    }
+    if (list.size() >= limit) {
+        return 0;
+    }
+    list.push_back(name);
+    return static_cast<uint16_t>(list.size() - 1);
+}
+
+void append_name(std::string& out, const std::string& name) {
+    // Names are identifiers chosen in code, only quotes and backslashes need escaping
+    out += '"';
+    for (char c : name) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    out += "\":";
+}
+
+void append_number(std::string& out, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+void append_number(std::string& out, const char* format, ...) {
+    char buffer[32];
+    va_list args;
+    va_start(args, format);
+    int n = std::vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    out.append(buffer, static_cast<size_t>(std::clamp(n, 0, static_cast<int>(sizeof(buffer) - 1))));
+}
+
+}
+
+namespace detail {
+
+Shard& attach_thread() {
+    for (size_t slot = 0; slot < MAX_THREADS; ++slot) {
+        Shard* shard = shards[slot].load(std::memory_order_acquire);
+        if (shard == nullptr) {
+            auto* created = new Shard();
+            created->held.store(true, std::memory_order_relaxed);
+            if (shards[slot].compare_exchange_strong(shard, created, std::memory_order_acq_rel)) {
+                return *created;
+            }
+            // Another thread filled the slot first
+            delete created;
+        }
+        // Acquires the counts the previous holder wrote
+        bool held = false;
+        if (shard->held.compare_exchange_strong(held, true, std::memory_order_acquire)) {
+            return *shard;
+        }
+    }
+
+    // Out of private shards; the last one is shared by every further thread
+    Shard* shared = shards[MAX_THREADS].load(std::memory_order_acquire);
+    if (shared != nullptr) {
+        return *shared;
+    }
+    auto* created = new Shard();
+    created->shared = true;
+    if (shards[MAX_THREADS].compare_exchange_strong(shared, created, std::memory_order_acq_rel)) {
+        return *created;
+    }
+    delete created;
+    return *shared;
+}
+
+void detach_thread(Shard& shard) {
+    if (!shard.shared) {
+        shard.held.store(false, std::memory_order_release);
+    }
+}
+
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (auto& shard : shards) {
+        if (detail::Shard* s = shard.load(std::memory_order_acquire)) {
+            total += s->counters[index_].load(std::memory_order_relaxed);
+        }
+    }
+    return total;
+}
+
+Counter counter(const std::string& name) {
+    Names& n = names();
+    std::lock_guard<std::mutex> lock(n.mutex);
+    return Counter(index_of(n.counters, name, MAX_COUNTERS));
+}
+
+Gauge gauge(const std::string& name) {
+    Names& n = names();
+    std::lock_guard<std::mutex> lock(n.mutex);
+    return Gauge(index_of(n.gauges, name, MAX_GAUGES));
+}
+
+Histogram histogram(const std::string& name) {
+    Names& n = names();
+    std::lock_guard<std::mutex> lock(n.mutex);
+    return Histogram(index_of(n.histograms, name, MAX_HISTOGRAMS));
+}
+
+std::string snapshot_json(int64_t timestamp_ms) {
+    std::vector<std::string> counter_names, gauge_names, histogram_names;
+    {
+        Names& n = names();
+        std::lock_guard<std::mutex> lock(n.mutex);
+        counter_names = n.counters;
+        gauge_names = n.gauges;
+        histogram_names = n.histograms;
+    }
+    std::vector<detail::Shard*> live;
+    for (auto& shard : shards) {
+        if (detail::Shard* s = shard.load(std::memory_order_acquire)) {
+            live.push_back(s);
+        }
+    }
+
+    std::string out;
+    out.reserve(64 + 48 * (counter_names.size() + gauge_names.size()) + 112 * histogram_names.size());
+    out += "{\"t\":";
+    append_number(out, "%" PRId64, timestamp_ms);
+
+    out += ",\"counters\":{";
+    for (size_t i = 1; i < counter_names.size(); ++i) {
+        uint64_t total = 0;
+        for (detail::Shard* s : live) {
+            total += s->counters[i].load(std::memory_order_relaxed);
+        }
+        if (i > 1) out += ',';
+        append_name(out, counter_names[i]);
+        append_number(out, "%" PRIu64, total);
+    }
+
+    out += "},\"gauges\":{";
+    for (size_t i = 1; i < gauge_names.size(); ++i) {
+        if (i > 1) out += ',';
+        append_name(out, gauge_names[i]);
+        append_number(out, "%" PRId64, detail::gauges[i].load(std::memory_order_relaxed));
+    }
+
+    out += "},\"histograms\":{";
+    for (size_t i = 1; i < histogram_names.size(); ++i) {
+        uint64_t buckets[HISTOGRAM_BUCKETS] = {};
+        uint64_t count = 0, sum = 0;
+        for (detail::Shard* s : live) {
+            for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+                buckets[b] += s->buckets[i][b].load(std::memory_order_relaxed);
+            }
+            sum += s->sums[i].load(std::memory_order_relaxed);
+        }
+        for (uint64_t c : buckets) {
+            count += c;
+        }
+        // Value of the bucket holding the given rank, counting from 1
+        auto at_rank = [&](uint64_t rank) -> uint64_t {
+            uint64_t seen = 0;
+            for (size_t b = 0; b < HISTOGRAM_BUCKETS; ++b) {
+                seen += buckets[b];
+                if (seen >= rank && buckets[b] > 0) {
+                    return detail::bucket_floor(b);
+                }
+            }
+            return 0;
+        };
+        auto percentile = [&](uint64_t p) { return at_rank(std::max<uint64_t>(1, (count * p + 99) / 100)); };
+
+        if (i > 1) out += ',';
+        append_name(out, histogram_names[i]);
+        out += "{\"n\":";
+        append_number(out, "%" PRIu64, count);
+        out += ",\"mean\":";
+        append_number(out, "%" PRIu64, count > 0 ? sum / count : 0);
+        out += ",\"p50\":";
+        append_number(out, "%" PRIu64, count > 0 ? percentile(50) : 0);
+        out += ",\"p90\":";
+        append_number(out, "%" PRIu64, count > 0 ? percentile(90) : 0);
+        out += ",\"p99\":";
+        append_number(out, "%" PRIu64, count > 0 ? percentile(99) : 0);
+        out += ",\"max\":";
+        append_number(out, "%" PRIu64, count > 0 ? at_rank(count) : 0);
+        out += '}';
+    }
+    out += "}}";
+    return out;
+}
+
+}
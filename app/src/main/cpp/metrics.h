@@ -0,0 +1,149 @@
+#ifndef OPEN_SENSOR_METRICS_H
+#define OPEN_SENSOR_METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Process-wide registry of named counters, gauges and histograms for the native pipeline,
+// cheap enough to update for every sample.
+//
+// Counters and histograms are sharded per thread. A thread that records holds one of
+// MAX_THREADS cache-line aligned blocks, which only it writes, so an update is a relaxed
+// load and store with no locked instruction and no cache line shared with another thread.
+// It gives the block back when it exits, and the next thread to record takes it over with
+// the counts in it, so short-lived threads do not use up the blocks. Threads beyond
+// MAX_THREADS running at once share one block updated with atomic adds. Gauges are single
+// atomics set by the code owning the value. A snapshot sums the shards; it is consistent
+// per metric but not across metrics.
+//
+// Histograms take unsigned values in the unit their name gives (..._us, ..._ns) into
+// log-linear buckets, four per power of two, so percentiles are exact below 4 and within
+// 25% above. Values from 2^32 up fall into the last bucket.
+//
+// Metrics are registered once by name, usually when their owner is constructed, and
+// registering a name again returns the same metric, so owners that are recreated keep
+// counting where the previous one stopped. Registration takes a lock; recording never does.
+// Once the registry is full, further names share a slot that is not reported.
+namespace metrics {
+
+constexpr size_t MAX_COUNTERS = 128;
+constexpr size_t MAX_GAUGES = 32;
+constexpr size_t MAX_HISTOGRAMS = 16;
+constexpr size_t MAX_THREADS = 15;
+constexpr size_t HISTOGRAM_BUCKETS = 4 + 4 * 30;
+
+namespace detail {
+
+struct alignas(64) Shard {
+    std::atomic<uint64_t> counters[MAX_COUNTERS] = {};
+    std::atomic<uint64_t> sums[MAX_HISTOGRAMS] = {};
+    std::atomic<uint64_t> buckets[MAX_HISTOGRAMS][HISTOGRAM_BUCKETS] = {};
+    // Written by several threads, the overflow shard
+    bool shared = false;
+    // Held by a running thread; private shards only
+    std::atomic<bool> held{false};
+};
+
+extern std::atomic<int64_t> gauges[MAX_GAUGES];
+
+Shard& attach_thread();
+void detach_thread(Shard& shard);
+
+// Gives the thread's shard back when the thread exits
+struct ShardLease {
+    Shard& shard = attach_thread();
+    ~ShardLease() { detach_thread(shard); }
+};
+
+inline Shard& local_shard() {
+    thread_local ShardLease lease;
+    return lease.shard;
+}
+
+template<typename T>
+inline void increment(std::atomic<T>& value, T n, bool shared) {
+    if (shared) {
+        value.fetch_add(n, std::memory_order_relaxed);
+    } else {
+        value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+}
+
+inline size_t bucket_index(uint64_t value) {
+    if (value < 4) {
+        return static_cast<size_t>(value);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    size_t index = 4 + static_cast<size_t>(exponent - 2) * 4 + static_cast<size_t>((value >> (exponent - 2)) & 3);
+    return index < HISTOGRAM_BUCKETS ? index : HISTOGRAM_BUCKETS - 1;
+}
+
+// Smallest value counted in a bucket
+inline uint64_t bucket_floor(size_t index) {
+    if (index < 4) {
+        return index;
+    }
+    size_t exponent = (index - 4) / 4 + 2;
+    return static_cast<uint64_t>(4 + (index - 4) % 4) << (exponent - 2);
+}
+
+}
+
+class Counter {
+public:
+    Counter() = default;
+    void add(uint64_t n = 1) const {
+        detail::Shard& shard = detail::local_shard();
+        detail::increment(shard.counters[index_], n, shard.shared);
+    }
+    // Sum over all threads; for tools and tests, the diagnostics use snapshot_json
+    uint64_t value() const;
+
+private:
+    friend Counter counter(const std::string& name);
+    explicit Counter(uint16_t index) : index_(index) {}
+    uint16_t index_ = 0;
+};
+
+class Gauge {
+public:
+    Gauge() = default;
+    void set(int64_t value) const { detail::gauges[index_].store(value, std::memory_order_relaxed); }
+    void add(int64_t delta) const { detail::gauges[index_].fetch_add(delta, std::memory_order_relaxed); }
+    int64_t value() const { return detail::gauges[index_].load(std::memory_order_relaxed); }
+
+private:
+    friend Gauge gauge(const std::string& name);
+    explicit Gauge(uint16_t index) : index_(index) {}
+    uint16_t index_ = 0;
+};
+
+class Histogram {
+public:
+    Histogram() = default;
+    void record(uint64_t value) const {
+        detail::Shard& shard = detail::local_shard();
+        detail::increment(shard.buckets[index_][detail::bucket_index(value)], uint64_t{1}, shard.shared);
+        detail::increment(shard.sums[index_], value, shard.shared);
+    }
+
+private:
+    friend Histogram histogram(const std::string& name);
+    explicit Histogram(uint16_t index) : index_(index) {}
+    uint16_t index_ = 0;
+};
+
+Counter counter(const std::string& name);
+Gauge gauge(const std::string& name);
+Histogram histogram(const std::string& name);
+
+// {"t":<ms>,"counters":{"<name>":<n>,...},"gauges":{...},
+//  "histograms":{"<name>":{"n":..,"mean":..,"p50":..,"p90":..,"p99":..,"max":..},...}}
+// Percentiles and the maximum are the lower bounds of their buckets.
+std::string snapshot_json(int64_t timestamp_ms);
+
+}
+
+#endif //OPEN_SENSOR_METRICS_H
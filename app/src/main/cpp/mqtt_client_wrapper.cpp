@@ -1,14 +1,31 @@
 #include "mqtt_client_wrapper.h"
-#include <android/log.h>
+#include "platform_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
+#include <boost/asio/bind_allocator.hpp>
 #include <boost/asio/dispatch.hpp>
+#include <boost/asio/post.hpp>
 #include <boost/asio/executor_work_guard.hpp>
 #include <boost/url/url_view.hpp>
 
 #define LOG_TAG "MqttClientWrapper"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+
+namespace {
+
+uint32_t microseconds_since(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point now) {
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(now - start).count();
+    return static_cast<uint32_t>(std::clamp<int64_t>(elapsed, 0, UINT32_MAX));
+}
+
+std::string format_ms(uint32_t us) {
+    char text[16];
+    snprintf(text, sizeof(text), "%.1f", static_cast<double>(us) / 1000.0);
+    return text;
+}
+
+}
 
 // External customization point.
 namespace boost::mqtt5 {
@@ -21,18 +38,44 @@ struct tls_handshake_type<boost::asio::ssl::stream<StreamBase>> {
 
 // This client uses this function to indicate which hostname it is
 // attempting to connect to at the start of the handshaking process.
+// The wrapper's session cache also offers the session to resume, and supplies the name
+// when the client connects to an address resolved earlier.
 template<typename StreamBase>
 void assign_tls_sni(
         const authority_path &ap,
-        boost::asio::ssl::context & /* ctx */,
+        boost::asio::ssl::context &ctx,
         boost::asio::ssl::stream<StreamBase> &stream
 ) {
-    SSL_set_tlsext_host_name(stream.native_handle(), ap.host.c_str());
+    if (TlsSessionCache* sessions = TlsSessionCache::from(ctx.native_handle())) {
+        sessions->prepare(stream.native_handle(), ap.host);
+    } else {
+        SSL_set_tlsext_host_name(stream.native_handle(), ap.host.c_str());
+    }
 }
 
 }
 
-MqttClientWrapper::MqttClientWrapper(std::string log_file_path) : logger_{*this, std::move(log_file_path)} {
+MqttClientWrapper::client_metrics::client_metrics()
+    : publishes(metrics::counter("mqtt.publishes")),
+      bytes(metrics::counter("mqtt.bytes")),
+      publish_errors(metrics::counter("mqtt.publish_errors")),
+      window_rejected(metrics::counter("mqtt.window_rejected")),
+      window_dropped(metrics::counter("mqtt.window_dropped")),
+      window_coalesced(metrics::counter("mqtt.window_coalesced")),
+      feed_drops(metrics::counter("mqtt.feed_drops")),
+      offline_stored(metrics::counter("mqtt.offline_stored")),
+      connections(metrics::counter("mqtt.connections")),
+      connected(metrics::gauge("mqtt.connected")),
+      in_flight{metrics::gauge("mqtt.in_flight.qos0"), metrics::gauge("mqtt.in_flight.qos1")},
+      held{metrics::gauge("mqtt.held.qos0"), metrics::gauge("mqtt.held.qos1")},
+      feed_queue_depth(metrics::gauge("mqtt.feed_queue_depth")),
+      offline_messages(metrics::gauge("mqtt.offline_messages")),
+      puback_us(metrics::histogram("mqtt.puback_us")),
+      connect_us(metrics::histogram("mqtt.connect_us")),
+      sample_age_us(metrics::histogram("mqtt.sample_age_us")) {}
+
+MqttClientWrapper::MqttClientWrapper(const std::string& log_file_path) : log_{log_file_path}, logger_{*this} {
+    tls_sessions_.attach(tls_context_.native_handle());
     ioc_thread_ = std::thread([this]() {
         LOGD("Starting io_context thread.");
         auto work_guard = boost::asio::make_work_guard(ioc_);
@@ -49,7 +92,68 @@ MqttClientWrapper::~MqttClientWrapper() {
     }
 }
 
+void MqttClientWrapper::set_offline_store(std::string path, size_t capacity_bytes, int drain_rate) {
+    boost::asio::dispatch(ioc_, [this, path = std::move(path), capacity_bytes, drain_rate] {
+        store_drain_rate_ = drain_rate > 0 ? drain_rate : 1;
+        if (capacity_bytes == 0) {
+            offline_store_.close();
+            return;
+        }
+        if (!offline_store_.open(path, capacity_bytes)) {
+            logger_.log("Cannot open the offline store at " + path + "; publishes wait in memory while offline");
+            return;
+        }
+        if (!offline_store_.empty()) {
+            logger_.log(std::to_string(offline_store_.size()) + " messages stored while offline are waiting to be sent");
+            if (connected_.load(std::memory_order_relaxed)) schedule_store_drain();
+        }
+    });
+}
+
+void MqttClientWrapper::set_in_flight_window(size_t qos0_window, size_t qos1_window, window_policy policy) {
+    windows_[0].limit.store(qos0_window > 0 ? qos0_window : 1, std::memory_order_relaxed);
+    windows_[1].limit.store(qos1_window > 0 ? qos1_window : 1, std::memory_order_relaxed);
+    window_policy_.store(policy, std::memory_order_relaxed);
+}
+
+void MqttClientWrapper::set_write_coalescing(std::chrono::microseconds window, size_t byte_budget) {
+    boost::asio::dispatch(ioc_, [this, window, byte_budget] {
+        flush_scheduler_.configure(window, byte_budget);
+    });
+}
+
+void MqttClientWrapper::set_diagnostics(std::string topic, std::chrono::seconds interval) {
+    boost::asio::dispatch(ioc_, [this, topic = std::move(topic), interval]() mutable {
+        diagnostics_topic_ = std::move(topic);
+        diagnostics_interval_ = interval.count() > 0 ? interval : std::chrono::seconds{0};
+        diagnostics_timer_.cancel();
+        schedule_diagnostics();
+    });
+}
+
+MqttClientWrapper::publish_stats MqttClientWrapper::stats() const {
+    publish_stats stats{};
+    for (size_t level = 0; level < windows_.size(); ++level) {
+        stats.in_flight[level] = windows_[level].in_flight.load(std::memory_order_relaxed);
+        stats.held[level] = windows_[level].held_count.load(std::memory_order_relaxed);
+    }
+    stats.rejected = window_rejected_.load(std::memory_order_relaxed);
+    stats.dropped = window_dropped_.load(std::memory_order_relaxed);
+    stats.coalesced = window_coalesced_.load(std::memory_order_relaxed);
+    stats.puback_latency_us = puback_latency_us_.load(std::memory_order_relaxed);
+    stats.max_puback_latency_us = max_puback_latency_us_.load(std::memory_order_relaxed);
+    stats.topic_alias_maximum = topic_alias_maximum_.load(std::memory_order_relaxed);
+    stats.aliased = aliased_publishes_.load(std::memory_order_relaxed);
+    stats.alias_bytes_saved = alias_bytes_saved_.load(std::memory_order_relaxed);
+    stats.connect_us = connect_us_.load(std::memory_order_relaxed);
+    stats.tls_resumptions = tls_resumptions_.load(std::memory_order_relaxed);
+    stats.write_batches = flush_scheduler_.flushes();
+    stats.batched_publishes = flush_scheduler_.messages();
+    return stats;
+}
+
 void MqttClientWrapper::connect(const std::string& broker_url, const std::string& client_id, const std::string& username, const std::string& password, const std::string& will_topic, const std::string& will_payload) {
+    connection_wanted_.store(true, std::memory_order_release);
     boost::asio::dispatch(ioc_, [this, broker_url, client_id, username, password, will_topic, will_payload] {
         logger_.log("Trying to connect...");
 
@@ -57,49 +161,141 @@ void MqttClientWrapper::connect(const std::string& broker_url, const std::string
         will_payload_ = will_payload;
 
         boost::urls::url_view u(broker_url);
+        broker_.host = u.host();
+        broker_.port = u.port_number();
+        broker_.tls = u.scheme() == "tls" || u.scheme() == "mqtts";
+        broker_.client_id = client_id;
+        broker_.username = username;
+        broker_.password = password;
+        start_client();
+    });
+}
 
-        try {
-            if (u.scheme() == "tls" || u.scheme() == "mqtts") {
-                auto& client = client_.emplace<mqtts_client_t>(
-                        ioc_,
-                        boost::asio::ssl::context(boost::asio::ssl::context::tls_client),
-                        logger_);
-
-                if (!will_topic.empty()) {
-                    client.will(boost::mqtt5::will(will_topic, will_payload, boost::mqtt5::qos_e::at_most_once, boost::mqtt5::retain_e::yes));
-                }
+void MqttClientWrapper::start_client() {
+    auto now = std::chrono::steady_clock::now();
+    std::string hosts = broker_.host;
+    using_resolved_ = resolved_.count > 0 && resolved_.host == broker_.host && resolved_.port == broker_.port &&
+                      now - resolved_.resolved < RESOLVED_BROKER_TTL;
+    if (using_resolved_) {
+        hosts = resolved_.addresses;
+        resolved_failures_ = 0;
+        logger_.log("Using the addresses of " + broker_.host + " resolved "
+                    + std::to_string(std::chrono::duration_cast<std::chrono::seconds>(now - resolved_.resolved).count())
+                    + " s ago: " + hosts);
+    }
+    // SNI and the session cache go by the name even when connecting to an address
+    tls_sessions_.set_server_name(broker_.host);
+    attempt_ = {};
+    first_attempt_ = true;
+    phase_started_ = now;
 
-                client.brokers(u.host(), u.port_number())
-                        .credentials(client_id, username, password)
-                        .connect_property(boost::mqtt5::prop::session_expiry_interval, 60)
-                        .keep_alive(30)
-                        .async_run(boost::asio::detached);
-            } else {
-                auto& client = client_.emplace<mqtt_client_t>(
-                        ioc_,
-                        std::monostate{},
-                        logger_);
-
-                if (!will_topic.empty()) {
-                    client.will(boost::mqtt5::will(will_topic, will_payload, boost::mqtt5::qos_e::at_most_once, boost::mqtt5::retain_e::yes));
-                }
+    try {
+        if (broker_.tls) {
+            // The client's context takes over a reference to the shared SSL_CTX
+            SSL_CTX_up_ref(tls_context_.native_handle());
+            auto& client = client_.emplace<mqtts_client_t>(
+                    ioc_,
+                    boost::asio::ssl::context(tls_context_.native_handle()),
+                    logger_);
 
-                client.brokers(u.host(), u.port_number())
-                        .credentials(client_id, username, password)
-                        .connect_property(boost::mqtt5::prop::session_expiry_interval, 60)
-                        .keep_alive(30)
-                        .async_run(boost::asio::detached);
+            if (!will_topic_.empty()) {
+                client.will(boost::mqtt5::will(will_topic_, will_payload_, boost::mqtt5::qos_e::at_most_once, boost::mqtt5::retain_e::yes));
             }
-        } catch (const std::exception& e) {
-            LOGE("MQTT connection failed: %s", e.what());
-            logger_.log("MQTT connection failed: " + std::string(e.what()));
-            client_.emplace<std::monostate>();
+
+            client.brokers(hosts, broker_.port)
+                    .credentials(broker_.client_id, broker_.username, broker_.password)
+                    .connect_property(boost::mqtt5::prop::session_expiry_interval, 60)
+                    .keep_alive(30)
+                    .async_run(boost::asio::detached);
+        } else {
+            auto& client = client_.emplace<mqtt_client_t>(
+                    ioc_,
+                    std::monostate{},
+                    logger_);
+
+            if (!will_topic_.empty()) {
+                client.will(boost::mqtt5::will(will_topic_, will_payload_, boost::mqtt5::qos_e::at_most_once, boost::mqtt5::retain_e::yes));
+            }
+
+            client.brokers(hosts, broker_.port)
+                    .credentials(broker_.client_id, broker_.username, broker_.password)
+                    .connect_property(boost::mqtt5::prop::session_expiry_interval, 60)
+                    .keep_alive(30)
+                    .async_run(boost::asio::detached);
         }
-    });
+    } catch (const std::exception& e) {
+        LOGE("MQTT connection failed: %s", e.what());
+        logger_.log("MQTT connection failed: " + std::string(e.what()));
+        client_.emplace<std::monostate>();
+    }
+    // Waiting publishes go to the new client, which sends them once connected
+    flush_scheduler_.flush();
+}
+
+void MqttClientWrapper::on_resolved(boost::system::error_code ec, std::string_view host,
+                                    const boost::asio::ip::tcp::resolver::results_type& endpoints) {
+    auto now = std::chrono::steady_clock::now();
+    if (first_attempt_) {
+        attempt_.resolve_us = microseconds_since(phase_started_, now);
+    }
+    phase_started_ = now;
+
+    // Only lookups of the name count; the cached addresses resolve to themselves
+    if (ec || host != broker_.host) return;
+    resolved_broker resolved;
+    for (const auto& entry : endpoints) {
+        auto address = entry.endpoint().address();
+        if (!address.is_v4()) continue;
+        std::string literal = address.to_string();
+        if (resolved.addresses.find(literal) != std::string::npos) continue;
+        if (resolved.count > 0) resolved.addresses += ',';
+        resolved.addresses += literal;
+        ++resolved.count;
+    }
+    if (resolved.count == 0) return;
+    resolved.host = broker_.host;
+    resolved.port = broker_.port;
+    resolved.resolved = now;
+    resolved_ = std::move(resolved);
+}
+
+void MqttClientWrapper::on_tcp_connected(boost::system::error_code ec) {
+    if (!ec) {
+        auto now = std::chrono::steady_clock::now();
+        attempt_.tcp_us = microseconds_since(phase_started_, now);
+        phase_started_ = now;
+        resolved_failures_ = 0;
+        return;
+    }
+    // Addresses that answered before may be gone after a network change. Once none of them
+    // accepts a connection, start over from the name with a new client; like on any
+    // connect(), messages still waiting in the old one are lost.
+    if (using_resolved_ && ++resolved_failures_ >= resolved_.count) {
+        logger_.log("Addresses cached for " + broker_.host + " do not answer; resolving it again");
+        using_resolved_ = false;
+        resolved_ = {};
+        boost::asio::post(ioc_, [this] {
+            if (connection_wanted_.load(std::memory_order_acquire)) start_client();
+        });
+    }
+}
+
+void MqttClientWrapper::on_tls_handshake(boost::system::error_code ec) {
+    if (ec) {
+        // A rejected session would otherwise be offered again
+        tls_sessions_.forget(broker_.host);
+        return;
+    }
+    auto now = std::chrono::steady_clock::now();
+    attempt_.tls_us = microseconds_since(phase_started_, now);
+    attempt_.tls_resumed = tls_sessions_.last_resumed();
+    phase_started_ = now;
 }
 
 void MqttClientWrapper::disconnect() {
+    connection_wanted_.store(false, std::memory_order_release);
     boost::asio::dispatch(ioc_, [this]() {
+        flush_scheduler_.flush();
         if (!std::holds_alternative<std::monostate>(client_)) {
             try {
                 std::visit([this](auto&& cli) {
@@ -129,41 +325,603 @@ void MqttClientWrapper::disconnect() {
     });
 }
 
-bool MqttClientWrapper::publish(const std::string& topic, const std::string& payload, bool retain, int qos) {
-    boost::asio::dispatch(ioc_, [this, topic, payload, retain, qos] {
-        if (!std::holds_alternative<std::monostate>(client_)) {
-            try {
-                std::visit([&](auto&& cli) {
-                    using T = std::decay_t<decltype(cli)>;
-                    if constexpr (!std::is_same_v<T, std::monostate>) {
-                        if (qos == 1) {
-                            cli.template async_publish<boost::mqtt5::qos_e::at_least_once>(
-                                    topic,
-                                    payload,
-                                    retain ? boost::mqtt5::retain_e::yes : boost::mqtt5::retain_e::no,
-                                    boost::mqtt5::publish_props {},
-                                    [this](auto ec, auto rc, const auto& props) {
-                                        if (ec) logger_.log(ec.message());
-                                    });
-                        } else {
-                            cli.template async_publish<boost::mqtt5::qos_e::at_most_once>(
-                                    topic,
-                                    payload,
-                                    retain ? boost::mqtt5::retain_e::yes : boost::mqtt5::retain_e::no,
-                                    boost::mqtt5::publish_props {},
-                                    [this](auto ec) {
-                                        if (ec) logger_.log(ec.message());
-                                    });
-                        }
+bool MqttClientWrapper::publish(const std::string& topic, const std::string& payload, bool retain, int qos,
+                                PayloadEncoding encoding, pipeline_trace::origin origin) {
+    if (!connection_wanted_.load(std::memory_order_acquire) || !admit(qos_level(qos))) {
+        return false;
+    }
+
+    boost::asio::dispatch(ioc_, [this, topic, payload, retain, qos, encoding, origin] {
+        publish_now(topic, payload, retain, qos, encoding, origin);
+    });
+
+    return true;
+}
+
+bool MqttClientWrapper::admit(size_t level) {
+    qos_window& w = windows_[level];
+    size_t admitted = w.admitted.fetch_add(1, std::memory_order_acq_rel);
+    if (admitted < w.shared() ||
+        window_policy_.load(std::memory_order_relaxed) != window_policy::reject) {
+        return true;
+    }
+    w.admitted.fetch_sub(1, std::memory_order_acq_rel);
+    window_rejected_.fetch_add(1, std::memory_order_relaxed);
+    metrics_.window_rejected.add();
+    return false;
+}
+
+void MqttClientWrapper::release(size_t level) {
+    windows_[level].admitted.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void MqttClientWrapper::publish_now(std::string topic, std::string payload, bool retain, int qos,
+                                    PayloadEncoding encoding, const pipeline_trace::origin& origin) {
+    if (!connected_.load(std::memory_order_relaxed) && offline_store_.is_open() &&
+        connection_wanted_.load(std::memory_order_relaxed)) {
+        // Bounded, unlike the client's own queue, and kept across restarts
+        offline_store_.push(topic, payload, retain, qos, static_cast<uint8_t>(encoding));
+        metrics_.offline_stored.add();
+        release(qos_level(qos));
+        return;
+    }
+    submit(std::move(topic), std::move(payload), retain, qos, encoding, origin);
+}
+
+void MqttClientWrapper::submit(std::string topic, std::string payload, bool retain, int qos,
+                               PayloadEncoding encoding, const pipeline_trace::origin& origin) {
+    size_t level = qos_level(qos);
+    qos_window& w = windows_[level];
+    if (w.held.empty() && w.in_flight.load(std::memory_order_relaxed) < w.shared()) {
+        send(std::move(topic), std::move(payload), retain, qos, encoding, origin);
+        return;
+    }
+
+    // Under reject, publish() admitted no more than the shared places, so what is held here
+    // waits only for reserved places taken by the coalescing slots or the store replay
+    size_t limit = w.limit.load(std::memory_order_relaxed);
+    window_policy policy = window_policy_.load(std::memory_order_relaxed);
+    if (policy == window_policy::coalesce) {
+        auto same_topic = std::find_if(w.held.begin(), w.held.end(),
+                                       [&topic](const held_message& m) { return m.topic == topic; });
+        if (same_topic != w.held.end()) {
+            same_topic->payload = std::move(payload);
+            same_topic->retain = retain;
+            same_topic->encoding = encoding;
+            same_topic->origin = origin;
+            same_topic->held_ns = origin.trace_id != 0 ? pipeline_trace::now_ns() : 0;
+            window_coalesced_.fetch_add(1, std::memory_order_relaxed);
+            metrics_.window_coalesced.add();
+            release(level);
+            return;
+        }
+    }
+    if (w.held.size() >= limit) {
+        w.held.pop_front();
+        window_dropped_.fetch_add(1, std::memory_order_relaxed);
+        metrics_.window_dropped.add();
+        release(level);
+    }
+    w.held.push_back(held_message{std::move(topic), std::move(payload), retain, encoding, origin,
+                                  origin.trace_id != 0 ? pipeline_trace::now_ns() : 0});
+    w.held_count.store(w.held.size(), std::memory_order_relaxed);
+}
+
+void MqttClientWrapper::send_held(size_t level) {
+    qos_window& w = windows_[level];
+    while (!w.held.empty() && w.in_flight.load(std::memory_order_relaxed) < w.shared()) {
+        held_message message = std::move(w.held.front());
+        w.held.pop_front();
+        if (message.origin.trace_id != 0) {
+            pipeline_trace::span("window", message.origin.trace_id, message.held_ns, pipeline_trace::now_ns());
+        }
+        send(std::move(message.topic), std::move(message.payload), message.retain, static_cast<int>(level),
+             message.encoding, message.origin);
+    }
+    w.held_count.store(w.held.size(), std::memory_order_relaxed);
+}
+
+void MqttClientWrapper::update_reservations() {
+    std::array<size_t, 2> reserved{};
+    int count = feed_count_.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i) {
+        const feed& f = *feeds_[i];
+        if (f.mode.load(std::memory_order_relaxed) == feed_mode::coalesce) {
+            ++reserved[qos_level(f.qos.load(std::memory_order_relaxed))];
+        }
+    }
+    if (!offline_store_.empty()) {
+        // Stored messages of either level may be next
+        ++reserved[0];
+        ++reserved[1];
+    }
+    for (size_t level = 0; level < reserved.size(); ++level) {
+        windows_[level].reserved.store(reserved[level], std::memory_order_relaxed);
+    }
+}
+
+void MqttClientWrapper::on_publish_complete(size_t level, std::chrono::steady_clock::time_point sent,
+                                            const pipeline_trace::origin& origin, int64_t sent_ns) {
+    windows_[level].in_flight.fetch_sub(1, std::memory_order_relaxed);
+    release(level);
+
+    if (origin.sensor_ns != 0 || origin.trace_id != 0) {
+        int64_t now = pipeline_trace::now_ns();
+        if (origin.sensor_ns != 0) {
+            metrics_.sample_age_us.record(static_cast<uint64_t>(std::max<int64_t>(now - origin.sensor_ns, 0) / 1000));
+        }
+        if (origin.trace_id != 0) {
+            pipeline_trace::span(level == 1 ? "puback" : "write", origin.trace_id, sent_ns, now);
+        }
+    }
+
+    if (level == 1) {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - sent);
+        auto sample = static_cast<uint32_t>(std::min<int64_t>(elapsed.count(), UINT32_MAX));
+        metrics_.puback_us.record(sample);
+        // Moving average over roughly the last eight acknowledgements
+        uint32_t average = puback_latency_us_.load(std::memory_order_relaxed);
+        puback_latency_us_.store(average == 0 ? sample : average - average / 8 + sample / 8, std::memory_order_relaxed);
+        if (sample > max_puback_latency_us_.load(std::memory_order_relaxed)) {
+            max_puback_latency_us_.store(sample, std::memory_order_relaxed);
+        }
+    }
+
+    send_held(level);
+    if (latest_waiting_) {
+        schedule_drain();
+    }
+    metrics_.in_flight[level].set(static_cast<int64_t>(windows_[level].in_flight.load(std::memory_order_relaxed)));
+}
+
+bool MqttClientWrapper::send(std::string topic, std::string payload, bool retain, int qos,
+                             PayloadEncoding encoding, const pipeline_trace::origin& origin) {
+    if (!flush_scheduler_.enabled() || std::holds_alternative<std::monostate>(client_)) {
+        return write(std::move(topic), std::move(payload), retain, qos, encoding, origin);
+    }
+    // In flight from here, so that the window also covers the batch
+    windows_[qos_level(qos)].in_flight.fetch_add(1, std::memory_order_relaxed);
+    // Close to the PUBLISH size: fixed header, topic and property lengths, properties
+    size_t bytes = 16 + topic.size() + payload.size() + std::strlen(contentType(encoding));
+    write_queue_.push_back({std::move(topic), std::move(payload), retain, qos, encoding, origin,
+                            origin.trace_id != 0 ? pipeline_trace::now_ns() : 0});
+    flush_scheduler_.add(bytes);
+    return true;
+}
+
+void MqttClientWrapper::flush_writes() {
+    // Swapped so that both vectors keep their capacity
+    write_batch_.swap(write_queue_);
+    for (queued_write& w : write_batch_) {
+        // write() counts the message in flight again
+        windows_[qos_level(w.qos)].in_flight.fetch_sub(1, std::memory_order_relaxed);
+        if (w.origin.trace_id != 0) {
+            pipeline_trace::span("write batch", w.origin.trace_id, w.queued_ns, pipeline_trace::now_ns());
+        }
+        write(std::move(w.topic), std::move(w.payload), w.retain, w.qos, w.encoding, w.origin);
+    }
+    write_batch_.clear();
+}
+
+bool MqttClientWrapper::write(std::string topic, std::string payload, bool retain, int qos,
+                              PayloadEncoding encoding, const pipeline_trace::origin& origin) {
+    size_t level = qos_level(qos);
+    if (!std::holds_alternative<std::monostate>(client_)) {
+        boost::mqtt5::publish_props properties;
+        properties[boost::mqtt5::prop::content_type] = contentType(encoding);
+        properties[boost::mqtt5::prop::payload_format_indicator] = static_cast<uint8_t>(isTextEncoding(encoding) ? 1 : 0);
+        // Only QoS 0 publishes use aliases: the client resends unacknowledged QoS 1 ones as they
+        // were after a reconnect, when the broker has forgotten the aliases
+        uint16_t alias = 0;
+        if (qos == 0 && connected_.load(std::memory_order_relaxed)) {
+            bool with_topic = false;
+            alias = topic_aliases_.lookup(topic, with_topic);
+            if (alias != 0) {
+                properties[boost::mqtt5::prop::topic_alias] = alias;
+                auto saved = static_cast<int64_t>(with_topic ? 0 : topic.size()) -
+                             static_cast<int64_t>(TopicAliasTable::PROPERTY_SIZE);
+                alias_bytes_saved_.fetch_add(saved, std::memory_order_relaxed);
+                aliased_publishes_.fetch_add(1, std::memory_order_relaxed);
+                if (!with_topic) {
+                    topic.clear();
+                }
+            }
+        }
+        try {
+            std::visit([&](auto&& cli) {
+                using T = std::decay_t<decltype(cli)>;
+                if constexpr (!std::is_same_v<T, std::monostate>) {
+                    // Completion handlers are allocated from recycled blocks rather than the heap
+                    handler_allocator<void> allocator(publish_handler_memory_);
+                    auto sent = std::chrono::steady_clock::now();
+                    int64_t sent_ns = origin.trace_id != 0 ? pipeline_trace::now_ns() : 0;
+                    windows_[level].in_flight.fetch_add(1, std::memory_order_relaxed);
+                    metrics_.publishes.add();
+                    metrics_.bytes.add(topic.size() + payload.size());
+                    if (qos == 1) {
+                        cli.template async_publish<boost::mqtt5::qos_e::at_least_once>(
+                                std::move(topic),
+                                std::move(payload),
+                                retain ? boost::mqtt5::retain_e::yes : boost::mqtt5::retain_e::no,
+                                properties,
+                                boost::asio::bind_allocator(allocator, [this, sent, origin, sent_ns](auto ec, auto rc, const auto& props) {
+                                    if (ec) {
+                                        logger_.log(ec.message());
+                                        metrics_.publish_errors.add();
+                                    }
+                                    on_publish_complete(1, sent, origin, sent_ns);
+                                }));
+                    } else {
+                        cli.template async_publish<boost::mqtt5::qos_e::at_most_once>(
+                                std::move(topic),
+                                std::move(payload),
+                                retain ? boost::mqtt5::retain_e::yes : boost::mqtt5::retain_e::no,
+                                properties,
+                                boost::asio::bind_allocator(allocator, [this, sent, origin, sent_ns](auto ec) {
+                                    if (ec) {
+                                        logger_.log(ec.message());
+                                        metrics_.publish_errors.add();
+                                    }
+                                    on_publish_complete(0, sent, origin, sent_ns);
+                                }));
                     }
-                }, client_);
-            } catch (const std::exception& e) {
-                LOGE("MQTT publish error: %s", e.what());
+                }
+            }, client_);
+            return true;
+        } catch (const std::exception& e) {
+            LOGE("MQTT publish error: %s", e.what());
+            // Thrown before the handler was taken over, so it will not complete
+            windows_[level].in_flight.fetch_sub(1, std::memory_order_relaxed);
+            topic_aliases_.forget(alias);
+        }
+    } else {
+        LOGW("MQTT publish called but client is not connected.");
+    }
+    metrics_.publish_errors.add();
+    release(level);
+    return false;
+}
+
+void MqttClientWrapper::set_feed_options(size_t queue_depth, overflow_policy policy) {
+    feed_queue_depth_ = queue_depth > 0 ? queue_depth : 1;
+    feed_overflow_policy_ = policy;
+}
+
+MqttClientWrapper::feed_id MqttClientWrapper::register_feed(std::string topic) {
+    int index = feed_count_.load(std::memory_order_relaxed);
+    if (index >= static_cast<int>(MAX_FEEDS)) {
+        LOGE("Cannot register more than %zu feeds.", MAX_FEEDS);
+        return invalid_feed;
+    }
+
+    feeds_[index] = std::make_unique<feed>(feed_queue_depth_, feed_overflow_policy_, std::move(topic));
+    // Publishing the new count makes the feed visible to the io_context thread
+    feed_count_.store(index + 1, std::memory_order_release);
+    LOGD("Registered feed %d with queue depth %zu.", index, feeds_[index]->ring.capacity());
+    return index;
+}
+
+void MqttClientWrapper::set_feed_topic(feed_id id, std::string topic) {
+    if (id < 0 || id >= feed_count_.load(std::memory_order_acquire)) return;
+
+    boost::asio::dispatch(ioc_, [this, id, topic = std::move(topic)]() mutable {
+        feeds_[id]->topic = std::move(topic);
+    });
+}
+
+void MqttClientWrapper::set_feed_mode(feed_id id, feed_mode mode) {
+    if (id < 0 || id >= feed_count_.load(std::memory_order_acquire)) return;
+    feeds_[id]->mode.store(mode, std::memory_order_relaxed);
+}
+
+void MqttClientWrapper::set_feed_qos(feed_id id, int qos) {
+    if (id < 0 || id >= feed_count_.load(std::memory_order_acquire)) return;
+    feeds_[id]->qos.store(qos >= 1 ? 1 : 0, std::memory_order_relaxed);
+}
+
+bool MqttClientWrapper::publish(feed_id id, const char* payload, size_t length, PayloadEncoding encoding,
+                                pipeline_trace::origin origin) {
+    if (id < 0 || id >= feed_count_.load(std::memory_order_acquire) || length > max_feed_payload ||
+        !connection_wanted_.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    feed& f = *feeds_[id];
+    publish_record record;
+    record.length = static_cast<uint16_t>(length);
+    record.encoding = encoding;
+    record.origin = origin;
+    record.queued_ns = origin.trace_id != 0 ? pipeline_trace::now_ns() : 0;
+    std::memcpy(record.payload, payload, length);
+
+    if (f.mode.load(std::memory_order_relaxed) == feed_mode::coalesce) {
+        if (!f.latest.store(record)) {
+            f.coalesced.fetch_add(1, std::memory_order_relaxed);
+        }
+        schedule_drain();
+        return true;
+    }
+
+    // Admitted while queued, so that the drain never has to turn an accepted sample away;
+    // a sample dropped from the queue gives its place back
+    record.qos = static_cast<uint8_t>(f.qos.load(std::memory_order_relaxed));
+    if (!admit(qos_level(record.qos))) {
+        return false;
+    }
+
+    bool accepted;
+    if (f.policy == overflow_policy::drop_oldest) {
+        publish_record discarded;
+        if (!f.ring.push_overwrite(record, &discarded)) {
+            release(qos_level(discarded.qos));
+            f.dropped.fetch_add(1, std::memory_order_relaxed);
+            metrics_.feed_drops.add();
+        }
+        accepted = true;
+    } else {
+        accepted = f.ring.try_push(record);
+        if (!accepted) {
+            release(qos_level(record.qos));
+            f.dropped.fetch_add(1, std::memory_order_relaxed);
+            metrics_.feed_drops.add();
+        }
+    }
+
+    schedule_drain();
+    return accepted;
+}
+
+uint64_t MqttClientWrapper::feed_drops(feed_id id) const {
+    if (id < 0 || id >= feed_count_.load(std::memory_order_acquire)) return 0;
+    return feeds_[id]->dropped.load(std::memory_order_relaxed);
+}
+
+void MqttClientWrapper::schedule_drain() {
+    // Only one drain handler is queued at a time, however many samples arrive meanwhile
+    if (!drain_scheduled_.exchange(true, std::memory_order_acq_rel)) {
+        boost::asio::post(ioc_, boost::asio::bind_allocator(
+                handler_allocator<void>(drain_handler_memory_), [this] { drain_feeds(); }));
+    }
+}
+
+void MqttClientWrapper::drain_feeds() {
+    // Cleared before draining so that samples pushed from now on schedule another pass
+    drain_scheduled_.store(false, std::memory_order_release);
+
+    bool pending = false;
+    latest_waiting_ = false;
+    update_reservations();
+    int count = feed_count_.load(std::memory_order_acquire);
+    publish_record record;
+    size_t queued = 0;
+    for (int i = 0; i < count; ++i) {
+        feed& f = *feeds_[i];
+        int qos = f.qos.load(std::memory_order_relaxed);
+        qos_window& w = windows_[qos_level(qos)];
+        queued += f.ring.size();
+        for (size_t n = 0; n < MAX_DRAIN_PER_FEED && f.ring.try_pop(record); ++n) {
+            if (f.topic.empty()) {
+                release(qos_level(record.qos));
+                continue;
             }
-        } else {
-            LOGW("MQTT publish called but client is not connected.");
+            if (record.origin.trace_id != 0) {
+                pipeline_trace::span("feed queue", record.origin.trace_id, record.queued_ns,
+                                     pipeline_trace::now_ns());
+            }
+            publish_now(f.topic, std::string(record.payload, record.length), true, record.qos, record.encoding,
+                        record.origin);
         }
+        pending = pending || f.ring.size() > 0;
+
+        if (f.latest.pending()) {
+            // Left in the slot, where newer samples replace it, until it can go out right away.
+            // Not behind held messages, which only use the shared places. Resumed by the next
+            // completion or CONNACK.
+            if (!connected_.load(std::memory_order_relaxed) ||
+                w.in_flight.load(std::memory_order_relaxed) >= w.capacity()) {
+                latest_waiting_ = true;
+            } else if (f.latest.take(record) && !f.topic.empty()) {
+                if (record.origin.trace_id != 0) {
+                    pipeline_trace::span("feed queue", record.origin.trace_id, record.queued_ns,
+                                         pipeline_trace::now_ns());
+                }
+                w.admitted.fetch_add(1, std::memory_order_acq_rel);
+                send(f.topic, std::string(record.payload, record.length), true, qos, record.encoding,
+                     record.origin);
+            }
+        }
+    }
+
+    metrics_.feed_queue_depth.set(static_cast<int64_t>(queued));
+    update_gauges();
+    report_feed_drops();
+
+    if (pending) {
+        // Yield to the MQTT client before draining the rest
+        schedule_drain();
+    }
+}
+
+void MqttClientWrapper::on_connack(bool accepted, uint16_t topic_alias_maximum) {
+    if (accepted) {
+        attempt_.connack_us = microseconds_since(phase_started_, std::chrono::steady_clock::now());
+        uint32_t total = attempt_.resolve_us + attempt_.tcp_us + attempt_.tls_us + attempt_.connack_us;
+        std::string timing = "Connected in " + format_ms(total) + " ms: ";
+        if (first_attempt_) {
+            timing += "resolve " + format_ms(attempt_.resolve_us) + " ms"
+                      + (using_resolved_ ? " (cached addresses), " : ", ");
+        }
+        timing += "TCP " + format_ms(attempt_.tcp_us) + " ms, ";
+        if (broker_.tls) {
+            timing += "TLS " + format_ms(attempt_.tls_us) + " ms"
+                      + (attempt_.tls_resumed ? " (resumed session), " : " (full handshake), ");
+        }
+        timing += "CONNACK " + format_ms(attempt_.connack_us) + " ms";
+        logger_.log(timing);
+        connect_us_.store(total, std::memory_order_relaxed);
+        metrics_.connections.add();
+        metrics_.connect_us.record(total);
+        if (attempt_.tls_resumed) {
+            tls_resumptions_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    attempt_ = {};
+    first_attempt_ = false;
+
+    // The broker starts every connection without aliases; the busiest topics establish theirs
+    // again with their next publish
+    if (!accepted) topic_alias_maximum = 0;
+    topic_aliases_.reset(topic_alias_maximum);
+    topic_alias_maximum_.store(topic_aliases_.capacity(), std::memory_order_relaxed);
+    if (topic_alias_maximum > 0) {
+        logger_.log("Broker allows " + std::to_string(topic_alias_maximum) + " topic aliases, using up to "
+                    + std::to_string(topic_aliases_.capacity()));
+    }
+}
+
+void MqttClientWrapper::on_connection_changed(bool connected) {
+    bool was_connected = connected_.exchange(connected, std::memory_order_acq_rel);
+    if (connected && !was_connected && !offline_store_.empty()) {
+        logger_.log("Replaying " + std::to_string(offline_store_.size()) + " messages stored while offline");
+        schedule_store_drain();
+    } else if (!connected && was_connected) {
+        offline_store_.sync();
+        report_topic_aliases();
+    }
+    if (connected && latest_waiting_) {
+        schedule_drain();
+    }
+    metrics_.connected.set(connected ? 1 : 0);
+    update_gauges();
+}
+
+void MqttClientWrapper::schedule_store_drain() {
+    if (store_drain_scheduled_) return;
+    store_drain_scheduled_ = true;
+    store_drain_timer_.expires_after(STORE_DRAIN_INTERVAL);
+    store_drain_timer_.async_wait([this](boost::system::error_code ec) {
+        store_drain_scheduled_ = false;
+        if (!ec) drain_offline_store();
+    });
+}
+
+// Sends the oldest stored messages, a rate-limited slice per tick, so that live publishes
+// are interleaved with the replay rather than queued behind it.
+void MqttClientWrapper::drain_offline_store() {
+    if (!connected_.load(std::memory_order_relaxed)) {
+        return; // Resumed by the next CONNACK
+    }
+
+    update_reservations();
+    auto per_tick = static_cast<int64_t>(store_drain_rate_) * STORE_DRAIN_INTERVAL.count() / 1000;
+    OfflineStore::message_view message;
+    for (int64_t n = 0; n < std::max<int64_t>(per_tick, 1) && offline_store_.front(message); ++n) {
+        // Stored messages stay in the store, rather than being held back, while the window is full
+        qos_window& w = windows_[qos_level(message.qos)];
+        if (w.in_flight.load(std::memory_order_relaxed) >= w.capacity()) {
+            break;
+        }
+        w.admitted.fetch_add(1, std::memory_order_acq_rel);
+        send(std::string(message.topic), std::string(message.payload), message.retain, message.qos,
+             payloadEncodingFromInt(message.tag), {});
+        offline_store_.pop();
+    }
+
+    if (!offline_store_.empty()) {
+        schedule_store_drain();
+    } else {
+        logger_.log("Offline store drained");
+        update_reservations();
+    }
+}
+
+void MqttClientWrapper::report_feed_drops() {
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_drop_report_ < DROP_REPORT_INTERVAL) return;
+    last_drop_report_ = now;
+
+    int count = feed_count_.load(std::memory_order_acquire);
+    for (int i = 0; i < count; ++i) {
+        feed& f = *feeds_[i];
+        uint64_t dropped = f.dropped.load(std::memory_order_relaxed);
+        if (dropped != f.reported_drops) {
+            logger_.log("Queue full for " + f.topic + ": " + std::to_string(dropped - f.reported_drops)
+                        + " samples dropped (" + std::to_string(dropped) + " total, depth "
+                        + std::to_string(f.ring.capacity()) + ")");
+            f.reported_drops = dropped;
+        }
+        uint64_t coalesced = f.coalesced.load(std::memory_order_relaxed);
+        if (coalesced != f.reported_coalesced) {
+            logger_.log(f.topic + ": " + std::to_string(coalesced - f.reported_coalesced)
+                        + " samples replaced by newer ones before they could be sent");
+            f.reported_coalesced = coalesced;
+        }
+    }
+
+    uint64_t store_drops = offline_store_.dropped();
+    if (store_drops != reported_store_drops_) {
+        if (store_drops > reported_store_drops_) {
+            logger_.log("Offline store full: " + std::to_string(store_drops - reported_store_drops_)
+                        + " oldest messages discarded (" + std::to_string(offline_store_.capacity()) + " bytes)");
+        }
+        reported_store_drops_ = store_drops;
+    }
+
+    report_window();
+}
+
+void MqttClientWrapper::report_topic_aliases() {
+    uint64_t aliased = aliased_publishes_.load(std::memory_order_relaxed) - reported_aliased_;
+    int64_t saved = alias_bytes_saved_.load(std::memory_order_relaxed) - reported_alias_bytes_saved_;
+    if (aliased == 0) return;
+    logger_.log("Topic aliases: " + std::to_string(aliased) + " publishes on " + std::to_string(topic_aliases_.size())
+                + " topics sent with one during the connection, " + std::to_string(saved) + " header bytes saved ("
+                + std::to_string(saved / static_cast<int64_t>(aliased)) + " per message)");
+    reported_aliased_ += aliased;
+    reported_alias_bytes_saved_ += saved;
+}
+
+void MqttClientWrapper::report_window() {
+    publish_stats s = stats();
+    uint64_t losses = s.rejected + s.dropped + s.coalesced;
+    if (losses == reported_window_losses_ && s.held[0] == 0 && s.held[1] == 0 && s.max_puback_latency_us == 0) {
+        return;
+    }
+    logger_.log("Publish window: QoS 0 " + std::to_string(s.in_flight[0]) + "/"
+                + std::to_string(windows_[0].limit.load(std::memory_order_relaxed)) + " in flight, "
+                + std::to_string(s.held[0]) + " held; QoS 1 " + std::to_string(s.in_flight[1]) + "/"
+                + std::to_string(windows_[1].limit.load(std::memory_order_relaxed)) + " in flight, "
+                + std::to_string(s.held[1]) + " held; " + std::to_string(s.rejected) + " rejected, "
+                + std::to_string(s.dropped) + " dropped, " + std::to_string(s.coalesced) + " coalesced in total; "
+                + "PUBACK " + std::to_string(s.puback_latency_us / 1000) + " ms average, "
+                + std::to_string(s.max_puback_latency_us / 1000) + " ms max");
+    reported_window_losses_ = losses;
+    max_puback_latency_us_.store(0, std::memory_order_relaxed);
+}
+
+void MqttClientWrapper::update_gauges() {
+    for (size_t level = 0; level < windows_.size(); ++level) {
+        metrics_.in_flight[level].set(static_cast<int64_t>(windows_[level].in_flight.load(std::memory_order_relaxed)));
+        metrics_.held[level].set(static_cast<int64_t>(windows_[level].held.size()));
+    }
+    metrics_.offline_messages.set(static_cast<int64_t>(offline_store_.size()));
+}
+
+void MqttClientWrapper::schedule_diagnostics() {
+    if (diagnostics_topic_.empty() || diagnostics_interval_.count() == 0) return;
+    diagnostics_timer_.expires_after(diagnostics_interval_);
+    diagnostics_timer_.async_wait([this](boost::system::error_code ec) {
+        if (ec) return; // Cancelled by new settings or the wrapper going away
+        publish_diagnostics();
+        schedule_diagnostics();
     });
+}
 
-    return true; 
+void MqttClientWrapper::publish_diagnostics() {
+    // Skipped while offline rather than filling the offline store with stale snapshots
+    if (!connected_.load(std::memory_order_relaxed)) return;
+    update_gauges();
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch());
+    publish(diagnostics_topic_, metrics::snapshot_json(now.count()), true, 0);
 }
@@ -3,100 +3,177 @@
 
 #include <boost/asio/ssl.hpp>
 #include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/mqtt5/logger.hpp>
 #include <boost/mqtt5/mqtt_client.hpp>
 #include <boost/mqtt5/ssl.hpp>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <string>
 #include <memory>
 #include <thread>
 #include <variant>
 #include <functional>
-#include <fstream>
 #include <chrono>
-#include <ctime>
-#include <iterator>
+#include <deque>
 #include <vector>
 
+#include "async_logger.h"
+#include "binary_payload.h"
+#include "flush_scheduler.h"
+#include "handler_memory.h"
+#include "latest_slot.h"
+#include "metrics.h"
+#include "offline_store.h"
+#include "pipeline_trace.h"
+#include "spsc_ring.h"
+#include "tls_session_cache.h"
+#include "topic_alias_table.h"
+
 class MqttClientWrapper {
 public:
     using status_callback_t = std::function<void(const std::string&, const std::string&)>;
 
-    explicit MqttClientWrapper(std::string log_file_path);
+    // A feed is a per-sensor lock-free queue between the thread delivering sensor samples
+    // and the io_context thread, which drains all feeds in bulk.
+    using feed_id = int;
+    static constexpr feed_id invalid_feed = -1;
+    static constexpr size_t max_feed_payload = 250;
+
+    // How a feed passes samples on. Streamed samples are all sent, in order, through the
+    // feed's queue. A coalescing feed has a single slot instead: each sample replaces the one
+    // before if that was not sent yet, and the slot is only emptied while connected and with
+    // room in the window of the feed's QoS level, so a slow link delivers the current value
+    // rather than a backlog. Suits state-like topics such as light level or temperature.
+    enum class feed_mode {
+        stream = 0,
+        coalesce = 1
+    };
+
+    enum class overflow_policy {
+        drop_newest = 0, // Reject the incoming sample while the queue is full
+        drop_oldest = 1  // Discard the oldest queued sample to make room
+    };
+
+    // What happens to a message while the in-flight window of its QoS level is full, that is
+    // while as many messages of that level have been handed to the client without completing
+    // (written for QoS 0, acknowledged for QoS 1).
+    enum class window_policy {
+        reject = 0,      // Refuse it; publish() returns false
+        drop_oldest = 1, // Hold it back, discarding the oldest held-back message beyond the window
+        coalesce = 2     // Hold it back, replacing an older held-back message on the same topic
+    };
+
+    struct publish_stats {
+        // Per QoS level: handed to the client and not completed, and held back by the window
+        size_t in_flight[2];
+        size_t held[2];
+        uint64_t rejected;
+        uint64_t dropped;
+        uint64_t coalesced;
+        // Time from handing a QoS 1 message to the client to its PUBACK: moving average and
+        // maximum since the last report in the log
+        uint32_t puback_latency_us;
+        uint32_t max_puback_latency_us;
+        // Topic aliases allowed by the broker on this connection, QoS 0 publishes sent with one,
+        // and the PUBLISH header bytes that saved over sending the topic every time
+        uint16_t topic_alias_maximum;
+        uint64_t aliased;
+        int64_t alias_bytes_saved;
+        // Time to CONNACK of the last connection, and connections that resumed a TLS session
+        uint32_t connect_us;
+        uint64_t tls_resumptions;
+        // With write coalescing: batches handed to the client, and the publishes in them
+        uint64_t write_batches;
+        uint64_t batched_publishes;
+    };
+
+    // log_file_path is the ring file read back with AsyncLogger::read_since
+    explicit MqttClientWrapper(const std::string& log_file_path);
     ~MqttClientWrapper();
 
     void set_status_callback(status_callback_t cb) { status_callback_ = std::move(cb); }
 
+    // Publishes made while the broker is unreachable are kept in a memory-mapped ring file of
+    // the given capacity and replayed after reconnecting, at most drain_rate messages per
+    // second so that live traffic keeps flowing. Messages left from a previous run are
+    // replayed too. Without a store they wait in the client's memory.
+    void set_offline_store(std::string path, size_t capacity_bytes, int drain_rate);
+
+    // Applies from the next publish. A window of 0 is treated as 1. Each coalescing feed of a
+    // level, and the offline store replay while it lasts, keeps a place of its window to itself,
+    // growing the window if it would otherwise leave none to the other messages.
+    void set_in_flight_window(size_t qos0_window, size_t qos1_window, window_policy policy);
+    // Off by default. Publishes are held for up to window, or until byte_budget bytes are
+    // waiting, and then handed to the client in one go, which gathers all but the first into
+    // a single socket write. A window of 0 turns it off.
+    void set_write_coalescing(std::chrono::microseconds window, size_t byte_budget);
+    // Publishes a snapshot of metrics.h as a retained QoS 0 JSON message every interval while
+    // connected. An empty topic or an interval of 0 turns it off.
+    void set_diagnostics(std::string topic, std::chrono::seconds interval);
+    publish_stats stats() const;
+    // For timers of the wrapper's users, whose handlers then run on the io_context thread
+    boost::asio::io_context::executor_type executor() { return ioc_.get_executor(); }
+
+    // Connections share one TLS context, which resumes the previous session with the broker,
+    // and a connect() within a few minutes of the last resolve of the broker's name goes to
+    // the addresses found then.
     void connect(const std::string& broker_url, const std::string& client_id, const std::string& username, const std::string& password, const std::string& will_topic = "", const std::string& will_payload = "");
     void disconnect();
-    bool publish(const std::string& topic, const std::string& payload, bool retain = true, int qos = 0);
+    // Returns false if the message is dropped because no connection has been requested or the
+    // in-flight window rejects it. The encoding selects the content type and payload format
+    // properties. The origin of a message made from samples is kept until the publish
+    // completes, for the mqtt.sample_age_us histogram and for tracing; the offline store
+    // does not keep it.
+    bool publish(const std::string& topic, const std::string& payload, bool retain = true, int qos = 0,
+                 PayloadEncoding encoding = PayloadEncoding::json, pipeline_trace::origin origin = {});
+
+    // Applies to feeds registered afterwards.
+    void set_feed_options(size_t queue_depth, overflow_policy policy);
+    feed_id register_feed(std::string topic);
+    void set_feed_topic(feed_id feed, std::string topic);
+    // May be called from any thread; a sample already queued when switching to coalescing is
+    // still sent.
+    void set_feed_mode(feed_id feed, feed_mode mode);
+    // QoS 0 by default. May be called from any thread; applies to samples queued afterwards.
+    void set_feed_qos(feed_id feed, int qos);
+    // Must only be called from the single thread producing samples for this feed.
+    // Returns false if the sample was dropped, including for lack of a connection request or
+    // because the window of the feed's QoS level is full under window_policy::reject. A
+    // streamed sample holds its place in the window from here, so one that was accepted is
+    // not rejected later on. Never fails for a coalescing feed once it has a connection
+    // request.
+    bool publish(feed_id feed, const char* payload, size_t length,
+                 PayloadEncoding encoding = PayloadEncoding::json, pipeline_trace::origin origin = {});
+    uint64_t feed_drops(feed_id feed) const;
 
 private:
     struct custom_logger {
         MqttClientWrapper& wrapper_;
-        std::string log_file_path_;
-        // Using size-based limit to avoid reading the file for line counts.
-        // Limit to 40KB, and when trimming, reduce to 20KB.
-        const size_t MAX_LOG_SIZE = 40000;
-        const size_t TRIM_TO_SIZE = 20000;
-
-        explicit custom_logger(MqttClientWrapper& wrapper, std::string log_file_path)
-            : wrapper_(wrapper), log_file_path_(std::move(log_file_path)) {
+
+        explicit custom_logger(MqttClientWrapper& wrapper) : wrapper_(wrapper) {
         }
 
+        // Called on the io_context thread; the line is written to the file in the background
         void log(const std::string& message) const {
-            if (log_file_path_.empty()) return;
-
-            std::ofstream log_file(log_file_path_, std::ios_base::app);
-            if (!log_file.is_open()) return;
-
-            auto now = std::chrono::system_clock::now();
-            auto in_time_t = std::chrono::system_clock::to_time_t(now);
-
-            char time_buf[80];
-            std::strftime(time_buf, sizeof(time_buf), "%F %T", std::localtime(&in_time_t));
-
-            log_file << time_buf << " | " << message << std::endl;
-
-            if (log_file.tellp() > MAX_LOG_SIZE) {
-                log_file.close();
-                // File exceeds max size, need to trim it.
-                std::ifstream infile(log_file_path_);
-                if (!infile.is_open()) return;
-
-                // Seek to a point to keep the last TRIM_TO_SIZE bytes
-                infile.seekg(0, std::ios::end);
-                size_t current_size = infile.tellg();
-                if (current_size > TRIM_TO_SIZE) {
-                    infile.seekg(current_size - TRIM_TO_SIZE);
-                     // Discard the first partial line to not corrupt log messages
-                    std::string dummy;
-                    std::getline(infile, dummy);
-                } else {
-                    infile.seekg(0);
-                }
-
-                std::string content((std::istreambuf_iterator<char>(infile)),
-                                     std::istreambuf_iterator<char>());
-                infile.close();
-
-                // Write the trimmed content back to the file
-                std::ofstream outfile(log_file_path_, std::ios_base::trunc);
-                outfile << content;
-            }
+            wrapper_.log_.log(message);
         }
 
-
         void at_resolve(boost::system::error_code ec, std::string_view host, std::string_view port, const boost::asio::ip::tcp::resolver::results_type& eps) {
             log("resolve: " + std::string(host) + ":" + std::string(port) + " - " + ec.message());
+            wrapper_.on_resolved(ec, host, eps);
         }
 
         void at_tcp_connect(boost::system::error_code ec, boost::asio::ip::tcp::endpoint ep) {
             log("TCP connect: " + ep.address().to_string() + ":" + std::to_string(ep.port()) + " - " + ec.message());
+            wrapper_.on_tcp_connected(ec);
         }
 
         void at_tls_handshake(boost::system::error_code ec, boost::asio::ip::tcp::endpoint ep) {
             log("TLS handshake: " + ep.address().to_string() + ":" + std::to_string(ep.port()) + " - " + ec.message());
+            wrapper_.on_tls_handshake(ec);
         }
 
         void at_ws_handshake(boost::system::error_code ec, boost::asio::ip::tcp::endpoint ep) {
@@ -107,6 +184,8 @@ private:
             std::string msg = "connack: " + std::string(rc.message());
             msg += ", session_present: " + std::to_string(session_present);
             log(msg);
+            wrapper_.on_connack(!rc, props[boost::mqtt5::prop::topic_alias_maximum].value_or(0));
+            wrapper_.on_connection_changed(!rc);
             if (wrapper_.status_callback_) {
                 wrapper_.status_callback_(rc ? "ERROR" : "CONNECTED", std::string(rc.message()));
             }
@@ -114,6 +193,7 @@ private:
 
         void at_disconnect(boost::mqtt5::reason_code rc, const boost::mqtt5::disconnect_props& props) const {
             log("disconnect: " + std::string(rc.message()));
+            wrapper_.on_connection_changed(false);
             if (wrapper_.status_callback_) {
                 wrapper_.status_callback_("DISCONNECTED", std::string(rc.message()));
             }
@@ -121,6 +201,7 @@ private:
 
         void at_transport_error(boost::system::error_code ec) {
             log("transport layer error: " + ec.message());
+            wrapper_.on_connection_changed(false);
             if (wrapper_.status_callback_) {
                 wrapper_.status_callback_("DISCONNECTED", ec.message());
             }
@@ -138,14 +219,269 @@ private:
             custom_logger
     >;
 
+    struct publish_record {
+        uint16_t length;
+        PayloadEncoding encoding;
+        // QoS of a streamed sample, whose window it was admitted to when queued
+        uint8_t qos;
+        pipeline_trace::origin origin;
+        // When it was queued, for traced samples only
+        int64_t queued_ns;
+        char payload[max_feed_payload];
+    };
+
+    struct feed {
+        feed(size_t depth, overflow_policy policy, std::string topic)
+            : ring(depth), policy(policy), topic(std::move(topic)) {}
+
+        SpscRing<publish_record> ring;
+        LatestSlot<publish_record> latest;
+        const overflow_policy policy;
+        std::atomic<feed_mode> mode{feed_mode::stream};
+        std::atomic<int> qos{0};
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<uint64_t> coalesced{0};
+        // Only touched on the io_context thread
+        std::string topic;
+        uint64_t reported_drops = 0;
+        uint64_t reported_coalesced = 0;
+    };
+
+    struct held_message {
+        std::string topic;
+        std::string payload;
+        bool retain;
+        PayloadEncoding encoding;
+        pipeline_trace::origin origin;
+        int64_t held_ns; // Traced messages only
+    };
+
+    // One per QoS level. Every admitted message is counted until it completes, is moved to
+    // the offline store or is dropped; that includes messages still on their way to the
+    // io_context thread and samples queued in a feed, so that publish() can reject against
+    // the limit without a lock. A place is reserved for each coalescing feed of the level and
+    // for the offline store replay while it has messages: publish() admits, and held messages
+    // are sent, only within the shared places, so a busy stream feed cannot starve those.
+    struct qos_window {
+        std::atomic<size_t> limit{128};
+        std::atomic<size_t> admitted{0};
+        std::atomic<size_t> in_flight{0};
+        std::atomic<size_t> held_count{0};
+        // Set on the io_context thread by update_reservations()
+        std::atomic<size_t> reserved{0};
+        // io_context thread only, bounded by limit
+        std::deque<held_message> held;
+
+        // All places, at least one more than are reserved
+        size_t capacity() const {
+            return std::max(limit.load(std::memory_order_relaxed), reserved.load(std::memory_order_relaxed) + 1);
+        }
+        // The places for messages from publish()
+        size_t shared() const {
+            size_t r = reserved.load(std::memory_order_relaxed);
+            return std::max(limit.load(std::memory_order_relaxed), r + 1) - r;
+        }
+    };
+
+    static size_t qos_level(int qos) { return qos >= 1 ? 1 : 0; }
+    // Counts a message against the window of its level; false if the policy rejects it
+    bool admit(size_t level);
+    void release(size_t level);
+
+    // io_context thread only, for admitted messages. publish_now diverts to the offline store
+    // while disconnected, submit holds the message back while the window is full.
+    void publish_now(std::string topic, std::string payload, bool retain, int qos, PayloadEncoding encoding,
+                     const pipeline_trace::origin& origin);
+    void submit(std::string topic, std::string payload, bool retain, int qos, PayloadEncoding encoding,
+                const pipeline_trace::origin& origin);
+    void send_held(size_t level);
+    // Recounts the places reserved in each window
+    void update_reservations();
+    // Hands a message to the client, or to the write batch with coalescing, bypassing the
+    // offline store and the window. Returns false if there is no client; the message is
+    // released then.
+    bool send(std::string topic, std::string payload, bool retain, int qos, PayloadEncoding encoding,
+              const pipeline_trace::origin& origin);
+    bool write(std::string topic, std::string payload, bool retain, int qos, PayloadEncoding encoding,
+               const pipeline_trace::origin& origin);
+    void flush_writes();
+    // sent_ns is on the sensor clock and only taken for traced messages
+    void on_publish_complete(size_t level, std::chrono::steady_clock::time_point sent,
+                             const pipeline_trace::origin& origin, int64_t sent_ns);
+    // Builds the client for broker_, replacing the current one
+    void start_client();
+    // Connection phases, from the client's logger hooks
+    void on_resolved(boost::system::error_code ec, std::string_view host,
+                     const boost::asio::ip::tcp::resolver::results_type& endpoints);
+    void on_tcp_connected(boost::system::error_code ec);
+    void on_tls_handshake(boost::system::error_code ec);
+    void on_connack(bool accepted, uint16_t topic_alias_maximum);
+    void on_connection_changed(bool connected);
+    void schedule_store_drain();
+    void drain_offline_store();
+    void schedule_drain();
+    void drain_feeds();
+    void report_feed_drops();
+    void report_window();
+    // Once per connection, when it ends
+    void report_topic_aliases();
+    // Gauges sampled rather than kept up to date; io_context thread only
+    void update_gauges();
+    void schedule_diagnostics();
+    void publish_diagnostics();
+
+    static constexpr size_t MAX_FEEDS = 8;
+    static constexpr size_t MAX_DRAIN_PER_FEED = 256;
+    static constexpr size_t PUBLISH_HANDLER_BLOCKS = 64;
+    static constexpr std::chrono::seconds DROP_REPORT_INTERVAL{10};
+    static constexpr std::chrono::milliseconds STORE_DRAIN_INTERVAL{100};
+    static constexpr std::chrono::minutes RESOLVED_BROKER_TTL{10};
+
+    // Before logger_, which writes to it, and destroyed after the io_context thread has ended
+    AsyncLogger log_;
     custom_logger logger_;
+    // Completion handler storage for async_publish, used on the io_context thread only. Both
+    // arenas come before ioc_ and client_, whose teardown destroys the handlers still pending
+    // in them and so gives their blocks back.
+    handler_memory publish_handler_memory_{PUBLISH_HANDLER_BLOCKS};
+    // Storage for the single outstanding drain handler; whoever sets drain_scheduled_ owns it
+    handler_memory drain_handler_memory_{1};
     boost::asio::io_context ioc_;
+    // Shared by the TLS clients, which each hold a reference to the SSL_CTX, so both are
+    // destroyed after client_
+    TlsSessionCache tls_sessions_;
+    boost::asio::ssl::context tls_context_{boost::asio::ssl::context::tls_client};
     std::variant<std::monostate, mqtt_client_t, mqtts_client_t> client_;
     std::thread ioc_thread_;
     status_callback_t status_callback_;
 
     std::string will_topic_;
     std::string will_payload_;
+
+    // io_context thread only
+    struct broker_config {
+        std::string host;
+        uint16_t port = 0;
+        bool tls = false;
+        std::string client_id;
+        std::string username;
+        std::string password;
+    };
+    broker_config broker_;
+
+    // Addresses of the broker from the last resolve of its name; the client is given these
+    // instead of the name while they are fresh. IPv4 only, as the broker list syntax takes
+    // no IPv6 literals. io_context thread only.
+    struct resolved_broker {
+        std::string host;
+        uint16_t port = 0;
+        std::string addresses; // Comma-separated, as brokers() takes them
+        size_t count = 0;
+        std::chrono::steady_clock::time_point resolved;
+    };
+    resolved_broker resolved_;
+    bool using_resolved_ = false;
+    size_t resolved_failures_ = 0;
+
+    // Phases of the current connection attempt in microseconds, io_context thread only.
+    // Resolving is only timed for a client's first attempt; the client starts later ones by
+    // itself after its reconnect delay.
+    struct connect_timing {
+        uint32_t resolve_us = 0;
+        uint32_t tcp_us = 0;
+        uint32_t tls_us = 0;
+        uint32_t connack_us = 0;
+        bool tls_resumed = false;
+    };
+    connect_timing attempt_;
+    bool first_attempt_ = false;
+    std::chrono::steady_clock::time_point phase_started_;
+    std::atomic<uint32_t> connect_us_{0};
+    std::atomic<uint64_t> tls_resumptions_{0};
+
+    // Whether a broker session is up, written on the io_context thread
+    std::atomic<bool> connected_{false};
+    // Between connect() and disconnect(); publishes outside that are dropped
+    std::atomic<bool> connection_wanted_{false};
+    // io_context thread only
+    OfflineStore offline_store_;
+    boost::asio::steady_timer store_drain_timer_{ioc_};
+    int store_drain_rate_ = 50;
+    bool store_drain_scheduled_ = false;
+    uint64_t reported_store_drops_ = 0;
+
+    // Publishes waiting for the next write batch, counted in flight; io_context thread only
+    struct queued_write {
+        std::string topic;
+        std::string payload;
+        bool retain;
+        int qos;
+        PayloadEncoding encoding;
+        pipeline_trace::origin origin;
+        int64_t queued_ns; // Traced messages only
+    };
+    std::vector<queued_write> write_queue_;
+    std::vector<queued_write> write_batch_;
+    FlushScheduler flush_scheduler_{ioc_, [this] { flush_writes(); }};
+
+    std::array<std::unique_ptr<feed>, MAX_FEEDS> feeds_;
+    std::atomic<int> feed_count_{0};
+    std::atomic<bool> drain_scheduled_{false};
+    // A coalescing feed has a value waiting for the connection or for room in its window;
+    // io_context thread only
+    bool latest_waiting_ = false;
+    size_t feed_queue_depth_ = 256;
+    overflow_policy feed_overflow_policy_ = overflow_policy::drop_newest;
+    std::chrono::steady_clock::time_point last_drop_report_;
+
+    std::array<qos_window, 2> windows_;
+    std::atomic<window_policy> window_policy_{window_policy::reject};
+    std::atomic<uint64_t> window_rejected_{0};
+    std::atomic<uint64_t> window_dropped_{0};
+    std::atomic<uint64_t> window_coalesced_{0};
+    std::atomic<uint32_t> puback_latency_us_{0};
+    std::atomic<uint32_t> max_puback_latency_us_{0};
+    // io_context thread only
+    uint64_t reported_window_losses_ = 0;
+
+    std::atomic<uint16_t> topic_alias_maximum_{0};
+    std::atomic<uint64_t> aliased_publishes_{0};
+    std::atomic<int64_t> alias_bytes_saved_{0};
+    // io_context thread only
+    TopicAliasTable topic_aliases_;
+    uint64_t reported_aliased_ = 0;
+    int64_t reported_alias_bytes_saved_ = 0;
+
+    // Registered under "mqtt." in metrics.h, shared with any later wrapper
+    struct client_metrics {
+        client_metrics();
+        // Handed to the client, with the topic and payload bytes, and failed to send
+        metrics::Counter publishes;
+        metrics::Counter bytes;
+        metrics::Counter publish_errors;
+        metrics::Counter window_rejected;
+        metrics::Counter window_dropped;
+        metrics::Counter window_coalesced;
+        metrics::Counter feed_drops;
+        metrics::Counter offline_stored;
+        metrics::Counter connections;
+        metrics::Gauge connected;
+        metrics::Gauge in_flight[2];
+        metrics::Gauge held[2];
+        // Samples waiting in the feeds when last drained, and messages in the offline store
+        metrics::Gauge feed_queue_depth;
+        metrics::Gauge offline_messages;
+        metrics::Histogram puback_us;
+        metrics::Histogram connect_us;
+        // From the sensor timestamp of a sample to the completion of the message made from it
+        metrics::Histogram sample_age_us;
+    };
+    client_metrics metrics_;
+    // io_context thread only
+    std::string diagnostics_topic_;
+    std::chrono::seconds diagnostics_interval_{0};
+    boost::asio::steady_timer diagnostics_timer_{ioc_};
+
 };
 
 #endif //HAANDROIDACCELEROMETER_MQTT_CLIENT_WRAPPER_H
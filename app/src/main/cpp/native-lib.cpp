@@ -1,9 +1,13 @@
 #include <jni.h>
+#include <cstring>
+#include <mutex>
 #include <string>
+#include "metrics.h"
 #include "mqtt_client_wrapper.h"
+#include "orientation_fusion.h"
+#include "pipeline_trace.h"
 #include "sensor_processor.h"
-#include "light_sensor_processor.h"
-#include "temperature_sensor_processor.h"
+#include "android_sensor_source.h"
 #include <android/log.h>
 
 #define LOG_TAG "NativeLib"
@@ -12,45 +16,134 @@
 #define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
 
 static MqttClientWrapper* mqttClientWrapper = nullptr;
-static SensorProcessor* accelerometerProcessor = nullptr;
-static SensorProcessor* gyroscopeProcessor = nullptr;
-static SensorProcessor* gravityProcessor = nullptr;
-static LightSensorProcessor* lightSensorProcessor = nullptr;
-static TemperatureSensorProcessor* temperatureSensorProcessor = nullptr;
+static ThreeAxisSensorProcessor* accelerometerProcessor = nullptr;
+static ThreeAxisSensorProcessor* gyroscopeProcessor = nullptr;
+static ThreeAxisSensorProcessor* gravityProcessor = nullptr;
+static ScalarSensorProcessor* lightSensorProcessor = nullptr;
+static ScalarSensorProcessor* temperatureSensorProcessor = nullptr;
+// Fed by the accelerometer, gyroscope and gravity samples; with orientationOnly set, those
+// three are not published themselves.
+static OrientationFusion* orientationFusion = nullptr;
+static bool orientationOnly = false;
+
+// Native sensor ingestion. The source is stopped whenever the processors are created or
+// destroyed, so its thread never sees them change; sensorSourceMutex serialises those steps.
+static SensorSource* sensorSource = nullptr;
+static std::mutex sensorSourceMutex;
 
 static JavaVM* g_jvm = nullptr;
 static jobject g_callback_obj = nullptr;
+static jmethodID g_status_update_method = nullptr;
 
 jint JNI_OnLoad(JavaVM* vm, void* reserved) {
     g_jvm = vm;
     return JNI_VERSION_1_6;
 }
 
-void notifyStatusUpdate(const std::string& status, const std::string& reason) {
-    if (g_jvm == nullptr || g_callback_obj == nullptr) return;
-
-    JNIEnv* env;
+// Native threads that deliver status callbacks (the io_context thread) are attached to the
+// JVM once and stay attached until they exit, instead of attaching for every callback.
+struct JvmThreadAttachment {
     bool attached = false;
+
+    ~JvmThreadAttachment() {
+        if (attached && g_jvm != nullptr) {
+            g_jvm->DetachCurrentThread();
+        }
+    }
+};
+
+static JNIEnv* getCallbackEnv() {
+    JNIEnv* env = nullptr;
     jint res = g_jvm->GetEnv((void**)&env, JNI_VERSION_1_6);
-    if (res == JNI_EDETACHED) {
-        if (g_jvm->AttachCurrentThread(&env, nullptr) != 0) return;
-        attached = true;
-    } else if (res != JNI_OK) {
+    if (res == JNI_OK) return env;
+    if (res != JNI_EDETACHED) return nullptr;
+
+    static thread_local JvmThreadAttachment attachment;
+    JavaVMAttachArgs args{JNI_VERSION_1_6, "MqttCallback", nullptr};
+    if (g_jvm->AttachCurrentThread(&env, &args) != JNI_OK) return nullptr;
+    attachment.attached = true;
+    return env;
+}
+
+void notifyStatusUpdate(const std::string& status, const std::string& reason) {
+    if (g_jvm == nullptr || g_callback_obj == nullptr || g_status_update_method == nullptr) return;
+
+    JNIEnv* env = getCallbackEnv();
+    if (env == nullptr) return;
+
+    // The thread never returns to Java, so local references must be released explicitly
+    jstring statusStr = env->NewStringUTF(status.c_str());
+    jstring reasonStr = env->NewStringUTF(reason.c_str());
+    env->CallVoidMethod(g_callback_obj, g_status_update_method, statusStr, reasonStr);
+    env->DeleteLocalRef(statusStr);
+    env->DeleteLocalRef(reasonStr);
+}
+
+// Layout of one record in the direct ByteBuffer filled by SensorEventBuffer.kt
+struct ThreeAxisEventRecord {
+    int64_t timestamp; // SensorEvent.timestamp, nanoseconds
+    float x;
+    float y;
+    float z;
+    float reserved;
+};
+static_assert(sizeof(ThreeAxisEventRecord) == 24, "Must match SensorEventBuffer.RECORD_SIZE");
+
+// Hands a three-axis sample to its processor, and to the orientation fusion if it is fused
+static void processThreeAxisSample(SensorKind kind, ThreeAxisSensorProcessor* processor, const float values[3],
+                                   int64_t timestamp) {
+    if (orientationFusion != nullptr) {
+        switch (kind) {
+            case SensorKind::gyroscope: orientationFusion->addGyroscope(values, timestamp); break;
+            case SensorKind::gravity: orientationFusion->addGravity(values, timestamp); break;
+            default: break;
+        }
+    }
+    if (!orientationOnly) {
+        processor->processData({values[0], values[1], values[2]}, timestamp);
+    }
+}
+
+static void processThreeAxisBatch(JNIEnv* env, SensorKind kind, ThreeAxisSensorProcessor* processor, jobject buffer,
+                                  jint count) {
+    if (processor == nullptr || count <= 0) return;
+
+    auto* data = static_cast<const uint8_t*>(env->GetDirectBufferAddress(buffer));
+    jlong capacity = env->GetDirectBufferCapacity(buffer);
+    if (data == nullptr || capacity < static_cast<jlong>(count) * static_cast<jlong>(sizeof(ThreeAxisEventRecord))) {
+        LOGE("Invalid sensor event buffer (capacity %lld, %d records).", static_cast<long long>(capacity), count);
         return;
     }
 
-    jclass cls = env->GetObjectClass(g_callback_obj);
-    jmethodID method = env->GetMethodID(cls, "onMqttStatusUpdate", "(Ljava/lang/String;Ljava/lang/String;)V");
-    if (method != nullptr) {
-        jstring statusStr = env->NewStringUTF(status.c_str());
-        jstring reasonStr = env->NewStringUTF(reason.c_str());
-        env->CallVoidMethod(g_callback_obj, method, statusStr, reasonStr);
-        env->DeleteLocalRef(statusStr);
-        env->DeleteLocalRef(reasonStr);
+    for (jint i = 0; i < count; ++i) {
+        ThreeAxisEventRecord record;
+        std::memcpy(&record, data + i * sizeof(ThreeAxisEventRecord), sizeof(record));
+        const float values[3] = {record.x, record.y, record.z};
+        processThreeAxisSample(kind, processor, values, record.timestamp);
     }
+}
 
-    if (attached) {
-        g_jvm->DetachCurrentThread();
+// Runs on the sensor source's thread
+static void dispatchSensorSamples(const SensorSample* samples, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        const SensorSample& sample = samples[i];
+        switch (sample.kind) {
+            case SensorKind::accelerometer:
+                if (accelerometerProcessor != nullptr) processThreeAxisSample(sample.kind, accelerometerProcessor, sample.values, sample.timestamp);
+                break;
+            case SensorKind::gyroscope:
+                if (gyroscopeProcessor != nullptr) processThreeAxisSample(sample.kind, gyroscopeProcessor, sample.values, sample.timestamp);
+                break;
+            case SensorKind::gravity:
+                if (gravityProcessor != nullptr) processThreeAxisSample(sample.kind, gravityProcessor, sample.values, sample.timestamp);
+                break;
+            case SensorKind::light:
+                if (lightSensorProcessor != nullptr) lightSensorProcessor->processData({sample.values[0]}, sample.timestamp);
+                break;
+            case SensorKind::temperature:
+                if (temperatureSensorProcessor != nullptr) temperatureSensorProcessor->processData({sample.values[0]}, sample.timestamp);
+                break;
+        }
     }
 }
 
@@ -64,9 +157,32 @@ Java_com_opendevelopment_opensensor_MqttService_nativeInit(
     jstring gyroscopeTopic,
     jstring gravityTopic,
     jstring lightSensorTopic,
-    jstring temperatureSensorTopic) {
+    jstring temperatureSensorTopic,
+    jint queueDepth,
+    jint queueOverflowPolicy,
+    jstring offlineStorePath,
+    jint offlineStoreKb,
+    jint offlineDrainRate,
+    jint qos0Window,
+    jint qos1Window,
+    jint windowPolicy,
+    jint writeCoalescingUs,
+    jint writeCoalescingBytes,
+    jstring diagnosticsTopic,
+    jint diagnosticsIntervalS,
+    jstring orientationTopic,
+    jint orientationAlgorithm,
+    jfloat orientationGain,
+    jfloat orientationRateHz,
+    jboolean orientationOnlyEnabled) {
     if (mqttClientWrapper == nullptr) {
+        std::lock_guard<std::mutex> lock(sensorSourceMutex);
+        if (sensorSource != nullptr) sensorSource->stop();
+
         g_callback_obj = env->NewGlobalRef(callback_obj);
+        jclass callbackClass = env->GetObjectClass(callback_obj);
+        g_status_update_method = env->GetMethodID(callbackClass, "onMqttStatusUpdate", "(Ljava/lang/String;Ljava/lang/String;)V");
+        env->DeleteLocalRef(callbackClass);
 
         const char* logFilePathCStr = env->GetStringUTFChars(logFilePath, nullptr);
         const char* accelerometerTopicCStr = env->GetStringUTFChars(accelerometerTopic, nullptr);
@@ -79,12 +195,39 @@ Java_com_opendevelopment_opensensor_MqttService_nativeInit(
         mqttClientWrapper->set_status_callback([](const std::string& status, const std::string& reason) {
             notifyStatusUpdate(status, reason);
         });
-
-        accelerometerProcessor = new SensorProcessor(mqttClientWrapper, accelerometerTopicCStr);
-        gyroscopeProcessor = new SensorProcessor(mqttClientWrapper, gyroscopeTopicCStr);
-        gravityProcessor = new SensorProcessor(mqttClientWrapper, gravityTopicCStr);
-        lightSensorProcessor = new LightSensorProcessor(mqttClientWrapper, lightSensorTopicCStr);
-        temperatureSensorProcessor = new TemperatureSensorProcessor(mqttClientWrapper, temperatureSensorTopicCStr);
+        mqttClientWrapper->set_feed_options(
+                queueDepth > 0 ? static_cast<size_t>(queueDepth) : 1,
+                queueOverflowPolicy == 1 ? MqttClientWrapper::overflow_policy::drop_oldest
+                                         : MqttClientWrapper::overflow_policy::drop_newest);
+        const char* offlineStorePathCStr = env->GetStringUTFChars(offlineStorePath, nullptr);
+        mqttClientWrapper->set_offline_store(offlineStorePathCStr,
+                offlineStoreKb > 0 ? static_cast<size_t>(offlineStoreKb) * 1024 : 0, offlineDrainRate);
+        env->ReleaseStringUTFChars(offlineStorePath, offlineStorePathCStr);
+        mqttClientWrapper->set_in_flight_window(
+                qos0Window > 0 ? static_cast<size_t>(qos0Window) : 1,
+                qos1Window > 0 ? static_cast<size_t>(qos1Window) : 1,
+                windowPolicy == 1 ? MqttClientWrapper::window_policy::drop_oldest
+                : windowPolicy == 2 ? MqttClientWrapper::window_policy::coalesce
+                                    : MqttClientWrapper::window_policy::reject);
+        mqttClientWrapper->set_write_coalescing(std::chrono::microseconds(writeCoalescingUs > 0 ? writeCoalescingUs : 0),
+                writeCoalescingBytes > 0 ? static_cast<size_t>(writeCoalescingBytes) : 0);
+        const char* diagnosticsTopicCStr = env->GetStringUTFChars(diagnosticsTopic, nullptr);
+        mqttClientWrapper->set_diagnostics(diagnosticsTopicCStr, std::chrono::seconds(diagnosticsIntervalS > 0 ? diagnosticsIntervalS : 0));
+        env->ReleaseStringUTFChars(diagnosticsTopic, diagnosticsTopicCStr);
+
+        accelerometerProcessor = new ThreeAxisSensorProcessor(mqttClientWrapper, "accelerometer", accelerometerTopicCStr);
+        gyroscopeProcessor = new ThreeAxisSensorProcessor(mqttClientWrapper, "gyroscope", gyroscopeTopicCStr);
+        gravityProcessor = new ThreeAxisSensorProcessor(mqttClientWrapper, "gravity", gravityTopicCStr);
+        lightSensorProcessor = new ScalarSensorProcessor(mqttClientWrapper, "light", lightSensorTopicCStr);
+        temperatureSensorProcessor = new ScalarSensorProcessor(mqttClientWrapper, "temperature", temperatureSensorTopicCStr);
+
+        const char* orientationTopicCStr = env->GetStringUTFChars(orientationTopic, nullptr);
+        orientationFusion = new OrientationFusion(mqttClientWrapper, orientationTopicCStr);
+        env->ReleaseStringUTFChars(orientationTopic, orientationTopicCStr);
+        orientationFusion->configure(orientationAlgorithm == 1 ? FusionAlgorithm::mahony : FusionAlgorithm::madgwick,
+                                     orientationGain, orientationRateHz > 0.0f ? orientationRateHz : 0.0f);
+        // The raw streams are only left out while something takes their place
+        orientationOnly = orientationOnlyEnabled == JNI_TRUE && orientationFusion->enabled();
 
         env->ReleaseStringUTFChars(logFilePath, logFilePathCStr);
         env->ReleaseStringUTFChars(accelerometerTopic, accelerometerTopicCStr);
@@ -93,6 +236,8 @@ Java_com_opendevelopment_opensensor_MqttService_nativeInit(
         env->ReleaseStringUTFChars(lightSensorTopic, lightSensorTopicCStr);
         env->ReleaseStringUTFChars(temperatureSensorTopic, temperatureSensorTopicCStr);
 
+        if (sensorSource != nullptr) sensorSource->start(dispatchSensorSamples);
+
         LOGD("MqttClientWrapper and SensorProcessors initialized.");
     }
 }
@@ -159,9 +304,14 @@ Java_com_opendevelopment_opensensor_MqttService_nativeCleanup(JNIEnv* env, jobje
     if (mqttClientWrapper != nullptr) {
         LOGD("Cleaning up native resources.");
 
+        // Sensors stay enabled and resume if the MQTT service is initialised again
+        std::lock_guard<std::mutex> lock(sensorSourceMutex);
+        if (sensorSource != nullptr) sensorSource->stop();
+
         if (g_callback_obj != nullptr) {
             env->DeleteGlobalRef(g_callback_obj);
             g_callback_obj = nullptr;
+            g_status_update_method = nullptr;
         }
 
         delete accelerometerProcessor;
@@ -174,101 +324,279 @@ Java_com_opendevelopment_opensensor_MqttService_nativeCleanup(JNIEnv* env, jobje
         lightSensorProcessor = nullptr;
         delete temperatureSensorProcessor;
         temperatureSensorProcessor = nullptr;
+        delete orientationFusion;
+        orientationFusion = nullptr;
+        orientationOnly = false;
 
         delete mqttClientWrapper;
         mqttClientWrapper = nullptr;
     }
 }
 
-extern "C" JNIEXPORT void JNICALL
+extern "C" JNIEXPORT jboolean JNICALL
 Java_com_opendevelopment_opensensor_MqttService_nativePublish(JNIEnv* env, jobject /* this */, jstring topic, jstring payload, jboolean retain, jint qos) {
+    bool accepted = false;
     if (mqttClientWrapper != nullptr) {
         const char* topicCStr = env->GetStringUTFChars(topic, nullptr);
         const char* payloadCStr = env->GetStringUTFChars(payload, nullptr);
 
-        mqttClientWrapper->publish(topicCStr, payloadCStr, retain, qos);
+        accepted = mqttClientWrapper->publish(topicCStr, payloadCStr, retain, qos);
 
         env->ReleaseStringUTFChars(topic, topicCStr);
         env->ReleaseStringUTFChars(payload, payloadCStr);
     }
+    return accepted ? JNI_TRUE : JNI_FALSE;
+}
+
+static ChangeDetectionSettings changeDetectionSettings(jfloat deadband, jfloat relativeDeadbandPercent,
+                                                       jfloat hysteresisPercent, jint minIntervalMs, jint heartbeatMs) {
+    ChangeDetectionSettings settings;
+    settings.deadband = deadband > 0.0f ? deadband : 0.0f;
+    settings.relativeDeadband = relativeDeadbandPercent > 0.0f ? relativeDeadbandPercent / 100.0f : 0.0f;
+    settings.hysteresis = hysteresisPercent > 0.0f ? hysteresisPercent / 100.0f : 0.0f;
+    settings.minIntervalMs = minIntervalMs;
+    settings.heartbeatMs = heartbeatMs;
+    return settings;
+}
+
+static MqttClientWrapper::feed_mode feedModeFromInt(jint publishMode) {
+    return publishMode == 1 ? MqttClientWrapper::feed_mode::coalesce : MqttClientWrapper::feed_mode::stream;
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_opendevelopment_opensensor_AccelerometerService_nativeUpdateSettings(
-        JNIEnv* env, jobject /* this */, jfloat multiplierX, jfloat multiplierY, jfloat multiplierZ, jint rounding) {
+        JNIEnv* env, jobject /* this */, jfloat multiplierX, jfloat multiplierY, jfloat multiplierZ, jint rounding,
+        jint batchWindowMs, jint batchMaxSamples, jfloat deadband, jfloat relativeDeadbandPercent,
+        jfloat hysteresisPercent, jint minIntervalMs, jint heartbeatMs,
+        jint aggregationWindowMs, jint aggregationStepMs, jint payloadEncoding, jint publishMode) {
     if (accelerometerProcessor != nullptr) {
-        accelerometerProcessor->updateSettings(multiplierX, multiplierY, multiplierZ, rounding);
+        accelerometerProcessor->updateSettings({multiplierX, multiplierY, multiplierZ}, rounding, batchWindowMs, batchMaxSamples,
+                changeDetectionSettings(deadband, relativeDeadbandPercent, hysteresisPercent, minIntervalMs, heartbeatMs),
+                aggregationWindowMs, aggregationStepMs, payloadEncodingFromInt(payloadEncoding),
+                feedModeFromInt(publishMode));
     }
 }
 
 extern "C" JNIEXPORT void JNICALL
-Java_com_opendevelopment_opensensor_AccelerometerService_nativeProcessData(
-        JNIEnv* env, jobject /* this */, jfloat x, jfloat y, jfloat z) {
-    if (accelerometerProcessor != nullptr) {
-        accelerometerProcessor->processData(x, y, z);
-    }
+Java_com_opendevelopment_opensensor_AccelerometerService_nativeProcessDataBatch(
+        JNIEnv* env, jobject /* this */, jobject buffer, jint count) {
+    processThreeAxisBatch(env, SensorKind::accelerometer, accelerometerProcessor, buffer, count);
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_opendevelopment_opensensor_GyroscopeService_nativeUpdateGyroscopeSettings(
-        JNIEnv* env, jobject /* this */, jfloat multiplierX, jfloat multiplierY, jfloat multiplierZ, jint rounding) {
+        JNIEnv* env, jobject /* this */, jfloat multiplierX, jfloat multiplierY, jfloat multiplierZ, jint rounding,
+        jint batchWindowMs, jint batchMaxSamples, jfloat deadband, jfloat relativeDeadbandPercent,
+        jfloat hysteresisPercent, jint minIntervalMs, jint heartbeatMs,
+        jint aggregationWindowMs, jint aggregationStepMs, jint payloadEncoding, jint publishMode) {
     if (gyroscopeProcessor != nullptr) {
-        gyroscopeProcessor->updateSettings(multiplierX, multiplierY, multiplierZ, rounding);
+        gyroscopeProcessor->updateSettings({multiplierX, multiplierY, multiplierZ}, rounding, batchWindowMs, batchMaxSamples,
+                changeDetectionSettings(deadband, relativeDeadbandPercent, hysteresisPercent, minIntervalMs, heartbeatMs),
+                aggregationWindowMs, aggregationStepMs, payloadEncodingFromInt(payloadEncoding),
+                feedModeFromInt(publishMode));
     }
 }
 
 extern "C" JNIEXPORT void JNICALL
-Java_com_opendevelopment_opensensor_GyroscopeService_nativeProcessGyroscopeData(
-        JNIEnv* env, jobject /* this */, jfloat x, jfloat y, jfloat z) {
-    if (gyroscopeProcessor != nullptr) {
-        gyroscopeProcessor->processData(x, y, z);
-    }
+Java_com_opendevelopment_opensensor_GyroscopeService_nativeProcessGyroscopeDataBatch(
+        JNIEnv* env, jobject /* this */, jobject buffer, jint count) {
+    processThreeAxisBatch(env, SensorKind::gyroscope, gyroscopeProcessor, buffer, count);
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_opendevelopment_opensensor_GravityService_nativeUpdateGravitySettings(
-        JNIEnv* env, jobject /* this */, jfloat multiplierX, jfloat multiplierY, jfloat multiplierZ, jint rounding) {
+        JNIEnv* env, jobject /* this */, jfloat multiplierX, jfloat multiplierY, jfloat multiplierZ, jint rounding,
+        jint batchWindowMs, jint batchMaxSamples, jfloat deadband, jfloat relativeDeadbandPercent,
+        jfloat hysteresisPercent, jint minIntervalMs, jint heartbeatMs,
+        jint aggregationWindowMs, jint aggregationStepMs, jint payloadEncoding, jint publishMode) {
     if (gravityProcessor != nullptr) {
-        gravityProcessor->updateSettings(multiplierX, multiplierY, multiplierZ, rounding);
+        gravityProcessor->updateSettings({multiplierX, multiplierY, multiplierZ}, rounding, batchWindowMs, batchMaxSamples,
+                changeDetectionSettings(deadband, relativeDeadbandPercent, hysteresisPercent, minIntervalMs, heartbeatMs),
+                aggregationWindowMs, aggregationStepMs, payloadEncodingFromInt(payloadEncoding),
+                feedModeFromInt(publishMode));
     }
 }
 
 extern "C" JNIEXPORT void JNICALL
-Java_com_opendevelopment_opensensor_GravityService_nativeProcessGravityData(
-        JNIEnv* env, jobject /* this */, jfloat x, jfloat y, jfloat z) {
-    if (gravityProcessor != nullptr) {
-        gravityProcessor->processData(x, y, z);
-    }
+Java_com_opendevelopment_opensensor_GravityService_nativeProcessGravityDataBatch(
+        JNIEnv* env, jobject /* this */, jobject buffer, jint count) {
+    processThreeAxisBatch(env, SensorKind::gravity, gravityProcessor, buffer, count);
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_opendevelopment_opensensor_LightSensorService_nativeUpdateLightSensorSettings(
-        JNIEnv* env, jobject /* this */, jint rounding) {
+        JNIEnv* env, jobject /* this */, jint rounding, jint batchWindowMs, jint batchMaxSamples,
+        jfloat deadband, jfloat relativeDeadbandPercent, jfloat hysteresisPercent, jint minIntervalMs, jint heartbeatMs,
+        jint aggregationWindowMs, jint aggregationStepMs, jint payloadEncoding, jint publishMode) {
     if (lightSensorProcessor != nullptr) {
-        lightSensorProcessor->updateSettings(rounding);
+        lightSensorProcessor->updateSettings(rounding, batchWindowMs, batchMaxSamples,
+                changeDetectionSettings(deadband, relativeDeadbandPercent, hysteresisPercent, minIntervalMs, heartbeatMs),
+                aggregationWindowMs, aggregationStepMs, payloadEncodingFromInt(payloadEncoding),
+                feedModeFromInt(publishMode));
     }
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_opendevelopment_opensensor_LightSensorService_nativeProcessLightSensorData(
-        JNIEnv* env, jobject /* this */, jfloat value) {
+        JNIEnv* env, jobject /* this */, jfloat value, jlong timestampNs) {
     if (lightSensorProcessor != nullptr) {
-        lightSensorProcessor->processData(value);
+        lightSensorProcessor->processData({value}, timestampNs);
     }
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_opendevelopment_opensensor_TemperatureSensorService_nativeUpdateTemperatureSensorSettings(
-        JNIEnv* env, jobject /* this */, jint rounding) {
+        JNIEnv* env, jobject /* this */, jint rounding, jint batchWindowMs, jint batchMaxSamples,
+        jfloat deadband, jfloat relativeDeadbandPercent, jfloat hysteresisPercent, jint minIntervalMs, jint heartbeatMs,
+        jint aggregationWindowMs, jint aggregationStepMs, jint payloadEncoding, jint publishMode) {
     if (temperatureSensorProcessor != nullptr) {
-        temperatureSensorProcessor->updateSettings(rounding);
+        temperatureSensorProcessor->updateSettings(rounding, batchWindowMs, batchMaxSamples,
+                changeDetectionSettings(deadband, relativeDeadbandPercent, hysteresisPercent, minIntervalMs, heartbeatMs),
+                aggregationWindowMs, aggregationStepMs, payloadEncodingFromInt(payloadEncoding),
+                feedModeFromInt(publishMode));
     }
 }
 
 extern "C" JNIEXPORT void JNICALL
 Java_com_opendevelopment_opensensor_TemperatureSensorService_nativeProcessTemperatureSensorData(
-        JNIEnv* env, jobject /* this */, jfloat value) {
+        JNIEnv* env, jobject /* this */, jfloat value, jlong timestampNs) {
     if (temperatureSensorProcessor != nullptr) {
-        temperatureSensorProcessor->processData(value);
+        temperatureSensorProcessor->processData({value}, timestampNs);
+    }
+}
+
+// Applies a filter chain spec (see parseFilterChain) to a processor and returns whether it was
+// valid. An invalid spec turns filtering off rather than keeping a chain the user no longer sees
+// in the settings.
+template<typename Processor>
+static jboolean updateFilters(JNIEnv* env, Processor* processor, jstring spec, jfloat sampleRateHz) {
+    const char* specCStr = env->GetStringUTFChars(spec, nullptr);
+    FilterChainSettings filters;
+    bool valid = parseFilterChain(specCStr, sampleRateHz, filters);
+    if (!valid) {
+        LOGW("Invalid filter chain '%s' at %g Hz, filtering disabled", specCStr, sampleRateHz);
+    }
+    env->ReleaseStringUTFChars(spec, specCStr);
+
+    if (processor != nullptr && !processor->updateFilters(filters)) {
+        valid = false;
+    }
+    return valid ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_opendevelopment_opensensor_AccelerometerService_nativeUpdateFilters(
+        JNIEnv* env, jobject /* this */, jstring spec, jfloat sampleRateHz) {
+    return updateFilters(env, accelerometerProcessor, spec, sampleRateHz);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_opendevelopment_opensensor_GyroscopeService_nativeUpdateGyroscopeFilters(
+        JNIEnv* env, jobject /* this */, jstring spec, jfloat sampleRateHz) {
+    return updateFilters(env, gyroscopeProcessor, spec, sampleRateHz);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_opendevelopment_opensensor_GravityService_nativeUpdateGravityFilters(
+        JNIEnv* env, jobject /* this */, jstring spec, jfloat sampleRateHz) {
+    return updateFilters(env, gravityProcessor, spec, sampleRateHz);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_opendevelopment_opensensor_LightSensorService_nativeUpdateLightSensorFilters(
+        JNIEnv* env, jobject /* this */, jstring spec, jfloat sampleRateHz) {
+    return updateFilters(env, lightSensorProcessor, spec, sampleRateHz);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_opendevelopment_opensensor_TemperatureSensorService_nativeUpdateTemperatureSensorFilters(
+        JNIEnv* env, jobject /* this */, jstring spec, jfloat sampleRateHz) {
+    return updateFilters(env, temperatureSensorProcessor, spec, sampleRateHz);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_opendevelopment_opensensor_AccelerometerService_nativeUpdateSpectrum(
+        JNIEnv* env, jobject /* this */, jint blockSize, jint bands, jfloat sampleRateHz) {
+    if (accelerometerProcessor == nullptr) return JNI_TRUE;
+    if (!accelerometerProcessor->updateSpectrum(blockSize, bands, sampleRateHz)) {
+        LOGW("Invalid spectrum settings (%d samples, %d bands at %g Hz), analysis disabled", blockSize, bands, sampleRateHz);
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_opendevelopment_opensensor_NativeSensorIngestion_nativeEnable(
+        JNIEnv* env, jobject /* this */, jstring packageName, jint kind, jint samplingPeriodUs) {
+    if (kind < 0 || kind >= SENSOR_KIND_COUNT) return JNI_FALSE;
+
+    std::lock_guard<std::mutex> lock(sensorSourceMutex);
+    if (sensorSource == nullptr) {
+        const char* packageNameCStr = env->GetStringUTFChars(packageName, nullptr);
+        sensorSource = new AndroidSensorSource(packageNameCStr);
+        env->ReleaseStringUTFChars(packageName, packageNameCStr);
+    }
+    if (!sensorSource->enable(static_cast<SensorKind>(kind), samplingPeriodUs)) {
+        LOGW("Native ingestion not available for sensor %d.", kind);
+        return JNI_FALSE;
+    }
+    if (!sensorSource->running() && !sensorSource->start(dispatchSensorSamples)) {
+        sensorSource->disable(static_cast<SensorKind>(kind));
+        LOGE("Failed to start native sensor ingestion.");
+        return JNI_FALSE;
+    }
+    return JNI_TRUE;
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_opendevelopment_opensensor_NativeSensorIngestion_nativeDisable(
+        JNIEnv* env, jobject /* this */, jint kind) {
+    if (kind < 0 || kind >= SENSOR_KIND_COUNT) return;
+
+    std::lock_guard<std::mutex> lock(sensorSourceMutex);
+    if (sensorSource != nullptr) {
+        sensorSource->disable(static_cast<SensorKind>(kind));
+    }
+}
+
+extern "C" JNIEXPORT jstring JNICALL
+Java_com_opendevelopment_opensensor_NativeMetrics_nativeSnapshot(JNIEnv* env, jobject /* this */) {
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+    return env->NewStringUTF(metrics::snapshot_json(now.count()).c_str());
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_opendevelopment_opensensor_NativeTrace_nativeStart(JNIEnv* env, jobject /* this */, jint sampleEvery) {
+    pipeline_trace::start(sampleEvery > 0 ? static_cast<uint32_t>(sampleEvery) : 1);
+}
+
+extern "C" JNIEXPORT jboolean JNICALL
+Java_com_opendevelopment_opensensor_NativeTrace_nativeStop(JNIEnv* env, jobject /* this */, jstring path) {
+    const char* pathCStr = env->GetStringUTFChars(path, nullptr);
+    bool written = pipeline_trace::write_chrome_json(pathCStr);
+    if (!written) {
+        LOGE("Cannot write the trace to %s", pathCStr);
+    }
+    env->ReleaseStringUTFChars(path, pathCStr);
+    return written ? JNI_TRUE : JNI_FALSE;
+}
+
+extern "C" JNIEXPORT jbyteArray JNICALL
+Java_com_opendevelopment_opensensor_MqttLog_nativeReadSince(
+        JNIEnv* env, jobject /* this */, jstring logFilePath, jlong offset, jint maxBytes, jlongArray nextOffset) {
+    const char* logFilePathCStr = env->GetStringUTFChars(logFilePath, nullptr);
+    std::string text;
+    uint64_t next = 0;
+    bool ok = AsyncLogger::read_since(logFilePathCStr, offset > 0 ? static_cast<uint64_t>(offset) : 0,
+                                      maxBytes > 0 ? static_cast<size_t>(maxBytes) : 0, text, next);
+    env->ReleaseStringUTFChars(logFilePath, logFilePathCStr);
+    if (!ok) return nullptr;
+
+    jlong nextValue = static_cast<jlong>(next);
+    env->SetLongArrayRegion(nextOffset, 0, 1, &nextValue);
+    jbyteArray result = env->NewByteArray(static_cast<jsize>(text.size()));
+    if (result != nullptr) {
+        env->SetByteArrayRegion(result, 0, static_cast<jsize>(text.size()), reinterpret_cast<const jbyte*>(text.data()));
     }
+    return result;
 }
@@ -0,0 +1,297 @@
+#include "offline_store.h"
+#include "platform_log.h"
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define LOG_TAG "OfflineStore"
+
+// Positions are byte counts since the file was created and only ever grow; the offset in the
+// ring is the position modulo the capacity.
+struct OfflineStore::file_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;
+    uint64_t head;    // Position of the oldest record
+    uint64_t tail;    // Position after the newest complete record
+    uint64_t count;   // Messages between head and tail
+    uint64_t dropped;
+};
+
+// Followed by the topic and the payload, then padding to ALIGNMENT
+struct OfflineStore::record_header {
+    uint32_t size;     // Whole record including padding; a multiple of ALIGNMENT
+    uint32_t checksum; // CRC32 of everything after this field up to the end of the payload
+    uint16_t topic_length;
+    uint8_t flags;
+    uint8_t tag;       // Opaque to the store, see push()
+    uint32_t payload_length;
+};
+
+namespace {
+
+constexpr uint32_t MAGIC = 0x3151534F; // "OSQ1"
+constexpr uint32_t VERSION = 1;
+constexpr size_t HEADER_SIZE = 4096;
+
+constexpr uint8_t FLAG_RETAIN = 0x01;
+constexpr uint8_t FLAG_QOS_SHIFT = 1;
+constexpr uint8_t FLAG_QOS_MASK = 0x06;
+constexpr uint8_t FLAG_PADDING = 0x80; // Fills the end of the ring before a record that wraps
+
+struct crc_table {
+    uint32_t entries[256];
+
+    constexpr crc_table() : entries() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[i] = c;
+        }
+    }
+};
+
+constexpr crc_table CRC_TABLE;
+
+uint32_t crc32(uint32_t crc, const void* data, size_t length) {
+    auto* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < length; ++i) {
+        crc = CRC_TABLE.entries[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+size_t align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+OfflineStore::~OfflineStore() {
+    close();
+}
+
+bool OfflineStore::open(const std::string& path, size_t capacity) {
+    close();
+
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    capacity = align_up(capacity > 0 ? capacity : page, page);
+    size_t file_size = HEADER_SIZE + capacity;
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd_ < 0) {
+        LOGW("Cannot open %s: %s", path.c_str(), strerror(errno));
+        return false;
+    }
+
+    struct stat st {};
+    bool fresh = fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) != file_size;
+    if (fresh && ftruncate(fd_, static_cast<off_t>(file_size)) != 0) {
+        LOGW("Cannot size %s to %zu bytes: %s", path.c_str(), file_size, strerror(errno));
+        close();
+        return false;
+    }
+
+    mapping_ = mmap(nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        LOGW("Cannot map %s: %s", path.c_str(), strerror(errno));
+        mapping_ = nullptr;
+        close();
+        return false;
+    }
+    mapping_size_ = file_size;
+    header_ = static_cast<file_header*>(mapping_);
+    ring_ = static_cast<char*>(mapping_) + HEADER_SIZE;
+    capacity_ = capacity;
+
+    if (fresh || header_->magic != MAGIC || header_->version != VERSION || header_->capacity != capacity) {
+        reset();
+    } else {
+        recover();
+    }
+    LOGD("Opened %s: %zu bytes, %zu messages pending", path.c_str(), capacity_, size());
+    return true;
+}
+
+void OfflineStore::close() {
+    if (mapping_ != nullptr) {
+        msync(mapping_, mapping_size_, MS_SYNC);
+        munmap(mapping_, mapping_size_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = -1;
+    mapping_ = nullptr;
+    mapping_size_ = 0;
+    header_ = nullptr;
+    ring_ = nullptr;
+    capacity_ = 0;
+}
+
+void OfflineStore::reset() {
+    std::memset(header_, 0, sizeof(file_header));
+    header_->capacity = capacity_;
+    header_->version = VERSION;
+    // Written last, so a half-initialised header is never taken for a valid one
+    header_->magic = MAGIC;
+}
+
+// Keeps the records from the head up to the first one that is inconsistent or fails its
+// checksum, which is where a crash interrupted the previous run.
+void OfflineStore::recover() {
+    uint64_t head = header_->head;
+    uint64_t tail = header_->tail;
+    if (tail < head || tail - head > capacity_ || head % ALIGNMENT != 0) {
+        LOGW("Inconsistent positions (head %llu, tail %llu), starting over",
+             static_cast<unsigned long long>(head), static_cast<unsigned long long>(tail));
+        reset();
+        return;
+    }
+
+    uint64_t count = 0;
+    uint64_t position = head;
+    while (position < tail) {
+        const record_header* record = record_at(position);
+        size_t contiguous = capacity_ - position % capacity_;
+        bool valid = record->size >= sizeof(record_header) && record->size % ALIGNMENT == 0 &&
+                     record->size <= contiguous && record->size <= tail - position;
+        if (valid && !(record->flags & FLAG_PADDING)) {
+            size_t length = sizeof(record_header) + record->topic_length + record->payload_length;
+            valid = align_up(length, ALIGNMENT) == record->size &&
+                    crc32(0, &record->topic_length, length - offsetof(record_header, topic_length)) == record->checksum;
+        }
+        if (!valid) {
+            LOGW("Discarding %llu bytes after a damaged record",
+                 static_cast<unsigned long long>(tail - position));
+            break;
+        }
+        if (!(record->flags & FLAG_PADDING)) ++count;
+        position += record->size;
+    }
+    header_->tail = position;
+    header_->count = count;
+}
+
+OfflineStore::record_header* OfflineStore::record_at(uint64_t position) const {
+    return reinterpret_cast<record_header*>(ring_ + position % capacity_);
+}
+
+bool OfflineStore::push(std::string_view topic, std::string_view payload, bool retain, int qos, uint8_t tag) {
+    if (header_ == nullptr) return false;
+
+    size_t length = sizeof(record_header) + topic.size() + payload.size();
+    size_t size = align_up(length, ALIGNMENT);
+    if (topic.size() > UINT16_MAX || size > capacity_) {
+        header_->dropped++;
+        return false;
+    }
+
+    if (header_->head == header_->tail && header_->tail % capacity_ != 0) {
+        // Empty: start again at the beginning of the ring, so that no padding is needed. The
+        // head moves first; a crash in between leaves head > tail, which recover() resets.
+        uint64_t start = header_->tail + (capacity_ - header_->tail % capacity_);
+        header_->head = start;
+        std::atomic_signal_fence(std::memory_order_release);
+        header_->tail = start;
+    }
+
+    // A record never wraps; the rest of the ring is skipped with a padding record instead
+    size_t contiguous = capacity_ - header_->tail % capacity_;
+    size_t padding = size > contiguous ? contiguous : 0;
+    if (padding + size > capacity_) {
+        // Would not fit even after dropping every other message
+        header_->dropped++;
+        return false;
+    }
+    while (capacity_ - (header_->tail - header_->head) < padding + size) {
+        drop_oldest();
+    }
+
+    uint64_t position = header_->tail;
+    if (padding > 0) {
+        record_header* pad = record_at(position);
+        std::memset(pad, 0, sizeof(record_header));
+        pad->size = static_cast<uint32_t>(padding);
+        pad->flags = FLAG_PADDING;
+        position += padding;
+    }
+
+    record_header* record = record_at(position);
+    record->size = static_cast<uint32_t>(size);
+    record->topic_length = static_cast<uint16_t>(topic.size());
+    record->flags = static_cast<uint8_t>((retain ? FLAG_RETAIN : 0) | ((qos << FLAG_QOS_SHIFT) & FLAG_QOS_MASK));
+    record->tag = tag;
+    record->payload_length = static_cast<uint32_t>(payload.size());
+    char* data = reinterpret_cast<char*>(record + 1);
+    std::memcpy(data, topic.data(), topic.size());
+    std::memcpy(data + topic.size(), payload.data(), payload.size());
+    record->checksum = crc32(0, &record->topic_length, length - offsetof(record_header, topic_length));
+
+    // The record is complete before it becomes visible through the header
+    std::atomic_signal_fence(std::memory_order_release);
+    header_->tail = position + size;
+    header_->count++;
+    return true;
+}
+
+bool OfflineStore::front(message_view& out) {
+    if (header_ == nullptr) return false;
+
+    while (header_->head < header_->tail) {
+        const record_header* record = record_at(header_->head);
+        if (record->flags & FLAG_PADDING) {
+            header_->head += record->size;
+            continue;
+        }
+        const char* data = reinterpret_cast<const char*>(record + 1);
+        out.topic = std::string_view(data, record->topic_length);
+        out.payload = std::string_view(data + record->topic_length, record->payload_length);
+        out.retain = record->flags & FLAG_RETAIN;
+        out.qos = (record->flags & FLAG_QOS_MASK) >> FLAG_QOS_SHIFT;
+        out.tag = record->tag;
+        return true;
+    }
+    return false;
+}
+
+void OfflineStore::pop() {
+    message_view ignored;
+    if (!front(ignored)) return;
+    header_->head += record_at(header_->head)->size;
+    header_->count--;
+}
+
+void OfflineStore::drop_oldest() {
+    if (header_->head == header_->tail) return;
+    const record_header* record = record_at(header_->head);
+    if (!(record->flags & FLAG_PADDING)) {
+        header_->count--;
+        header_->dropped++;
+    }
+    header_->head += record->size;
+}
+
+size_t OfflineStore::size() const {
+    return header_ != nullptr ? static_cast<size_t>(header_->count) : 0;
+}
+
+size_t OfflineStore::bytes_used() const {
+    return header_ != nullptr ? static_cast<size_t>(header_->tail - header_->head) : 0;
+}
+
+uint64_t OfflineStore::dropped() const {
+    return header_ != nullptr ? header_->dropped : 0;
+}
+
+void OfflineStore::sync() {
+    if (mapping_ != nullptr) {
+        msync(mapping_, mapping_size_, MS_ASYNC);
+    }
+}
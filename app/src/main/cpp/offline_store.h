@@ -0,0 +1,81 @@
+#ifndef OPEN_SENSOR_OFFLINE_STORE_H
+#define OPEN_SENSOR_OFFLINE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Bounded FIFO of MQTT messages in a memory-mapped file, used to hold publishes while the
+// broker is unreachable and to replay them afterwards.
+//
+// The file is a header page followed by a ring of variable-length records, so memory use is
+// fixed by the capacity however long an outage lasts; when the ring is full the oldest
+// messages are discarded. Each record carries a CRC32 and the header's write position is only
+// advanced after the record is complete. Stores to the mapping survive a crash of the process,
+// and on open the records are validated up to the first torn or corrupt one, so a power loss
+// before the kernel wrote everything back costs at most the unflushed tail.
+//
+// Not thread-safe; the MQTT client wrapper only uses it on its io_context thread.
+class OfflineStore {
+public:
+    struct message_view {
+        std::string_view topic;
+        std::string_view payload;
+        bool retain;
+        int qos;
+        uint8_t tag;
+    };
+
+    OfflineStore() = default;
+    ~OfflineStore();
+
+    OfflineStore(const OfflineStore&) = delete;
+    OfflineStore& operator=(const OfflineStore&) = delete;
+
+    // Opens the file, creating it or starting over if it does not match capacity (rounded up
+    // to whole pages), and recovers the messages stored by a previous run.
+    bool open(const std::string& path, size_t capacity);
+    void close();
+    bool is_open() const { return header_ != nullptr; }
+
+    // Discards the oldest messages as needed. Returns false if the message is larger than
+    // the whole ring, or than the part left once the rest of the ring would have to be
+    // skipped so that the record does not wrap; an empty ring starts over at its beginning,
+    // so any message that fits the ring is then taken. The tag is stored with the message
+    // but not interpreted; the MQTT client wrapper keeps the payload encoding there.
+    bool push(std::string_view topic, std::string_view payload, bool retain, int qos, uint8_t tag = 0);
+    // The oldest message; the views stay valid until the next push() or pop().
+    bool front(message_view& out);
+    void pop();
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return capacity_; }
+    size_t bytes_used() const;
+    // Messages discarded because the ring was full, over the lifetime of the file
+    uint64_t dropped() const;
+
+    // Asks the kernel to write the mapping back
+    void sync();
+
+private:
+    struct file_header;
+    struct record_header;
+
+    static constexpr size_t ALIGNMENT = 16;
+
+    void reset();
+    void recover();
+    void drop_oldest();
+    record_header* record_at(uint64_t position) const;
+
+    int fd_ = -1;
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    file_header* header_ = nullptr;
+    char* ring_ = nullptr;
+    size_t capacity_ = 0;
+};
+
+#endif //OPEN_SENSOR_OFFLINE_STORE_H
@@ -0,0 +1,149 @@
+#include "orientation_filter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float DEFAULT_MADGWICK_BETA = 0.1f;
+constexpr float DEFAULT_MAHONY_KP = 0.5f;
+
+// 1 / |v|, or 0 for a vector of zero length
+float inverseNorm(float sumOfSquares) {
+    return sumOfSquares > 0.0f ? 1.0f / std::sqrt(sumOfSquares) : 0.0f;
+}
+
+void normalise(Quaternion& q) {
+    float inverse = inverseNorm(q.w * q.w + q.x * q.x + q.y * q.y + q.z * q.z);
+    if (inverse == 0.0f) {
+        q = Quaternion{};
+        return;
+    }
+    q.w *= inverse;
+    q.x *= inverse;
+    q.y *= inverse;
+    q.z *= inverse;
+}
+
+}
+
+EulerAngles toEuler(const Quaternion& q) {
+    EulerAngles angles;
+    angles.roll = std::atan2(2.0f * (q.w * q.x + q.y * q.z), 1.0f - 2.0f * (q.x * q.x + q.y * q.y));
+    angles.pitch = std::asin(std::clamp(2.0f * (q.w * q.y - q.z * q.x), -1.0f, 1.0f));
+    angles.yaw = std::atan2(2.0f * (q.w * q.z + q.x * q.y), 1.0f - 2.0f * (q.y * q.y + q.z * q.z));
+    return angles;
+}
+
+void OrientationFilter::configure(FusionAlgorithm algorithm, float gain, float integralGain) {
+    if (algorithm != algorithm_) {
+        bias_[0] = bias_[1] = bias_[2] = 0.0f;
+    }
+    algorithm_ = algorithm;
+    gain_ = gain > 0.0f ? gain : algorithm == FusionAlgorithm::madgwick ? DEFAULT_MADGWICK_BETA : DEFAULT_MAHONY_KP;
+    integralGain_ = integralGain > 0.0f ? integralGain : 0.0f;
+}
+
+void OrientationFilter::reset() {
+    q_ = Quaternion{};
+    bias_[0] = bias_[1] = bias_[2] = 0.0f;
+}
+
+void OrientationFilter::align(const float gravity[3]) {
+    float roll = std::atan2(gravity[1], gravity[2]);
+    float pitch = std::atan2(-gravity[0], std::sqrt(gravity[1] * gravity[1] + gravity[2] * gravity[2]));
+    float cr = std::cos(roll * 0.5f);
+    float sr = std::sin(roll * 0.5f);
+    float cp = std::cos(pitch * 0.5f);
+    float sp = std::sin(pitch * 0.5f);
+    // Yaw of zero
+    q_ = Quaternion{cr * cp, sr * cp, cr * sp, -sr * sp};
+}
+
+void OrientationFilter::update(const float gyro[3], const float gravity[3], float dt) {
+    if (algorithm_ == FusionAlgorithm::madgwick) {
+        updateMadgwick(gyro, gravity, dt);
+    } else {
+        updateMahony(gyro, gravity, dt);
+    }
+}
+
+// S. Madgwick, "An efficient orientation filter for inertial and inertial/magnetic sensor
+// arrays", 2010: the rate of change from the gyroscope, less beta times the normalised
+// gradient of the error between the measured and the predicted direction of gravity.
+void OrientationFilter::updateMadgwick(const float gyro[3], const float gravity[3], float dt) {
+    float q0 = q_.w, q1 = q_.x, q2 = q_.y, q3 = q_.z;
+    float gx = gyro[0], gy = gyro[1], gz = gyro[2];
+
+    float qDot0 = 0.5f * (-q1 * gx - q2 * gy - q3 * gz);
+    float qDot1 = 0.5f * (q0 * gx + q2 * gz - q3 * gy);
+    float qDot2 = 0.5f * (q0 * gy - q1 * gz + q3 * gx);
+    float qDot3 = 0.5f * (q0 * gz + q1 * gy - q2 * gx);
+
+    float inverse = inverseNorm(gravity[0] * gravity[0] + gravity[1] * gravity[1] + gravity[2] * gravity[2]);
+    if (inverse != 0.0f) {
+        float ax = gravity[0] * inverse, ay = gravity[1] * inverse, az = gravity[2] * inverse;
+
+        float q0q0 = q0 * q0, q1q1 = q1 * q1, q2q2 = q2 * q2, q3q3 = q3 * q3;
+        float s0 = 4.0f * q0 * q2q2 + 2.0f * q2 * ax + 4.0f * q0 * q1q1 - 2.0f * q1 * ay;
+        float s1 = 4.0f * q1 * q3q3 - 2.0f * q3 * ax + 4.0f * q0q0 * q1 - 2.0f * q0 * ay - 4.0f * q1 +
+                   8.0f * q1 * q1q1 + 8.0f * q1 * q2q2 + 4.0f * q1 * az;
+        float s2 = 4.0f * q0q0 * q2 + 2.0f * q0 * ax + 4.0f * q2 * q3q3 - 2.0f * q3 * ay - 4.0f * q2 +
+                   8.0f * q2 * q1q1 + 8.0f * q2 * q2q2 + 4.0f * q2 * az;
+        float s3 = 4.0f * q1q1 * q3 - 2.0f * q1 * ax + 4.0f * q2q2 * q3 - 2.0f * q2 * ay;
+
+        float step = gain_ * inverseNorm(s0 * s0 + s1 * s1 + s2 * s2 + s3 * s3);
+        qDot0 -= step * s0;
+        qDot1 -= step * s1;
+        qDot2 -= step * s2;
+        qDot3 -= step * s3;
+    }
+
+    q_.w = q0 + qDot0 * dt;
+    q_.x = q1 + qDot1 * dt;
+    q_.y = q2 + qDot2 * dt;
+    q_.z = q3 + qDot3 * dt;
+    normalise(q_);
+}
+
+// R. Mahony, T. Hamel, J.-M. Pflimlin, "Nonlinear complementary filters on the special
+// orthogonal group", 2008: the cross product of the measured and the predicted direction of
+// gravity is fed back into the rate, proportionally and, with an integral gain, integrated.
+void OrientationFilter::updateMahony(const float gyro[3], const float gravity[3], float dt) {
+    float q0 = q_.w, q1 = q_.x, q2 = q_.y, q3 = q_.z;
+    float gx = gyro[0], gy = gyro[1], gz = gyro[2];
+
+    float inverse = inverseNorm(gravity[0] * gravity[0] + gravity[1] * gravity[1] + gravity[2] * gravity[2]);
+    if (inverse != 0.0f) {
+        float ax = gravity[0] * inverse, ay = gravity[1] * inverse, az = gravity[2] * inverse;
+
+        // Half the predicted direction of gravity in device coordinates
+        float halfVx = q1 * q3 - q0 * q2;
+        float halfVy = q0 * q1 + q2 * q3;
+        float halfVz = q0 * q0 - 0.5f + q3 * q3;
+
+        float halfEx = ay * halfVz - az * halfVy;
+        float halfEy = az * halfVx - ax * halfVz;
+        float halfEz = ax * halfVy - ay * halfVx;
+
+        if (integralGain_ > 0.0f) {
+            bias_[0] += 2.0f * integralGain_ * halfEx * dt;
+            bias_[1] += 2.0f * integralGain_ * halfEy * dt;
+            bias_[2] += 2.0f * integralGain_ * halfEz * dt;
+            gx += bias_[0];
+            gy += bias_[1];
+            gz += bias_[2];
+        }
+        gx += 2.0f * gain_ * halfEx;
+        gy += 2.0f * gain_ * halfEy;
+        gz += 2.0f * gain_ * halfEz;
+    }
+
+    gx *= 0.5f * dt;
+    gy *= 0.5f * dt;
+    gz *= 0.5f * dt;
+    q_.w = q0 + (-q1 * gx - q2 * gy - q3 * gz);
+    q_.x = q1 + (q0 * gx + q2 * gz - q3 * gy);
+    q_.y = q2 + (q0 * gy - q1 * gz + q3 * gx);
+    q_.z = q3 + (q0 * gz + q1 * gy - q2 * gx);
+    normalise(q_);
+}
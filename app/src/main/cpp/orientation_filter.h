@@ -0,0 +1,63 @@
+#ifndef OPEN_SENSOR_ORIENTATION_FILTER_H
+#define OPEN_SENSOR_ORIENTATION_FILTER_H
+
+// Unit quaternion rotating device coordinates into the earth frame (z up)
+struct Quaternion {
+    float w = 1.0f;
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+};
+
+// Tait-Bryan angles in radians, applied yaw (about z), then pitch (y), then roll (x)
+struct EulerAngles {
+    float roll = 0.0f;
+    float pitch = 0.0f;
+    float yaw = 0.0f;
+};
+
+EulerAngles toEuler(const Quaternion& q);
+
+enum class FusionAlgorithm {
+    madgwick,
+    mahony
+};
+
+// Attitude from a gyroscope and a gravity reference, as a quaternion, with either Madgwick's
+// gradient descent filter or Mahony's explicit complementary filter. The gyroscope rate is
+// integrated and the result steered towards the measured direction of gravity, which fixes
+// roll and pitch; without a magnetometer the yaw is relative to the start and drifts slowly.
+//
+// The state is a few floats and an update is straight-line arithmetic with one reciprocal
+// square root per normalisation; nothing is allocated.
+class OrientationFilter {
+public:
+    // Madgwick's beta in rad/s, or Mahony's proportional gain; a gain of 0 or less selects
+    // the default of the algorithm (0.1 and 0.5). Mahony's integral gain (0.0 by default)
+    // removes a constant gyroscope bias. Keeps the orientation.
+    void configure(FusionAlgorithm algorithm, float gain, float integralGain = 0.0f);
+    FusionAlgorithm algorithm() const { return algorithm_; }
+
+    // gyro in rad/s and gravity in any unit, both in device coordinates, over dt seconds.
+    // A gravity vector of zero length, e.g. in free fall, leaves the gyroscope alone to
+    // integrate.
+    void update(const float gyro[3], const float gravity[3], float dt);
+    // Turns the orientation straight to the measured gravity, for the first sample
+    void align(const float gravity[3]);
+    void reset();
+
+    const Quaternion& orientation() const { return q_; }
+
+private:
+    void updateMadgwick(const float gyro[3], const float gravity[3], float dt);
+    void updateMahony(const float gyro[3], const float gravity[3], float dt);
+
+    FusionAlgorithm algorithm_ = FusionAlgorithm::madgwick;
+    float gain_ = 0.1f;
+    float integralGain_ = 0.0f;
+    Quaternion q_;
+    // Mahony's integral feedback, in rad/s: the negated gyroscope bias
+    float bias_[3] = {};
+};
+
+#endif //OPEN_SENSOR_ORIENTATION_FILTER_H
@@ -0,0 +1,147 @@
+#include "orientation_fusion.h"
+#include "pipeline_trace.h"
+#include "platform_log.h"
+#include "sample_batch.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#define LOG_TAG "OrientationFusion"
+
+namespace {
+
+// A reference sample older than this, relative to the step, is not used
+constexpr int64_t REFERENCE_MAX_AGE_NS = 200000000;
+// The gyroscope is taken as gone after this long without a sample, and gravity drives the
+// filter itself
+constexpr int64_t GYROSCOPE_TIMEOUT_NS = 200000000;
+// A longer gap between samples, e.g. while the sensor was off, is not integrated over
+constexpr int64_t MAX_STEP_NS = 100000000;
+
+constexpr float RADIANS_TO_DEGREES = static_cast<float>(180.0 / M_PI);
+
+int64_t orNow(int64_t timestampNs) {
+    return timestampNs != 0 ? timestampNs : pipeline_trace::now_ns();
+}
+
+}
+
+OrientationFusion::OrientationFusion(MqttClientWrapper* mqttClientWrapper, std::string topic)
+    : mqttClientWrapper_(mqttClientWrapper),
+      feed_(mqttClientWrapper->register_feed(topic)),
+      topic_(std::move(topic)),
+      updatesMetric_(metrics::counter("orientation.updates")),
+      messagesMetric_(metrics::counter("orientation.messages")),
+      failedMetric_(metrics::counter("orientation.publish_failed")) {
+    mqttClientWrapper_->set_feed_mode(feed_, MqttClientWrapper::feed_mode::coalesce);
+}
+
+void OrientationFusion::configure(FusionAlgorithm algorithm, float gain, float outputRateHz) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    LOGD("Updating fusion for topic %s: %s, gain %g, %g Hz", topic_.c_str(),
+         algorithm == FusionAlgorithm::madgwick ? "Madgwick" : "Mahony", gain, outputRateHz);
+    if (algorithm != filter_.algorithm()) {
+        filter_.reset();
+        aligned_ = false;
+    }
+    filter_.configure(algorithm, gain);
+    periodNs_ = outputRateHz > 0.0f ? static_cast<int64_t>(1e9 / outputRateHz) : 0;
+}
+
+void OrientationFusion::setTopic(std::string topic) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    topic_ = std::move(topic);
+    mqttClientWrapper_->set_feed_topic(feed_, topic_);
+}
+
+bool OrientationFusion::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return periodNs_ > 0 && !topic_.empty();
+}
+
+Quaternion OrientationFusion::orientation() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return filter_.orientation();
+}
+
+void OrientationFusion::addGyroscope(const float values[3], int64_t timestampNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (periodNs_ == 0 || topic_.empty()) {
+        return;
+    }
+    step(values, lastGyroscopeNs_, orNow(timestampNs));
+}
+
+void OrientationFusion::addGravity(const float values[3], int64_t timestampNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (periodNs_ == 0 || topic_.empty()) {
+        return;
+    }
+    timestampNs = orNow(timestampNs);
+    std::copy(values, values + 3, gravity_.values);
+    gravity_.timestampNs = timestampNs;
+    if (timestampNs - lastGyroscopeNs_ > GYROSCOPE_TIMEOUT_NS) {
+        static constexpr float STILL[3] = {};
+        step(STILL, lastReferenceNs_, timestampNs);
+    }
+}
+
+const OrientationFusion::Reference* OrientationFusion::reference(int64_t timestampNs) const {
+    if (gravity_.timestampNs != 0 && timestampNs - gravity_.timestampNs <= REFERENCE_MAX_AGE_NS) {
+        return &gravity_;
+    }
+    return nullptr;
+}
+
+void OrientationFusion::step(const float gyro[3], int64_t& lastNs, int64_t timestampNs) {
+    int64_t previousNs = lastNs;
+    if (timestampNs <= previousNs) {
+        return; // Repeated or out of order
+    }
+    lastNs = timestampNs;
+
+    const Reference* ref = reference(timestampNs);
+    if (!aligned_) {
+        if (ref == nullptr) {
+            return; // Nothing to start from yet
+        }
+        filter_.align(ref->values);
+        aligned_ = true;
+    } else if (previousNs != 0 && timestampNs - previousNs <= MAX_STEP_NS) {
+        static constexpr float NONE[3] = {};
+        filter_.update(gyro, ref != nullptr ? ref->values : NONE,
+                       static_cast<float>(timestampNs - previousNs) * 1e-9f);
+        updatesMetric_.add();
+    } else {
+        return;
+    }
+
+    if (timestampNs - lastPublishNs_ >= periodNs_) {
+        lastPublishNs_ = timestampNs;
+        publish(timestampNs);
+    }
+}
+
+// {"t":<ms>,"w":..,"x":..,"y":..,"z":..,"roll":<deg>,"pitch":<deg>,"yaw":<deg>}
+void OrientationFusion::publish(int64_t timestampNs) {
+    pipeline_trace::origin origin{timestampNs, pipeline_trace::sample()};
+    pipeline_trace::stages stages(origin.trace_id);
+
+    const Quaternion& q = filter_.orientation();
+    EulerAngles angles = toEuler(q);
+    char payload[256];
+    int length = std::snprintf(payload, sizeof(payload),
+                               "{\"t\":%lld,\"w\":%.5f,\"x\":%.5f,\"y\":%.5f,\"z\":%.5f,"
+                               "\"roll\":%.2f,\"pitch\":%.2f,\"yaw\":%.2f}",
+                               static_cast<long long>(currentTimeMillis()), q.w, q.x, q.y, q.z,
+                               angles.roll * RADIANS_TO_DEGREES, angles.pitch * RADIANS_TO_DEGREES,
+                               angles.yaw * RADIANS_TO_DEGREES);
+    stages.mark("format");
+    if (length < 0 || static_cast<size_t>(length) >= sizeof(payload)) {
+        return;
+    }
+    bool accepted = mqttClientWrapper_->publish(feed_, payload, static_cast<size_t>(length),
+                                                PayloadEncoding::json, origin);
+    (accepted ? messagesMetric_ : failedMetric_).add();
+    stages.mark("dispatch");
+}
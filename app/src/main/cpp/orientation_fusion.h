@@ -0,0 +1,76 @@
+#ifndef OPEN_SENSOR_ORIENTATION_FUSION_H
+#define OPEN_SENSOR_ORIENTATION_FUSION_H
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include "metrics.h"
+#include "mqtt_client_wrapper.h"
+#include "orientation_filter.h"
+
+// Device orientation from the gyroscope and gravity sensors, fused in the process and
+// published as a quaternion and Euler angles at a fixed output rate, so that the broker gets
+// one low-rate stream instead of several raw ones.
+//
+// Gyroscope samples drive the OrientationFilter, steered by the gravity sensor as long as its
+// samples are recent. Gravity is required: the app's "accelerometer" is the linear
+// acceleration sensor, with gravity removed, which points along the motion rather than down
+// and so cannot serve as the reference. Gravity on its own, without a gyroscope, still gives
+// roll and pitch. Samples are taken in SI units before any processor scaling. Sensors
+// delivered in batches reach the filter a batch at a time, so gravity may lag the gyroscope by
+// up to a batch, which the filter's small gain absorbs.
+//
+// The samples of the two sensors may come from different threads (the Kotlin services and
+// native ingestion), so the state is kept under a mutex; it is held for a filter update and,
+// at the output rate, for formatting and queueing a message, so the feed still sees one
+// producer at a time. The feed coalesces, since only the latest orientation matters.
+// Updates and messages are counted in metrics.h as "orientation.updates" and
+// "orientation.messages".
+class OrientationFusion {
+public:
+    OrientationFusion(MqttClientWrapper* mqttClientWrapper, std::string topic);
+
+    // An output rate of 0 turns fusion off. Keeps the orientation unless the algorithm changes.
+    void configure(FusionAlgorithm algorithm, float gain, float outputRateHz);
+    void setTopic(std::string topic);
+    bool enabled() const;
+
+    // Sensor values as reported by the sensor: rad/s and m/s^2. timestampNs is the sensor
+    // event's timestamp, on the clock of pipeline_trace::now_ns, or 0 if unknown.
+    void addGyroscope(const float values[3], int64_t timestampNs);
+    void addGravity(const float values[3], int64_t timestampNs);
+
+    Quaternion orientation() const;
+
+private:
+    // A sample of the gravity reference and when it was taken
+    struct Reference {
+        float values[3] = {};
+        int64_t timestampNs = 0;
+    };
+
+    // Runs one filter step ending at timestampNs; the caller holds mutex_
+    void step(const float gyro[3], int64_t& lastNs, int64_t timestampNs);
+    const Reference* reference(int64_t timestampNs) const;
+    void publish(int64_t timestampNs);
+
+    MqttClientWrapper* mqttClientWrapper_;
+    MqttClientWrapper::feed_id feed_;
+
+    mutable std::mutex mutex_;
+    std::string topic_;
+    int64_t periodNs_ = 0;
+    OrientationFilter filter_;
+    bool aligned_ = false;
+    Reference gravity_;
+    int64_t lastGyroscopeNs_ = 0;
+    // Timestamp of the previous step driven by gravity alone
+    int64_t lastReferenceNs_ = 0;
+    int64_t lastPublishNs_ = 0;
+
+    metrics::Counter updatesMetric_;
+    metrics::Counter messagesMetric_;
+    metrics::Counter failedMetric_;
+};
+
+#endif //OPEN_SENSOR_ORIENTATION_FUSION_H
@@ -0,0 +1,152 @@
+#include "payload_format.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+namespace {
+
+constexpr double POW10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12
+};
+
+// Scaled values at or above this magnitude no longer fit the 64-bit integer path.
+constexpr double MAX_EXACT_SCALED = 1e18;
+
+}
+
+void FixedPointFormat::setPrecision(int precision) {
+    precision_ = precision;
+    fastPath_ = precision >= 0 && precision <= MAX_FAST_PRECISION;
+    exactScale_ = fastPath_ ? POW10[precision] : 0.0;
+    scale_ = static_cast<float>(fastPath_ ? POW10[precision] : std::pow(10, precision));
+}
+
+float FixedPointFormat::truncate(float value) const {
+    float rounded = std::trunc(value * scale_) / scale_;
+    // Coerce negative zero to positive zero
+    if (rounded == 0.0f) rounded = 0.0f;
+    return rounded;
+}
+
+float FixedPointFormat::roundNearest(float value) const {
+    float rounded = std::nearbyint(value * scale_) / scale_;
+    if (rounded == 0.0f) rounded = 0.0f;
+    return rounded;
+}
+
+// The vector paths perform the same operations as the scalar ones in the same order
+// (multiply, scale, round, divide), so every lane rounds identically. Adding +0 turns -0
+// into +0.
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+void FixedPointFormat::truncate4(const float values[4], const float multipliers[4], float out[4]) const {
+    float32x4_t scale = vdupq_n_f32(scale_);
+    float32x4_t scaled = vmulq_f32(vmulq_f32(vld1q_f32(values), vld1q_f32(multipliers)), scale);
+    vst1q_f32(out, vaddq_f32(vdivq_f32(vrndq_f32(scaled), scale), vdupq_n_f32(0.0f)));
+}
+
+void FixedPointFormat::roundNearest4(const float values[4], const float multipliers[4], float out[4]) const {
+    float32x4_t scale = vdupq_n_f32(scale_);
+    float32x4_t scaled = vmulq_f32(vmulq_f32(vld1q_f32(values), vld1q_f32(multipliers)), scale);
+    vst1q_f32(out, vaddq_f32(vdivq_f32(vrndnq_f32(scaled), scale), vdupq_n_f32(0.0f)));
+}
+
+#elif defined(__SSE4_1__)
+
+void FixedPointFormat::truncate4(const float values[4], const float multipliers[4], float out[4]) const {
+    __m128 scale = _mm_set1_ps(scale_);
+    __m128 scaled = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(values), _mm_loadu_ps(multipliers)), scale);
+    __m128 rounded = _mm_round_ps(scaled, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    _mm_storeu_ps(out, _mm_add_ps(_mm_div_ps(rounded, scale), _mm_setzero_ps()));
+}
+
+void FixedPointFormat::roundNearest4(const float values[4], const float multipliers[4], float out[4]) const {
+    __m128 scale = _mm_set1_ps(scale_);
+    __m128 scaled = _mm_mul_ps(_mm_mul_ps(_mm_loadu_ps(values), _mm_loadu_ps(multipliers)), scale);
+    __m128 rounded = _mm_round_ps(scaled, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    _mm_storeu_ps(out, _mm_add_ps(_mm_div_ps(rounded, scale), _mm_setzero_ps()));
+}
+
+#else
+
+void FixedPointFormat::truncate4(const float values[4], const float multipliers[4], float out[4]) const {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = truncate(values[i] * multipliers[i]);
+    }
+}
+
+void FixedPointFormat::roundNearest4(const float values[4], const float multipliers[4], float out[4]) const {
+    for (int i = 0; i < 4; ++i) {
+        out[i] = roundNearest(values[i] * multipliers[i]);
+    }
+}
+
+#endif
+
+int FixedPointFormat::formatNumber(char* out, float value) const {
+    if (fastPath_ && std::isfinite(value)) {
+        // Exact product, so rounding it to the nearest integer (ties to even) matches how
+        // printf rounds the binary value to precision_ decimals.
+        double scaled = static_cast<double>(value) * exactScale_;
+        if (std::fabs(scaled) < MAX_EXACT_SCALED) {
+            auto digits = static_cast<uint64_t>(std::fabs(std::rint(scaled)));
+
+            // Collect digits in reverse, padded so that there is at least one integer digit
+            char reversed[24];
+            int count = 0;
+            do {
+                reversed[count++] = static_cast<char>('0' + digits % 10);
+                digits /= 10;
+            } while (digits != 0);
+            while (count <= precision_) {
+                reversed[count++] = '0';
+            }
+
+            char* p = out;
+            // printf keeps the sign of negative values that round to zero ("-0.00")
+            if (std::signbit(value)) *p++ = '-';
+            for (int i = count - 1; i >= precision_; --i) *p++ = reversed[i];
+            if (precision_ > 0) {
+                *p++ = '.';
+                for (int i = precision_ - 1; i >= 0; --i) *p++ = reversed[i];
+            }
+            return static_cast<int>(p - out);
+        }
+    }
+
+    int length = snprintf(out, MAX_NUMBER_LENGTH, "%.*f", precision_, value);
+    return length >= 0 && length < MAX_NUMBER_LENGTH ? length : -1;
+}
+
+int FixedPointFormat::formatJson(char* buffer, size_t size, const char* const keys[], const float values[], size_t count) const {
+    char* out = buffer;
+    char* const end = buffer + size;
+    // Keeps one byte free for the terminating NUL
+    auto append = [&](const char* text, size_t length) {
+        if (length >= static_cast<size_t>(end - out)) return false;
+        std::memcpy(out, text, length);
+        out += length;
+        return true;
+    };
+
+    if (!append("{", 1)) return -1;
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0 && !append(",", 1)) return -1;
+        if (!append("\"", 1) || !append(keys[i], std::strlen(keys[i])) || !append("\":", 2)) return -1;
+
+        char number[MAX_NUMBER_LENGTH];
+        int length = formatNumber(number, values[i]);
+        if (length < 0 || !append(number, length)) return -1;
+    }
+    if (!append("}", 1)) return -1;
+
+    *out = '\0';
+    return static_cast<int>(out - buffer);
+}
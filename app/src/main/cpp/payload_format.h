@@ -0,0 +1,56 @@
+#ifndef OPEN_SENSOR_PAYLOAD_FORMAT_H
+#define OPEN_SENSOR_PAYLOAD_FORMAT_H
+
+#include <cstddef>
+
+// How scaled values are reduced to the configured number of decimals
+enum class RoundingMode {
+    truncate, // Toward zero
+    nearest,  // To nearest, ties to even
+};
+
+// Rounding and JSON number formatting for a fixed number of decimals.
+// All scale factors are computed once when the precision changes, and numbers are written
+// without going through the locale-aware printf machinery. The output is byte-identical to
+// snprintf("%.*f", precision, value).
+class FixedPointFormat {
+public:
+    FixedPointFormat() { setPrecision(2); }
+
+    void setPrecision(int precision);
+    int precision() const { return precision_; }
+
+    // trunc(value * 10^precision) / 10^precision, with negative zero coerced to positive zero.
+    float truncate(float value) const;
+    // Same with rint instead of trunc.
+    float roundNearest(float value) const;
+
+    // truncate(values[i] * multipliers[i]) and roundNearest(values[i] * multipliers[i]) for
+    // four channels at once, using NEON or SSE where available. Produce exactly the same
+    // floats as the scalar functions.
+    void truncate4(const float values[4], const float multipliers[4], float out[4]) const;
+    void roundNearest4(const float values[4], const float multipliers[4], float out[4]) const;
+
+    // Writes {"<keys[0]>":<values[0]>,...} and returns its length, like snprintf would.
+    // Returns -1 if the output does not fit in size bytes or a value needs the printf
+    // fallback beyond the internal limits; callers then format with snprintf instead.
+    int formatJson(char* buffer, size_t size, const char* const keys[], const float values[], size_t count) const;
+
+    // Writes a single number like "%.*f" into out (at least MAX_NUMBER_LENGTH bytes).
+    // Returns the number of characters written, or -1 if it would be longer.
+    int formatNumber(char* out, float value) const;
+
+    static constexpr int MAX_NUMBER_LENGTH = 64;
+
+private:
+    // Precisions up to this value take the exact integer path: a float times 10^12 is exact
+    // in a double since 5^12 fits in the 29 bits left over by the 24-bit float mantissa.
+    static constexpr int MAX_FAST_PRECISION = 12;
+
+    int precision_ = 2;
+    float scale_ = 100.0f;       // Same value as static_cast<float>(std::pow(10, precision_))
+    double exactScale_ = 100.0;  // 10^precision_ as a double, for the integer path
+    bool fastPath_ = true;
+};
+
+#endif //OPEN_SENSOR_PAYLOAD_FORMAT_H
@@ -0,0 +1,215 @@
+#include "pipeline_trace.h"
+#include <sys/prctl.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <vector>
+
+namespace pipeline_trace {
+
+namespace detail {
+std::atomic<uint32_t> sample_every{0};
+}
+
+namespace {
+
+// Fields are relaxed atomics so that reading a ring while its thread finishes a span is not a
+// data race; such a span may come out mixed, but every name read is one that was written.
+struct Event {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<uint32_t> trace_id{0};
+    std::atomic<int64_t> begin_ns{0};
+    std::atomic<int64_t> end_ns{0};
+};
+
+struct Ring {
+    // Trace the events belong to; a ring of an older trace is emptied before its next span
+    std::atomic<uint32_t> generation{0};
+    std::atomic<uint64_t> written{0};
+    char thread_name[16] = {};
+    Event events[EVENTS_PER_THREAD];
+};
+
+std::atomic<uint32_t> generation{0};
+std::atomic<uint32_t> last_id{0};
+// Allocated by the threads that record, as they first do, and kept for the process
+std::atomic<Ring*> rings[MAX_THREADS] = {};
+std::atomic<size_t> attached{0};
+
+Ring* attach_thread() {
+    size_t slot = attached.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= MAX_THREADS) {
+        return nullptr;
+    }
+    auto* ring = new Ring();
+    prctl(PR_GET_NAME, ring->thread_name);
+    rings[slot].store(ring, std::memory_order_release);
+    return ring;
+}
+
+void append_escaped(std::string& out, const char* text) {
+    for (; *text != '\0'; ++text) {
+        char c = *text;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) >= 0x20) {
+            out += c;
+        }
+    }
+}
+
+struct Span {
+    const char* name;
+    uint32_t trace_id;
+    int64_t begin_ns;
+    int64_t end_ns;
+    size_t thread;
+};
+
+}
+
+namespace detail {
+
+uint32_t next_id() {
+    uint32_t id = last_id.fetch_add(1, std::memory_order_relaxed) + 1;
+    return id != 0 ? id : last_id.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+}
+
+int64_t now_ns() {
+#ifdef __ANDROID__
+    timespec now{};
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void start(uint32_t sample_every) {
+    if (sample_every == 0) {
+        stop();
+        return;
+    }
+    generation.fetch_add(1, std::memory_order_acq_rel);
+    detail::sample_every.store(sample_every, std::memory_order_release);
+}
+
+void stop() {
+    detail::sample_every.store(0, std::memory_order_release);
+}
+
+void span(const char* name, uint32_t trace_id, int64_t begin_ns, int64_t end_ns) {
+    if (trace_id == 0 || !enabled()) {
+        return;
+    }
+    thread_local Ring* ring = attach_thread();
+    if (ring == nullptr) {
+        return;
+    }
+    uint32_t current = generation.load(std::memory_order_acquire);
+    if (ring->generation.load(std::memory_order_relaxed) != current) {
+        ring->written.store(0, std::memory_order_relaxed);
+        ring->generation.store(current, std::memory_order_release);
+    }
+    uint64_t n = ring->written.load(std::memory_order_relaxed);
+    Event& event = ring->events[n % EVENTS_PER_THREAD];
+    event.name.store(name, std::memory_order_relaxed);
+    event.trace_id.store(trace_id, std::memory_order_relaxed);
+    event.begin_ns.store(begin_ns, std::memory_order_relaxed);
+    event.end_ns.store(end_ns, std::memory_order_relaxed);
+    ring->written.store(n + 1, std::memory_order_release);
+}
+
+std::string chrome_json() {
+    stop();
+    uint32_t current = generation.load(std::memory_order_acquire);
+
+    std::vector<Span> spans;
+    std::vector<const char*> thread_names(MAX_THREADS, nullptr);
+    for (size_t t = 0; t < MAX_THREADS; ++t) {
+        Ring* ring = rings[t].load(std::memory_order_acquire);
+        if (ring == nullptr || ring->generation.load(std::memory_order_acquire) != current) {
+            continue;
+        }
+        thread_names[t] = ring->thread_name;
+        uint64_t n = ring->written.load(std::memory_order_acquire);
+        // The oldest slot is left out: a span started before stop() may be overwriting it
+        uint64_t first = n >= EVENTS_PER_THREAD ? n - EVENTS_PER_THREAD + 1 : 0;
+        for (uint64_t i = first; i < n; ++i) {
+            const Event& event = ring->events[i % EVENTS_PER_THREAD];
+            const char* name = event.name.load(std::memory_order_relaxed);
+            if (name != nullptr) {
+                spans.push_back({name, event.trace_id.load(std::memory_order_relaxed),
+                                 event.begin_ns.load(std::memory_order_relaxed),
+                                 event.end_ns.load(std::memory_order_relaxed), t + 1});
+            }
+        }
+    }
+    std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) {
+        return a.trace_id != b.trace_id ? a.trace_id < b.trace_id : a.begin_ns < b.begin_ns;
+    });
+    int64_t origin_ns = INT64_MAX;
+    for (const Span& s : spans) {
+        origin_ns = std::min(origin_ns, s.begin_ns);
+    }
+
+    std::string out;
+    out.reserve(256 + 200 * spans.size());
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first_event = true;
+    char line[256];
+    auto append = [&](int length) {
+        if (!first_event) out += ',';
+        first_event = false;
+        out.append(line, static_cast<size_t>(std::clamp(length, 0, static_cast<int>(sizeof(line) - 1))));
+    };
+    for (size_t t = 0; t < MAX_THREADS; ++t) {
+        if (thread_names[t] == nullptr) continue;
+        if (!first_event) out += ',';
+        first_event = false;
+        out += "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" + std::to_string(t + 1) +
+               ",\"args\":{\"name\":\"";
+        append_escaped(out, thread_names[t]);
+        out += "\"}}";
+    }
+    for (size_t i = 0; i < spans.size(); ++i) {
+        const Span& s = spans[i];
+        double ts = static_cast<double>(s.begin_ns - origin_ns) / 1000.0;
+        double dur = static_cast<double>(std::max<int64_t>(s.end_ns - s.begin_ns, 0)) / 1000.0;
+        append(std::snprintf(line, sizeof(line),
+                             "{\"ph\":\"X\",\"cat\":\"pipeline\",\"name\":\"%s\",\"pid\":1,\"tid\":%zu,"
+                             "\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"sample\":%" PRIu32 "}}",
+                             s.name, s.thread, ts, dur, s.trace_id));
+
+        // A flow through the stages of the sample: starts in the first, steps through the
+        // middle ones and ends in the last
+        bool first_of_sample = i == 0 || spans[i - 1].trace_id != s.trace_id;
+        bool last_of_sample = i + 1 == spans.size() || spans[i + 1].trace_id != s.trace_id;
+        if (first_of_sample && last_of_sample) continue;
+        const char* phase = first_of_sample ? "s" : last_of_sample ? "f" : "t";
+        append(std::snprintf(line, sizeof(line),
+                             "{\"ph\":\"%s\",\"cat\":\"pipeline\",\"name\":\"sample\",\"id\":%" PRIu32
+                             ",\"pid\":1,\"tid\":%zu,\"ts\":%.3f%s}",
+                             phase, s.trace_id, s.thread, ts, last_of_sample ? ",\"bp\":\"e\"" : ""));
+    }
+    out += "]}";
+    return out;
+}
+
+bool write_chrome_json(const std::string& path) {
+    std::string json = chrome_json();
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (file == nullptr) {
+        return false;
+    }
+    bool written = std::fwrite(json.data(), 1, json.size(), file) == json.size();
+    return std::fclose(file) == 0 && written;
+}
+
+}
@@ -0,0 +1,96 @@
+#ifndef OPEN_SENSOR_PIPELINE_TRACE_H
+#define OPEN_SENSOR_PIPELINE_TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Sampled tracing of samples on their way from the sensor to the broker. While started, one
+// sample in every N per producing thread gets a trace id, and each stage it passes through
+// (processing, formatting, the feed queue, the in-flight window, the write and its
+// completion) records a span under that id. The spans can be written out as Chrome trace
+// event JSON, with a flow linking the stages of each sample across threads, to be opened in
+// Perfetto or chrome://tracing.
+//
+// Spans go to a fixed ring per thread, written only by that thread, so recording takes no
+// lock; each ring keeps its most recent EVENTS_PER_THREAD spans. Threads beyond MAX_THREADS
+// record nothing. When tracing is off, taking a trace id costs one relaxed load and untraced
+// samples record nothing.
+namespace pipeline_trace {
+
+constexpr size_t MAX_THREADS = 16;
+constexpr size_t EVENTS_PER_THREAD = 8192;
+
+// Nanoseconds on the clock of sensor timestamps: CLOCK_BOOTTIME on Android, as used by
+// SensorEvent.timestamp and ASensorEvent, and steady_clock elsewhere, as used by the
+// synthetic source.
+int64_t now_ns();
+
+// Where a message came from, carried with it until its publish completes. A sensor timestamp
+// of 0 is unknown and a trace id of 0 is not traced; messages not made from samples have both.
+struct origin {
+    int64_t sensor_ns = 0;
+    uint32_t trace_id = 0;
+};
+
+namespace detail {
+extern std::atomic<uint32_t> sample_every;
+uint32_t next_id();
+}
+
+// Starts tracing 1 in sample_every samples, discarding spans recorded before
+void start(uint32_t sample_every);
+void stop();
+
+inline bool enabled() {
+    return detail::sample_every.load(std::memory_order_relaxed) != 0;
+}
+
+// Trace id for a new sample: non-zero for the first and then every sample_every-th sample
+// taken on the calling thread while tracing
+inline uint32_t sample() {
+    uint32_t every = detail::sample_every.load(std::memory_order_relaxed);
+    if (every == 0) {
+        return 0;
+    }
+    thread_local uint32_t countdown = 1;
+    if (--countdown != 0) {
+        return 0;
+    }
+    countdown = every;
+    return detail::next_id();
+}
+
+// Records a stage of a traced sample on the calling thread; name must outlive the trace,
+// e.g. a string literal. Ignored for trace id 0 and while stopped.
+void span(const char* name, uint32_t trace_id, int64_t begin_ns, int64_t end_ns);
+
+// Consecutive stages of one sample on one thread: each mark records the time since the
+// previous one, or since construction, as a span. Reads no clock for an untraced sample.
+class stages {
+public:
+    explicit stages(uint32_t trace_id) : trace_id_(trace_id), last_ns_(trace_id != 0 ? now_ns() : 0) {}
+
+    void mark(const char* name) {
+        if (trace_id_ != 0) {
+            int64_t now = now_ns();
+            span(name, trace_id_, last_ns_, now);
+            last_ns_ = now;
+        }
+    }
+
+private:
+    uint32_t trace_id_;
+    int64_t last_ns_;
+};
+
+// Stops tracing and returns the spans recorded since start() as Chrome trace event JSON,
+// timestamps in microseconds from the earliest span
+std::string chrome_json();
+// Same, to a file; false if it cannot be written
+bool write_chrome_json(const std::string& path);
+
+}
+
+#endif //OPEN_SENSOR_PIPELINE_TRACE_H
@@ -0,0 +1,44 @@
+#include "platform_log.h"
+#include <atomic>
+#include <cstdarg>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#else
+#include <cstdio>
+#endif
+
+namespace platform_log {
+
+namespace {
+std::atomic<level> min_level{level::warn};
+}
+
+void set_min_level(level min) {
+    min_level.store(min, std::memory_order_relaxed);
+}
+
+void write(level severity, const char* tag, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+#ifdef __ANDROID__
+    int priority = severity == level::error ? ANDROID_LOG_ERROR
+                   : severity == level::warn ? ANDROID_LOG_WARN
+                                             : ANDROID_LOG_DEBUG;
+    __android_log_vprint(priority, tag, format, args);
+#else
+    if (severity >= min_level.load(std::memory_order_relaxed)) {
+        // One line per call; stderr is unbuffered, so build it first to keep lines whole
+        char line[1024];
+        int length = std::snprintf(line, sizeof(line), "%c/%s: ",
+                                   severity == level::error ? 'E' : severity == level::warn ? 'W' : 'D', tag);
+        if (length > 0 && static_cast<size_t>(length) < sizeof(line)) {
+            std::vsnprintf(line + length, sizeof(line) - static_cast<size_t>(length), format, args);
+        }
+        std::fprintf(stderr, "%s\n", line);
+    }
+#endif
+    va_end(args);
+}
+
+}
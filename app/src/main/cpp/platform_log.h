@@ -0,0 +1,25 @@
+#ifndef OPEN_SENSOR_PLATFORM_LOG_H
+#define OPEN_SENSOR_PLATFORM_LOG_H
+
+// Diagnostic logging for the platform-neutral core. Android builds write to logcat; other
+// builds write to stderr, from warnings up unless set_min_level lowers the threshold. Sources
+// define LOG_TAG and use the LOGD, LOGW and LOGE macros.
+namespace platform_log {
+
+enum class level {
+    debug = 0,
+    warn = 1,
+    error = 2
+};
+
+// Ignored on Android, where logcat filters
+void set_min_level(level min);
+void write(level severity, const char* tag, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+}
+
+#define LOGD(...) platform_log::write(platform_log::level::debug, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) platform_log::write(platform_log::level::warn, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) platform_log::write(platform_log::level::error, LOG_TAG, __VA_ARGS__)
+
+#endif //OPEN_SENSOR_PLATFORM_LOG_H
@@ -0,0 +1,132 @@
+#include "replay_sensor_source.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+
+namespace {
+
+// Longest sleep while waiting, so that stop() takes effect promptly
+constexpr auto MAX_WAIT = std::chrono::milliseconds(10);
+
+// Parses "<kind>,<timestamp>,<x>[,<y>,<z>]". Returns false for comments and malformed lines.
+bool parseLine(const std::string& line, SensorSample& sample) {
+    if (line.empty() || line[0] == '#') return false;
+
+    const char* p = line.c_str();
+    char* end;
+    long kind = std::strtol(p, &end, 10);
+    if (end == p || *end != ',' || kind < 0 || kind >= SENSOR_KIND_COUNT) return false;
+    p = end + 1;
+    long long timestamp = std::strtoll(p, &end, 10);
+    if (end == p || *end != ',') return false;
+
+    sample.kind = static_cast<SensorKind>(kind);
+    sample.timestamp = timestamp;
+    sample.values[0] = sample.values[1] = sample.values[2] = 0.0f;
+    for (int i = 0; i < 3; ++i) {
+        p = end + 1;
+        sample.values[i] = std::strtof(p, &end);
+        if (end == p) return i > 0;
+        if (*end != ',') break;
+    }
+    return true;
+}
+
+}
+
+ReplaySensorSource::~ReplaySensorSource() {
+    stop();
+}
+
+bool ReplaySensorSource::start(sample_callback callback) {
+    if (running()) return true;
+
+    callback_ = std::move(callback);
+    stopRequested_ = false;
+    finished_ = false;
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void ReplaySensorSource::stop() {
+    if (!running()) return;
+
+    stopRequested_ = true;
+    thread_.join();
+    callback_ = nullptr;
+}
+
+bool ReplaySensorSource::enable(SensorKind kind, int32_t /* samplingPeriodUs */) {
+    int index = static_cast<int>(kind);
+    if (index < 0 || index >= SENSOR_KIND_COUNT) return false;
+    enabledMask_.fetch_or(1u << index);
+    return true;
+}
+
+void ReplaySensorSource::disable(SensorKind kind) {
+    int index = static_cast<int>(kind);
+    if (index < 0 || index >= SENSOR_KIND_COUNT) return;
+    enabledMask_.fetch_and(~(1u << index));
+}
+
+void ReplaySensorSource::run() {
+    std::ifstream file(path_);
+    if (!file) {
+        finished_ = true;
+        return;
+    }
+
+    const auto startTime = std::chrono::steady_clock::now();
+    SensorSample samples[BATCH];
+    size_t count = 0;
+    auto flush = [&] {
+        if (count == 0) return;
+        callback_(samples, count);
+        delivered_.fetch_add(count, std::memory_order_relaxed);
+        count = 0;
+    };
+
+    int64_t first = -1;
+    int64_t last = -1;
+    int64_t offset = 0; // Added to timestamps on every further pass when looping
+    uint64_t lines = 0;
+    std::string line;
+
+    while (!stopRequested_) {
+        if (!std::getline(file, line)) {
+            flush();
+            if (!loop_ || lines < 2) {
+                finished_ = true;
+                return;
+            }
+            // Continue one average sample interval after the last sample of this pass
+            int64_t span = last - first;
+            offset += span + span / static_cast<int64_t>(lines - 1);
+            file.clear();
+            file.seekg(0);
+            lines = 0;
+            continue;
+        }
+
+        SensorSample sample;
+        if (!parseLine(line, sample)) continue;
+        if (lines++ == 0 && first < 0) first = sample.timestamp;
+        if (offset == 0) last = sample.timestamp;
+        if ((enabledMask_.load(std::memory_order_relaxed) & (1u << static_cast<int>(sample.kind))) == 0) continue;
+
+        if (paced_) {
+            auto due = startTime + std::chrono::nanoseconds(sample.timestamp + offset - first);
+            if (due > std::chrono::steady_clock::now()) {
+                flush();
+                while (!stopRequested_ && std::chrono::steady_clock::now() < due) {
+                    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                            due - std::chrono::steady_clock::now(), MAX_WAIT));
+                }
+            }
+        }
+
+        sample.timestamp += offset;
+        samples[count++] = sample;
+        if (count == BATCH) flush();
+    }
+}
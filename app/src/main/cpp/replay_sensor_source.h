@@ -0,0 +1,54 @@
+#ifndef OPEN_SENSOR_REPLAY_SENSOR_SOURCE_H
+#define OPEN_SENSOR_REPLAY_SENSOR_SOURCE_H
+
+#include "sensor_source.h"
+#include <atomic>
+#include <string>
+#include <thread>
+
+// Replays samples recorded in a text file, one per line:
+//
+//     <kind>,<timestamp ns>,<x>[,<y>,<z>]
+//
+// where kind is the SensorKind value. Blank lines and lines starting with '#' are ignored.
+// Only enabled sensors are delivered, at the recorded rate; the sampling period passed to
+// enable() is ignored.
+class ReplaySensorSource : public SensorSource {
+public:
+    // When paced, samples are delivered with the spacing of their recorded timestamps.
+    // Otherwise they are delivered as fast as the callback returns. When looping, the file
+    // is replayed from the start with timestamps continuing where the previous pass ended.
+    explicit ReplaySensorSource(std::string path, bool paced = true, bool loop = false)
+            : path_(std::move(path)), paced_(paced), loop_(loop) {}
+    ~ReplaySensorSource() override;
+
+    bool start(sample_callback callback) override;
+    void stop() override;
+    bool running() const override { return thread_.joinable(); }
+
+    bool enable(SensorKind kind, int32_t samplingPeriodUs) override;
+    void disable(SensorKind kind) override;
+
+    // True once the whole file has been delivered (never when looping)
+    bool finished() const { return finished_.load(); }
+    uint64_t samplesDelivered() const { return delivered_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    static constexpr size_t BATCH = 64;
+
+    const std::string path_;
+    const bool paced_;
+    const bool loop_;
+
+    std::atomic<uint32_t> enabledMask_{0};
+
+    sample_callback callback_;
+    std::thread thread_;
+    std::atomic<bool> stopRequested_{false};
+    std::atomic<bool> finished_{false};
+    std::atomic<uint64_t> delivered_{0};
+};
+
+#endif //OPEN_SENSOR_REPLAY_SENSOR_SOURCE_H
@@ -0,0 +1,158 @@
+#include "sample_batch.h"
+#include "platform_log.h"
+
+#define LOG_TAG "SampleBatch"
+
+void SampleBatch::configure(int windowMs, int maxSamples, PayloadEncoding encoding, int decimals) {
+    windowMs_ = windowMs > 0 ? windowMs : 0;
+    maxSamples_ = maxSamples > 0 ? maxSamples : 0;
+    encoding_ = encoding;
+    decimals_ = decimals;
+    count_ = 0;
+    payload_.clear();
+}
+
+void SampleBatch::add(int64_t timestampMs, const char* sample, size_t length, clock::time_point now) {
+    size_t before = payload_.size();
+    switch (encoding_) {
+        case PayloadEncoding::json: addJson(timestampMs, sample, length); break;
+        case PayloadEncoding::cbor: addCbor(timestampMs, sample, length); break;
+        case PayloadEncoding::packed:
+        case PayloadEncoding::packedTimestamped: addPacked(timestampMs, sample, length); break;
+        case PayloadEncoding::series: break; // Takes the values instead
+    }
+    if (payload_.size() == before) {
+        return; // Not a sample in the configured encoding
+    }
+    if (count_ == 0) {
+        opened_ = now;
+    }
+    ++count_;
+}
+
+void SampleBatch::add(int64_t timestampMs, const float values[], size_t count, clock::time_point now) {
+    if (encoding_ != PayloadEncoding::series || count == 0) {
+        return;
+    }
+    if (count_ == 0) {
+        series_.reset(count, decimals_);
+        opened_ = now;
+    }
+    series_.add(timestampMs, values);
+    ++count_;
+}
+
+void SampleBatch::addJson(int64_t timestampMs, const char* sample, size_t length) {
+    if (length < 2 || sample[0] != '{') {
+        return; // Not a JSON object, nothing to merge the timestamp into
+    }
+
+    if (count_ == 0) {
+        payload_.assign("{\"samples\":[");
+    } else {
+        payload_ += ',';
+    }
+
+    // Merge the timestamp into the sample object: {"t":<ms>,"x":...}
+    payload_ += "{\"t\":";
+    payload_ += std::to_string(timestampMs);
+    if (length > 2) {
+        payload_ += ',';
+    }
+    payload_.append(sample + 1, length - 1);
+}
+
+void SampleBatch::addCbor(int64_t timestampMs, const char* sample, size_t length) {
+    // A map of fewer than 23 entries, whose size is in its first byte
+    if (length < 1) {
+        return;
+    }
+    auto head = static_cast<uint8_t>(sample[0]);
+    if ((head & 0xE0) != 0xA0 || (head & 0x1F) >= 23) {
+        return;
+    }
+
+    if (count_ == 0) {
+        // {"samples": [ ... with an indefinite-length array, closed by take()
+        payload_.assign("\xA1\x67samples\x9F", 10);
+    }
+
+    // One entry more, "t" first, then the sample's own entries
+    payload_ += static_cast<char>(head + 1);
+    payload_ += "\x61t\x1B";
+    auto t = static_cast<uint64_t>(timestampMs);
+    for (int i = 7; i >= 0; --i) {
+        payload_ += static_cast<char>(t >> (8 * i));
+    }
+    payload_.append(sample + 1, length - 1);
+}
+
+void SampleBatch::addPacked(int64_t timestampMs, const char* sample, size_t length) {
+    if (length < 1) {
+        return;
+    }
+    auto header = static_cast<uint8_t>(sample[0]);
+    size_t values = 4 * (header & packed_format::CHANNEL_MASK);
+    if (values == 0 || length < 1 + values) {
+        return;
+    }
+
+    if (count_ == 0) {
+        payload_.assign(1, static_cast<char>((header & packed_format::CHANNEL_MASK) | packed_format::TIMESTAMP));
+    }
+
+    // Every record of a batch is timestamped, whether or not the single samples are
+    auto t = static_cast<uint64_t>(timestampMs);
+    for (int i = 0; i < 8; ++i) {
+        payload_ += static_cast<char>(t >> (8 * i));
+    }
+    payload_.append(sample + length - values, values);
+}
+
+bool SampleBatch::isDue(clock::time_point now) const {
+    if (count_ == 0) {
+        return false;
+    }
+    if (count_ >= MAX_SAMPLES || (maxSamples_ > 0 && count_ >= maxSamples_)) {
+        return true;
+    }
+    return windowMs_ > 0 && now - opened_ >= std::chrono::milliseconds(windowMs_);
+}
+
+SampleBatch::clock::time_point SampleBatch::deadline() const {
+    if (count_ == 0 || windowMs_ == 0) {
+        return clock::time_point::max();
+    }
+    return opened_ + std::chrono::milliseconds(windowMs_);
+}
+
+std::string SampleBatch::take() {
+    if (encoding_ == PayloadEncoding::json) {
+        payload_ += "]}";
+    } else if (encoding_ == PayloadEncoding::cbor) {
+        payload_ += '\xFF'; // Break, ending the array
+    } else if (encoding_ == PayloadEncoding::series) {
+        count_ = 0;
+        return series_.finish();
+    }
+    count_ = 0;
+    std::string payload = std::move(payload_);
+    payload_.clear();
+    return payload;
+}
+
+void PublishRateMeter::maybeReport(const std::string& topic, clock::time_point now) {
+    auto elapsed = now - since_;
+    if (elapsed < REPORT_INTERVAL) {
+        return;
+    }
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    LOGD("%s: batched %.1f msg/s %.0f B/s, unbatched would be %.1f msg/s %.0f B/s",
+         topic.c_str(),
+         static_cast<double>(messages_) / seconds, static_cast<double>(messageBytes_) / seconds,
+         static_cast<double>(samples_) / seconds, static_cast<double>(sampleBytes_) / seconds);
+
+    since_ = now;
+    samples_ = sampleBytes_ = messages_ = messageBytes_ = 0;
+}
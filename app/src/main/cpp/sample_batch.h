@@ -0,0 +1,85 @@
+#ifndef OPEN_SENSOR_SAMPLE_BATCH_H
+#define OPEN_SENSOR_SAMPLE_BATCH_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "binary_payload.h"
+#include "series_codec.h"
+
+// Milliseconds since the Unix epoch, used to timestamp batched samples.
+inline int64_t currentTimeMillis() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+// Collects single-sample payloads into one message so that high-rate sensors publish once
+// per window instead of once per sample. JSON and CBOR samples become {"samples":[...]}
+// with a "t" field merged into each; packed records are concatenated behind a single
+// header, each with its timestamp (binary_payload.h). Series batches are compressed as the
+// samples arrive (series_codec.h).
+class SampleBatch {
+public:
+    using clock = std::chrono::steady_clock;
+
+    // Upper bound on samples per message, also applied when only a time window is set.
+    static constexpr int MAX_SAMPLES = 500;
+
+    // A window of 0 ms and a sample count of 0 disable batching. Samples passed to add()
+    // must be in the given encoding. Decimals are those of the rounded values, for the
+    // series encoding.
+    void configure(int windowMs, int maxSamples, PayloadEncoding encoding = PayloadEncoding::json,
+                   int decimals = 2);
+    bool enabled() const { return windowMs_ > 0 || maxSamples_ > 0; }
+    bool empty() const { return count_ == 0; }
+
+    // Appends a formatted sample (e.g. {"x":1.00,...}) tagged with its timestamp.
+    void add(int64_t timestampMs, const char* sample, size_t length, clock::time_point now);
+    // Appends the values of a sample, for the series encoding, which codes them against
+    // those of the previous sample
+    void add(int64_t timestampMs, const float values[], size_t count, clock::time_point now);
+    PayloadEncoding encoding() const { return encoding_; }
+    bool isDue(clock::time_point now) const;
+    // When the time window of the open batch ends; time_point::max() if there is no open
+    // batch or no time window
+    clock::time_point deadline() const;
+    // Closes the array and hands out the payload; the batch starts over empty.
+    std::string take();
+
+private:
+    void addJson(int64_t timestampMs, const char* sample, size_t length);
+    void addCbor(int64_t timestampMs, const char* sample, size_t length);
+    void addPacked(int64_t timestampMs, const char* sample, size_t length);
+
+    int windowMs_ = 0;
+    int maxSamples_ = 0;
+    int count_ = 0;
+    PayloadEncoding encoding_ = PayloadEncoding::json;
+    int decimals_ = 2;
+    clock::time_point opened_;
+    std::string payload_;
+    SeriesEncoder series_;
+};
+
+// Compares what was actually published with what the one-sample-per-publish mode
+// would have sent for the same samples, and logs both rates periodically.
+class PublishRateMeter {
+public:
+    using clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::seconds REPORT_INTERVAL{10};
+
+    void recordSample(size_t unbatchedBytes) { ++samples_; sampleBytes_ += unbatchedBytes; }
+    void recordPublish(size_t bytes) { ++messages_; messageBytes_ += bytes; }
+    void maybeReport(const std::string& topic, clock::time_point now);
+
+private:
+    clock::time_point since_ = clock::now();
+    uint64_t samples_ = 0;
+    uint64_t sampleBytes_ = 0;
+    uint64_t messages_ = 0;
+    uint64_t messageBytes_ = 0;
+};
+
+#endif //OPEN_SENSOR_SAMPLE_BATCH_H
@@ -1,67 +1,463 @@
 #include "sensor_processor.h"
+#include "platform_log.h"
+#include <algorithm>
+#include <chrono>
 #include <cstdio>
-#include <cmath> // For fabs and trunc
-#include <android/log.h>
 
 #define LOG_TAG "SensorProcessor"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
 
-// A small epsilon value for float comparison
-constexpr float SENSOR_EPSILON = std::numeric_limits<float>::epsilon();
+namespace {
 
-SensorProcessor::SensorProcessor(MqttClientWrapper* mqttClientWrapper, std::string topic)
-    : mqttClientWrapper_(mqttClientWrapper), topic_(std::move(topic)) {}
+// Slow path for values FixedPointFormat::formatJson does not handle. Returns the length the
+// full message would have, like snprintf.
+int formatJsonWithPrintf(char* buffer, size_t size, const char* const keys[], const float values[], size_t count,
+                         int precision) {
+    std::string json = "{";
+    for (size_t i = 0; i < count; ++i) {
+        if (i > 0) json += ',';
+        json += '"';
+        json += keys[i];
+        json += "\":";
+        char number[512];
+        snprintf(number, sizeof(number), "%.*f", precision, values[i]);
+        json += number;
+    }
+    json += '}';
+    return snprintf(buffer, size, "%s", json.c_str());
+}
+
+// Wall-clock time at which a sample was taken, from its sensor timestamp, or the current time
+// if that is unknown
+int64_t sampleTimeMillis(int64_t sensorNs) {
+    int64_t now = currentTimeMillis();
+    return sensorNs != 0 ? now - (pipeline_trace::now_ns() - sensorNs) / 1000000 : now;
+}
+
+}
+
+template<size_t N, typename Traits>
+SensorProcessor<N, Traits>::SensorProcessor(MqttClientWrapper* mqttClientWrapper, const std::string& name,
+                                            std::string topic)
+    : mqttClientWrapper_(mqttClientWrapper), topic_(std::move(topic)),
+      feed_(mqttClientWrapper->register_feed(topic_)),
+      samplesMetric_(metrics::counter(name + ".samples")),
+      suppressedMetric_(metrics::counter(name + ".suppressed")),
+      messagesMetric_(metrics::counter(name + ".messages")),
+      failedMetric_(metrics::counter(name + ".publish_failed")),
+      bytesMetric_(metrics::counter(name + ".bytes")),
+      processNsMetric_(metrics::histogram(name + ".process_ns")),
+      deadlineGuard_(std::make_shared<DeadlineGuard>()),
+      deadlineTimer_(mqttClientWrapper->executor()) {
+    deadlineGuard_->owner = this;
+}
+
+template<size_t N, typename Traits>
+SensorProcessor<N, Traits>::~SensorProcessor() {
+    {
+        // A deadline handler running now finishes first; later ones find no owner
+        std::lock_guard<std::mutex> lock(deadlineGuard_->mutex);
+        deadlineGuard_->owner = nullptr;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    flushBatch();
+}
+
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::setTopic(std::string topic) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    topic_ = std::move(topic);
+    mqttClientWrapper_->set_feed_topic(feed_, topic_);
+}
+
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::setQos(int qos) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    qos_ = qos;
+    mqttClientWrapper_->set_feed_qos(feed_, qos);
+}
+
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::updateSettings(const values_type& multipliers, int rounding,
+                                                int batchWindowMs, int batchMaxSamples,
+                                                const ChangeDetectionSettings& changeDetection,
+                                                int aggregationWindowMs, int aggregationStepMs,
+                                                PayloadEncoding encoding, MqttClientWrapper::feed_mode feedMode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::copy(multipliers.begin(), multipliers.end(), multipliers_);
+    applySettings(rounding, batchWindowMs, batchMaxSamples, changeDetection, aggregationWindowMs, aggregationStepMs,
+                  encoding, feedMode);
+}
+
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::updateSettings(int rounding, int batchWindowMs, int batchMaxSamples,
+                                                const ChangeDetectionSettings& changeDetection,
+                                                int aggregationWindowMs, int aggregationStepMs,
+                                                PayloadEncoding encoding, MqttClientWrapper::feed_mode feedMode) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    applySettings(rounding, batchWindowMs, batchMaxSamples, changeDetection, aggregationWindowMs, aggregationStepMs,
+                  encoding, feedMode);
+}
 
-void SensorProcessor::updateSettings(float multiplierX, float multiplierY, float multiplierZ, int rounding) {
-    LOGD("Updating settings for topic %s: multipliers(%.2f, %.2f, %.2f), rounding(%d)",
-         topic_.c_str(), multiplierX, multiplierY, multiplierZ, rounding);
-    multiplierX_ = multiplierX;
-    multiplierY_ = multiplierY;
-    multiplierZ_ = multiplierZ;
-    rounding_ = rounding;
-    // Reset last values to ensure the next event is published
-    lastX_ = std::numeric_limits<float>::quiet_NaN();
-    lastY_ = std::numeric_limits<float>::quiet_NaN();
-    lastZ_ = std::numeric_limits<float>::quiet_NaN();
+// The batch, the change detector and the window panes are all in use by processData, hence
+// the caller holds mutex_
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::applySettings(int rounding, int batchWindowMs, int batchMaxSamples,
+                                               const ChangeDetectionSettings& changeDetection,
+                                               int aggregationWindowMs, int aggregationStepMs,
+                                               PayloadEncoding encoding, MqttClientWrapper::feed_mode feedMode) {
+    LOGD("Updating settings for topic %s: rounding(%d), batch(%d ms, %d samples), "
+         "deadband(%g, %g%%, hysteresis %g%%), interval(%d-%d ms), aggregation(%d ms, step %d ms), %s, %s, "
+         "%llu samples suppressed so far",
+         topic_.c_str(), rounding, batchWindowMs, batchMaxSamples,
+         changeDetection.deadband, changeDetection.relativeDeadband * 100.0f, changeDetection.hysteresis * 100.0f,
+         changeDetection.minIntervalMs, changeDetection.heartbeatMs, aggregationWindowMs, aggregationStepMs,
+         contentType(encoding), feedMode == MqttClientWrapper::feed_mode::coalesce ? "latest value only" : "every sample",
+         static_cast<unsigned long long>(changeDetector_.suppressed()));
+    // Publish whatever was collected under the previous settings
+    flushBatch();
+    encoding_ = encoding;
+    mqttClientWrapper_->set_feed_mode(feed_, feedMode);
+    batch_.configure(batchWindowMs, batchMaxSamples, encoding, rounding);
+    format_.setPrecision(rounding);
+    // Also resets the last values to ensure the next event is published
+    changeDetector_.configure(changeDetection);
+    windowStats_.configure(aggregationWindowMs, aggregationStepMs);
 }
 
-void SensorProcessor::processData(float x, float y, float z) {
+template<size_t N, typename Traits>
+bool SensorProcessor<N, Traits>::updateFilters(const FilterChainSettings& filters) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (filters == filters_.settings()) {
+        return true;
+    }
+    LOGD("Updating filters for topic %s: %zu stages at %g Hz", topic_.c_str(), filters.count, filters.sampleRateHz);
+    return filters_.configure(filters);
+}
+
+template<size_t N, typename Traits>
+bool SensorProcessor<N, Traits>::updateSpectrum(int blockSize, int bands, float sampleRateHz) {
+    // configure reallocates the blocks and tables add() writes into
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spectrum_.enabled() ? spectrum_.blockSize() == blockSize && spectrum_.bands() == bands &&
+                              spectrum_.sampleRateHz() == sampleRateHz
+                            : blockSize <= 0) {
+        return true;
+    }
+    LOGD("Updating spectrum for topic %s: %d samples, %d bands at %g Hz", topic_.c_str(), blockSize, bands, sampleRateHz);
+    return spectrum_.configure(blockSize, bands, sampleRateHz);
+}
+
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::processData(const values_type& values, int64_t timestampNs) {
+    std::lock_guard<std::mutex> lock(mutex_);
     if (topic_.empty()) {
         return; // Do not process if the topic is empty
     }
+    // Checked for every sample, not only for those the change detector lets through, so that
+    // unchanging values do not hold back a batch beyond its window
+    if (batch_.isDue(SampleBatch::clock::now())) {
+        flushBatch();
+    }
+    auto start = std::chrono::steady_clock::now();
+    samplesMetric_.add();
+    pipeline_trace::origin origin{timestampNs, pipeline_trace::sample()};
+    if (origin.trace_id != 0 && timestampNs != 0) {
+        // From the sensor to here: delivery by the framework and the JNI batching
+        pipeline_trace::span("sensor", origin.trace_id, timestampNs, pipeline_trace::now_ns());
+    }
+    processSample(values, origin);
+    processNsMetric_.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()));
+}
 
-    float processedX = x * multiplierX_;
-    float processedY = y * multiplierY_;
-    float processedZ = z * multiplierZ_;
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::processSample(const values_type& values, const pipeline_trace::origin& origin) {
+    pipeline_trace::stages stages(origin.trace_id);
+    // Padded to a full vector for the filters and the rounding kernels
+    alignas(16) float input[4] = {};
+    std::copy(values.begin(), values.end(), input);
+    if (filters_.enabled()) {
+        filters_.process(input);
+    }
 
-    // Round the values first before comparison
-    auto powerOf10 = static_cast<float>(std::pow(10, rounding_));
-    float roundedX = std::trunc(processedX * powerOf10) / powerOf10;
-    float roundedY = std::trunc(processedY * powerOf10) / powerOf10;
-    float roundedZ = std::trunc(processedZ * powerOf10) / powerOf10;
+    if (spectrum_.enabled() || windowStats_.enabled()) {
+        // Analyse the scaled values at full precision; rounding applies to the results
+        float scaled[N];
+        for (size_t i = 0; i < N; ++i) {
+            scaled[i] = input[i] * multipliers_[i];
+        }
+        if (spectrum_.enabled()) {
+            typename SpectrumAnalyzer<N>::result_type spectra;
+            bool complete = spectrum_.add(scaled, spectra);
+            stages.mark("analyse");
+            if (complete) {
+                publishSpectrum(spectra, origin);
+                stages.mark("publish spectrum");
+            }
+            return;
+        }
+        typename WindowedStats<N>::result_type closed;
+        bool closing = windowStats_.add(scaled, WindowedStats<N>::clock::now(), closed);
+        stages.mark("analyse");
+        if (closing) {
+            publishWindow(closed, origin);
+            stages.mark("publish window");
+        }
+        armDeadline();
+        return;
+    }
 
-    // Coerce negative zero to positive zero
-    if (roundedX == 0.0f) roundedX = 0.0f;
-    if (roundedY == 0.0f) roundedY = 0.0f;
-    if (roundedZ == 0.0f) roundedZ = 0.0f;
+    // Apply the multipliers and round the values first before comparison
+    alignas(16) float rounded[4];
+    if constexpr (N == 1) {
+        rounded[0] = Traits::ROUNDING == RoundingMode::truncate ? format_.truncate(input[0] * multipliers_[0])
+                                                                : format_.roundNearest(input[0] * multipliers_[0]);
+    } else if constexpr (Traits::ROUNDING == RoundingMode::truncate) {
+        format_.truncate4(input, multipliers_, rounded);
+    } else {
+        format_.roundNearest4(input, multipliers_, rounded);
+    }
 
-    // Check if the rounded values have changed
-    if (std::fabs(roundedX - lastX_) < SENSOR_EPSILON &&
-        std::fabs(roundedY - lastY_) < SENSOR_EPSILON &&
-        std::fabs(roundedZ - lastZ_) < SENSOR_EPSILON) {
-        return; // Do not publish if data is unchanged
+    if (!changeDetector_.shouldPublish(rounded)) {
+        suppressedMetric_.add();
+        stages.mark("suppressed");
+        return; // Unchanged, within the deadband, or too soon after the last publish
     }
+    stages.mark("round");
 
+    int64_t timestampMs = sampleTimeMillis(origin.sensor_ns);
     char buffer[256];
-    snprintf(buffer, sizeof(buffer), "{\"x\":%.*f,\"y\":%.*f,\"z\":%.*f}",
-             rounding_, roundedX,
-             rounding_, roundedY,
-             rounding_, roundedZ);
+    int length = encodeSample(rounded, timestampMs, buffer, sizeof(buffer));
+    stages.mark("format");
 
-    if (mqttClientWrapper_->publish(topic_, buffer)) {
-        // Update last values with the new rounded values
-        lastX_ = roundedX;
-        lastY_ = roundedY;
-        lastZ_ = roundedZ;
+    if (batch_.enabled()) {
+        if (length <= 0 || static_cast<size_t>(length) >= sizeof(buffer)) {
+            return; // Truncated sample, cannot be merged into the batch
+        }
+        auto now = SampleBatch::clock::now();
+        if (batch_.empty()) {
+            batchOrigin_ = origin;
+        }
+        if (encoding_ == PayloadEncoding::series) {
+            batch_.add(timestampMs, rounded, N, now);
+        } else {
+            batch_.add(timestampMs, buffer, length, now);
+        }
+        rateMeter_.recordSample(length);
+        // The sample is committed to the batch, so it counts as published
+        changeDetector_.commit(rounded);
+
+        stages.mark("batch");
+        if (batch_.isDue(now)) {
+            flushBatch();
+            stages.mark("publish batch");
+        } else {
+            armDeadline();
+        }
+        rateMeter_.maybeReport(topic_, now);
+        return;
+    }
+
+    if (length <= 0) {
+        return;
+    }
+    bool accepted = mqttClientWrapper_->publish(feed_, buffer, length, encoding_, origin);
+    stages.mark("dispatch");
+    countPublish(accepted, static_cast<size_t>(length));
+    if (accepted) {
+        changeDetector_.commit(rounded);
     }
 }
+
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::countPublish(bool accepted, size_t bytes) {
+    if (accepted) {
+        messagesMetric_.add();
+        bytesMetric_.add(bytes);
+    } else {
+        failedMetric_.add();
+    }
+}
+
+template<size_t N, typename Traits>
+int SensorProcessor<N, Traits>::encodeSample(const float rounded[], int64_t timestampMs, char* buffer,
+                                             size_t size) const {
+    switch (encoding_) {
+        case PayloadEncoding::cbor:
+            return encodeCbor(buffer, size, Traits::KEYS, rounded, N);
+        case PayloadEncoding::packed:
+            return encodePacked(buffer, size, rounded, N, false, 0);
+        case PayloadEncoding::packedTimestamped:
+            return encodePacked(buffer, size, rounded, N, true, timestampMs);
+        case PayloadEncoding::series:
+            return encodeSeriesSample(buffer, size, rounded, N, format_.precision(), timestampMs);
+        case PayloadEncoding::json:
+            break;
+    }
+    int length = format_.formatJson(buffer, size, Traits::KEYS, rounded, N);
+    if (length < 0) {
+        length = formatJsonWithPrintf(buffer, size, Traits::KEYS, rounded, N, format_.precision());
+    }
+    return length;
+}
+
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::flushBatch() {
+    if (batch_.empty()) {
+        return;
+    }
+
+    std::string payload = batch_.take();
+    pipeline_trace::origin origin = batchOrigin_;
+    batchOrigin_ = {};
+    if (topic_.empty()) {
+        return;
+    }
+    size_t bytes = payload.size();
+    bool accepted = mqttClientWrapper_->publish(topic_, payload, true, qos_, batch_.encoding(), origin);
+    countPublish(accepted, bytes);
+    if (accepted) {
+        rateMeter_.recordPublish(bytes);
+    } else {
+        // The samples were committed as they were batched; start over from the next one
+        changeDetector_.reset();
+    }
+}
+
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::armDeadline() {
+    auto deadline = std::min(batch_.deadline(), windowStats_.closesAt());
+    if (deadline == armedDeadline_ || deadline == std::chrono::steady_clock::time_point::max()) {
+        // A wait left pending for an earlier deadline finds nothing due
+        return;
+    }
+    armedDeadline_ = deadline;
+    // Replaces any pending wait, whose handler then sees operation_aborted
+    deadlineTimer_.expires_at(deadline);
+    deadlineTimer_.async_wait([guard = std::weak_ptr<DeadlineGuard>(deadlineGuard_)](boost::system::error_code ec) {
+        if (ec) {
+            return;
+        }
+        if (auto locked = guard.lock()) {
+            std::lock_guard<std::mutex> lock(locked->mutex);
+            if (locked->owner != nullptr) {
+                locked->owner->onDeadline();
+            }
+        }
+    });
+}
+
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::onDeadline() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    armedDeadline_ = std::chrono::steady_clock::time_point::max();
+    auto now = std::chrono::steady_clock::now();
+    if (batch_.isDue(now)) {
+        flushBatch();
+    }
+    typename WindowedStats<N>::result_type closed;
+    if (windowStats_.close(now, closed)) {
+        publishWindow(closed, {});
+    }
+    // In case the batch or window was replaced meanwhile by one that is not due yet
+    armDeadline();
+}
+
+// {"t":<ms>,"n":<samples>,"<key>":{"mean":..,"min":..,"max":..,"rms":..,"stddev":..},...}
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::publishWindow(const typename WindowedStats<N>::result_type& stats,
+                                               const pipeline_trace::origin& origin) {
+    std::string payload;
+    payload.reserve(64 + N * 160);
+    payload += "{\"t\":";
+    payload += std::to_string(currentTimeMillis());
+    payload += ",\"n\":";
+    payload += std::to_string(stats[0].count);
+
+    auto appendField = [&](const char* prefix, double value) {
+        payload += prefix;
+        appendNumber(payload, value);
+    };
+
+    for (size_t i = 0; i < N; ++i) {
+        const RunningStats& channel = stats[i];
+        payload += ",\"";
+        payload += Traits::KEYS[i];
+        payload += "\":";
+        appendField("{\"mean\":", channel.mean);
+        appendField(",\"min\":", channel.min);
+        appendField(",\"max\":", channel.max);
+        appendField(",\"rms\":", channel.rms());
+        appendField(",\"stddev\":", channel.stddev());
+        payload += '}';
+    }
+    payload += '}';
+
+    size_t bytes = payload.size();
+    bool accepted = mqttClientWrapper_->publish(topic_, payload, true, qos_, PayloadEncoding::json, origin);
+    countPublish(accepted, bytes);
+    if (accepted) {
+        rateMeter_.recordPublish(bytes);
+    }
+}
+
+// {"t":<ms>,"rate":<Hz>,"n":<samples>,"<key>":{"peak":..,"peaks":[[<Hz>,<amplitude>],...],"bands":[..]},...}
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::publishSpectrum(const typename SpectrumAnalyzer<N>::result_type& spectra,
+                                                 const pipeline_trace::origin& origin) {
+    std::string payload;
+    payload.reserve(64 + N * (64 + ChannelSpectrum::MAX_PEAKS * 32 + ChannelSpectrum::MAX_BANDS * 16));
+    payload += "{\"t\":";
+    payload += std::to_string(currentTimeMillis());
+    payload += ",\"rate\":";
+    appendNumber(payload, spectrum_.sampleRateHz());
+    payload += ",\"n\":";
+    payload += std::to_string(spectrum_.blockSize());
+
+    for (size_t i = 0; i < N; ++i) {
+        const ChannelSpectrum& channel = spectra[i];
+        payload += ",\"";
+        payload += Traits::KEYS[i];
+        payload += "\":{\"peak\":";
+        appendNumber(payload, channel.peakAmplitude);
+        payload += ",\"peaks\":[";
+        for (size_t p = 0; p < channel.peakCount; ++p) {
+            if (p > 0) payload += ',';
+            payload += '[';
+            appendNumber(payload, channel.peaks[p].frequency);
+            payload += ',';
+            appendNumber(payload, channel.peaks[p].amplitude);
+            payload += ']';
+        }
+        payload += "],\"bands\":[";
+        for (int b = 0; b < spectrum_.bands(); ++b) {
+            if (b > 0) payload += ',';
+            appendNumber(payload, channel.bandEnergy[b]);
+        }
+        payload += "]}";
+    }
+    payload += '}';
+
+    size_t bytes = payload.size();
+    bool accepted = mqttClientWrapper_->publish(topic_, payload, true, qos_, PayloadEncoding::json, origin);
+    countPublish(accepted, bytes);
+    if (accepted) {
+        rateMeter_.recordPublish(bytes);
+    }
+}
+
+template<size_t N, typename Traits>
+void SensorProcessor<N, Traits>::appendNumber(std::string& payload, double value) const {
+    char number[FixedPointFormat::MAX_NUMBER_LENGTH];
+    int length = format_.formatNumber(number, static_cast<float>(value));
+    if (length < 0) {
+        // Too long for the buffer; JSON has no representation for such values anyway
+        payload += "null";
+    } else {
+        payload.append(number, length);
+    }
+}
+
+template class SensorProcessor<1, ScalarTraits>;
+template class SensorProcessor<3, ThreeAxisTraits>;
+template class SensorProcessor<4, RotationVectorTraits>;
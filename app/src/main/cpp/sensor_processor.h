@@ -1,32 +1,172 @@
 #ifndef HAANDROIDACCELEROMETER_SENSOR_PROCESSOR_H
 #define HAANDROIDACCELEROMETER_SENSOR_PROCESSOR_H
 
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <memory>
 #include <string>
 #include <limits> // Required for std::numeric_limits
+#include <mutex>
 #include <utility>
+#include <boost/asio/steady_timer.hpp>
+#include "binary_payload.h"
+#include "change_detector.h"
+#include "filter_chain.h"
+#include "metrics.h"
 #include "mqtt_client_wrapper.h"
+#include "payload_format.h"
+#include "pipeline_trace.h"
+#include "sample_batch.h"
+#include "series_codec.h"
+#include "spectrum_analyzer.h"
+#include "window_stats.h"
 
+// Channel layouts. KEYS names the JSON field of each channel and ROUNDING selects how
+// values are reduced to the configured number of decimals.
+struct ScalarTraits {
+    static constexpr const char* KEYS[] = {"value"};
+    static constexpr RoundingMode ROUNDING = RoundingMode::truncate;
+};
+
+struct ThreeAxisTraits {
+    static constexpr const char* KEYS[] = {"x", "y", "z"};
+    static constexpr RoundingMode ROUNDING = RoundingMode::truncate;
+};
+
+struct RotationVectorTraits {
+    static constexpr const char* KEYS[] = {"x", "y", "z", "w"};
+    static constexpr RoundingMode ROUNDING = RoundingMode::truncate;
+};
+
+// Filters, scales and rounds the samples of one sensor, drops those the change detector
+// rejects and publishes the rest as JSON, CBOR, packed floats or a compressed series
+// (binary_payload.h), either one message per sample or batched. With spectral analysis or
+// aggregation enabled, only per-block spectra or per-window statistics of the scaled values
+// are published instead, spectra taking precedence; those are always JSON.
+//
+// The channel count and layout are template parameters, so the per-sample arithmetic is
+// straight-line code. Up to four channels are handled in one NEON or SSE vector. The member
+// functions live in sensor_processor.cpp, which instantiates the layouts used by the app;
+// a new sensor needs traits and an instantiation there.
+//
+// Samples, suppressions, publishes and processing time are counted in metrics.h under the
+// name given at construction, e.g. "accelerometer.samples". Samples picked for tracing record
+// their stages in pipeline_trace.h.
+//
+// Samples arrive on the sensor thread while settings may be changed from another (the
+// services' settings coroutines), and reconfiguring reallocates the state processData works
+// on, so the two are serialised by a per-processor mutex. Only the sensor thread takes it
+// in the steady state, where locking it costs an uncontended atomic exchange.
+//
+// Batches and aggregation windows are also closed at their end by a timer on the client
+// wrapper's io_context, so a sensor that reports only on change, or stops, does not hold
+// them back.
+template<size_t N, typename Traits>
 class SensorProcessor {
+    static_assert(N >= 1 && N <= 4, "Channels are processed in a single four-lane vector");
+    static_assert(std::size(Traits::KEYS) == N, "One JSON key per channel");
+
 public:
-    explicit SensorProcessor(MqttClientWrapper* mqttClientWrapper, std::string topic);
+    using values_type = std::array<float, N>;
+
+    SensorProcessor(MqttClientWrapper* mqttClientWrapper, const std::string& name, std::string topic);
+    // Publishes a partly collected batch and cancels the deadline timer, so it must go
+    // before the client wrapper
+    ~SensorProcessor();
 
-    void updateSettings(float multiplierX, float multiplierY, float multiplierZ, int rounding);
-    void setTopic(std::string topic) { topic_ = std::move(topic); }
-    void processData(float x, float y, float z);
+    // The feed mode applies to single samples; batches, windows and spectra are always sent.
+    // A partly collected batch is published under the previous settings first.
+    void updateSettings(const values_type& multipliers, int rounding, int batchWindowMs, int batchMaxSamples,
+                        const ChangeDetectionSettings& changeDetection, int aggregationWindowMs, int aggregationStepMs,
+                        PayloadEncoding encoding, MqttClientWrapper::feed_mode feedMode);
+    // Keeps the current multipliers
+    void updateSettings(int rounding, int batchWindowMs, int batchMaxSamples,
+                        const ChangeDetectionSettings& changeDetection, int aggregationWindowMs, int aggregationStepMs,
+                        PayloadEncoding encoding, MqttClientWrapper::feed_mode feedMode);
+    // Leaves the filter state alone when the settings are unchanged. Returns false, and
+    // disables filtering, if the chain cannot be realised.
+    bool updateFilters(const FilterChainSettings& filters);
+    // A block size of 0 disables spectral analysis. Leaves a partly collected block alone when
+    // the settings are unchanged. Returns false, and disables analysis, if they are invalid.
+    bool updateSpectrum(int blockSize, int bands, float sampleRateHz);
+    void setTopic(std::string topic);
+    // QoS of everything the processor publishes; 0 unless set
+    void setQos(int qos);
+    // timestampNs is the sensor event's timestamp, on the clock of pipeline_trace::now_ns, or
+    // 0 if unknown. It goes with the sample to the completion of its publish.
+    void processData(const values_type& values, int64_t timestampNs);
+
+    // Samples dropped by the change detector since the processor was created
+    uint64_t suppressedSamples() const { return changeDetector_.suppressed(); }
 
 private:
+    void applySettings(int rounding, int batchWindowMs, int batchMaxSamples,
+                       const ChangeDetectionSettings& changeDetection, int aggregationWindowMs, int aggregationStepMs,
+                       PayloadEncoding encoding, MqttClientWrapper::feed_mode feedMode);
+    // Held by processData and by whatever replaces state it uses
+    std::mutex mutex_;
+
+    void processSample(const values_type& values, const pipeline_trace::origin& origin);
+    // Counts a message handed to the client, or refused by it
+    void countPublish(bool accepted, size_t bytes);
+    // Writes the rounded sample in the configured encoding; returns its length or -1
+    int encodeSample(const float rounded[], int64_t timestampMs, char* buffer, size_t size) const;
+    void flushBatch();
+    // Waits for the end of the batch or window if it is not waited for yet; the caller holds
+    // mutex_
+    void armDeadline();
+    // On the io_context thread, when the deadline passes without a sample to act on it
+    void onDeadline();
+    // The origin is that of the sample closing the window or block; none for a window closed
+    // by the timer
+    void publishWindow(const typename WindowedStats<N>::result_type& stats, const pipeline_trace::origin& origin);
+    void publishSpectrum(const typename SpectrumAnalyzer<N>::result_type& spectra,
+                         const pipeline_trace::origin& origin);
+    // Appends a number with the configured precision, or null if it cannot be represented
+    void appendNumber(std::string& payload, double value) const;
+
     MqttClientWrapper* mqttClientWrapper_;
     std::string topic_;
+    MqttClientWrapper::feed_id feed_;
+    int qos_ = 0;
+
+    // Padded to a full vector; lanes past N are ignored
+    alignas(16) float multipliers_[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    FixedPointFormat format_;
+    PayloadEncoding encoding_ = PayloadEncoding::json;
 
-    float multiplierX_ = 1.0f;
-    float multiplierY_ = 1.0f;
-    float multiplierZ_ = 1.0f;
-    int rounding_ = 2;
+    FilterChain filters_;
+    ChangeDetector<N> changeDetector_;
+    WindowedStats<N> windowStats_;
+    SpectrumAnalyzer<N> spectrum_;
 
-    // Variables to store the last published values
-    float lastX_ = std::numeric_limits<float>::quiet_NaN();
-    float lastY_ = std::numeric_limits<float>::quiet_NaN();
-    float lastZ_ = std::numeric_limits<float>::quiet_NaN();
+    // Optional batching of samples into a single message
+    SampleBatch batch_;
+    // Of the oldest sample in the batch
+    pipeline_trace::origin batchOrigin_;
+    PublishRateMeter rateMeter_;
+
+    metrics::Counter samplesMetric_;
+    metrics::Counter suppressedMetric_;
+    metrics::Counter messagesMetric_;
+    metrics::Counter failedMetric_;
+    metrics::Counter bytesMetric_;
+    metrics::Histogram processNsMetric_;
+
+    // Lets a handler still queued when the processor is destroyed find that out
+    struct DeadlineGuard {
+        std::mutex mutex;
+        SensorProcessor* owner;
+    };
+    std::shared_ptr<DeadlineGuard> deadlineGuard_;
+    boost::asio::steady_timer deadlineTimer_;
+    // What the timer waits for; time_point::max() if nothing
+    std::chrono::steady_clock::time_point armedDeadline_ = std::chrono::steady_clock::time_point::max();
 };
 
+using ScalarSensorProcessor = SensorProcessor<1, ScalarTraits>;
+using ThreeAxisSensorProcessor = SensorProcessor<3, ThreeAxisTraits>;
+using RotationVectorSensorProcessor = SensorProcessor<4, RotationVectorTraits>;
+
 #endif //HAANDROIDACCELEROMETER_SENSOR_PROCESSOR_H
@@ -0,0 +1,50 @@
+#ifndef OPEN_SENSOR_SENSOR_SOURCE_H
+#define OPEN_SENSOR_SENSOR_SOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+// Sensors the app publishes. The values are shared with NativeSensorIngestion.kt.
+enum class SensorKind : int {
+    accelerometer = 0, // Linear acceleration, like AccelerometerService
+    gyroscope = 1,
+    gravity = 2,
+    light = 3,
+    temperature = 4,
+};
+
+constexpr int SENSOR_KIND_COUNT = 5;
+
+struct SensorSample {
+    SensorKind kind;
+    int64_t timestamp; // Nanoseconds, same clock as SensorEvent.timestamp
+    float values[3];   // Single-value sensors only use values[0]
+};
+
+// Produces sensor samples on a thread owned by the source, so the processing pipeline can be
+// driven by the Android sensor framework on a device or by a synthetic or recorded stream on
+// a plain Linux host.
+class SensorSource {
+public:
+    // Called on the source's thread with one or more consecutive samples.
+    using sample_callback = std::function<void(const SensorSample* samples, size_t count)>;
+
+    virtual ~SensorSource() = default;
+
+    // Starts the delivery thread. Returns false if the source cannot run.
+    virtual bool start(sample_callback callback) = 0;
+
+    // Stops the delivery thread. Once this returns the callback is no longer running.
+    // Enabled sensors are remembered and resume on the next start().
+    virtual void stop() = 0;
+
+    virtual bool running() const = 0;
+
+    // Requests samples for a sensor at roughly the given period. May be called at any time,
+    // from any thread. Returns false if the sensor is not available.
+    virtual bool enable(SensorKind kind, int32_t samplingPeriodUs) = 0;
+    virtual void disable(SensorKind kind) = 0;
+};
+
+#endif //OPEN_SENSOR_SENSOR_SOURCE_H
@@ -0,0 +1,357 @@
+#include "series_codec.h"
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+// Same values as FixedPointFormat uses, so that k / scale reproduces its rounded floats
+constexpr double POW10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+static_assert(std::size(POW10) == series_format::MAX_FIXED_DECIMALS + 1);
+
+// Fixed-point values stay below this magnitude, where every integer is exact in a float
+constexpr double MAX_FIXED = 16777216.0;
+
+// Bit widths of the timestamp buckets 10, 110, 1110 and 1111
+constexpr int TIMESTAMP_BITS[] = {7, 9, 12, 64};
+// Bit widths of the fixed-point buckets 10, 110, 1110 and 11110; 11111 is an escaped float
+constexpr int FIXED_BITS[] = {7, 12, 20, 32};
+
+// No XOR window yet: a leading zero count no nonzero XOR can reach
+constexpr int NO_WINDOW = 32;
+
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+float bitsToFloat(uint32_t bits) {
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+float fixedScale(int decimals) {
+    return static_cast<float>(POW10[decimals]);
+}
+
+// The k with k / scale == value, bit for bit
+bool toFixed(float value, float scale, int64_t& k) {
+    double scaled = static_cast<double>(value) * static_cast<double>(scale);
+    if (!(std::fabs(scaled) < MAX_FIXED)) {
+        return false; // Also NaN
+    }
+    int64_t candidate = std::llround(scaled);
+    if (floatBits(static_cast<float>(candidate) / scale) != floatBits(value)) {
+        return false;
+    }
+    k = candidate;
+    return true;
+}
+
+void writeLittleEndian(uint8_t* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint64_t readLittleEndian(const uint8_t* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) value = value << 8 | in[i];
+    return value;
+}
+
+// Header and first sample, shared by the encoder and encodeSeriesSample()
+void writeFirstSample(uint8_t* out, size_t channels, int decimals, SeriesCoding coding, int64_t timestampMs,
+                      const float values[]) {
+    out[0] = static_cast<uint8_t>(channels | (coding == SeriesCoding::xorFloat ? series_format::XOR_FLOAT : 0));
+    out[1] = static_cast<uint8_t>(static_cast<int8_t>(coding == SeriesCoding::xorFloat ? 0 : decimals));
+    writeLittleEndian(out + 2, 1, 2);
+    writeLittleEndian(out + 4, static_cast<uint64_t>(timestampMs), 8);
+    for (size_t c = 0; c < channels; ++c) {
+        writeLittleEndian(out + series_format::HEADER_SIZE + 4 * c, floatBits(values[c]), 4);
+    }
+}
+
+class BitReader {
+public:
+    BitReader(const uint8_t* p, const uint8_t* end) : p_(p), end_(end) {}
+
+    bool read(int count, uint64_t& value) {
+        value = 0;
+        while (count > 0) {
+            if (available_ == 0) {
+                if (p_ == end_) return false;
+                byte_ = *p_++;
+                available_ = 8;
+            }
+            int take = count < available_ ? count : available_;
+            available_ -= take;
+            value = value << take | ((byte_ >> available_) & ((1u << take) - 1));
+            count -= take;
+        }
+        return true;
+    }
+
+    // Counts leading one bits, stopping after max of them
+    bool ones(int max, int& count) {
+        for (count = 0; count < max; ++count) {
+            uint64_t bit;
+            if (!read(1, bit)) return false;
+            if (bit == 0) break;
+        }
+        return true;
+    }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint32_t byte_ = 0;
+    int available_ = 0;
+};
+
+}
+
+void SeriesEncoder::reset(size_t channels, int decimals, SeriesCoding coding) {
+    channels_ = channels > series_format::CHANNEL_MASK ? series_format::CHANNEL_MASK : channels;
+    coding_ = coding == SeriesCoding::fixedPoint && decimals >= 0 && decimals <= series_format::MAX_FIXED_DECIMALS
+              ? SeriesCoding::fixedPoint : SeriesCoding::xorFloat;
+    scale_ = coding_ == SeriesCoding::fixedPoint ? fixedScale(decimals) : 1.0f;
+    decimals_ = decimals;
+    out_.clear();
+    bits_ = 0;
+    pending_ = 0;
+    count_ = 0;
+    lastInterval_ = 0;
+}
+
+void SeriesEncoder::reset(size_t channels, int decimals) {
+    reset(channels, decimals, SeriesCoding::fixedPoint);
+}
+
+void SeriesEncoder::add(int64_t timestampMs, const float values[]) {
+    if (channels_ == 0 || count_ == UINT16_MAX) {
+        return;
+    }
+
+    if (count_ == 0) {
+        out_.resize(series_format::HEADER_SIZE + 4 * channels_);
+        writeFirstSample(reinterpret_cast<uint8_t*>(out_.data()), channels_, decimals_, coding_, timestampMs, values);
+        for (size_t c = 0; c < channels_; ++c) {
+            lastBits_[c] = floatBits(values[c]);
+            if (!toFixed(values[c], scale_, lastFixed_[c])) lastFixed_[c] = 0;
+            leading_[c] = trailing_[c] = NO_WINDOW;
+        }
+        lastTimestamp_ = timestampMs;
+        count_ = 1;
+        return;
+    }
+
+    writeTimestamp(timestampMs);
+    for (size_t c = 0; c < channels_; ++c) {
+        if (coding_ == SeriesCoding::fixedPoint) {
+            writeFixedPoint(c, values[c]);
+        } else {
+            writeXor(c, values[c]);
+        }
+    }
+    ++count_;
+}
+
+std::string SeriesEncoder::finish() {
+    if (pending_ > 0) {
+        out_ += static_cast<char>(bits_ << (8 - pending_));
+        bits_ = 0;
+        pending_ = 0;
+    }
+    if (count_ > 0) {
+        writeLittleEndian(reinterpret_cast<uint8_t*>(out_.data()) + 2, count_, 2);
+    }
+    count_ = 0;
+    std::string payload = std::move(out_);
+    out_.clear();
+    return payload;
+}
+
+void SeriesEncoder::writeBits(uint64_t value, int count) {
+    if (count > 32) {
+        writeBits(value >> 32, count - 32);
+        value &= UINT32_MAX;
+        count = 32;
+    }
+    // At most 7 bits are pending, so 32 more still fit
+    bits_ = bits_ << count | (value & ((uint64_t{1} << count) - 1));
+    pending_ += count;
+    while (pending_ >= 8) {
+        pending_ -= 8;
+        out_ += static_cast<char>(bits_ >> pending_);
+    }
+    bits_ &= (uint64_t{1} << pending_) - 1;
+}
+
+void SeriesEncoder::writeTimestamp(int64_t timestampMs) {
+    // Unsigned arithmetic, so that a clock step of any size wraps instead of overflowing
+    auto interval = static_cast<int64_t>(static_cast<uint64_t>(timestampMs) - static_cast<uint64_t>(lastTimestamp_));
+    uint64_t value = zigzag(static_cast<int64_t>(static_cast<uint64_t>(interval) - static_cast<uint64_t>(lastInterval_)));
+    lastTimestamp_ = timestampMs;
+    lastInterval_ = interval;
+
+    if (value == 0) {
+        writeBits(0, 1);
+        return;
+    }
+    for (int bucket = 0; bucket < 4; ++bucket) {
+        int width = TIMESTAMP_BITS[bucket];
+        if (width == 64 || value < (uint64_t{1} << width)) {
+            // bucket + 1 ones, then a zero unless it is the last bucket
+            writeBits(bucket < 3 ? (uint64_t{1} << (bucket + 2)) - 2 : 0xF, bucket < 3 ? bucket + 2 : 4);
+            writeBits(value, width);
+            return;
+        }
+    }
+}
+
+void SeriesEncoder::writeFixedPoint(size_t channel, float value) {
+    int64_t k;
+    if (!toFixed(value, scale_, k)) {
+        writeBits(0x1F, 5);
+        writeBits(floatBits(value), 32);
+        return;
+    }
+    uint64_t delta = zigzag(k - lastFixed_[channel]);
+    lastFixed_[channel] = k;
+
+    if (delta == 0) {
+        writeBits(0, 1);
+        return;
+    }
+    // Both values are below 2^24, so the last bucket always fits
+    for (int bucket = 0; bucket < 4; ++bucket) {
+        if (bucket == 3 || delta < (uint64_t{1} << FIXED_BITS[bucket])) {
+            writeBits((uint64_t{1} << (bucket + 2)) - 2, bucket + 2);
+            writeBits(delta, FIXED_BITS[bucket]);
+            return;
+        }
+    }
+}
+
+void SeriesEncoder::writeXor(size_t channel, float value) {
+    uint32_t bits = floatBits(value);
+    uint32_t delta = bits ^ lastBits_[channel];
+    lastBits_[channel] = bits;
+
+    if (delta == 0) {
+        writeBits(0, 1);
+        return;
+    }
+    int leading = __builtin_clz(delta);
+    int trailing = __builtin_ctz(delta);
+    if (leading >= leading_[channel] && trailing >= trailing_[channel]) {
+        writeBits(0x2, 2);
+        writeBits(delta >> trailing_[channel], 32 - leading_[channel] - trailing_[channel]);
+        return;
+    }
+
+    int meaningful = 32 - leading - trailing;
+    writeBits(0x3, 2);
+    writeBits(static_cast<uint64_t>(leading), 5);
+    writeBits(static_cast<uint64_t>(meaningful - 1), 5);
+    writeBits(delta >> trailing, meaningful);
+    leading_[channel] = leading;
+    trailing_[channel] = trailing;
+}
+
+int encodeSeriesSample(char* out, size_t size, const float values[], size_t count, int decimals,
+                       int64_t timestampMs) {
+    size_t length = series_format::HEADER_SIZE + 4 * count;
+    if (count == 0 || count > series_format::CHANNEL_MASK || length > size) {
+        return -1;
+    }
+    SeriesCoding coding = decimals >= 0 && decimals <= series_format::MAX_FIXED_DECIMALS
+                          ? SeriesCoding::fixedPoint : SeriesCoding::xorFloat;
+    writeFirstSample(reinterpret_cast<uint8_t*>(out), count, decimals, coding, timestampMs, values);
+    return static_cast<int>(length);
+}
+
+bool decodeSeries(std::string_view payload, std::vector<DecodedSample>& out) {
+    auto* p = reinterpret_cast<const uint8_t*>(payload.data());
+    auto* end = p + payload.size();
+    if (payload.size() < series_format::HEADER_SIZE) return false;
+
+    size_t channels = p[0] & series_format::CHANNEL_MASK;
+    bool xorFloat = p[0] & series_format::XOR_FLOAT;
+    int decimals = static_cast<int8_t>(p[1]);
+    auto count = static_cast<size_t>(readLittleEndian(p + 2, 2));
+    if (channels == 0 || payload.size() < series_format::HEADER_SIZE + 4 * channels) return false;
+    if (!xorFloat && (decimals < 0 || decimals > series_format::MAX_FIXED_DECIMALS)) return false;
+    if (count == 0) return true;
+    float scale = xorFloat ? 1.0f : fixedScale(decimals);
+
+    DecodedSample sample;
+    sample.hasTimestamp = true;
+    sample.timestampMs = static_cast<int64_t>(readLittleEndian(p + 4, 8));
+    uint32_t lastBits[series_format::CHANNEL_MASK];
+    int64_t lastFixed[series_format::CHANNEL_MASK];
+    int leading[series_format::CHANNEL_MASK];
+    int trailing[series_format::CHANNEL_MASK];
+    for (size_t c = 0; c < channels; ++c) {
+        lastBits[c] = static_cast<uint32_t>(readLittleEndian(p + series_format::HEADER_SIZE + 4 * c, 4));
+        sample.values.push_back(bitsToFloat(lastBits[c]));
+        if (!toFixed(sample.values[c], scale, lastFixed[c])) lastFixed[c] = 0;
+        leading[c] = trailing[c] = NO_WINDOW;
+    }
+    out.push_back(sample);
+
+    BitReader reader(p + series_format::HEADER_SIZE + 4 * channels, end);
+    int64_t lastInterval = 0;
+    for (size_t i = 1; i < count; ++i) {
+        int bucket;
+        uint64_t value = 0;
+        if (!reader.ones(4, bucket)) return false;
+        if (bucket > 0 && !reader.read(TIMESTAMP_BITS[bucket - 1], value)) return false;
+        lastInterval = static_cast<int64_t>(static_cast<uint64_t>(lastInterval) + static_cast<uint64_t>(unzigzag(value)));
+        sample.timestampMs = static_cast<int64_t>(static_cast<uint64_t>(sample.timestampMs) +
+                                                  static_cast<uint64_t>(lastInterval));
+
+        for (size_t c = 0; c < channels; ++c) {
+            if (!xorFloat) {
+                if (!reader.ones(5, bucket)) return false;
+                if (bucket == 5) {
+                    if (!reader.read(32, value)) return false;
+                    sample.values[c] = bitsToFloat(static_cast<uint32_t>(value));
+                    continue;
+                }
+                value = 0;
+                if (bucket > 0 && !reader.read(FIXED_BITS[bucket - 1], value)) return false;
+                lastFixed[c] += unzigzag(value);
+                if (!(std::fabs(static_cast<double>(lastFixed[c])) < MAX_FIXED)) return false;
+                sample.values[c] = static_cast<float>(lastFixed[c]) / scale;
+                continue;
+            }
+
+            if (!reader.ones(2, bucket)) return false;
+            if (bucket == 1) {
+                if (leading[c] == NO_WINDOW) return false;
+                if (!reader.read(32 - leading[c] - trailing[c], value)) return false;
+                lastBits[c] ^= static_cast<uint32_t>(value << trailing[c]);
+            } else if (bucket == 2) {
+                uint64_t zeros, meaningful;
+                if (!reader.read(5, zeros) || !reader.read(5, meaningful)) return false;
+                leading[c] = static_cast<int>(zeros);
+                trailing[c] = 32 - leading[c] - static_cast<int>(meaningful + 1);
+                if (trailing[c] < 0 || !reader.read(static_cast<int>(meaningful + 1), value)) return false;
+                lastBits[c] ^= static_cast<uint32_t>(value << trailing[c]);
+            }
+            sample.values[c] = bitsToFloat(lastBits[c]);
+        }
+        out.push_back(sample);
+    }
+    return true;
+}
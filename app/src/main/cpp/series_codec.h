@@ -0,0 +1,118 @@
+#ifndef OPEN_SENSOR_SERIES_CODEC_H
+#define OPEN_SENSOR_SERIES_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "binary_payload.h"
+
+// Compressed time series for batches, after Facebook's Gorilla: every sample is coded
+// against the one before it, so slowly changing channels take a few bits per sample.
+//
+// The payload starts byte-aligned, all little-endian:
+//
+//     byte 0:      bits 0-2 channel count, bit 6 set for XOR-coded floats
+//     byte 1:      decimals of the fixed-point coding (signed)
+//     bytes 2-3:   sample count
+//     bytes 4-11:  timestamp of the first sample, int64 milliseconds since the epoch
+//     then:        the first sample, float32 * channel count
+//
+// and continues with a bit stream, most significant bit first and zero-padded to a byte.
+// Per further sample it holds the timestamp as the zigzag-coded difference between this and
+// the previous interval ("delta of delta"):
+//
+//     0                      same interval as before
+//     10   + 7 bits          zigzag value below 2^7
+//     110  + 9 bits          below 2^9
+//     1110 + 12 bits         below 2^12
+//     1111 + 64 bits         anything else
+//
+// then every channel. Rounded values are integers k / 10^decimals, so by default each channel
+// is the zigzag-coded change in k:
+//
+//     0                      unchanged
+//     10    + 7 bits         zigzag value below 2^7
+//     110   + 12 bits        below 2^12
+//     1110  + 20 bits        below 2^20
+//     11110 + 32 bits        below 2^32
+//     11111 + 32 bits        float32 that is not k / 10^decimals for a k below 2^24; the next
+//                            change is relative to the last value that was
+//
+// With bit 6 of the header set, channels are the XOR of the float32 bits with the previous
+// value instead, which suits unrounded data:
+//
+//     0                      same value
+//     10 + meaningful bits   XOR fits the previous leading/trailing zero window
+//     11 + 5 bits leading zeros + 5 bits meaningful bit count - 1 + meaningful bits
+//
+// A single sample is just the byte-aligned part.
+enum class SeriesCoding : uint8_t {
+    fixedPoint = 0,
+    xorFloat = 1,
+};
+
+namespace series_format {
+constexpr uint8_t CHANNEL_MASK = 0x07;
+constexpr uint8_t XOR_FLOAT = 0x40;
+constexpr size_t HEADER_SIZE = 12;
+// Decimals up to this take the fixed-point coding, others fall back to XOR
+constexpr int MAX_FIXED_DECIMALS = 9;
+}
+
+// Appends samples one at a time; the cost of add() does not depend on how many samples came
+// before it and finish() only patches the header.
+class SeriesEncoder {
+public:
+    // Starts a new payload. Keeps the capacity of the previous one.
+    void reset(size_t channels, int decimals, SeriesCoding coding);
+    // Fixed point when decimals allow it, XOR otherwise
+    void reset(size_t channels, int decimals);
+
+    // Values must be rounded to the decimals passed to reset() for the fixed-point coding to
+    // pay off; others are stored as escaped floats.
+    void add(int64_t timestampMs, const float values[]);
+
+    size_t count() const { return count_; }
+    // Bytes so far, counting a partly filled last byte
+    size_t size() const { return out_.size() + (pending_ + 7) / 8; }
+
+    // Hands out the payload, which is empty if no sample was added. reset() must be called
+    // before adding more samples.
+    std::string finish();
+
+private:
+    void writeBits(uint64_t value, int count);
+    void writeTimestamp(int64_t timestampMs);
+    void writeFixedPoint(size_t channel, float value);
+    void writeXor(size_t channel, float value);
+
+    std::string out_;
+    uint64_t bits_ = 0; // The last pending_ bits are not yet in out_
+    int pending_ = 0;
+
+    size_t channels_ = 0;
+    SeriesCoding coding_ = SeriesCoding::fixedPoint;
+    int decimals_ = 0;
+    float scale_ = 1.0f;
+    size_t count_ = 0;
+
+    int64_t lastTimestamp_ = 0;
+    int64_t lastInterval_ = 0;
+    // Per channel: the last fixed-point value, or the last float bits and XOR window
+    int64_t lastFixed_[series_format::CHANNEL_MASK] = {};
+    uint32_t lastBits_[series_format::CHANNEL_MASK] = {};
+    int leading_[series_format::CHANNEL_MASK] = {};
+    int trailing_[series_format::CHANNEL_MASK] = {};
+};
+
+// Writes a one-sample payload and returns its length, or -1 if it does not fit in size bytes.
+int encodeSeriesSample(char* out, size_t size, const float values[], size_t count, int decimals,
+                       int64_t timestampMs);
+
+// Appends the samples in payload to out, all timestamped and without keys. Returns false if
+// the payload is malformed; the samples decoded up to that point are kept.
+bool decodeSeries(std::string_view payload, std::vector<DecodedSample>& out);
+
+#endif //OPEN_SENSOR_SERIES_CODEC_H
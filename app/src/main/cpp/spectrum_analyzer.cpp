@@ -0,0 +1,206 @@
+#include "spectrum_analyzer.h"
+#include <algorithm>
+#include <cmath>
+
+void RealFft::resize(size_t size) {
+    size_ = size;
+    half_ = size / 2;
+
+    int bits = 0;
+    while ((size_t{1} << bits) < half_) ++bits;
+    bitReverse_.resize(half_);
+    for (size_t i = 0; i < half_; ++i) {
+        uint32_t reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            reversed |= ((i >> b) & 1u) << (bits - 1 - b);
+        }
+        bitReverse_[i] = reversed;
+    }
+
+    // exp(-pi i j / L) for each stage length L, computed in double to keep the tables exact
+    twiddleRe_.resize(half_ > 1 ? half_ - 1 : 0);
+    twiddleIm_.resize(twiddleRe_.size());
+    for (size_t length = 1; length < half_; length <<= 1) {
+        for (size_t j = 0; j < length; ++j) {
+            double angle = -M_PI * static_cast<double>(j) / static_cast<double>(length);
+            twiddleRe_[length - 1 + j] = static_cast<float>(std::cos(angle));
+            twiddleIm_[length - 1 + j] = static_cast<float>(std::sin(angle));
+        }
+    }
+
+    splitRe_.resize(half_ + 1);
+    splitIm_.resize(half_ + 1);
+    for (size_t k = 0; k <= half_; ++k) {
+        double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(size);
+        splitRe_[k] = static_cast<float>(std::cos(angle));
+        splitIm_[k] = static_cast<float>(std::sin(angle));
+    }
+
+    workRe_.resize(half_);
+    workIm_.resize(half_);
+}
+
+void RealFft::transform(const float* input, float* re, float* im) {
+    float* __restrict zr = workRe_.data();
+    float* __restrict zi = workIm_.data();
+
+    // Pack even and odd samples into one complex sequence, in bit-reversed order
+    for (size_t k = 0; k < half_; ++k) {
+        size_t source = 2 * static_cast<size_t>(bitReverse_[k]);
+        zr[k] = input[source];
+        zi[k] = input[source + 1];
+    }
+
+    for (size_t length = 1; length < half_; length <<= 1) {
+        const float* __restrict wr = twiddleRe_.data() + length - 1;
+        const float* __restrict wi = twiddleIm_.data() + length - 1;
+        for (size_t start = 0; start < half_; start += 2 * length) {
+            float* __restrict ar = zr + start;
+            float* __restrict ai = zi + start;
+            float* __restrict br = zr + start + length;
+            float* __restrict bi = zi + start + length;
+            for (size_t j = 0; j < length; ++j) {
+                float tr = br[j] * wr[j] - bi[j] * wi[j];
+                float ti = br[j] * wi[j] + bi[j] * wr[j];
+                br[j] = ar[j] - tr;
+                bi[j] = ai[j] - ti;
+                ar[j] += tr;
+                ai[j] += ti;
+            }
+        }
+    }
+
+    // Separate the spectra E of the even and O of the odd samples, X[k] = E[k] + W^k O[k]:
+    // E[k] = (Z[k] + conj Z[M - k]) / 2 and O[k] = (Z[k] - conj Z[M - k]) / 2i, Z[M] = Z[0]
+    for (size_t k = 0; k <= half_; ++k) {
+        size_t a = k == half_ ? 0 : k;
+        size_t b = k == 0 ? 0 : half_ - k;
+        float evenRe = 0.5f * (zr[a] + zr[b]);
+        float evenIm = 0.5f * (zi[a] - zi[b]);
+        float diffRe = 0.5f * (zr[a] - zr[b]);
+        float diffIm = 0.5f * (zi[a] + zi[b]);
+        // O[k] = (diffIm, -diffRe)
+        re[k] = evenRe + splitRe_[k] * diffIm + splitIm_[k] * diffRe;
+        im[k] = evenIm - splitRe_[k] * diffRe + splitIm_[k] * diffIm;
+    }
+}
+
+template<size_t N>
+bool SpectrumAnalyzer<N>::configure(int blockSize, int bands, float sampleRateHz) {
+    blockSize_ = 0;
+    fill_ = 0;
+    if (blockSize <= 0) {
+        return true;
+    }
+    bool powerOfTwo = (blockSize & (blockSize - 1)) == 0;
+    if (!powerOfTwo || blockSize < MIN_BLOCK || blockSize > MAX_BLOCK || bands < 1 ||
+        bands > static_cast<int>(ChannelSpectrum::MAX_BANDS) || !(sampleRateHz > 0.0f)) {
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(blockSize);
+    fft_.resize(size);
+
+    window_.resize(size);
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    for (size_t i = 0; i < size; ++i) {
+        // Periodic Hann window
+        double w = 0.5 - 0.5 * std::cos(2.0 * M_PI * static_cast<double>(i) / static_cast<double>(size));
+        window_[i] = static_cast<float>(w);
+        sum += w;
+        sumSquares += w * w;
+    }
+    amplitudeScale_ = static_cast<float>(2.0 / sum);
+    powerScale_ = static_cast<float>(1.0 / (static_cast<double>(size) * sumSquares));
+
+    for (auto& block : blocks_) {
+        block.assign(size, 0.0f);
+    }
+    windowed_.resize(size);
+    re_.resize(size / 2 + 1);
+    im_.resize(size / 2 + 1);
+    amplitude_.resize(size / 2 + 1);
+
+    blockSize_ = size;
+    bands_ = static_cast<size_t>(bands);
+    sampleRateHz_ = sampleRateHz;
+    return true;
+}
+
+template<size_t N>
+bool SpectrumAnalyzer<N>::add(const float values[], result_type& result) {
+    for (size_t c = 0; c < N; ++c) {
+        blocks_[c][fill_] = values[c];
+    }
+    if (++fill_ < blockSize_) {
+        return false;
+    }
+
+    fill_ = 0;
+    for (size_t c = 0; c < N; ++c) {
+        analyse(blocks_[c].data(), result[c]);
+    }
+    return true;
+}
+
+template<size_t N>
+void SpectrumAnalyzer<N>::analyse(const float* block, ChannelSpectrum& out) {
+    const size_t size = blockSize_;
+    const size_t half = size / 2;
+
+    double mean = 0.0;
+    for (size_t i = 0; i < size; ++i) mean += block[i];
+    float offset = static_cast<float>(mean / static_cast<double>(size));
+    for (size_t i = 0; i < size; ++i) {
+        windowed_[i] = (block[i] - offset) * window_[i];
+    }
+
+    fft_.transform(windowed_.data(), re_.data(), im_.data());
+
+    out = ChannelSpectrum{};
+    for (size_t k = 0; k <= half; ++k) {
+        float power = re_[k] * re_[k] + im_[k] * im_[k];
+        // DC and Nyquist appear once in the one-sided spectrum, every other bin twice
+        bool single = k == 0 || k == half;
+        amplitude_[k] = std::sqrt(power) * amplitudeScale_ * (single ? 0.5f : 1.0f);
+        if (k > 0) {
+            size_t band = std::min((k - 1) * bands_ / half, bands_ - 1);
+            out.bandEnergy[band] += power * powerScale_ * (single ? 1.0f : 2.0f);
+            out.peakAmplitude = std::max(out.peakAmplitude, amplitude_[k]);
+        }
+    }
+
+    const float binHz = sampleRateHz_ / static_cast<float>(size);
+    for (size_t k = 1; k < half; ++k) {
+        float a = amplitude_[k - 1];
+        float b = amplitude_[k];
+        float c = amplitude_[k + 1];
+        if (!(b > a && b >= c)) continue;
+        if (out.peakCount == ChannelSpectrum::MAX_PEAKS && b <= out.peaks[out.peakCount - 1].amplitude) continue;
+
+        // Parabola through the log amplitudes, which is close to exact for the Hann main lobe
+        constexpr float FLOOR = 1e-30f;
+        float la = std::log(std::max(a, FLOOR));
+        float lb = std::log(std::max(b, FLOOR));
+        float lc = std::log(std::max(c, FLOOR));
+        float curvature = la - 2.0f * lb + lc;
+        float delta = curvature < 0.0f ? 0.5f * (la - lc) / curvature : 0.0f;
+        SpectralPeak peak;
+        peak.frequency = (static_cast<float>(k) + delta) * binHz;
+        peak.amplitude = std::exp(lb - 0.25f * (la - lc) * delta);
+
+        // Insert in descending order of amplitude, dropping the weakest if full
+        size_t position = std::min(out.peakCount, ChannelSpectrum::MAX_PEAKS - 1);
+        while (position > 0 && out.peaks[position - 1].amplitude < peak.amplitude) {
+            out.peaks[position] = out.peaks[position - 1];
+            --position;
+        }
+        out.peaks[position] = peak;
+        out.peakCount = std::min(out.peakCount + 1, ChannelSpectrum::MAX_PEAKS);
+    }
+}
+
+template class SpectrumAnalyzer<1>;
+template class SpectrumAnalyzer<3>;
+template class SpectrumAnalyzer<4>;
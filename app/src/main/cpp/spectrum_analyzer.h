@@ -0,0 +1,99 @@
+#ifndef OPEN_SENSOR_SPECTRUM_ANALYZER_H
+#define OPEN_SENSOR_SPECTRUM_ANALYZER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Discrete Fourier transform of a real block whose length is a power of two.
+//
+// The block is transformed as a complex sequence of half its length (even samples as real
+// parts, odd samples as imaginary parts) and the two interleaved spectra are separated
+// afterwards. The complex kernel is an iterative radix-2 FFT on separate real and imaginary
+// arrays, with the twiddle factors of each stage stored contiguously, so every butterfly loop
+// runs over unit-stride data the compiler can vectorise. All tables and work buffers are
+// allocated by resize(); transform() does not allocate.
+class RealFft {
+public:
+    // size must be a power of two and at least 4
+    void resize(size_t size);
+    size_t size() const { return size_; }
+
+    // Writes bins 0 to size / 2 of the DFT of input (size values) to re and im
+    // (size / 2 + 1 values each).
+    void transform(const float* input, float* re, float* im);
+
+private:
+    size_t size_ = 0;
+    size_t half_ = 0;
+    std::vector<uint32_t> bitReverse_;             // Permutation of the half-length sequence
+    std::vector<float> twiddleRe_, twiddleIm_;     // Stage of length L at offset L - 1
+    std::vector<float> splitRe_, splitIm_;         // exp(-2 pi i k / size) for the separation
+    std::vector<float> workRe_, workIm_;
+};
+
+struct SpectralPeak {
+    float frequency = 0.0f; // Hz, interpolated between bins
+    float amplitude = 0.0f; // Of the sinusoid, in sensor units
+};
+
+// What is published for one channel of one block
+struct ChannelSpectrum {
+    static constexpr size_t MAX_PEAKS = 3;
+    static constexpr size_t MAX_BANDS = 16;
+
+    // Largest local maxima of the amplitude spectrum, strongest first
+    std::array<SpectralPeak, MAX_PEAKS> peaks{};
+    size_t peakCount = 0;
+    // Mean-square value contributed by each of the equal-width bands between 0 Hz and the
+    // Nyquist frequency; together they add up to the variance of the block
+    std::array<float, MAX_BANDS> bandEnergy{};
+    // Largest amplitude of any bin except DC
+    float peakAmplitude = 0.0f;
+};
+
+// Collects blocks of an N-channel sensor and computes a Hann-windowed amplitude spectrum of
+// each channel once a block is full. Blocks do not overlap. The mean of each block is removed
+// before windowing, so a constant offset such as gravity does not leak into the low bins.
+template<size_t N>
+class SpectrumAnalyzer {
+public:
+    using result_type = std::array<ChannelSpectrum, N>;
+
+    static constexpr int MIN_BLOCK = 16;
+    static constexpr int MAX_BLOCK = 8192;
+
+    // A block size of 0 disables the analyzer. Returns false, and disables it, if the block
+    // size is not a power of two within the limits, the band count is not between 1 and
+    // ChannelSpectrum::MAX_BANDS, or the sample rate is not positive.
+    bool configure(int blockSize, int bands, float sampleRateHz);
+    bool enabled() const { return blockSize_ > 0; }
+
+    int blockSize() const { return static_cast<int>(blockSize_); }
+    int bands() const { return static_cast<int>(bands_); }
+    float sampleRateHz() const { return sampleRateHz_; }
+
+    // Adds a sample. Returns true when it completed a block, whose spectra are then stored
+    // in result.
+    bool add(const float values[], result_type& result);
+
+private:
+    void analyse(const float* block, ChannelSpectrum& out);
+
+    size_t blockSize_ = 0;
+    size_t bands_ = 0;
+    float sampleRateHz_ = 0.0f;
+
+    RealFft fft_;
+    std::vector<float> window_;
+    float amplitudeScale_ = 0.0f; // 2 / sum(window): bin magnitude to sinusoid amplitude
+    float powerScale_ = 0.0f;     // 1 / (size * sum(window^2)): bin power to mean square
+
+    std::array<std::vector<float>, N> blocks_;
+    size_t fill_ = 0;
+    std::vector<float> windowed_;
+    std::vector<float> re_, im_, amplitude_;
+};
+
+#endif //OPEN_SENSOR_SPECTRUM_ANALYZER_H
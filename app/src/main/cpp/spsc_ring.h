@@ -0,0 +1,120 @@
+#ifndef OPEN_SENSOR_SPSC_RING_H
+#define OPEN_SENSOR_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+
+// Bounded lock-free ring buffer for exactly one producer thread and one consumer thread.
+// Capacity is rounded up to a power of two. Elements are copied in and out, so T should be
+// a small trivially copyable record.
+//
+// Each slot carries a sequence number (as in Vyukov's bounded queue) saying whose turn it is:
+// equal to the position the producer writes next into it when free, one more once that
+// element is published. The consumer claims an element by advancing head before copying it
+// out, and frees the slot only afterwards, so the producer's push_overwrite, which claims the
+// oldest element the same way, never writes a slot the consumer is still reading.
+template<typename T>
+class SpscRing {
+    static_assert(std::is_trivially_copyable_v<T>, "SpscRing elements must be trivially copyable");
+
+public:
+    explicit SpscRing(size_t capacity) {
+        size_t rounded = 2;
+        while (rounded < capacity) rounded <<= 1;
+        mask_ = rounded - 1;
+        slots_ = std::make_unique<slot[]>(rounded);
+        for (size_t i = 0; i < rounded; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    size_t size() const {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+
+    // Producer side. Fails without side effects when the ring is full.
+    bool try_push(const T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        slot& s = slots_[tail & mask_];
+        if (s.sequence.load(std::memory_order_acquire) != tail) {
+            return false;
+        }
+        publish(s, tail, item);
+        return true;
+    }
+
+    // Producer side. When the ring is full the oldest element is discarded to make room,
+    // and copied to discarded_item if given; if the consumer is copying that element out at
+    // that moment, the item itself is discarded instead. Returns false if an element was
+    // discarded.
+    bool push_overwrite(const T& item, T* discarded_item = nullptr) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        slot& s = slots_[tail & mask_];
+        if (s.sequence.load(std::memory_order_acquire) == tail) {
+            publish(s, tail, item);
+            return true;
+        }
+        // Full: the slot holds the oldest element, unless the consumer has just claimed it
+        size_t oldest = tail - capacity();
+        if (head_.compare_exchange_strong(oldest, oldest + 1, std::memory_order_acq_rel)) {
+            if (discarded_item != nullptr) *discarded_item = s.value;
+            publish(s, tail, item);
+            return false;
+        }
+        if (s.sequence.load(std::memory_order_acquire) == tail) {
+            publish(s, tail, item);
+            return true;
+        }
+        if (discarded_item != nullptr) *discarded_item = item;
+        return false;
+    }
+
+    // Consumer side.
+    bool try_pop(T& out) {
+        size_t head = head_.load(std::memory_order_acquire);
+        for (;;) {
+            slot& s = slots_[head & mask_];
+            if (s.sequence.load(std::memory_order_acquire) != head + 1) {
+                // Empty, unless the producer discarded the element meanwhile and wrote another
+                size_t current = head_.load(std::memory_order_acquire);
+                if (current == head) return false;
+                head = current;
+                continue;
+            }
+            // On failure the producer discarded this element (push_overwrite); try the next
+            if (head_.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                out = s.value;
+                s.sequence.store(head + capacity(), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+
+    struct slot {
+        std::atomic<size_t> sequence{0};
+        T value;
+    };
+
+    void publish(slot& s, size_t tail, const T& item) {
+        s.value = item;
+        s.sequence.store(tail + 1, std::memory_order_release);
+        tail_.store(tail + 1, std::memory_order_release);
+    }
+
+    alignas(CACHE_LINE) std::atomic<size_t> head_{0};
+    alignas(CACHE_LINE) std::atomic<size_t> tail_{0};
+    alignas(CACHE_LINE) size_t mask_ = 0;
+    std::unique_ptr<slot[]> slots_;
+};
+
+#endif //OPEN_SENSOR_SPSC_RING_H
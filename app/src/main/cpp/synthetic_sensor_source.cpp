@@ -0,0 +1,129 @@
+#include "synthetic_sensor_source.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+struct Waveform {
+    float offset[3];
+    float amplitude[3];
+    float frequencyHz;
+};
+
+// Indexed by SensorKind; magnitudes in the units the real sensors report
+constexpr Waveform WAVEFORMS[SENSOR_KIND_COUNT] = {
+    {{0.0f, 0.0f, 0.0f}, {1.5f, 1.0f, 0.5f}, 1.3f},      // m/s^2
+    {{0.0f, 0.0f, 0.0f}, {0.4f, 0.3f, 0.2f}, 0.7f},      // rad/s
+    {{0.0f, 0.0f, 9.6f}, {2.0f, 2.0f, 0.2f}, 0.05f},     // m/s^2
+    {{300.0f, 0.0f, 0.0f}, {250.0f, 0.0f, 0.0f}, 0.01f}, // lx
+    {{21.0f, 0.0f, 0.0f}, {0.5f, 0.0f, 0.0f}, 0.001f},   // degrees C
+};
+
+// Longest sleep while waiting, so that enable(), disable() and stop() take effect promptly
+constexpr auto MAX_WAIT = std::chrono::milliseconds(10);
+
+int64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void generate(int index, int64_t timestamp, SensorSample& sample) {
+    const Waveform& wave = WAVEFORMS[index];
+    double phase = 2.0 * M_PI * wave.frequencyHz * (static_cast<double>(timestamp) * 1e-9);
+    sample.kind = static_cast<SensorKind>(index);
+    sample.timestamp = timestamp;
+    sample.values[0] = wave.offset[0] + wave.amplitude[0] * static_cast<float>(std::sin(phase));
+    sample.values[1] = wave.offset[1] + wave.amplitude[1] * static_cast<float>(std::cos(phase));
+    sample.values[2] = wave.offset[2] + wave.amplitude[2] * static_cast<float>(std::sin(0.5 * phase + 1.0));
+}
+
+}
+
+SyntheticSensorSource::~SyntheticSensorSource() {
+    stop();
+}
+
+bool SyntheticSensorSource::start(sample_callback callback) {
+    if (running()) return true;
+
+    callback_ = std::move(callback);
+    stopRequested_ = false;
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void SyntheticSensorSource::stop() {
+    if (!running()) return;
+
+    stopRequested_ = true;
+    thread_.join();
+    callback_ = nullptr;
+}
+
+bool SyntheticSensorSource::enable(SensorKind kind, int32_t samplingPeriodUs) {
+    int index = static_cast<int>(kind);
+    if (index < 0 || index >= SENSOR_KIND_COUNT) return false;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    periodUs_[index] = std::max<int32_t>(samplingPeriodUs, 1);
+    return true;
+}
+
+void SyntheticSensorSource::disable(SensorKind kind) {
+    int index = static_cast<int>(kind);
+    if (index < 0 || index >= SENSOR_KIND_COUNT) return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    periodUs_[index] = 0;
+}
+
+void SyntheticSensorSource::run() {
+    int64_t periodNanos[SENSOR_KIND_COUNT] = {};
+    int64_t next[SENSOR_KIND_COUNT] = {};
+    int64_t clock = steadyNanos(); // Timestamp of the most recent sample
+    SensorSample samples[BATCH];
+
+    while (!stopRequested_) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (int i = 0; i < SENSOR_KIND_COUNT; ++i) {
+                int64_t period = static_cast<int64_t>(periodUs_[i]) * 1000;
+                // A newly enabled sensor starts at the current time
+                if (period != 0 && periodNanos[i] == 0) next[i] = paced_ ? steadyNanos() : clock;
+                periodNanos[i] = period;
+            }
+        }
+
+        const int64_t horizon = paced_ ? steadyNanos() : std::numeric_limits<int64_t>::max();
+        size_t count = 0;
+        int64_t earliest = std::numeric_limits<int64_t>::max();
+        while (count < BATCH) {
+            int due = -1;
+            for (int i = 0; i < SENSOR_KIND_COUNT; ++i) {
+                if (periodNanos[i] != 0 && (due < 0 || next[i] < next[due])) due = i;
+            }
+            if (due < 0) break;
+            earliest = next[due];
+            if (earliest > horizon) break;
+
+            generate(due, next[due], samples[count++]);
+            clock = next[due];
+            next[due] += periodNanos[due];
+        }
+
+        if (count > 0) {
+            callback_(samples, count);
+            delivered_.fetch_add(count, std::memory_order_relaxed);
+        }
+        if (count < BATCH) {
+            // Nothing enabled, or paced and waiting for the next sample to fall due
+            std::chrono::nanoseconds wait = MAX_WAIT;
+            if (earliest != std::numeric_limits<int64_t>::max()) {
+                wait = std::min(wait, std::chrono::nanoseconds(std::max<int64_t>(earliest - steadyNanos(), 0)));
+            }
+            std::this_thread::sleep_for(wait);
+        }
+    }
+}
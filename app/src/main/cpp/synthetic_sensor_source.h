@@ -0,0 +1,43 @@
+#ifndef OPEN_SENSOR_SYNTHETIC_SENSOR_SOURCE_H
+#define OPEN_SENSOR_SYNTHETIC_SENSOR_SOURCE_H
+
+#include "sensor_source.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// Generates smooth, deterministic waveforms for every enabled sensor at its sampling period.
+// Does not depend on Android, so the processing pipeline can be exercised on a Linux host.
+class SyntheticSensorSource : public SensorSource {
+public:
+    // When paced, samples are delivered in real time. Otherwise they are delivered as fast as
+    // the callback returns, with timestamps still spaced by the sampling periods.
+    explicit SyntheticSensorSource(bool paced = true) : paced_(paced) {}
+    ~SyntheticSensorSource() override;
+
+    bool start(sample_callback callback) override;
+    void stop() override;
+    bool running() const override { return thread_.joinable(); }
+
+    bool enable(SensorKind kind, int32_t samplingPeriodUs) override;
+    void disable(SensorKind kind) override;
+
+    uint64_t samplesDelivered() const { return delivered_.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+
+    static constexpr size_t BATCH = 64;
+
+    const bool paced_;
+
+    std::mutex mutex_;
+    int32_t periodUs_[SENSOR_KIND_COUNT] = {}; // 0 = disabled, guarded by mutex_
+
+    sample_callback callback_;
+    std::thread thread_;
+    std::atomic<bool> stopRequested_{false};
+    std::atomic<uint64_t> delivered_{0};
+};
+
+#endif //OPEN_SENSOR_SYNTHETIC_SENSOR_SOURCE_H
@@ -0,0 +1,106 @@
+// The sensor thread's path for single samples, from processData to the feed of a connected
+// MqttClientWrapper, must not allocate once the processor has warmed up. Counted with
+// allocation_counter.h, which this test target always compiles in; only the calling thread
+// is counted, so what the io_context thread does with the queued samples is not covered
+// (see allocation_counter.h).
+
+#include "allocation_counter.h"
+#include "binary_payload.h"
+#include "loopback_broker.h"
+#include "mqtt_client_wrapper.h"
+#include "pipeline_trace.h"
+#include "sensor_processor.h"
+#include <gtest/gtest.h>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace {
+
+constexpr size_t WARM_UP_SAMPLES = 1000;
+constexpr size_t MEASURED_SAMPLES = 10000;
+
+class AllocationTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ASSERT_TRUE(allocation_counter::enabled());
+        wrapper_ = std::make_unique<MqttClientWrapper>("");
+        // Never refuse on the calling thread, which would take a different path
+        wrapper_->set_feed_options(4096, MqttClientWrapper::overflow_policy::drop_oldest);
+        wrapper_->set_in_flight_window(4096, 64, MqttClientWrapper::window_policy::drop_oldest);
+        wrapper_->set_status_callback([this](const std::string& status, const std::string&) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connected_ = status == "CONNECTED";
+            changed_.notify_all();
+        });
+    }
+
+    void TearDown() override {
+        if (wrapper_ == nullptr) return;
+        // Before the members its status callback uses
+        wrapper_->disconnect();
+        wrapper_.reset();
+    }
+
+    void connect() {
+        wrapper_->connect(broker_.url(), "allocation_test", "", "");
+        std::unique_lock<std::mutex> lock(mutex_);
+        ASSERT_TRUE(changed_.wait_for(lock, std::chrono::seconds(10), [this] { return connected_; }));
+    }
+
+    // Allocations on this thread over MEASURED_SAMPLES samples, after WARM_UP_SAMPLES
+    template<typename Processor>
+    uint64_t steadyStateAllocations(Processor& processor) {
+        typename Processor::values_type values{};
+        size_t i = 0;
+        auto next = [&] {
+            // Slowly varying, so that no sample is suppressed as unchanged
+            for (size_t c = 0; c < values.size(); ++c) {
+                values[c] = 9.81f * std::sin(0.013f * static_cast<float>(i) + static_cast<float>(c));
+            }
+            processor.processData(values, pipeline_trace::now_ns());
+            ++i;
+        };
+        while (i < WARM_UP_SAMPLES) next();
+        uint64_t before = allocation_counter::thread_allocations();
+        while (i < WARM_UP_SAMPLES + MEASURED_SAMPLES) next();
+        return allocation_counter::thread_allocations() - before;
+    }
+
+    template<typename Processor>
+    void expectNoAllocations(const std::string& name) {
+        // Processors go before the wrapper they publish through
+        auto processor = std::make_unique<Processor>(wrapper_.get(), name, "test/" + name);
+        connect();
+        for (PayloadEncoding encoding : {PayloadEncoding::json, PayloadEncoding::cbor, PayloadEncoding::packed}) {
+            processor->updateSettings(2, 0, 0, ChangeDetectionSettings{}, 0, 0, encoding,
+                                      MqttClientWrapper::feed_mode::stream);
+            EXPECT_EQ(steadyStateAllocations(*processor), 0u) << contentType(encoding);
+        }
+        processor.reset();
+    }
+
+    LoopbackBroker broker_;
+    std::unique_ptr<MqttClientWrapper> wrapper_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool connected_ = false;
+};
+
+TEST_F(AllocationTest, ScalarProcessDataAllocatesNothing) {
+    expectNoAllocations<ScalarSensorProcessor>("scalar");
+}
+
+TEST_F(AllocationTest, ThreeAxisProcessDataAllocatesNothing) {
+    expectNoAllocations<ThreeAxisSensorProcessor>("three_axis");
+}
+
+TEST_F(AllocationTest, RotationVectorProcessDataAllocatesNothing) {
+    expectNoAllocations<RotationVectorSensorProcessor>("rotation");
+}
+
+}
@@ -0,0 +1,153 @@
+// AsyncLogger::read_since over a log of one page, small enough for the text to wrap around.
+// Each logger is destroyed before reading, which writes out every line it was given.
+
+#include "async_logger.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+class AsyncLoggerTest : public ::testing::Test {
+protected:
+    static constexpr size_t CAPACITY = 4096;
+
+    void SetUp() override {
+        path_ = ::testing::TempDir() + "async_logger_test." + std::to_string(getpid());
+        std::remove(path_.c_str());
+    }
+
+    void TearDown() override { std::remove(path_.c_str()); }
+
+    // Logs "line <first>" to "line <first + count - 1>", padded to about 40 bytes with the
+    // timestamp, in batches the logger's ring takes without dropping
+    void logLines(int first, int count) {
+        for (int i = first; i < first + count; i += 100) {
+            AsyncLogger logger(path_, CAPACITY);
+            for (int j = i; j < std::min(first + count, i + 100); ++j) {
+                ASSERT_TRUE(logger.log("line " + std::to_string(j) + " ..........."));
+            }
+        }
+    }
+
+    static std::vector<std::string> lines(const std::string& text) {
+        std::vector<std::string> result;
+        std::istringstream stream(text);
+        for (std::string line; std::getline(stream, line);) result.push_back(line);
+        return result;
+    }
+
+    // The number logged in a line
+    static int number(const std::string& line) {
+        size_t at = line.find("| line ");
+        return at == std::string::npos ? -1 : std::stoi(line.substr(at + 7));
+    }
+
+    std::string path_;
+};
+
+TEST_F(AsyncLoggerTest, ReadsOnlyWhatWasAppendedSinceTheLastPosition) {
+    logLines(0, 3);
+    std::string text;
+    uint64_t next = 0;
+    ASSERT_TRUE(AsyncLogger::read_since(path_, 0, CAPACITY, text, next));
+    std::vector<std::string> first = lines(text);
+    ASSERT_EQ(first.size(), 3u);
+    EXPECT_EQ(number(first[0]), 0);
+    EXPECT_EQ(next, text.size());
+
+    logLines(3, 2);
+    text.clear();
+    uint64_t since = next;
+    ASSERT_TRUE(AsyncLogger::read_since(path_, since, CAPACITY, text, next));
+    std::vector<std::string> second = lines(text);
+    ASSERT_EQ(second.size(), 2u);
+    EXPECT_EQ(number(second[0]), 3);
+    EXPECT_EQ(number(second[1]), 4);
+    EXPECT_EQ(next, since + text.size());
+}
+
+TEST_F(AsyncLoggerTest, StartsAtTheOldestCompleteLineAfterWrapping) {
+    // Several times the capacity
+    logLines(0, 400);
+    std::string text;
+    uint64_t next = 0;
+    ASSERT_TRUE(AsyncLogger::read_since(path_, 0, CAPACITY, text, next));
+    EXPECT_GT(next, 3 * CAPACITY);
+    EXPECT_LE(text.size(), CAPACITY);
+
+    std::vector<std::string> read = lines(text);
+    ASSERT_GT(read.size(), 50u);
+    // No partial line at the start, and nothing missing up to the newest
+    for (size_t i = 0; i < read.size(); ++i) {
+        EXPECT_EQ(number(read[i]), 400 - static_cast<int>(read.size()) + static_cast<int>(i)) << read[i];
+    }
+    EXPECT_EQ(text.back(), '\n');
+}
+
+TEST_F(AsyncLoggerTest, ContinuesFromAPositionAcrossTheWrap) {
+    logLines(0, 50);
+    std::string text;
+    uint64_t since = 0;
+    ASSERT_TRUE(AsyncLogger::read_since(path_, 0, CAPACITY, text, since));
+
+    // Less than the capacity since the last read, but past the end of the ring
+    logLines(50, 60);
+    text.clear();
+    uint64_t next = 0;
+    ASSERT_TRUE(AsyncLogger::read_since(path_, since, CAPACITY, text, next));
+    ASSERT_GT(next, CAPACITY);
+    std::vector<std::string> read = lines(text);
+    ASSERT_EQ(read.size(), 60u);
+    for (size_t i = 0; i < read.size(); ++i) {
+        EXPECT_EQ(number(read[i]), 50 + static_cast<int>(i)) << read[i];
+    }
+
+    // A position that has been overwritten since gives the oldest complete line still there
+    logLines(110, 200);
+    text.clear();
+    ASSERT_TRUE(AsyncLogger::read_since(path_, since, CAPACITY, text, next));
+    read = lines(text);
+    ASSERT_FALSE(read.empty());
+    EXPECT_GT(number(read.front()), 110);
+    EXPECT_EQ(number(read.back()), 309);
+}
+
+TEST_F(AsyncLoggerTest, MaxBytesKeepsTheNewestCompleteLines) {
+    logLines(0, 20);
+    std::string text;
+    uint64_t next = 0;
+    ASSERT_TRUE(AsyncLogger::read_since(path_, 0, 100, text, next));
+    EXPECT_LE(text.size(), 100u);
+    std::vector<std::string> read = lines(text);
+    ASSERT_FALSE(read.empty());
+    EXPECT_GE(number(read.front()), 0);
+    EXPECT_EQ(number(read.back()), 19);
+}
+
+TEST_F(AsyncLoggerTest, ReportsARecreatedFile) {
+    logLines(0, 10);
+    std::string text;
+    uint64_t since = 0;
+    ASSERT_TRUE(AsyncLogger::read_since(path_, 0, CAPACITY, text, since));
+
+    std::remove(path_.c_str());
+    logLines(0, 1);
+    text.clear();
+    uint64_t next = 0;
+    ASSERT_TRUE(AsyncLogger::read_since(path_, since, CAPACITY, text, next));
+    EXPECT_LT(next, since);
+    ASSERT_EQ(lines(text).size(), 1u);
+}
+
+TEST_F(AsyncLoggerTest, FailsForAMissingFile) {
+    std::string text;
+    uint64_t next = 0;
+    EXPECT_FALSE(AsyncLogger::read_since(path_, 0, CAPACITY, text, next));
+}
+
+}
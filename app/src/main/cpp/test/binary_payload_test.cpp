@@ -0,0 +1,132 @@
+// CBOR and packed payloads through the reference decoder, and the exact bytes of the CBOR
+// float encodings.
+
+#include "binary_payload.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+uint32_t bitsOf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// The bytes CBOR writes for {"x": value}
+std::vector<uint8_t> cborOf(float value) {
+    static constexpr const char* KEYS[] = {"x"};
+    char out[32];
+    int length = encodeCbor(out, sizeof(out), KEYS, &value, 1);
+    EXPECT_GT(length, 0);
+    return std::vector<uint8_t>(out, out + std::max(length, 0));
+}
+
+TEST(BinaryPayloadTest, CborUsesHalfPrecisionWhenExact) {
+    struct Case {
+        float value;
+        std::vector<uint8_t> number;
+    };
+    const Case cases[] = {
+        {0.0f, {0xF9, 0x00, 0x00}},
+        {-0.0f, {0xF9, 0x80, 0x00}},
+        {1.5f, {0xF9, 0x3E, 0x00}},
+        {-9.75f, {0xF9, 0xC8, 0xE0}},
+        {65504.0f, {0xF9, 0x7B, 0xFF}},                // Largest half
+        {5.9604645e-8f, {0xF9, 0x00, 0x01}},           // Smallest half subnormal
+        {std::numeric_limits<float>::infinity(), {0xF9, 0x7C, 0x00}},
+        {std::numeric_limits<float>::quiet_NaN(), {0xF9, 0x7E, 0x00}},
+        {0.1f, {0xFA, 0x3D, 0xCC, 0xCC, 0xCD}},        // Not exact in half precision
+        {65520.0f, {0xFA, 0x47, 0x7F, 0xF0, 0x00}},    // Beyond the half range
+        {1.0004883f, {0xFA, 0x3F, 0x80, 0x10, 0x00}},  // One mantissa bit too many
+    };
+    for (const Case& c : cases) {
+        std::vector<uint8_t> expected = {0xA1, 0x61, 'x'};
+        expected.insert(expected.end(), c.number.begin(), c.number.end());
+        EXPECT_EQ(cborOf(c.value), expected) << c.value;
+    }
+}
+
+TEST(BinaryPayloadTest, CborRoundTripsEveryFloatBitForBit) {
+    static constexpr const char* KEYS[] = {"x", "y", "z"};
+    const float values[] = {
+        0.0f, -0.0f, 1.5f, 0.1f, -123.456f, 65504.0f, 65520.0f, 1e-7f, 5.9604645e-8f, 6.1035156e-5f,
+        3.4028235e38f, std::numeric_limits<float>::denorm_min(), -std::numeric_limits<float>::infinity(),
+    };
+    for (size_t i = 0; i + 3 <= std::size(values); ++i) {
+        char out[64];
+        int length = encodeCbor(out, sizeof(out), KEYS, &values[i], 3);
+        ASSERT_GT(length, 0);
+        std::vector<DecodedSample> decoded;
+        ASSERT_TRUE(decodePayload(PayloadEncoding::cbor, std::string_view(out, static_cast<size_t>(length)), decoded));
+        ASSERT_EQ(decoded.size(), 1u);
+        EXPECT_FALSE(decoded[0].hasTimestamp);
+        ASSERT_EQ(decoded[0].values.size(), 3u);
+        for (size_t c = 0; c < 3; ++c) {
+            EXPECT_EQ(decoded[0].keys[c], KEYS[c]);
+            EXPECT_EQ(bitsOf(decoded[0].values[c]), bitsOf(values[i + c])) << values[i + c];
+        }
+    }
+}
+
+TEST(BinaryPayloadTest, CborNaNDecodesAsNaN) {
+    std::vector<uint8_t> bytes = cborOf(std::numeric_limits<float>::quiet_NaN());
+    std::vector<DecodedSample> decoded;
+    ASSERT_TRUE(decodePayload(PayloadEncoding::cbor,
+                              std::string_view(reinterpret_cast<const char*>(bytes.data()), bytes.size()), decoded));
+    ASSERT_EQ(decoded.size(), 1u);
+    EXPECT_TRUE(std::isnan(decoded[0].values[0]));
+}
+
+TEST(BinaryPayloadTest, CborFailsWhenTheBufferIsTooSmall) {
+    static constexpr const char* KEYS[] = {"x", "y", "z"};
+    const float values[] = {0.1f, 0.2f, 0.3f};
+    char out[10];
+    EXPECT_EQ(encodeCbor(out, sizeof(out), KEYS, values, 3), -1);
+}
+
+TEST(BinaryPayloadTest, PackedRoundTripsWithAndWithoutTimestamp) {
+    const float values[] = {1.0f, -0.1f, std::numeric_limits<float>::infinity()};
+    const int64_t timestamp = 1700000000123;
+    for (bool timestamped : {false, true}) {
+        char out[32];
+        int length = encodePacked(out, sizeof(out), values, 3, timestamped, timestamp);
+        ASSERT_EQ(length, timestamped ? 21 : 13);
+        EXPECT_EQ(static_cast<uint8_t>(out[0]), timestamped ? 0x83 : 0x03);
+
+        std::vector<DecodedSample> decoded;
+        PayloadEncoding encoding = timestamped ? PayloadEncoding::packedTimestamped : PayloadEncoding::packed;
+        ASSERT_TRUE(decodePayload(encoding, std::string_view(out, static_cast<size_t>(length)), decoded));
+        ASSERT_EQ(decoded.size(), 1u);
+        EXPECT_EQ(decoded[0].hasTimestamp, timestamped);
+        if (timestamped) EXPECT_EQ(decoded[0].timestampMs, timestamp);
+        ASSERT_EQ(decoded[0].values.size(), 3u);
+        for (size_t c = 0; c < 3; ++c) {
+            EXPECT_EQ(bitsOf(decoded[0].values[c]), bitsOf(values[c]));
+        }
+    }
+}
+
+TEST(BinaryPayloadTest, RejectsTruncatedPayloads) {
+    const float values[] = {1.0f, 2.0f, 3.0f};
+    char out[32];
+    int length = encodePacked(out, sizeof(out), values, 3, true, 0);
+    std::vector<DecodedSample> decoded;
+    EXPECT_FALSE(decodePayload(PayloadEncoding::packedTimestamped, std::string_view(out, static_cast<size_t>(length - 1)),
+                               decoded));
+
+    static constexpr const char* KEYS[] = {"x", "y", "z"};
+    length = encodeCbor(out, sizeof(out), KEYS, values, 3);
+    decoded.clear();
+    EXPECT_FALSE(decodePayload(PayloadEncoding::cbor, std::string_view(out, static_cast<size_t>(length - 1)), decoded));
+}
+
+}
@@ -0,0 +1,130 @@
+// ChangeDetector: the deadbands, hysteresis, minimum interval and heartbeat that decide which
+// samples are published. The timed cases sleep for tens of milliseconds.
+
+#include "change_detector.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+// shouldPublish() followed by commit() when accepted, as the processors do
+template<size_t N>
+bool offer(ChangeDetector<N>& detector, const float (&values)[N]) {
+    if (!detector.shouldPublish(values)) return false;
+    detector.commit(values);
+    return true;
+}
+
+TEST(ChangeDetectorTest, PublishesEveryChangeWithDefaultSettings) {
+    ChangeDetector<1> detector;
+    detector.configure(ChangeDetectionSettings{});
+    EXPECT_TRUE(offer(detector, {1.0f}));
+    EXPECT_FALSE(offer(detector, {1.0f}));
+    EXPECT_TRUE(offer(detector, {1.01f}));
+    EXPECT_EQ(detector.suppressed(), 1u);
+}
+
+TEST(ChangeDetectorTest, FirstSampleIsAlwaysPublished) {
+    ChangeDetectionSettings settings;
+    settings.deadband = 100.0f;
+    ChangeDetector<1> detector;
+    detector.configure(settings);
+    EXPECT_TRUE(offer(detector, {0.0f}));
+    detector.reset();
+    EXPECT_TRUE(offer(detector, {0.0f}));
+}
+
+TEST(ChangeDetectorTest, DeadbandIsExclusiveAndMeasuredFromTheLastPublishedValue) {
+    ChangeDetectionSettings settings;
+    settings.deadband = 0.5f;
+    ChangeDetector<1> detector;
+    detector.configure(settings);
+    ASSERT_TRUE(offer(detector, {10.0f}));
+    EXPECT_FALSE(offer(detector, {10.5f})); // Exactly the deadband is not more than it
+    EXPECT_FALSE(offer(detector, {9.6f}));
+    // Small steps add up, since they are compared with 10.0 rather than with each other
+    EXPECT_FALSE(offer(detector, {10.3f}));
+    EXPECT_TRUE(offer(detector, {10.6f}));
+    EXPECT_EQ(detector.suppressed(), 3u);
+}
+
+TEST(ChangeDetectorTest, AnyChannelBeyondTheDeadbandPublishesTheSample) {
+    ChangeDetectionSettings settings;
+    settings.deadband = 1.0f;
+    ChangeDetector<3> detector;
+    detector.configure(settings);
+    ASSERT_TRUE(offer(detector, {0.0f, 0.0f, 0.0f}));
+    EXPECT_FALSE(offer(detector, {0.9f, -0.9f, 0.9f}));
+    EXPECT_TRUE(offer(detector, {0.0f, 0.0f, -1.5f}));
+}
+
+TEST(ChangeDetectorTest, RelativeDeadbandScalesWithTheLastMagnitude) {
+    ChangeDetectionSettings settings;
+    settings.deadband = 0.1f;
+    settings.relativeDeadband = 0.1f;
+    ChangeDetector<1> detector;
+    detector.configure(settings);
+    ASSERT_TRUE(offer(detector, {100.0f}));
+    EXPECT_FALSE(offer(detector, {109.0f})); // 10% of 100
+    EXPECT_TRUE(offer(detector, {111.0f}));
+
+    // Near zero the absolute deadband takes over
+    detector.reset();
+    ASSERT_TRUE(offer(detector, {0.0f}));
+    EXPECT_FALSE(offer(detector, {0.05f}));
+    EXPECT_TRUE(offer(detector, {0.2f}));
+}
+
+TEST(ChangeDetectorTest, HysteresisRaisesTheThresholdOnlyForReversals) {
+    ChangeDetectionSettings settings;
+    settings.deadband = 1.0f;
+    settings.hysteresis = 0.5f;
+    ChangeDetector<1> detector;
+    detector.configure(settings);
+    ASSERT_TRUE(offer(detector, {0.0f}));
+    ASSERT_TRUE(offer(detector, {2.0f})); // Moving up
+    EXPECT_TRUE(offer(detector, {3.2f})); // Same direction, plain deadband
+    EXPECT_FALSE(offer(detector, {1.9f})); // Reversal needs more than 1.5
+    EXPECT_TRUE(offer(detector, {1.6f}));
+    EXPECT_FALSE(offer(detector, {2.9f})); // Reversing again
+    EXPECT_TRUE(offer(detector, {3.2f}));
+}
+
+TEST(ChangeDetectorTest, NaNCountsAsAChange) {
+    ChangeDetectionSettings settings;
+    settings.deadband = 10.0f;
+    ChangeDetector<1> detector;
+    detector.configure(settings);
+    ASSERT_TRUE(offer(detector, {1.0f}));
+    EXPECT_TRUE(offer(detector, {std::nanf("")}));
+    EXPECT_TRUE(offer(detector, {1.0f}));
+}
+
+TEST(ChangeDetectorTest, MinimumIntervalHoldsBackChanges) {
+    ChangeDetectionSettings settings;
+    settings.minIntervalMs = 50;
+    ChangeDetector<1> detector;
+    detector.configure(settings);
+    ASSERT_TRUE(offer(detector, {1.0f}));
+    EXPECT_FALSE(offer(detector, {2.0f}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_TRUE(offer(detector, {2.0f}));
+}
+
+TEST(ChangeDetectorTest, HeartbeatRepublishesUnchangedValuesAfterSilence) {
+    ChangeDetectionSettings settings;
+    settings.deadband = 1.0f;
+    settings.heartbeatMs = 50;
+    ChangeDetector<1> detector;
+    detector.configure(settings);
+    ASSERT_TRUE(offer(detector, {1.0f}));
+    EXPECT_FALSE(offer(detector, {1.0f}));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_TRUE(offer(detector, {1.0f}));
+    // The heartbeat restarted the silence
+    EXPECT_FALSE(offer(detector, {1.0f}));
+}
+
+}
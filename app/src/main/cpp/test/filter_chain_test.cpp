@@ -0,0 +1,116 @@
+// FilterChain: steady-state gain of the biquads against their designs, and the median
+// filter's window.
+
+#include "filter_chain.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+namespace {
+
+constexpr float SAMPLE_RATE_HZ = 100.0f;
+
+FilterChainSettings chainOf(const char* spec) {
+    FilterChainSettings settings;
+    EXPECT_TRUE(parseFilterChain(spec, SAMPLE_RATE_HZ, settings)) << spec;
+    return settings;
+}
+
+// Amplitude of the output for a unit sine of the given frequency in lane 0, measured over
+// whole periods once the filter has settled
+double sineGain(FilterChain& chain, double frequencyHz) {
+    constexpr int SETTLE = 2000;
+    const int measured = static_cast<int>(std::lround(20 * SAMPLE_RATE_HZ / frequencyHz));
+    double sumOfSquares = 0.0;
+    for (int n = 0; n < SETTLE + measured; ++n) {
+        float values[4] = {static_cast<float>(std::sin(2.0 * M_PI * frequencyHz * n / SAMPLE_RATE_HZ)), 0, 0, 0};
+        chain.process(values);
+        if (n >= SETTLE) sumOfSquares += static_cast<double>(values[0]) * values[0];
+    }
+    return std::sqrt(2.0 * sumOfSquares / measured);
+}
+
+TEST(FilterChainTest, LowPassPassesDcAndIsThreeDecibelsDownAtTheCutoff) {
+    FilterChain chain;
+    ASSERT_TRUE(chain.configure(chainOf("lowpass:5")));
+    EXPECT_NEAR(sineGain(chain, 0.5), 1.0, 0.01);
+    EXPECT_NEAR(sineGain(chain, 5.0), std::sqrt(0.5), 0.01);
+    // Second order: 12 dB per octave well above the cutoff
+    EXPECT_NEAR(sineGain(chain, 20.0), 0.06, 0.02);
+
+    chain.reset();
+    for (int n = 0; n < 100; ++n) {
+        float values[4] = {9.81f, -1.0f, 0.5f, 0.0f};
+        chain.process(values);
+        EXPECT_NEAR(values[0], 9.81f, 1e-4f);
+        EXPECT_NEAR(values[1], -1.0f, 1e-4f);
+        EXPECT_NEAR(values[2], 0.5f, 1e-4f);
+    }
+}
+
+TEST(FilterChainTest, HighPassBlocksDcAndPassesHighFrequencies) {
+    FilterChain chain;
+    ASSERT_TRUE(chain.configure(chainOf("highpass:2")));
+    EXPECT_NEAR(sineGain(chain, 2.0), std::sqrt(0.5), 0.01);
+    EXPECT_NEAR(sineGain(chain, 25.0), 1.0, 0.01);
+
+    chain.reset();
+    for (int n = 0; n < 100; ++n) {
+        float values[4] = {9.81f, 0.0f, 0.0f, 0.0f};
+        chain.process(values);
+        EXPECT_NEAR(values[0], 0.0f, 1e-4f);
+    }
+}
+
+TEST(FilterChainTest, BandPassHasUnitGainAtItsCentre) {
+    FilterChain chain;
+    ASSERT_TRUE(chain.configure(chainOf("bandpass:10:2")));
+    EXPECT_NEAR(sineGain(chain, 10.0), 1.0, 0.01);
+    EXPECT_LT(sineGain(chain, 1.0), 0.1);
+    EXPECT_LT(sineGain(chain, 40.0), 0.2);
+}
+
+TEST(FilterChainTest, FirstSampleStartsWithoutTransient) {
+    FilterChain chain;
+    ASSERT_TRUE(chain.configure(chainOf("median:5,ema:0.1,lowpass:5")));
+    float values[4] = {3.0f, 3.0f, 3.0f, 3.0f};
+    chain.process(values);
+    EXPECT_NEAR(values[0], 3.0f, 1e-5f);
+}
+
+TEST(FilterChainTest, MedianRemovesIsolatedSpikes) {
+    FilterChain chain;
+    ASSERT_TRUE(chain.configure(chainOf("median:3")));
+    const float input[] = {1.0f, 1.0f, 50.0f, 1.0f, 1.0f, -50.0f, 1.0f};
+    for (float x : input) {
+        float values[4] = {x, 0, 0, 0};
+        chain.process(values);
+        EXPECT_EQ(values[0], 1.0f) << x;
+    }
+}
+
+TEST(FilterChainTest, MedianIsTheMiddleOfTheLastSamplesPerLane) {
+    FilterChain chain;
+    ASSERT_TRUE(chain.configure(chainOf("median:5")));
+    // Primed with the first sample, so the window starts as five copies of it
+    const float input[][2] = {{0, 10}, {5, 4}, {3, 8}, {9, 2}, {1, 6}, {7, 0}};
+    const float expected[][2] = {{0, 10}, {0, 10}, {0, 10}, {3, 8}, {3, 6}, {5, 4}};
+    for (size_t n = 0; n < 6; ++n) {
+        float values[4] = {input[n][0], input[n][1], 0, 0};
+        chain.process(values);
+        EXPECT_EQ(values[0], expected[n][0]) << "sample " << n;
+        EXPECT_EQ(values[1], expected[n][1]) << "sample " << n;
+    }
+}
+
+TEST(FilterChainTest, RejectsStagesThatCannotBeRealised) {
+    FilterChainSettings settings;
+    EXPECT_FALSE(parseFilterChain("median:4", SAMPLE_RATE_HZ, settings));
+    EXPECT_FALSE(parseFilterChain("median:11", SAMPLE_RATE_HZ, settings));
+    EXPECT_FALSE(parseFilterChain("lowpass:50", SAMPLE_RATE_HZ, settings)); // At Nyquist
+    EXPECT_FALSE(parseFilterChain("ema:0", SAMPLE_RATE_HZ, settings));
+    EXPECT_FALSE(parseFilterChain("lowpass:5,", SAMPLE_RATE_HZ, settings));
+    EXPECT_TRUE(parseFilterChain("", SAMPLE_RATE_HZ, settings));
+    EXPECT_EQ(settings.count, 0u);
+}
+
+}
@@ -0,0 +1,112 @@
+// MqttClientWrapper against the loopback broker: how the in-flight window shares its places
+// between the feeds.
+
+#include "loopback_broker.h"
+#include "mqtt_client_wrapper.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+
+class MqttClientWrapperTest : public ::testing::Test {
+protected:
+    MqttClientWrapperTest()
+        : broker_(brokerOptions(), [this](std::string_view topic, std::string_view payload, int) {
+              std::lock_guard<std::mutex> lock(mutex_);
+              if (topic == "test/coalesced") {
+                  ++coalescedReceived_;
+                  lastCoalesced_.assign(payload);
+              } else if (topic == "test/stream") {
+                  ++streamReceived_;
+              }
+              changed_.notify_all();
+          }) {}
+
+    static LoopbackBroker::options brokerOptions() {
+        LoopbackBroker::options opts;
+        // Keeps a QoS 1 window of a few places full for as long as the stream feed is fed
+        opts.ack_delay = std::chrono::milliseconds(20);
+        return opts;
+    }
+
+    void SetUp() override {
+        wrapper_ = std::make_unique<MqttClientWrapper>("");
+        wrapper_->set_status_callback([this](const std::string& status, const std::string&) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connected_ = status == "CONNECTED";
+            changed_.notify_all();
+        });
+    }
+
+    void TearDown() override {
+        if (wrapper_ == nullptr) return;
+        // Before the members its status callback uses
+        wrapper_->disconnect();
+        wrapper_.reset();
+    }
+
+    void connect() {
+        wrapper_->connect(broker_.url(), "mqtt_client_wrapper_test", "", "");
+        std::unique_lock<std::mutex> lock(mutex_);
+        ASSERT_TRUE(changed_.wait_for(lock, std::chrono::seconds(10), [this] { return connected_; }));
+    }
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool connected_ = false;
+    size_t coalescedReceived_ = 0;
+    size_t streamReceived_ = 0;
+    std::string lastCoalesced_;
+
+    LoopbackBroker broker_;
+    std::unique_ptr<MqttClientWrapper> wrapper_;
+};
+
+TEST_F(MqttClientWrapperTest, CoalescedFeedIsNotStarvedBySaturatingStreamFeed) {
+    wrapper_->set_in_flight_window(4, 4, MqttClientWrapper::window_policy::reject);
+    MqttClientWrapper::feed_id stream = wrapper_->register_feed("test/stream");
+    MqttClientWrapper::feed_id coalesced = wrapper_->register_feed("test/coalesced");
+    wrapper_->set_feed_qos(stream, 1);
+    wrapper_->set_feed_qos(coalesced, 1);
+    wrapper_->set_feed_mode(coalesced, MqttClientWrapper::feed_mode::coalesce);
+    connect();
+
+    // The stream feed is offered far more than the window lets through, from its own thread
+    // as every feed has a single producer
+    std::atomic<bool> stop{false};
+    std::thread streamProducer([&] {
+        const std::string payload = "{\"value\":1}";
+        while (!stop.load(std::memory_order_relaxed)) {
+            wrapper_->publish(stream, payload.data(), payload.size());
+        }
+    });
+
+    std::string last;
+    auto until = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    for (int i = 0; std::chrono::steady_clock::now() < until; ++i) {
+        last = "{\"value\":" + std::to_string(i) + "}";
+        EXPECT_TRUE(wrapper_->publish(coalesced, last.data(), last.size()));
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // Still saturated while the last value of the coalesced feed has to get through
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        EXPECT_TRUE(changed_.wait_for(lock, std::chrono::seconds(5), [&] { return lastCoalesced_ == last; }))
+            << lastCoalesced_ << " instead of " << last;
+        // A reserved place turns over every ack delay
+        EXPECT_GE(coalescedReceived_, 10u);
+        EXPECT_GT(streamReceived_, 0u);
+    }
+    stop.store(true, std::memory_order_relaxed);
+    streamProducer.join();
+}
+
+}
@@ -0,0 +1,109 @@
+#include "offline_store.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+class OfflineStoreTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        path_ = ::testing::TempDir() + "offline_store_test." + std::to_string(getpid());
+        std::remove(path_.c_str());
+    }
+
+    void TearDown() override {
+        store_.close();
+        std::remove(path_.c_str());
+    }
+
+    std::string path_;
+    OfflineStore store_;
+};
+
+TEST_F(OfflineStoreTest, KeepsMessagesInOrder) {
+    ASSERT_TRUE(store_.open(path_, 4096));
+    ASSERT_TRUE(store_.push("a", "one", true, 0, 1));
+    ASSERT_TRUE(store_.push("b", "two", false, 1, 2));
+    EXPECT_EQ(store_.size(), 2u);
+
+    OfflineStore::message_view message{};
+    ASSERT_TRUE(store_.front(message));
+    EXPECT_EQ(message.topic, "a");
+    EXPECT_EQ(message.payload, "one");
+    EXPECT_TRUE(message.retain);
+    EXPECT_EQ(message.qos, 0);
+    EXPECT_EQ(message.tag, 1);
+    store_.pop();
+    ASSERT_TRUE(store_.front(message));
+    EXPECT_EQ(message.topic, "b");
+    EXPECT_EQ(message.qos, 1);
+    store_.pop();
+    EXPECT_TRUE(store_.empty());
+}
+
+// A message that fits the ring but not the rest of it past the tail, once the ring is empty:
+// the ring starts over instead of padding and dropping forever
+TEST_F(OfflineStoreTest, TakesLargeMessageWhenEmptyAfterTailMoved) {
+    ASSERT_TRUE(store_.open(path_, 4096));
+    ASSERT_EQ(store_.capacity(), 4096u);
+    ASSERT_TRUE(store_.push("t", std::string(100, 'x'), false, 0));
+    store_.pop();
+    ASSERT_TRUE(store_.empty());
+
+    std::string large(4000, 'y');
+    ASSERT_TRUE(store_.push("t", large, false, 0));
+    OfflineStore::message_view message{};
+    ASSERT_TRUE(store_.front(message));
+    EXPECT_EQ(message.payload, large);
+    EXPECT_EQ(store_.dropped(), 0u);
+}
+
+// Same while the ring holds a message: refused rather than dropping everything for nothing
+TEST_F(OfflineStoreTest, RefusesMessageThatCannotFitPastTheTail) {
+    ASSERT_TRUE(store_.open(path_, 4096));
+    ASSERT_TRUE(store_.push("t", std::string(100, 'x'), false, 0));
+
+    EXPECT_FALSE(store_.push("t", std::string(4000, 'y'), false, 0));
+    EXPECT_EQ(store_.dropped(), 1u);
+    EXPECT_EQ(store_.size(), 1u);
+}
+
+TEST_F(OfflineStoreTest, RefusesMessageLargerThanTheRing) {
+    ASSERT_TRUE(store_.open(path_, 4096));
+    EXPECT_FALSE(store_.push("t", std::string(5000, 'z'), false, 0));
+    EXPECT_EQ(store_.dropped(), 1u);
+    EXPECT_TRUE(store_.empty());
+}
+
+TEST_F(OfflineStoreTest, DropsOldestWhenFull) {
+    ASSERT_TRUE(store_.open(path_, 4096));
+    std::string payload(1000, 'p');
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(store_.push("t/" + std::to_string(i), payload, false, 0));
+    }
+    EXPECT_LE(store_.bytes_used(), store_.capacity());
+    EXPECT_EQ(store_.size() + store_.dropped(), 10u);
+
+    OfflineStore::message_view message{};
+    ASSERT_TRUE(store_.front(message));
+    EXPECT_EQ(message.topic, "t/" + std::to_string(store_.dropped()));
+}
+
+TEST_F(OfflineStoreTest, RecoversMessagesAfterReopen) {
+    ASSERT_TRUE(store_.open(path_, 4096));
+    ASSERT_TRUE(store_.push("t", std::string(100, 'x'), false, 0));
+    store_.pop();
+    ASSERT_TRUE(store_.push("t", std::string(4000, 'y'), false, 1));
+    store_.close();
+
+    ASSERT_TRUE(store_.open(path_, 4096));
+    EXPECT_EQ(store_.size(), 1u);
+    OfflineStore::message_view message{};
+    ASSERT_TRUE(store_.front(message));
+    EXPECT_EQ(message.payload.size(), 4000u);
+    EXPECT_EQ(message.qos, 1);
+}
+
+}
@@ -0,0 +1,98 @@
+// FixedPointFormat against snprintf("%.*f"), which its output must match byte for byte.
+
+#include "payload_format.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+const std::vector<float>& testValues() {
+    static const std::vector<float> values = {
+        0.0f, -0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 0.125f, 2.5f, 3.5f, 9.80665f, -9.80665f,
+        0.001f, -0.0049f, 0.0000001f, 123.456f, -123.456f, 99999.99f, 1e7f, -1e7f,
+        16777216.0f, 1e12f, -3e15f, 1e20f, 3.4028235e38f, -3.4028235e38f,
+        std::numeric_limits<float>::min(), std::numeric_limits<float>::denorm_min(),
+        std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity(),
+        std::numeric_limits<float>::quiet_NaN(),
+    };
+    return values;
+}
+
+std::string withPrintf(float value, int precision) {
+    char buffer[512];
+    int n = std::snprintf(buffer, sizeof(buffer), "%.*f", precision, static_cast<double>(value));
+    return std::string(buffer, static_cast<size_t>(n));
+}
+
+TEST(PayloadFormatTest, FormatNumberMatchesSnprintf) {
+    FixedPointFormat format;
+    for (int precision = 0; precision <= 6; ++precision) {
+        format.setPrecision(precision);
+        for (float value : testValues()) {
+            char out[FixedPointFormat::MAX_NUMBER_LENGTH];
+            int n = format.formatNumber(out, value);
+            std::string expected = withPrintf(value, precision);
+            if (n < 0) {
+                // Too long for the buffer; callers fall back to snprintf
+                EXPECT_GE(expected.size(), static_cast<size_t>(FixedPointFormat::MAX_NUMBER_LENGTH))
+                    << value << " at precision " << precision;
+                continue;
+            }
+            EXPECT_EQ(std::string(out, static_cast<size_t>(n)), expected) << "precision " << precision;
+        }
+    }
+}
+
+TEST(PayloadFormatTest, FormatNumberMatchesSnprintfForTruncatedValues) {
+    FixedPointFormat format;
+    for (int precision = 0; precision <= 6; ++precision) {
+        format.setPrecision(precision);
+        for (int i = -20000; i <= 20000; i += 7) {
+            float value = format.truncate(static_cast<float>(i) * 0.0123f);
+            char out[FixedPointFormat::MAX_NUMBER_LENGTH];
+            int n = format.formatNumber(out, value);
+            ASSERT_GE(n, 0) << value;
+            EXPECT_EQ(std::string(out, static_cast<size_t>(n)), withPrintf(value, precision))
+                << "precision " << precision;
+        }
+    }
+}
+
+TEST(PayloadFormatTest, FormatJsonMatchesSnprintf) {
+    static constexpr const char* KEYS[] = {"x", "y", "z"};
+    FixedPointFormat format;
+    const std::vector<float>& values = testValues();
+    size_t compared = 0;
+    for (int precision = 0; precision <= 6; ++precision) {
+        format.setPrecision(precision);
+        for (size_t i = 0; i + 3 <= values.size(); ++i) {
+            const float* v = &values[i];
+            char buffer[512];
+            int n = format.formatJson(buffer, sizeof(buffer), KEYS, v, 3);
+            if (n < 0) continue; // Formatted with snprintf by the caller
+
+            char expected[512];
+            int m = std::snprintf(expected, sizeof(expected), "{\"x\":%.*f,\"y\":%.*f,\"z\":%.*f}",
+                                  precision, static_cast<double>(v[0]), precision, static_cast<double>(v[1]),
+                                  precision, static_cast<double>(v[2]));
+            EXPECT_EQ(std::string(buffer, static_cast<size_t>(n)), std::string(expected, static_cast<size_t>(m)))
+                << "precision " << precision;
+            ++compared;
+        }
+    }
+    EXPECT_GT(compared, values.size() * 7 / 2);
+}
+
+TEST(PayloadFormatTest, FormatJsonFailsWhenTheBufferIsTooSmall) {
+    static constexpr const char* KEYS[] = {"x"};
+    FixedPointFormat format;
+    const float value = 123.456f;
+    char buffer[8];
+    EXPECT_EQ(format.formatJson(buffer, sizeof(buffer), KEYS, &value, 1), -1);
+}
+
+}
@@ -0,0 +1,118 @@
+// SensorProcessor against a MqttClientWrapper connected to the loopback broker, for what
+// depends on time: batches and aggregation windows closed by the deadline timer rather than
+// by the next sample.
+
+#include "loopback_broker.h"
+#include "mqtt_client_wrapper.h"
+#include "pipeline_trace.h"
+#include "sample_batch.h"
+#include "sensor_processor.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+class SensorProcessorTest : public ::testing::Test {
+protected:
+    SensorProcessorTest()
+        : broker_(LoopbackBroker::options{}, [this](std::string_view topic, std::string_view payload, int) {
+              std::lock_guard<std::mutex> lock(mutex_);
+              if (topic == "test/sensor") {
+                  received_.emplace_back(payload);
+                  changed_.notify_all();
+              }
+          }) {}
+
+    void SetUp() override {
+        wrapper_ = std::make_unique<MqttClientWrapper>("");
+        wrapper_->set_status_callback([this](const std::string& status, const std::string&) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            connected_ = status == "CONNECTED";
+            changed_.notify_all();
+        });
+        processor_ = std::make_unique<ScalarSensorProcessor>(wrapper_.get(), "test", "test/sensor");
+        wrapper_->connect(broker_.url(), "sensor_processor_test", "", "");
+        std::unique_lock<std::mutex> lock(mutex_);
+        ASSERT_TRUE(changed_.wait_for(lock, std::chrono::seconds(10), [this] { return connected_; }));
+    }
+
+    void TearDown() override {
+        // The processor publishes through the wrapper, whose callback uses the members
+        processor_.reset();
+        if (wrapper_ != nullptr) wrapper_->disconnect();
+        wrapper_.reset();
+    }
+
+    // Waits up to timeout for the count-th message
+    bool waitForMessages(size_t count, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return changed_.wait_for(lock, timeout, [&] { return received_.size() >= count; });
+    }
+
+    std::vector<std::string> received() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return received_;
+    }
+
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    bool connected_ = false;
+    std::vector<std::string> received_;
+
+    LoopbackBroker broker_;
+    std::unique_ptr<MqttClientWrapper> wrapper_;
+    std::unique_ptr<ScalarSensorProcessor> processor_;
+};
+
+TEST_F(SensorProcessorTest, ClosesBatchAtTheEndOfItsWindowWithoutAnotherSample) {
+    processor_->updateSettings(2, 100, 50, ChangeDetectionSettings{}, 0, 0, PayloadEncoding::json,
+                               MqttClientWrapper::feed_mode::stream);
+    int64_t now = pipeline_trace::now_ns();
+    processor_->processData({1.0f}, now);
+    processor_->processData({2.0f}, now + 1000000);
+
+    ASSERT_TRUE(waitForMessages(1, std::chrono::seconds(5)));
+    std::vector<std::string> messages = received();
+    EXPECT_NE(messages[0].find("\"value\":1.00"), std::string::npos) << messages[0];
+    EXPECT_NE(messages[0].find("\"value\":2.00"), std::string::npos) << messages[0];
+}
+
+TEST_F(SensorProcessorTest, ClosesAggregationWindowAtItsEndWithoutAnotherSample) {
+    processor_->updateSettings(2, 0, 0, ChangeDetectionSettings{}, 100, 0, PayloadEncoding::json,
+                               MqttClientWrapper::feed_mode::stream);
+    processor_->processData({1.0f}, 0);
+    processor_->processData({3.0f}, 0);
+
+    ASSERT_TRUE(waitForMessages(1, std::chrono::seconds(5)));
+    EXPECT_NE(received()[0].find("\"mean\":2.00"), std::string::npos) << received()[0];
+
+    // A sample in a later pane does not close the same window again
+    processor_->processData({5.0f}, 0);
+    ASSERT_TRUE(waitForMessages(2, std::chrono::seconds(5)));
+    EXPECT_NE(received()[1].find("\"n\":1,"), std::string::npos) << received()[1];
+}
+
+TEST_F(SensorProcessorTest, StampsBatchedSamplesWithTheirSensorTime) {
+    processor_->updateSettings(2, 60000, 2, ChangeDetectionSettings{}, 0, 0, PayloadEncoding::json,
+                               MqttClientWrapper::feed_mode::stream);
+    // Taken a minute ago, e.g. delivered late from the sensor's hardware queue
+    int64_t taken = pipeline_trace::now_ns() - 60000000000LL;
+    int64_t expectedMs = currentTimeMillis() - 60000;
+    processor_->processData({1.0f}, taken);
+    processor_->processData({2.0f}, taken + 10000000);
+
+    ASSERT_TRUE(waitForMessages(1, std::chrono::seconds(5)));
+    std::string message = received()[0];
+    size_t t = message.find("\"t\":");
+    ASSERT_NE(t, std::string::npos) << message;
+    int64_t stampedMs = std::stoll(message.substr(t + 4));
+    EXPECT_NEAR(static_cast<double>(stampedMs), static_cast<double>(expectedMs), 1000.0) << message;
+}
+
+}
@@ -0,0 +1,167 @@
+// SeriesEncoder and decodeSeries: round trips in both codings, the width of each bucket code
+// and the escape for values the fixed-point coding cannot hold.
+
+#include "series_codec.h"
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+uint32_t bitsOf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+struct Sample {
+    int64_t timestampMs;
+    std::vector<float> values;
+};
+
+std::string encode(const std::vector<Sample>& samples, int decimals, SeriesCoding coding) {
+    SeriesEncoder encoder;
+    encoder.reset(samples[0].values.size(), decimals, coding);
+    for (const Sample& s : samples) encoder.add(s.timestampMs, s.values.data());
+    return encoder.finish();
+}
+
+void expectRoundTrip(const std::vector<Sample>& samples, int decimals, SeriesCoding coding) {
+    std::string payload = encode(samples, decimals, coding);
+    std::vector<DecodedSample> decoded;
+    ASSERT_TRUE(decodeSeries(payload, decoded));
+    ASSERT_EQ(decoded.size(), samples.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        EXPECT_TRUE(decoded[i].hasTimestamp);
+        EXPECT_EQ(decoded[i].timestampMs, samples[i].timestampMs) << "sample " << i;
+        ASSERT_EQ(decoded[i].values.size(), samples[i].values.size());
+        for (size_t c = 0; c < samples[i].values.size(); ++c) {
+            EXPECT_EQ(bitsOf(decoded[i].values[c]), bitsOf(samples[i].values[c]))
+                << "sample " << i << " channel " << c << ": " << samples[i].values[c];
+        }
+    }
+}
+
+// Payload size of two single-channel samples 10 ms apart, the second differing by delta
+// units of the last decimal from the first; the timestamp takes 9 bits
+size_t sizeForChange(int64_t delta) {
+    const float first = 1000.0f;
+    std::vector<Sample> samples = {{0, {first}}, {10, {first + static_cast<float>(delta)}}};
+    return encode(samples, 0, SeriesCoding::fixedPoint).size();
+}
+
+size_t expectedSize(int channelBits) {
+    return series_format::HEADER_SIZE + 4 + static_cast<size_t>(9 + channelBits + 7) / 8;
+}
+
+TEST(SeriesCodecTest, FixedPointBucketsHaveTheirDocumentedWidths) {
+    // zigzag(63) = 126 is the largest 7-bit value, zigzag(64) = 128 the smallest 12-bit one
+    EXPECT_EQ(sizeForChange(0), expectedSize(1));
+    EXPECT_EQ(sizeForChange(63), expectedSize(2 + 7));
+    EXPECT_EQ(sizeForChange(-64), expectedSize(2 + 7));
+    EXPECT_EQ(sizeForChange(64), expectedSize(3 + 12));
+    EXPECT_EQ(sizeForChange(2047), expectedSize(3 + 12));
+    EXPECT_EQ(sizeForChange(2048), expectedSize(4 + 20));
+    EXPECT_EQ(sizeForChange((1 << 19) - 1), expectedSize(4 + 20));
+    EXPECT_EQ(sizeForChange(1 << 19), expectedSize(5 + 32));
+    EXPECT_EQ(sizeForChange(-(1 << 23)), expectedSize(5 + 32));
+
+    for (int64_t delta : {0, 63, -64, 64, 2047, 2048, (1 << 19) - 1, 1 << 19, -(1 << 23)}) {
+        expectRoundTrip({{0, {1000.0f}}, {10, {1000.0f + static_cast<float>(delta)}}}, 0, SeriesCoding::fixedPoint);
+    }
+}
+
+TEST(SeriesCodecTest, TimestampBucketsRoundTrip) {
+    // Delta-of-delta values at the edges of the 7, 9 and 12-bit buckets and beyond, in both
+    // directions, including clock steps
+    std::vector<Sample> samples;
+    int64_t t = 1700000000000;
+    int64_t interval = 10;
+    for (int64_t dod : {0, 0, 63, -64, 64, 255, -256, 256, 2047, -2048, 2048, 0, 100000000, -200000000, 0}) {
+        interval += dod;
+        t += interval;
+        samples.push_back({t, {static_cast<float>(samples.size())}});
+    }
+    expectRoundTrip(samples, 0, SeriesCoding::fixedPoint);
+    expectRoundTrip(samples, 0, SeriesCoding::xorFloat);
+
+    // A regular series takes one bit per timestamp
+    std::vector<Sample> regular;
+    for (int i = 0; i < 9; ++i) regular.push_back({1000 + 20 * i, {1.0f}});
+    // First interval 9 bits, then 7 single bits and one bit per unchanged channel
+    EXPECT_EQ(encode(regular, 2, SeriesCoding::fixedPoint).size(),
+              series_format::HEADER_SIZE + 4 + (9 + 1 + 7 * 2 + 7) / 8);
+}
+
+TEST(SeriesCodecTest, EscapesValuesThatAreNotFixedPoint) {
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    const float inf = std::numeric_limits<float>::infinity();
+    std::vector<Sample> samples = {
+        {0, {1.25f, 0.0f}},
+        {10, {0.123456f, -0.0f}}, // Not k / 100; -0 is not +0 bit for bit
+        {20, {1.26f, nan}},       // Relative to 1.25, the last fixed-point value
+        {30, {inf, 1e30f}},
+        {40, {-1.25f, 2.0f}},
+    };
+    expectRoundTrip(samples, 2, SeriesCoding::fixedPoint);
+
+    // The escape is 5 + 32 bits
+    std::vector<Sample> escaped = {{0, {1.0f}}, {10, {0.123456f}}};
+    EXPECT_EQ(encode(escaped, 2, SeriesCoding::fixedPoint).size(), expectedSize(5 + 32));
+}
+
+TEST(SeriesCodecTest, XorFloatRoundTripsUnroundedData) {
+    std::mt19937 generator(1);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<Sample> samples;
+    float x = 9.81f;
+    for (int i = 0; i < 500; ++i) {
+        x += 0.01f * normal(generator);
+        // Repeats and a sign change exercise the single-bit and new-window codes
+        samples.push_back({20 * i, {x, i % 7 == 0 ? 0.0f : -x, 1.0f}});
+    }
+    expectRoundTrip(samples, 2, SeriesCoding::xorFloat);
+    expectRoundTrip(samples, 2, SeriesCoding::fixedPoint);
+}
+
+TEST(SeriesCodecTest, DecimalsBeyondTheFixedRangeFallBackToXor) {
+    std::vector<Sample> samples = {{0, {1.5f}}, {10, {1.75f}}};
+    SeriesEncoder encoder;
+    encoder.reset(1, series_format::MAX_FIXED_DECIMALS + 1);
+    for (const Sample& s : samples) encoder.add(s.timestampMs, s.values.data());
+    std::string payload = encoder.finish();
+    EXPECT_NE(static_cast<uint8_t>(payload[0]) & series_format::XOR_FLOAT, 0);
+    std::vector<DecodedSample> decoded;
+    ASSERT_TRUE(decodeSeries(payload, decoded));
+    ASSERT_EQ(decoded.size(), 2u);
+    EXPECT_EQ(decoded[1].values[0], 1.75f);
+}
+
+TEST(SeriesCodecTest, SingleSampleIsTheByteAlignedPart) {
+    const float values[] = {1.5f, -2.0f, 0.1f};
+    char out[64];
+    int length = encodeSeriesSample(out, sizeof(out), values, 3, 2, 1700000000000);
+    ASSERT_EQ(length, static_cast<int>(series_format::HEADER_SIZE + 12));
+    std::vector<DecodedSample> decoded;
+    ASSERT_TRUE(decodeSeries(std::string_view(out, static_cast<size_t>(length)), decoded));
+    ASSERT_EQ(decoded.size(), 1u);
+    EXPECT_EQ(decoded[0].timestampMs, 1700000000000);
+    EXPECT_EQ(decoded[0].values, std::vector<float>(values, values + 3));
+}
+
+TEST(SeriesCodecTest, RejectsTruncatedPayloads) {
+    std::vector<Sample> samples;
+    for (int i = 0; i < 20; ++i) samples.push_back({10 * i, {static_cast<float>(i * i)}});
+    std::string payload = encode(samples, 0, SeriesCoding::fixedPoint);
+    std::vector<DecodedSample> decoded;
+    EXPECT_FALSE(decodeSeries(std::string_view(payload).substr(0, payload.size() - 2), decoded));
+    EXPECT_LT(decoded.size(), samples.size());
+}
+
+}
@@ -0,0 +1,133 @@
+// RealFft and SpectrumAnalyzer against a naive DFT computed in double.
+
+#include "spectrum_analyzer.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+namespace {
+
+std::vector<std::complex<double>> naiveDft(const std::vector<double>& x) {
+    const size_t n = x.size();
+    std::vector<std::complex<double>> bins(n / 2 + 1);
+    for (size_t k = 0; k <= n / 2; ++k) {
+        std::complex<double> sum;
+        for (size_t i = 0; i < n; ++i) {
+            double angle = -2.0 * M_PI * static_cast<double>(k * i % n) / static_cast<double>(n);
+            sum += x[i] * std::complex<double>(std::cos(angle), std::sin(angle));
+        }
+        bins[k] = sum;
+    }
+    return bins;
+}
+
+std::vector<float> noise(size_t n, unsigned seed) {
+    std::mt19937 generator(seed);
+    std::normal_distribution<float> normal(0.0f, 1.0f);
+    std::vector<float> values(n);
+    for (float& v : values) v = normal(generator);
+    return values;
+}
+
+TEST(SpectrumAnalyzerTest, RealFftMatchesNaiveDft) {
+    for (size_t size : {4u, 8u, 16u, 64u, 256u, 1024u}) {
+        std::vector<float> input = noise(size, static_cast<unsigned>(size));
+        RealFft fft;
+        fft.resize(size);
+        std::vector<float> re(size / 2 + 1), im(size / 2 + 1);
+        fft.transform(input.data(), re.data(), im.data());
+
+        auto expected = naiveDft(std::vector<double>(input.begin(), input.end()));
+        // Single-precision rounding grows with log2(size) and the magnitude of the sums
+        double tolerance = 1e-5 * std::sqrt(static_cast<double>(size)) * std::log2(static_cast<double>(size));
+        for (size_t k = 0; k <= size / 2; ++k) {
+            EXPECT_NEAR(re[k], expected[k].real(), tolerance) << "size " << size << " bin " << k;
+            EXPECT_NEAR(im[k], expected[k].imag(), tolerance) << "size " << size << " bin " << k;
+        }
+    }
+}
+
+TEST(SpectrumAnalyzerTest, BandsAndPeakAmplitudeMatchNaiveDft) {
+    constexpr int BLOCK = 128;
+    constexpr int BANDS = 8;
+    constexpr float RATE = 100.0f;
+    SpectrumAnalyzer<1> analyzer;
+    ASSERT_TRUE(analyzer.configure(BLOCK, BANDS, RATE));
+
+    std::vector<float> block = noise(BLOCK, 7);
+    for (float& v : block) v += 9.81f; // Offset removed before the transform
+    SpectrumAnalyzer<1>::result_type result;
+    for (int i = 0; i < BLOCK; ++i) {
+        bool complete = analyzer.add(&block[i], result);
+        ASSERT_EQ(complete, i == BLOCK - 1);
+    }
+
+    // Same steps in double: mean removal, periodic Hann window, one-sided spectrum
+    double mean = 0.0;
+    for (float v : block) mean += v;
+    mean /= BLOCK;
+    std::vector<double> windowed(BLOCK);
+    double windowSum = 0.0, windowSquares = 0.0;
+    for (int i = 0; i < BLOCK; ++i) {
+        double w = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / BLOCK);
+        windowed[i] = (block[i] - mean) * w;
+        windowSum += w;
+        windowSquares += w * w;
+    }
+    auto bins = naiveDft(windowed);
+
+    std::vector<double> bands(BANDS, 0.0);
+    double peakAmplitude = 0.0;
+    const size_t half = BLOCK / 2;
+    for (size_t k = 1; k <= half; ++k) {
+        bool single = k == half;
+        double power = std::norm(bins[k]);
+        bands[std::min((k - 1) * BANDS / half, size_t{BANDS - 1})] +=
+            power / (BLOCK * windowSquares) * (single ? 1.0 : 2.0);
+        peakAmplitude = std::max(peakAmplitude, std::abs(bins[k]) * 2.0 / windowSum * (single ? 0.5 : 1.0));
+    }
+
+    for (int b = 0; b < BANDS; ++b) {
+        EXPECT_NEAR(result[0].bandEnergy[b], bands[b], 1e-4 * (1.0 + bands[b])) << "band " << b;
+    }
+    EXPECT_NEAR(result[0].peakAmplitude, peakAmplitude, 1e-4 * peakAmplitude);
+}
+
+TEST(SpectrumAnalyzerTest, FindsFrequencyAndAmplitudeOfASinusoid) {
+    constexpr int BLOCK = 256;
+    constexpr float RATE = 200.0f;
+    SpectrumAnalyzer<1> analyzer;
+    ASSERT_TRUE(analyzer.configure(BLOCK, 4, RATE));
+
+    // Between bins 15 and 16, which are 0.78 Hz apart
+    const double frequency = 11.95;
+    const double amplitude = 0.8;
+    SpectrumAnalyzer<1>::result_type result;
+    for (int i = 0; i < BLOCK; ++i) {
+        float value = static_cast<float>(1.0 + amplitude * std::sin(2.0 * M_PI * frequency * i / RATE));
+        analyzer.add(&value, result);
+    }
+
+    ASSERT_GE(result[0].peakCount, 1u);
+    EXPECT_NEAR(result[0].peaks[0].frequency, frequency, 0.05);
+    EXPECT_NEAR(result[0].peaks[0].amplitude, amplitude, 0.02);
+    // Mean square of the sinusoid, nearly all of it in the lowest band
+    float total = 0.0f;
+    for (float e : result[0].bandEnergy) total += e;
+    EXPECT_NEAR(total, amplitude * amplitude / 2.0, 0.01);
+    EXPECT_GT(result[0].bandEnergy[0], 0.95f * total);
+}
+
+TEST(SpectrumAnalyzerTest, RejectsUnusableBlockSizes) {
+    SpectrumAnalyzer<3> analyzer;
+    EXPECT_FALSE(analyzer.configure(100, 4, 50.0f));
+    EXPECT_FALSE(analyzer.enabled());
+    EXPECT_FALSE(analyzer.configure(8, 4, 50.0f));
+    EXPECT_TRUE(analyzer.configure(0, 4, 50.0f));
+    EXPECT_FALSE(analyzer.enabled());
+}
+
+}
@@ -0,0 +1,127 @@
+// TopicAliasTable: when topics get an alias, when they lose it to a busier one, and what a
+// new connection does to the assignments.
+
+#include "topic_alias_table.h"
+#include <gtest/gtest.h>
+#include <string>
+
+namespace {
+
+// Looks topic up count times and returns the last alias
+uint16_t use(TopicAliasTable& table, const std::string& topic, uint32_t count, bool* with_topic = nullptr) {
+    uint16_t alias = 0;
+    bool sent = false;
+    for (uint32_t i = 0; i < count; ++i) alias = table.lookup(topic, sent);
+    if (with_topic != nullptr) *with_topic = sent;
+    return alias;
+}
+
+TEST(TopicAliasTableTest, NoAliasesUntilTheBrokerAllowsThem) {
+    TopicAliasTable table;
+    EXPECT_EQ(table.capacity(), 0u);
+    bool with_topic = true;
+    EXPECT_EQ(use(table, "a", 10, &with_topic), 0u);
+    EXPECT_FALSE(with_topic);
+
+    table.reset(1000);
+    EXPECT_EQ(table.capacity(), TopicAliasTable::MAX_ALIASES);
+}
+
+TEST(TopicAliasTableTest, AssignsAnAliasOnceATopicIsHot) {
+    TopicAliasTable table;
+    table.reset(4);
+    EXPECT_EQ(use(table, "a", TopicAliasTable::HOT_THRESHOLD - 1), 0u);
+
+    bool with_topic = false;
+    EXPECT_EQ(table.lookup("a", with_topic), 1u);
+    EXPECT_TRUE(with_topic); // Establishes the alias
+    EXPECT_EQ(table.lookup("a", with_topic), 1u);
+    EXPECT_FALSE(with_topic);
+
+    EXPECT_EQ(use(table, "b", TopicAliasTable::HOT_THRESHOLD, &with_topic), 2u);
+    EXPECT_TRUE(with_topic);
+    EXPECT_EQ(table.size(), 2u);
+}
+
+TEST(TopicAliasTableTest, BusierTopicTakesOverTheLeastUsedAlias) {
+    TopicAliasTable table;
+    table.reset(1);
+    ASSERT_EQ(use(table, "a", 5), 1u); // 5 uses
+
+    // b needs more than twice a's uses
+    EXPECT_EQ(use(table, "b", 10), 0u);
+    bool with_topic = false;
+    EXPECT_EQ(table.lookup("b", with_topic), 1u);
+    EXPECT_TRUE(with_topic); // Rebinding sends the topic like establishing
+
+    // a is back to being a candidate, with the uses it had
+    EXPECT_EQ(table.lookup("a", with_topic), 0u);
+    EXPECT_FALSE(with_topic);
+    EXPECT_EQ(table.size(), 1u);
+}
+
+TEST(TopicAliasTableTest, ReconnectKeepsAssignmentsButEstablishesThemAgain) {
+    TopicAliasTable table;
+    table.reset(2);
+    ASSERT_EQ(use(table, "a", 5), 1u);
+    ASSERT_EQ(use(table, "b", 5), 2u);
+
+    table.reset(2);
+    bool with_topic = false;
+    EXPECT_EQ(table.lookup("b", with_topic), 2u);
+    EXPECT_TRUE(with_topic);
+    EXPECT_EQ(table.lookup("b", with_topic), 2u);
+    EXPECT_FALSE(with_topic);
+    EXPECT_EQ(table.lookup("a", with_topic), 1u);
+    EXPECT_TRUE(with_topic);
+}
+
+TEST(TopicAliasTableTest, SmallerMaximumDropsTheAliasesBeyondIt) {
+    TopicAliasTable table;
+    table.reset(2);
+    ASSERT_EQ(use(table, "a", 5), 1u);
+    ASSERT_EQ(use(table, "b", 5), 2u);
+
+    table.reset(1);
+    EXPECT_EQ(table.capacity(), 1u);
+    EXPECT_EQ(table.size(), 1u);
+    bool with_topic = false;
+    EXPECT_EQ(table.lookup("b", with_topic), 0u);
+    EXPECT_EQ(table.lookup("a", with_topic), 1u);
+    EXPECT_TRUE(with_topic);
+
+    // A disconnect turns aliases off
+    table.reset(0);
+    EXPECT_EQ(table.size(), 0u);
+    EXPECT_EQ(table.lookup("a", with_topic), 0u);
+}
+
+TEST(TopicAliasTableTest, ForgottenPublishEstablishesTheAliasAgain) {
+    TopicAliasTable table;
+    table.reset(1);
+    bool with_topic = false;
+    uint16_t alias = use(table, "a", TopicAliasTable::HOT_THRESHOLD, &with_topic);
+    ASSERT_EQ(alias, 1u);
+    ASSERT_TRUE(with_topic);
+
+    // The PUBLISH that would have established it was not sent
+    table.forget(alias);
+    EXPECT_EQ(table.lookup("a", with_topic), 1u);
+    EXPECT_TRUE(with_topic);
+    EXPECT_EQ(table.lookup("a", with_topic), 1u);
+    EXPECT_FALSE(with_topic);
+}
+
+TEST(TopicAliasTableTest, UseCountsDecaySoRecentRatesDecide) {
+    TopicAliasTable table;
+    table.reset(1);
+    // a has been busy for a long time
+    ASSERT_EQ(use(table, "a", 3000), 1u);
+    // Since then b is the busy one. Without decay it would need more than 6000 uses; the
+    // decay at DECAY_INTERVAL lookups halves both, leaving a with 1500, so b takes over
+    // after about 3550.
+    EXPECT_EQ(use(table, "b", 3500), 0u);
+    EXPECT_EQ(use(table, "b", 100), 1u);
+}
+
+}
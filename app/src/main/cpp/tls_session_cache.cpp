@@ -0,0 +1,69 @@
+#include "tls_session_cache.h"
+
+namespace {
+
+int cache_index() {
+    static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+    return index;
+}
+
+}
+
+TlsSessionCache::~TlsSessionCache() {
+    for (auto& [name, session] : sessions_) {
+        SSL_SESSION_free(session);
+    }
+}
+
+void TlsSessionCache::attach(SSL_CTX* ctx) {
+    SSL_CTX_set_ex_data(ctx, cache_index(), this);
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, &TlsSessionCache::on_new_session);
+    SSL_CTX_set_info_callback(ctx, &TlsSessionCache::on_info);
+}
+
+TlsSessionCache* TlsSessionCache::from(SSL_CTX* ctx) {
+    return static_cast<TlsSessionCache*>(SSL_CTX_get_ex_data(ctx, cache_index()));
+}
+
+void TlsSessionCache::prepare(SSL* ssl, const std::string& host) {
+    const std::string& name = server_name(host);
+    SSL_set_tlsext_host_name(ssl, name.c_str());
+    auto cached = sessions_.find(name);
+    if (cached != sessions_.end()) {
+        SSL_set_session(ssl, cached->second);
+    }
+}
+
+void TlsSessionCache::forget(const std::string& host) {
+    auto cached = sessions_.find(server_name(host));
+    if (cached != sessions_.end()) {
+        SSL_SESSION_free(cached->second);
+        sessions_.erase(cached);
+    }
+}
+
+int TlsSessionCache::on_new_session(SSL* ssl, SSL_SESSION* session) {
+    TlsSessionCache* cache = from(SSL_get_SSL_CTX(ssl));
+    const char* name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (cache == nullptr || name == nullptr || !SSL_SESSION_is_resumable(session)) {
+        return 0; // Not kept; OpenSSL frees it
+    }
+    // TLS 1.3 servers may issue several tickets; the latest one replaces the others
+    SSL_SESSION*& slot = cache->sessions_[name];
+    if (slot != nullptr) {
+        SSL_SESSION_free(slot);
+    }
+    slot = session;
+    return 1;
+}
+
+void TlsSessionCache::on_info(const SSL* ssl, int where, int /* ret */) {
+    if ((where & SSL_CB_HANDSHAKE_DONE) == 0) {
+        return;
+    }
+    TlsSessionCache* cache = from(SSL_get_SSL_CTX(ssl));
+    if (cache != nullptr) {
+        cache->last_resumed_ = SSL_session_reused(ssl) == 1;
+    }
+}
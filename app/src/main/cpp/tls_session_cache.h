@@ -0,0 +1,55 @@
+#ifndef OPEN_SENSOR_TLS_SESSION_CACHE_H
+#define OPEN_SENSOR_TLS_SESSION_CACHE_H
+
+#include <openssl/ssl.h>
+#include <string>
+#include <unordered_map>
+
+// Client-side TLS session cache for an SSL_CTX shared by every broker connection, so that a
+// reconnect resumes the previous session (a TLS 1.3 ticket or a TLS 1.2 session) instead of
+// paying for a full handshake.
+//
+// OpenSSL keeps no client sessions of its own; the new-session callback hands them to this
+// cache, which keeps the latest one per server name. prepare() is called before each
+// handshake to set SNI and offer the cached session, which the server may still decline.
+//
+// Not thread-safe; the callbacks run on the thread doing the handshakes, the MQTT client
+// wrapper's io_context thread.
+class TlsSessionCache {
+public:
+    TlsSessionCache() = default;
+    ~TlsSessionCache();
+
+    TlsSessionCache(const TlsSessionCache&) = delete;
+    TlsSessionCache& operator=(const TlsSessionCache&) = delete;
+
+    // Installs the callbacks. The cache must outlive every handshake on ctx.
+    void attach(SSL_CTX* ctx);
+    static TlsSessionCache* from(SSL_CTX* ctx);
+
+    // Server name used instead of the connected host, for connections made to an address
+    // resolved earlier; empty to use the host
+    void set_server_name(std::string name) { server_name_ = std::move(name); }
+    // Sets SNI and offers the session cached for the server name
+    void prepare(SSL* ssl, const std::string& host);
+    // After a failed handshake, so the next one starts from scratch
+    void forget(const std::string& host);
+
+    // Whether the last completed handshake resumed a session
+    bool last_resumed() const { return last_resumed_; }
+    size_t size() const { return sessions_.size(); }
+
+private:
+    static int on_new_session(SSL* ssl, SSL_SESSION* session);
+    static void on_info(const SSL* ssl, int where, int ret);
+
+    const std::string& server_name(const std::string& host) const {
+        return server_name_.empty() ? host : server_name_;
+    }
+
+    std::unordered_map<std::string, SSL_SESSION*> sessions_;
+    std::string server_name_;
+    bool last_resumed_ = false;
+};
+
+#endif //OPEN_SENSOR_TLS_SESSION_CACHE_H
@@ -0,0 +1,94 @@
+#include "topic_alias_table.h"
+#include <algorithm>
+
+void TopicAliasTable::reset(uint16_t maximum) {
+    size_t capacity = std::min<size_t>(maximum, MAX_ALIASES);
+    // Topics beyond the new maximum have to earn an alias again
+    for (size_t i = capacity; i < entries_.size(); ++i) {
+        if (!entries_[i].topic.empty()) {
+            index_.erase(entries_[i].topic);
+        }
+    }
+    entries_.resize(capacity);
+    for (entry& e : entries_) {
+        e.established = false;
+    }
+}
+
+uint16_t TopicAliasTable::lookup(const std::string& topic, bool& with_topic) {
+    with_topic = false;
+    if (entries_.empty()) {
+        return 0;
+    }
+    if (++lookups_ == DECAY_INTERVAL) {
+        decay();
+    }
+
+    auto aliased = index_.find(topic);
+    if (aliased != index_.end()) {
+        entry& e = entries_[aliased->second - 1];
+        ++e.uses;
+        with_topic = !e.established;
+        e.established = true;
+        return aliased->second;
+    }
+
+    auto candidate = candidates_.find(topic);
+    if (candidate == candidates_.end()) {
+        if (candidates_.size() >= MAX_CANDIDATES) {
+            return 0; // Too many distinct topics to track; the busy ones are already in
+        }
+        candidate = candidates_.emplace(topic, 0).first;
+    }
+    uint32_t uses = ++candidate->second;
+    if (uses < HOT_THRESHOLD) {
+        return 0;
+    }
+    uint16_t alias = assign(topic, uses);
+    if (alias != 0) {
+        // By key, as assign() may have rehashed the candidates
+        candidates_.erase(topic);
+        with_topic = true;
+    }
+    return alias;
+}
+
+void TopicAliasTable::forget(uint16_t alias) {
+    if (alias != 0 && alias <= entries_.size()) {
+        entries_[alias - 1].established = false;
+    }
+}
+
+uint16_t TopicAliasTable::assign(const std::string& topic, uint32_t uses) {
+    auto coldest = std::min_element(entries_.begin(), entries_.end(), [](const entry& a, const entry& b) {
+        // Free entries first
+        return a.topic.empty() != b.topic.empty() ? a.topic.empty() : a.uses < b.uses;
+    });
+    if (!coldest->topic.empty()) {
+        if (uses <= 2 * coldest->uses) {
+            return 0;
+        }
+        index_.erase(coldest->topic);
+        if (candidates_.size() < MAX_CANDIDATES) {
+            candidates_.emplace(std::move(coldest->topic), coldest->uses);
+        }
+    }
+    // Rebinding an alias is done the same way as establishing it, by sending the topic with it
+    coldest->topic = topic;
+    coldest->uses = uses;
+    coldest->established = true;
+    auto alias = static_cast<uint16_t>(coldest - entries_.begin() + 1);
+    index_[topic] = alias;
+    return alias;
+}
+
+void TopicAliasTable::decay() {
+    lookups_ = 0;
+    for (entry& e : entries_) {
+        e.uses /= 2;
+    }
+    for (auto it = candidates_.begin(); it != candidates_.end();) {
+        it->second /= 2;
+        it = it->second == 0 ? candidates_.erase(it) : std::next(it);
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef OPEN_SENSOR_TOPIC_ALIAS_TABLE_H
+#define OPEN_SENSOR_TOPIC_ALIAS_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Client side of MQTT 5 topic aliases: decides which topics get one of the aliases the
+// broker allows, and whether a PUBLISH still has to carry the topic to establish its alias.
+//
+// A topic becomes a candidate once it has been published HOT_THRESHOLD times. Aliases are
+// handed out to candidates while there are free ones; after that a candidate takes over the
+// alias of the least used topic if it is used more than twice as often. Use counts are halved
+// every DECAY_INTERVAL lookups, so the ranking follows the current publish rates.
+//
+// Aliases only live as long as the network connection. reset() is called with the maximum
+// from each CONNACK; the assignments are kept, but every alias is established again by the
+// next PUBLISH on its topic.
+//
+// Not thread-safe; the MQTT client wrapper only uses it on its io_context thread.
+class TopicAliasTable {
+public:
+    static constexpr size_t MAX_ALIASES = 32;
+    static constexpr uint32_t HOT_THRESHOLD = 4;
+    static constexpr size_t MAX_CANDIDATES = 256;
+    static constexpr uint32_t DECAY_INTERVAL = 4096;
+    // Size of the Topic Alias property in a PUBLISH: identifier and two-byte value
+    static constexpr size_t PROPERTY_SIZE = 3;
+
+    // topic_alias_maximum from CONNACK; 0, as after a disconnect, turns aliases off
+    void reset(uint16_t maximum);
+    uint16_t capacity() const { return static_cast<uint16_t>(entries_.size()); }
+
+    // For a PUBLISH on topic: the alias to send, or 0 for none. with_topic is set when the
+    // topic has to be sent along with the alias, which then counts as established.
+    uint16_t lookup(const std::string& topic, bool& with_topic);
+    // The PUBLISH returned by lookup() was not sent after all
+    void forget(uint16_t alias);
+
+    size_t size() const { return index_.size(); }
+
+private:
+    struct entry {
+        std::string topic;
+        uint32_t uses = 0;
+        bool established = false;
+    };
+
+    uint16_t assign(const std::string& topic, uint32_t uses);
+    void decay();
+
+    std::vector<entry> entries_; // alias - 1
+    std::unordered_map<std::string, uint16_t> index_;
+    std::unordered_map<std::string, uint32_t> candidates_;
+    uint32_t lookups_ = 0;
+};
+
+#endif //OPEN_SENSOR_TOPIC_ALIAS_TABLE_H
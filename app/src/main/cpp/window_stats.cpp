@@ -0,0 +1,117 @@
+#include "window_stats.h"
+#include <algorithm>
+#include <cmath>
+
+void RunningStats::add(float value) {
+    double x = value;
+    ++count;
+    double delta = x - mean;
+    mean += delta / static_cast<double>(count);
+    m2 += delta * (x - mean);
+    sumSquares += x * x;
+    if (count == 1) {
+        min = max = value;
+    } else {
+        min = std::min(min, value);
+        max = std::max(max, value);
+    }
+}
+
+void RunningStats::merge(const RunningStats& other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    double total = static_cast<double>(count + other.count);
+    double delta = other.mean - mean;
+    mean += delta * static_cast<double>(other.count) / total;
+    m2 += other.m2 + delta * delta * static_cast<double>(count) * static_cast<double>(other.count) / total;
+    sumSquares += other.sumSquares;
+    count += other.count;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+}
+
+double RunningStats::stddev() const {
+    return std::sqrt(variance());
+}
+
+double RunningStats::rms() const {
+    return count > 0 ? std::sqrt(sumSquares / static_cast<double>(count)) : 0.0;
+}
+
+template<size_t N>
+void WindowedStats<N>::configure(int windowMs, int stepMs) {
+    current_ = -1;
+    closed_ = false;
+    ring_.fill(result_type{});
+    if (windowMs <= 0) {
+        panes_ = 0;
+        return;
+    }
+
+    if (stepMs <= 0 || stepMs >= windowMs) stepMs = windowMs;
+    // Keep the window length and coarsen the step if it would need too many panes
+    int panes = (windowMs + stepMs - 1) / stepMs;
+    if (panes > MAX_PANES) {
+        panes = MAX_PANES;
+        stepMs = (windowMs + MAX_PANES - 1) / MAX_PANES;
+    }
+    panes_ = panes;
+    step_ = std::chrono::milliseconds(stepMs);
+    origin_ = clock::now();
+}
+
+template<size_t N>
+bool WindowedStats<N>::add(const float values[], clock::time_point now, result_type& closed) {
+    int64_t index = std::max<int64_t>(paneIndex(now), 0);
+    // The window ending with the previous sample's pane is complete
+    bool windowClosed = close(now, closed);
+
+    if (current_ >= 0 && index > current_) {
+        // Panes the window has slid past are reused; all of them after a long gap
+        int64_t stale = std::min<int64_t>(index - current_, panes_);
+        for (int64_t i = 1; i <= stale; ++i) {
+            ring_[(current_ + i) % panes_] = result_type{};
+        }
+    }
+    if (index != current_) {
+        closed_ = false;
+    }
+    current_ = index;
+
+    result_type& pane = ring_[index % panes_];
+    for (size_t c = 0; c < N; ++c) {
+        pane[c].add(values[c]);
+    }
+    return windowClosed;
+}
+
+template<size_t N>
+bool WindowedStats<N>::close(clock::time_point now, result_type& closed) {
+    if (current_ < 0 || closed_ || paneIndex(now) <= current_) {
+        return false;
+    }
+    closed_ = true;
+    closed = result_type{};
+    for (int64_t i = 0; i < panes_ && current_ - i >= 0; ++i) {
+        const result_type& pane = ring_[(current_ - i) % panes_];
+        for (size_t c = 0; c < N; ++c) {
+            closed[c].merge(pane[c]);
+        }
+    }
+    return closed[0].count > 0;
+}
+
+template<size_t N>
+typename WindowedStats<N>::clock::time_point WindowedStats<N>::closesAt() const {
+    if (current_ < 0 || closed_) {
+        return clock::time_point::max();
+    }
+    return origin_ + step_ * (current_ + 1);
+}
+
+template class WindowedStats<1>;
+template class WindowedStats<3>;
+template class WindowedStats<4>;
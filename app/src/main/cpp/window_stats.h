@@ -0,0 +1,72 @@
+#ifndef OPEN_SENSOR_WINDOW_STATS_H
+#define OPEN_SENSOR_WINDOW_STATS_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Running count, mean, variance (Welford), sum of squares, min and max of one channel.
+// O(1) per sample and no buffering of raw values; two sets can be merged (Chan et al.),
+// which is how panes are combined into a sliding window.
+struct RunningStats {
+    uint64_t count = 0;
+    double mean = 0.0;
+    double m2 = 0.0;         // Sum of squared differences from the mean
+    double sumSquares = 0.0; // For the RMS
+    float min = 0.0f;
+    float max = 0.0f;
+
+    void add(float value);
+    void merge(const RunningStats& other);
+
+    double variance() const { return count > 0 ? m2 / static_cast<double>(count) : 0.0; }
+    double stddev() const;
+    double rms() const;
+};
+
+// Aggregates the samples of an N-channel sensor over tumbling or sliding time windows.
+//
+// Time is divided into panes of one step each. A window covers the most recent
+// window / step panes, so a tumbling window is the special case of one pane per window.
+// Each pane keeps RunningStats per channel, which are merged when a window closes; the
+// per-sample cost does not depend on the window length and nothing is allocated.
+//
+// A window closes when the first sample after its end arrives, or when close() is called
+// after its end, whichever comes first; the caller times the latter with closesAt().
+template<size_t N>
+class WindowedStats {
+public:
+    using clock = std::chrono::steady_clock;
+    using result_type = std::array<RunningStats, N>;
+
+    // Upper bound on window / step
+    static constexpr int MAX_PANES = 64;
+
+    // A window of 0 disables aggregation. A step of 0, or not shorter than the window, gives
+    // tumbling windows; otherwise the window slides by step and is rounded to whole steps.
+    void configure(int windowMs, int stepMs);
+    bool enabled() const { return panes_ > 0; }
+
+    // Adds a sample taken at now. Returns true when this closed a window that contained
+    // samples, whose statistics are then stored in closed.
+    bool add(const float values[], clock::time_point now, result_type& closed);
+    // Closes the window ending with the latest sample's pane if that pane has ended by now.
+    // Returns true if it contained samples, whose statistics are then stored in closed.
+    bool close(clock::time_point now, result_type& closed);
+    // When the window ending with the latest sample's pane is due to close; time_point::max()
+    // if it has already closed or there were no samples yet
+    clock::time_point closesAt() const;
+
+private:
+    int64_t paneIndex(clock::time_point now) const { return (now - origin_) / step_; }
+
+    int panes_ = 0;
+    clock::duration step_{};
+    clock::time_point origin_;
+    int64_t current_ = -1; // Index of the pane the previous sample fell into, -1 before the first
+    bool closed_ = false;  // Whether the window ending with that pane was closed by close()
+    std::array<result_type, MAX_PANES> ring_{};
+};
+
+#endif //OPEN_SENSOR_WINDOW_STATS_H
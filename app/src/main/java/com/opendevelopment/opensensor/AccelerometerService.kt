@@ -24,6 +24,7 @@ import kotlinx.coroutines.cancel
 import kotlinx.coroutines.channels.BufferOverflow
 import kotlinx.coroutines.flow.*
 import kotlinx.coroutines.launch
+import java.nio.ByteBuffer
 
 class AccelerometerService : Service(), SensorEventListener {
 
@@ -36,7 +37,9 @@ class AccelerometerService : Service(), SensorEventListener {
     private lateinit var sensorManager: SensorManager
     private var accelerometer: Sensor? = null
     private var isStarted = false
+    private var isNativeIngestion = false
     private lateinit var settingsDataStore: SettingsDataStore
+    private val eventBuffer = SensorEventBuffer { buffer, count -> nativeProcessDataBatch(buffer, count) }
 
     private data class AccelerometerConfig(
         val isEnabled: Boolean,
@@ -44,7 +47,18 @@ class AccelerometerService : Service(), SensorEventListener {
         val multiplierY: Float,
         val multiplierZ: Float,
         val rounding: Int,
-        val samplingPeriod: Int
+        val samplingPeriod: Int,
+        val batchWindowMs: Int,
+        val batchMaxSamples: Int,
+        val changeDetection: ChangeDetectionConfig,
+        val aggregationWindowMs: Int,
+        val aggregationStepMs: Int,
+        val payloadFormat: Int,
+        val publishMode: Int,
+        val filter: String,
+        val spectrumBlockSize: Int,
+        val spectrumBands: Int,
+        val nativeIngestion: Boolean
     )
 
     override fun onCreate() {
@@ -67,7 +81,18 @@ class AccelerometerService : Service(), SensorEventListener {
                         s.accelerometerMultiplierY.toFloatOrNull() ?: 1.0f,
                         s.accelerometerMultiplierZ.toFloatOrNull() ?: 1.0f,
                         s.accelerometerRounding.toIntOrNull() ?: 2,
-                        s.accelerometerSamplingPeriod
+                        s.accelerometerSamplingPeriod,
+                        s.batchWindowMs.toIntOrNull() ?: 0,
+                        s.batchMaxSamples.toIntOrNull() ?: 0,
+                        ChangeDetectionConfig.from(s, s.accelerometerDeadband),
+                        s.aggregationWindowMs.toIntOrNull() ?: 0,
+                        s.aggregationStepMs.toIntOrNull() ?: 0,
+                        s.accelerometerPayloadFormat,
+                        s.accelerometerPublishMode,
+                        s.accelerometerFilter,
+                        s.accelerometerSpectrumBlockSize.toIntOrNull() ?: 0,
+                        s.accelerometerSpectrumBands.toIntOrNull() ?: 8,
+                        s.isNativeSensorIngestionEnabled
                     )
                 }
                 .distinctUntilChanged()
@@ -77,8 +102,11 @@ class AccelerometerService : Service(), SensorEventListener {
                         return@collect
                     }
 
-                    updateSettings(config.multiplierX, config.multiplierY, config.multiplierZ, config.rounding)
-                    start(config.samplingPeriod)
+                    updateSettings(config.multiplierX, config.multiplierY, config.multiplierZ, config.rounding, config.batchWindowMs, config.batchMaxSamples, config.changeDetection,
+                        config.aggregationWindowMs, config.aggregationStepMs, config.payloadFormat, config.publishMode)
+                    updateFilters(config.filter, config.samplingPeriod)
+                    updateSpectrum(config.spectrumBlockSize, config.spectrumBands, config.samplingPeriod)
+                    start(config.samplingPeriod, config.nativeIngestion)
                     _isAccelerometerEnabled.value = isStarted
                     
                     if (!isStarted) {
@@ -95,13 +123,18 @@ class AccelerometerService : Service(), SensorEventListener {
         return START_STICKY
     }
 
-    private fun start(samplingPeriod: Int) {
+    private fun start(samplingPeriod: Int, nativeIngestion: Boolean) {
         Log.d(tag, "Starting accelerometer listener with sampling period: $samplingPeriod")
         if (isStarted) {
-            sensorManager.unregisterListener(this)
+            unregister()
         }
         if (accelerometer != null) {
-            sensorManager.registerListener(this, accelerometer, samplingPeriod)
+            isNativeIngestion = nativeIngestion &&
+                NativeSensorIngestion.enable(this, NativeSensorIngestion.ACCELEROMETER, samplingPeriod, accelerometer?.minDelay ?: 0)
+            if (!isNativeIngestion) {
+                eventBuffer.configure(samplingPeriod, accelerometer?.minDelay ?: 0)
+                sensorManager.registerListener(this, accelerometer, samplingPeriod)
+            }
             isStarted = true
         } else {
             Log.e(tag, "Accelerometer not available on this device.")
@@ -113,26 +146,55 @@ class AccelerometerService : Service(), SensorEventListener {
     private fun stop() {
         if (isStarted) {
             Log.d(tag, "Stopping accelerometer listener.")
-            sensorManager.unregisterListener(this)
+            unregister()
             isStarted = false
         }
     }
 
-    private fun updateSettings(multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int) {
-        nativeUpdateSettings(multiplierX, multiplierY, multiplierZ, rounding)
+    private fun unregister() {
+        if (isNativeIngestion) {
+            NativeSensorIngestion.disable(NativeSensorIngestion.ACCELEROMETER)
+            isNativeIngestion = false
+        } else {
+            sensorManager.unregisterListener(this)
+            eventBuffer.flush()
+        }
+    }
+
+    private fun updateSettings(multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int, batchWindowMs: Int, batchMaxSamples: Int, changeDetection: ChangeDetectionConfig,
+                               aggregationWindowMs: Int, aggregationStepMs: Int, payloadFormat: Int, publishMode: Int) {
+        nativeUpdateSettings(
+            multiplierX, multiplierY, multiplierZ, rounding, batchWindowMs, batchMaxSamples,
+            changeDetection.deadband, changeDetection.relativeDeadbandPercent, changeDetection.hysteresisPercent,
+            changeDetection.minIntervalMs, changeDetection.heartbeatMs,
+            aggregationWindowMs, aggregationStepMs, payloadFormat, publishMode
+        )
+    }
+
+    private fun updateFilters(filter: String, samplingPeriod: Int) {
+        val sampleRateHz = NativeSensorIngestion.sampleRateHz(samplingPeriod, accelerometer?.minDelay ?: 0)
+        if (!nativeUpdateFilters(filter, sampleRateHz)) {
+            Log.w(tag, "Invalid filter chain \"$filter\" at $sampleRateHz Hz, filtering disabled")
+        }
+    }
+
+    private fun updateSpectrum(blockSize: Int, bands: Int, samplingPeriod: Int) {
+        val sampleRateHz = NativeSensorIngestion.sampleRateHz(samplingPeriod, accelerometer?.minDelay ?: 0)
+        if (!nativeUpdateSpectrum(blockSize, bands, sampleRateHz)) {
+            Log.w(tag, "Invalid spectrum settings ($blockSize samples, $bands bands at $sampleRateHz Hz), analysis disabled")
+        }
     }
 
     override fun onSensorChanged(event: SensorEvent?) {
         if (event?.sensor?.type == Sensor.TYPE_LINEAR_ACCELERATION) {
-            val (x, y, z) = event.values
-
             // For the UI - only emit if there are active collectors
             if (_accelerometerData.subscriptionCount.value > 0) {
+                val (x, y, z) = event.values
                 _accelerometerData.tryEmit(Triple(x, y, z))
             }
 
-            // Process data in C++
-            nativeProcessData(x, y, z)
+            // Process data in C++, several events per call at high sampling rates
+            eventBuffer.add(event)
         }
     }
 
@@ -198,6 +260,12 @@ class AccelerometerService : Service(), SensorEventListener {
         val isAccelerometerEnabled = _isAccelerometerEnabled.asStateFlow()
     }
 
-    private external fun nativeUpdateSettings(multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int)
-    private external fun nativeProcessData(x: Float, y: Float, z: Float)
+    private external fun nativeUpdateSettings(
+        multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int, batchWindowMs: Int, batchMaxSamples: Int,
+        deadband: Float, relativeDeadbandPercent: Float, hysteresisPercent: Float, minIntervalMs: Int, heartbeatMs: Int,
+        aggregationWindowMs: Int, aggregationStepMs: Int, payloadFormat: Int, publishMode: Int
+    )
+    private external fun nativeUpdateFilters(spec: String, sampleRateHz: Float): Boolean
+    private external fun nativeUpdateSpectrum(blockSize: Int, bands: Int, sampleRateHz: Float): Boolean
+    private external fun nativeProcessDataBatch(buffer: ByteBuffer, count: Int)
 }
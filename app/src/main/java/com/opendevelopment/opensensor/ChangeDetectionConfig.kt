@@ -0,0 +1,23 @@
+package com.opendevelopment.opensensor
+
+/**
+ * Change detection options for one sensor, handed to its native processor together with the
+ * other sensor settings. See ChangeDetector in change_detector.h for how they combine.
+ */
+data class ChangeDetectionConfig(
+    val deadband: Float,
+    val relativeDeadbandPercent: Float,
+    val hysteresisPercent: Float,
+    val minIntervalMs: Int,
+    val heartbeatMs: Int
+) {
+    companion object {
+        fun from(settings: Settings, deadband: String) = ChangeDetectionConfig(
+            deadband.toFloatOrNull() ?: 0f,
+            settings.relativeDeadbandPercent.toFloatOrNull() ?: 0f,
+            settings.hysteresisPercent.toFloatOrNull() ?: 0f,
+            settings.minPublishIntervalMs.toIntOrNull() ?: 0,
+            ((settings.heartbeatSeconds.toFloatOrNull() ?: 0f) * 1000).toInt()
+        )
+    }
+}
@@ -24,6 +24,7 @@ import kotlinx.coroutines.cancel
 import kotlinx.coroutines.channels.BufferOverflow
 import kotlinx.coroutines.flow.*
 import kotlinx.coroutines.launch
+import java.nio.ByteBuffer
 
 class GravityService : Service(), SensorEventListener {
 
@@ -36,7 +37,9 @@ class GravityService : Service(), SensorEventListener {
     private lateinit var sensorManager: SensorManager
     private var gravitySensor: Sensor? = null
     private var isStarted = false
+    private var isNativeIngestion = false
     private lateinit var settingsDataStore: SettingsDataStore
+    private val eventBuffer = SensorEventBuffer { buffer, count -> nativeProcessGravityDataBatch(buffer, count) }
 
     private data class GravityConfig(
         val isEnabled: Boolean,
@@ -44,7 +47,16 @@ class GravityService : Service(), SensorEventListener {
         val multiplierY: Float,
         val multiplierZ: Float,
         val rounding: Int,
-        val samplingPeriod: Int
+        val samplingPeriod: Int,
+        val batchWindowMs: Int,
+        val batchMaxSamples: Int,
+        val changeDetection: ChangeDetectionConfig,
+        val aggregationWindowMs: Int,
+        val aggregationStepMs: Int,
+        val payloadFormat: Int,
+        val publishMode: Int,
+        val filter: String,
+        val nativeIngestion: Boolean
     )
 
     override fun onCreate() {
@@ -67,7 +79,16 @@ class GravityService : Service(), SensorEventListener {
                         s.gravityMultiplierY.toFloatOrNull() ?: 1.0f,
                         s.gravityMultiplierZ.toFloatOrNull() ?: 1.0f,
                         s.gravityRounding.toIntOrNull() ?: 2,
-                        s.gravitySamplingPeriod
+                        s.gravitySamplingPeriod,
+                        s.batchWindowMs.toIntOrNull() ?: 0,
+                        s.batchMaxSamples.toIntOrNull() ?: 0,
+                        ChangeDetectionConfig.from(s, s.gravityDeadband),
+                        s.aggregationWindowMs.toIntOrNull() ?: 0,
+                        s.aggregationStepMs.toIntOrNull() ?: 0,
+                        s.gravityPayloadFormat,
+                        s.gravityPublishMode,
+                        s.gravityFilter,
+                        s.isNativeSensorIngestionEnabled
                     )
                 }
                 .distinctUntilChanged()
@@ -77,8 +98,10 @@ class GravityService : Service(), SensorEventListener {
                         return@collect
                     }
 
-                    updateSettings(config.multiplierX, config.multiplierY, config.multiplierZ, config.rounding)
-                    start(config.samplingPeriod)
+                    updateSettings(config.multiplierX, config.multiplierY, config.multiplierZ, config.rounding, config.batchWindowMs, config.batchMaxSamples, config.changeDetection,
+                        config.aggregationWindowMs, config.aggregationStepMs, config.payloadFormat, config.publishMode)
+                    updateFilters(config.filter, config.samplingPeriod)
+                    start(config.samplingPeriod, config.nativeIngestion)
                     _isGravityEnabled.value = isStarted
 
                     if (!isStarted) {
@@ -95,13 +118,18 @@ class GravityService : Service(), SensorEventListener {
         return START_STICKY
     }
 
-    private fun start(samplingPeriod: Int) {
+    private fun start(samplingPeriod: Int, nativeIngestion: Boolean) {
         Log.d(tag, "Starting gravity listener with sampling period: $samplingPeriod")
         if (isStarted) {
-            sensorManager.unregisterListener(this)
+            unregister()
         }
         if (gravitySensor != null) {
-            sensorManager.registerListener(this, gravitySensor, samplingPeriod)
+            isNativeIngestion = nativeIngestion &&
+                NativeSensorIngestion.enable(this, NativeSensorIngestion.GRAVITY, samplingPeriod, gravitySensor?.minDelay ?: 0)
+            if (!isNativeIngestion) {
+                eventBuffer.configure(samplingPeriod, gravitySensor?.minDelay ?: 0)
+                sensorManager.registerListener(this, gravitySensor, samplingPeriod)
+            }
             isStarted = true
         } else {
             Log.e(tag, "Gravity sensor not available on this device.")
@@ -113,26 +141,48 @@ class GravityService : Service(), SensorEventListener {
     private fun stop() {
         if (isStarted) {
             Log.d(tag, "Stopping gravity listener.")
-            sensorManager.unregisterListener(this)
+            unregister()
             isStarted = false
         }
     }
 
-    private fun updateSettings(multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int) {
-        nativeUpdateGravitySettings(multiplierX, multiplierY, multiplierZ, rounding)
+    private fun unregister() {
+        if (isNativeIngestion) {
+            NativeSensorIngestion.disable(NativeSensorIngestion.GRAVITY)
+            isNativeIngestion = false
+        } else {
+            sensorManager.unregisterListener(this)
+            eventBuffer.flush()
+        }
+    }
+
+    private fun updateSettings(multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int, batchWindowMs: Int, batchMaxSamples: Int, changeDetection: ChangeDetectionConfig,
+                               aggregationWindowMs: Int, aggregationStepMs: Int, payloadFormat: Int, publishMode: Int) {
+        nativeUpdateGravitySettings(
+            multiplierX, multiplierY, multiplierZ, rounding, batchWindowMs, batchMaxSamples,
+            changeDetection.deadband, changeDetection.relativeDeadbandPercent, changeDetection.hysteresisPercent,
+            changeDetection.minIntervalMs, changeDetection.heartbeatMs,
+            aggregationWindowMs, aggregationStepMs, payloadFormat, publishMode
+        )
+    }
+
+    private fun updateFilters(filter: String, samplingPeriod: Int) {
+        val sampleRateHz = NativeSensorIngestion.sampleRateHz(samplingPeriod, gravitySensor?.minDelay ?: 0)
+        if (!nativeUpdateGravityFilters(filter, sampleRateHz)) {
+            Log.w(tag, "Invalid filter chain \"$filter\" at $sampleRateHz Hz, filtering disabled")
+        }
     }
 
     override fun onSensorChanged(event: SensorEvent?) {
         if (event?.sensor?.type == Sensor.TYPE_GRAVITY) {
-            val (x, y, z) = event.values
-
             // For the UI - only emit if there are active collectors
             if (_gravityData.subscriptionCount.value > 0) {
+                val (x, y, z) = event.values
                 _gravityData.tryEmit(Triple(x, y, z))
             }
 
-            // Process data in C++
-            nativeProcessGravityData(x, y, z)
+            // Process data in C++, several events per call at high sampling rates
+            eventBuffer.add(event)
         }
     }
 
@@ -198,6 +248,11 @@ class GravityService : Service(), SensorEventListener {
         val isGravityEnabled = _isGravityEnabled.asStateFlow()
     }
 
-    private external fun nativeUpdateGravitySettings(multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int)
-    private external fun nativeProcessGravityData(x: Float, y: Float, z: Float)
+    private external fun nativeUpdateGravitySettings(
+        multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int, batchWindowMs: Int, batchMaxSamples: Int,
+        deadband: Float, relativeDeadbandPercent: Float, hysteresisPercent: Float, minIntervalMs: Int, heartbeatMs: Int,
+        aggregationWindowMs: Int, aggregationStepMs: Int, payloadFormat: Int, publishMode: Int
+    )
+    private external fun nativeUpdateGravityFilters(spec: String, sampleRateHz: Float): Boolean
+    private external fun nativeProcessGravityDataBatch(buffer: ByteBuffer, count: Int)
 }
@@ -24,6 +24,7 @@ import kotlinx.coroutines.cancel
 import kotlinx.coroutines.channels.BufferOverflow
 import kotlinx.coroutines.flow.*
 import kotlinx.coroutines.launch
+import java.nio.ByteBuffer
 
 class GyroscopeService : Service(), SensorEventListener {
 
@@ -36,7 +37,9 @@ class GyroscopeService : Service(), SensorEventListener {
     private lateinit var sensorManager: SensorManager
     private var gyroscope: Sensor? = null
     private var isStarted = false
+    private var isNativeIngestion = false
     private lateinit var settingsDataStore: SettingsDataStore
+    private val eventBuffer = SensorEventBuffer { buffer, count -> nativeProcessGyroscopeDataBatch(buffer, count) }
 
     private data class GyroscopeConfig(
         val isEnabled: Boolean,
@@ -44,7 +47,16 @@ class GyroscopeService : Service(), SensorEventListener {
         val multiplierY: Float,
         val multiplierZ: Float,
         val rounding: Int,
-        val samplingPeriod: Int
+        val samplingPeriod: Int,
+        val batchWindowMs: Int,
+        val batchMaxSamples: Int,
+        val changeDetection: ChangeDetectionConfig,
+        val aggregationWindowMs: Int,
+        val aggregationStepMs: Int,
+        val payloadFormat: Int,
+        val publishMode: Int,
+        val filter: String,
+        val nativeIngestion: Boolean
     )
 
     override fun onCreate() {
@@ -67,7 +79,16 @@ class GyroscopeService : Service(), SensorEventListener {
                         s.gyroscopeMultiplierY.toFloatOrNull() ?: 1.0f,
                         s.gyroscopeMultiplierZ.toFloatOrNull() ?: 1.0f,
                         s.gyroscopeRounding.toIntOrNull() ?: 2,
-                        s.gyroscopeSamplingPeriod
+                        s.gyroscopeSamplingPeriod,
+                        s.batchWindowMs.toIntOrNull() ?: 0,
+                        s.batchMaxSamples.toIntOrNull() ?: 0,
+                        ChangeDetectionConfig.from(s, s.gyroscopeDeadband),
+                        s.aggregationWindowMs.toIntOrNull() ?: 0,
+                        s.aggregationStepMs.toIntOrNull() ?: 0,
+                        s.gyroscopePayloadFormat,
+                        s.gyroscopePublishMode,
+                        s.gyroscopeFilter,
+                        s.isNativeSensorIngestionEnabled
                     )
                 }
                 .distinctUntilChanged()
@@ -77,8 +98,10 @@ class GyroscopeService : Service(), SensorEventListener {
                         return@collect
                     }
 
-                    updateSettings(config.multiplierX, config.multiplierY, config.multiplierZ, config.rounding)
-                    start(config.samplingPeriod)
+                    updateSettings(config.multiplierX, config.multiplierY, config.multiplierZ, config.rounding, config.batchWindowMs, config.batchMaxSamples, config.changeDetection,
+                        config.aggregationWindowMs, config.aggregationStepMs, config.payloadFormat, config.publishMode)
+                    updateFilters(config.filter, config.samplingPeriod)
+                    start(config.samplingPeriod, config.nativeIngestion)
                     _isGyroscopeEnabled.value = isStarted
 
                     if (!isStarted) {
@@ -95,13 +118,18 @@ class GyroscopeService : Service(), SensorEventListener {
         return START_STICKY
     }
 
-    private fun start(samplingPeriod: Int) {
+    private fun start(samplingPeriod: Int, nativeIngestion: Boolean) {
         Log.d(tag, "Starting gyroscope listener with sampling period: $samplingPeriod")
         if (isStarted) {
-            sensorManager.unregisterListener(this)
+            unregister()
         }
         if (gyroscope != null) {
-            sensorManager.registerListener(this, gyroscope, samplingPeriod)
+            isNativeIngestion = nativeIngestion &&
+                NativeSensorIngestion.enable(this, NativeSensorIngestion.GYROSCOPE, samplingPeriod, gyroscope?.minDelay ?: 0)
+            if (!isNativeIngestion) {
+                eventBuffer.configure(samplingPeriod, gyroscope?.minDelay ?: 0)
+                sensorManager.registerListener(this, gyroscope, samplingPeriod)
+            }
             isStarted = true
         } else {
             Log.e(tag, "Gyroscope not available on this device.")
@@ -113,28 +141,50 @@ class GyroscopeService : Service(), SensorEventListener {
     private fun stop() {
         if (isStarted) {
             Log.d(tag, "Stopping gyroscope listener.")
-            sensorManager.unregisterListener(this)
+            unregister()
             isStarted = false
         }
     }
 
-    private fun updateSettings(multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int) {
-        nativeUpdateGyroscopeSettings(multiplierX, multiplierY, multiplierZ, rounding)
+    private fun unregister() {
+        if (isNativeIngestion) {
+            NativeSensorIngestion.disable(NativeSensorIngestion.GYROSCOPE)
+            isNativeIngestion = false
+        } else {
+            sensorManager.unregisterListener(this)
+            eventBuffer.flush()
+        }
+    }
+
+    private fun updateSettings(multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int, batchWindowMs: Int, batchMaxSamples: Int, changeDetection: ChangeDetectionConfig,
+                               aggregationWindowMs: Int, aggregationStepMs: Int, payloadFormat: Int, publishMode: Int) {
+        nativeUpdateGyroscopeSettings(
+            multiplierX, multiplierY, multiplierZ, rounding, batchWindowMs, batchMaxSamples,
+            changeDetection.deadband, changeDetection.relativeDeadbandPercent, changeDetection.hysteresisPercent,
+            changeDetection.minIntervalMs, changeDetection.heartbeatMs,
+            aggregationWindowMs, aggregationStepMs, payloadFormat, publishMode
+        )
     }
 
     override fun onAccuracyChanged(sensor: Sensor?, accuracy: Int) {}
 
+    private fun updateFilters(filter: String, samplingPeriod: Int) {
+        val sampleRateHz = NativeSensorIngestion.sampleRateHz(samplingPeriod, gyroscope?.minDelay ?: 0)
+        if (!nativeUpdateGyroscopeFilters(filter, sampleRateHz)) {
+            Log.w(tag, "Invalid filter chain \"$filter\" at $sampleRateHz Hz, filtering disabled")
+        }
+    }
+
     override fun onSensorChanged(event: SensorEvent?) {
         if (event?.sensor?.type == Sensor.TYPE_GYROSCOPE) {
-            val (x, y, z) = event.values
-
             // For the UI - only emit if there are active collectors
             if (_gyroscopeData.subscriptionCount.value > 0) {
+                val (x, y, z) = event.values
                 _gyroscopeData.tryEmit(Triple(x, y, z))
             }
 
-            // Process data in C++
-            nativeProcessGyroscopeData(x, y, z)
+            // Process data in C++, several events per call at high sampling rates
+            eventBuffer.add(event)
         }
     }
 
@@ -198,6 +248,11 @@ class GyroscopeService : Service(), SensorEventListener {
         val isGyroscopeEnabled = _isGyroscopeEnabled.asStateFlow()
     }
 
-    private external fun nativeUpdateGyroscopeSettings(multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int)
-    private external fun nativeProcessGyroscopeData(x: Float, y: Float, z: Float)
+    private external fun nativeUpdateGyroscopeSettings(
+        multiplierX: Float, multiplierY: Float, multiplierZ: Float, rounding: Int, batchWindowMs: Int, batchMaxSamples: Int,
+        deadband: Float, relativeDeadbandPercent: Float, hysteresisPercent: Float, minIntervalMs: Int, heartbeatMs: Int,
+        aggregationWindowMs: Int, aggregationStepMs: Int, payloadFormat: Int, publishMode: Int
+    )
+    private external fun nativeUpdateGyroscopeFilters(spec: String, sampleRateHz: Float): Boolean
+    private external fun nativeProcessGyroscopeDataBatch(buffer: ByteBuffer, count: Int)
 }
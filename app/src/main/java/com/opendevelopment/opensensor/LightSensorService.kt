@@ -36,12 +36,22 @@ class LightSensorService : Service(), SensorEventListener {
     private lateinit var sensorManager: SensorManager
     private var lightSensor: Sensor? = null
     private var isStarted = false
+    private var isNativeIngestion = false
     private lateinit var settingsDataStore: SettingsDataStore
 
     private data class LightSensorConfig(
         val isEnabled: Boolean,
         val rounding: Int,
-        val samplingPeriod: Int
+        val samplingPeriod: Int,
+        val batchWindowMs: Int,
+        val batchMaxSamples: Int,
+        val changeDetection: ChangeDetectionConfig,
+        val aggregationWindowMs: Int,
+        val aggregationStepMs: Int,
+        val payloadFormat: Int,
+        val publishMode: Int,
+        val filter: String,
+        val nativeIngestion: Boolean
     )
 
     override fun onCreate() {
@@ -61,7 +71,16 @@ class LightSensorService : Service(), SensorEventListener {
                     LightSensorConfig(
                         s.isLightSensorEnabled,
                         s.lightSensorRounding.toIntOrNull() ?: 2,
-                        s.lightSensorSamplingPeriod
+                        s.lightSensorSamplingPeriod,
+                        s.batchWindowMs.toIntOrNull() ?: 0,
+                        s.batchMaxSamples.toIntOrNull() ?: 0,
+                        ChangeDetectionConfig.from(s, s.lightSensorDeadband),
+                        s.aggregationWindowMs.toIntOrNull() ?: 0,
+                        s.aggregationStepMs.toIntOrNull() ?: 0,
+                        s.lightSensorPayloadFormat,
+                        s.lightSensorPublishMode,
+                        s.lightSensorFilter,
+                        s.isNativeSensorIngestionEnabled
                     )
                 }
                 .distinctUntilChanged()
@@ -71,8 +90,10 @@ class LightSensorService : Service(), SensorEventListener {
                         return@collect
                     }
 
-                    updateSettings(config.rounding)
-                    start(config.samplingPeriod)
+                    updateSettings(config.rounding, config.batchWindowMs, config.batchMaxSamples, config.changeDetection,
+                        config.aggregationWindowMs, config.aggregationStepMs, config.payloadFormat, config.publishMode)
+                    updateFilters(config.filter, config.samplingPeriod)
+                    start(config.samplingPeriod, config.nativeIngestion)
                     _isLightSensorEnabled.value = isStarted
 
                     if (!isStarted) {
@@ -89,13 +110,17 @@ class LightSensorService : Service(), SensorEventListener {
         return START_STICKY
     }
 
-    private fun start(samplingPeriod: Int) {
+    private fun start(samplingPeriod: Int, nativeIngestion: Boolean) {
         Log.d(tag, "Starting light sensor listener with sampling period: $samplingPeriod")
         if (isStarted) {
-            sensorManager.unregisterListener(this)
+            unregister()
         }
         if (lightSensor != null) {
-            sensorManager.registerListener(this, lightSensor, samplingPeriod)
+            isNativeIngestion = nativeIngestion &&
+                NativeSensorIngestion.enable(this, NativeSensorIngestion.LIGHT, samplingPeriod, lightSensor?.minDelay ?: 0)
+            if (!isNativeIngestion) {
+                sensorManager.registerListener(this, lightSensor, samplingPeriod)
+            }
             isStarted = true
         } else {
             Log.e(tag, "Light sensor not available on this device.")
@@ -107,13 +132,35 @@ class LightSensorService : Service(), SensorEventListener {
     private fun stop() {
         if (isStarted) {
             Log.d(tag, "Stopping light sensor listener.")
-            sensorManager.unregisterListener(this)
+            unregister()
             isStarted = false
         }
     }
 
-    private fun updateSettings(rounding: Int) {
-        nativeUpdateLightSensorSettings(rounding)
+    private fun unregister() {
+        if (isNativeIngestion) {
+            NativeSensorIngestion.disable(NativeSensorIngestion.LIGHT)
+            isNativeIngestion = false
+        } else {
+            sensorManager.unregisterListener(this)
+        }
+    }
+
+    private fun updateSettings(rounding: Int, batchWindowMs: Int, batchMaxSamples: Int, changeDetection: ChangeDetectionConfig,
+                               aggregationWindowMs: Int, aggregationStepMs: Int, payloadFormat: Int, publishMode: Int) {
+        nativeUpdateLightSensorSettings(
+            rounding, batchWindowMs, batchMaxSamples,
+            changeDetection.deadband, changeDetection.relativeDeadbandPercent, changeDetection.hysteresisPercent,
+            changeDetection.minIntervalMs, changeDetection.heartbeatMs,
+            aggregationWindowMs, aggregationStepMs, payloadFormat, publishMode
+        )
+    }
+
+    private fun updateFilters(filter: String, samplingPeriod: Int) {
+        val sampleRateHz = NativeSensorIngestion.sampleRateHz(samplingPeriod, lightSensor?.minDelay ?: 0)
+        if (!nativeUpdateLightSensorFilters(filter, sampleRateHz)) {
+            Log.w(tag, "Invalid filter chain \"$filter\" at $sampleRateHz Hz, filtering disabled")
+        }
     }
 
     override fun onSensorChanged(event: SensorEvent?) {
@@ -126,7 +173,7 @@ class LightSensorService : Service(), SensorEventListener {
             }
 
             // Process data in C++
-            nativeProcessLightSensorData(value)
+            nativeProcessLightSensorData(value, event.timestamp)
         }
     }
 
@@ -190,6 +237,11 @@ class LightSensorService : Service(), SensorEventListener {
         val isLightSensorEnabled = _isLightSensorEnabled.asStateFlow()
     }
 
-    private external fun nativeUpdateLightSensorSettings(rounding: Int)
-    private external fun nativeProcessLightSensorData(value: Float)
+    private external fun nativeUpdateLightSensorSettings(
+        rounding: Int, batchWindowMs: Int, batchMaxSamples: Int,
+        deadband: Float, relativeDeadbandPercent: Float, hysteresisPercent: Float, minIntervalMs: Int, heartbeatMs: Int,
+        aggregationWindowMs: Int, aggregationStepMs: Int, payloadFormat: Int, publishMode: Int
+    )
+    private external fun nativeUpdateLightSensorFilters(spec: String, sampleRateHz: Float): Boolean
+    private external fun nativeProcessLightSensorData(value: Float, timestampNs: Long)
 }
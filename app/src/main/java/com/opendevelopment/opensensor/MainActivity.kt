@@ -95,12 +95,28 @@ import androidx.navigation.compose.currentBackStackEntryAsState
 import androidx.navigation.compose.rememberNavController
 import com.opendevelopment.opensensor.ui.theme.OpendevelopmentOpensensorTheme
 import com.opendevelopment.opensensor.ui.theme.IconToast
+import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.delay
 import kotlinx.coroutines.isActive
 import kotlinx.coroutines.launch
-import java.io.File
+import kotlinx.coroutines.withContext
 
 private const val TAG = "MainActivity"
+// Lines kept on the MQTT screen; the log file itself holds 64 KB
+private const val MAX_LOG_LINES = 1000
+
+private const val FILTER_DESCRIPTION = "Smooth the values before they are rounded, as a comma-separated chain of " +
+    "ema:<factor>, lowpass:<Hz>[:<Q>], highpass:<Hz>[:<Q>], bandpass:<Hz>[:<Q>] and median:<samples>. " +
+    "Frequencies are relative to the sampling period."
+
+private const val PAYLOAD_FORMAT_DESCRIPTION = "Encoding of the published samples. CBOR and packed little-endian floats " +
+    "are smaller than JSON, and a compressed series shrinks batches further by storing only the change from " +
+    "one sample to the next. Each message names its format in the MQTT content type. Home Assistant only reads JSON, " +
+    "and spectra and aggregated statistics are always JSON."
+
+private const val PUBLISH_MODE_DESCRIPTION = "Whether every sample is sent, or only the latest one when the connection " +
+    "cannot keep up. With the latest value only, samples waiting to be sent are replaced by newer ones and none are " +
+    "stored while offline, which suits readings such as light or temperature. Batches are always sent whole."
 
 class MainActivity : ComponentActivity() {
 
@@ -417,17 +433,24 @@ fun AppNavigation(settingsViewModel: SettingsViewModel) {
 fun MqttScreen(settingsViewModel: SettingsViewModel) {
     val context = LocalContext.current
     val settings by settingsViewModel.settings.collectAsState()
+    // Newest first
     var logs by remember { mutableStateOf(listOf<String>()) }
+    var metrics by remember { mutableStateOf("") }
+    var tracing by remember { mutableStateOf(NativeTrace.running) }
+    var traceMessage by remember { mutableStateOf("") }
+    val scope = rememberCoroutineScope()
 
     LaunchedEffect(Unit) {
-        val logFile = File(context.filesDir, "mqtt_log.txt")
+        var offset = 0L
         while (isActive) {
-            if (logFile.exists()) {
-                val lines = logFile.readLines().reversed()
-                if (lines != logs) {
-                    logs = lines
-                }
+            val chunk = withContext(Dispatchers.IO) { MqttLog.readSince(context, offset) }
+            if (chunk.restarted) {
+                logs = chunk.lines.asReversed().take(MAX_LOG_LINES)
+            } else if (chunk.lines.isNotEmpty()) {
+                logs = (chunk.lines.asReversed() + logs).take(MAX_LOG_LINES)
             }
+            offset = chunk.nextOffset
+            metrics = withContext(Dispatchers.Default) { NativeMetrics.summary() }
             delay(1000) // Poll every second
         }
     }
@@ -440,6 +463,29 @@ fun MqttScreen(settingsViewModel: SettingsViewModel) {
     ) {
         val status = if (settings.isMqttEnabled) "ENABLED" else "DISABLED"
         Text("MQTT Status: $status")
+        if (metrics.isNotEmpty()) {
+            Spacer(modifier = Modifier.height(8.dp))
+            Text(metrics, style = MaterialTheme.typography.bodySmall)
+        }
+        Spacer(modifier = Modifier.height(8.dp))
+        Button(onClick = {
+            if (tracing) {
+                tracing = false
+                scope.launch {
+                    val file = withContext(Dispatchers.IO) { NativeTrace.stop(context) }
+                    traceMessage = file?.let { "Trace saved to ${it.absolutePath}" } ?: "Could not save the trace"
+                }
+            } else {
+                NativeTrace.start()
+                tracing = true
+                traceMessage = "Tracing 1 in ${NativeTrace.SAMPLE_EVERY} samples"
+            }
+        }) {
+            Text(if (tracing) "Stop and save trace" else "Start trace")
+        }
+        if (traceMessage.isNotEmpty()) {
+            Text(traceMessage, style = MaterialTheme.typography.bodySmall)
+        }
         Spacer(modifier = Modifier.height(16.dp))
 
         Text(
@@ -704,6 +750,39 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
         SensorManager.SENSOR_DELAY_NORMAL to "Normal"
     )
 
+    val queueOverflowOptions = mapOf(
+        0 to "Drop newest",
+        1 to "Drop oldest"
+    )
+
+    // Values match MqttClientWrapper::window_policy
+    val windowPolicyOptions = mapOf(
+        0 to "Reject",
+        1 to "Hold, drop oldest",
+        2 to "Hold, keep latest per topic"
+    )
+
+    // Values match FusionAlgorithm in orientation_filter.h
+    val orientationAlgorithmOptions = mapOf(
+        0 to "Madgwick",
+        1 to "Mahony"
+    )
+
+    // Values match PayloadEncoding in binary_payload.h
+    val payloadFormatOptions = mapOf(
+        0 to "JSON",
+        1 to "CBOR",
+        2 to "Packed floats",
+        3 to "Packed floats with timestamp",
+        4 to "Compressed series"
+    )
+
+    // Values match MqttClientWrapper::feed_mode
+    val publishModeOptions = mapOf(
+        0 to "Every sample",
+        1 to "Latest value only"
+    )
+
     openDialog?.let { key ->
         when (key) {
             "broker" -> EditTextPreferenceDialog(
@@ -762,6 +841,51 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
                 onSave = { settingsViewModel.updateAccelerometerRounding(it); onDismiss() },
                 keyboardType = KeyboardType.Number
             )
+            "accelerometerDeadband" -> EditTextPreferenceDialog(
+                title = "Deadband (m/s²)",
+                initialValue = settings.accelerometerDeadband,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateAccelerometerDeadband(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal,
+                hint = "0 publishes every change"
+            )
+            "accelerometerFilter" -> EditTextPreferenceDialog(
+                title = "Filters",
+                initialValue = settings.accelerometerFilter,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateAccelerometerFilter(it); onDismiss() },
+                hint = "e.g. median:5,lowpass:2"
+            )
+            "accelerometerPayloadFormat" -> ListPreferenceDialog(
+                title = "Payload Format",
+                options = payloadFormatOptions,
+                currentValue = settings.accelerometerPayloadFormat,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateAccelerometerPayloadFormat(it); onDismiss() }
+            )
+            "accelerometerPublishMode" -> ListPreferenceDialog(
+                title = "Publish Mode",
+                options = publishModeOptions,
+                currentValue = settings.accelerometerPublishMode,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateAccelerometerPublishMode(it); onDismiss() }
+            )
+            "accelerometerSpectrumBlockSize" -> EditTextPreferenceDialog(
+                title = "Spectrum Block Size (Samples)",
+                initialValue = settings.accelerometerSpectrumBlockSize,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateAccelerometerSpectrumBlockSize(it); onDismiss() },
+                keyboardType = KeyboardType.Number,
+                hint = "Power of two from 16 to 8192, 0 disables"
+            )
+            "accelerometerSpectrumBands" -> EditTextPreferenceDialog(
+                title = "Spectrum Bands",
+                initialValue = settings.accelerometerSpectrumBands,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateAccelerometerSpectrumBands(it); onDismiss() },
+                keyboardType = KeyboardType.Number,
+                hint = "1 to 16"
+            )
             "gyroscopeTopic" -> EditTextPreferenceDialog(
                 title = "Gyroscope Topic",
                 initialValue = settings.gyroscopeTopic,
@@ -797,6 +921,35 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
                 onSave = { settingsViewModel.updateGyroscopeRounding(it); onDismiss() },
                 keyboardType = KeyboardType.Number
             )
+            "gyroscopeDeadband" -> EditTextPreferenceDialog(
+                title = "Deadband (rad/s)",
+                initialValue = settings.gyroscopeDeadband,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateGyroscopeDeadband(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal,
+                hint = "0 publishes every change"
+            )
+            "gyroscopeFilter" -> EditTextPreferenceDialog(
+                title = "Filters",
+                initialValue = settings.gyroscopeFilter,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateGyroscopeFilter(it); onDismiss() },
+                hint = "e.g. median:5,lowpass:2"
+            )
+            "gyroscopePayloadFormat" -> ListPreferenceDialog(
+                title = "Payload Format",
+                options = payloadFormatOptions,
+                currentValue = settings.gyroscopePayloadFormat,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateGyroscopePayloadFormat(it); onDismiss() }
+            )
+            "gyroscopePublishMode" -> ListPreferenceDialog(
+                title = "Publish Mode",
+                options = publishModeOptions,
+                currentValue = settings.gyroscopePublishMode,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateGyroscopePublishMode(it); onDismiss() }
+            )
             "gravityTopic" -> EditTextPreferenceDialog(
                 title = "Gravity Topic",
                 initialValue = settings.gravityTopic,
@@ -832,6 +985,35 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
                 onSave = { settingsViewModel.updateGravityRounding(it); onDismiss() },
                 keyboardType = KeyboardType.Number
             )
+            "gravityDeadband" -> EditTextPreferenceDialog(
+                title = "Deadband (m/s²)",
+                initialValue = settings.gravityDeadband,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateGravityDeadband(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal,
+                hint = "0 publishes every change"
+            )
+            "gravityFilter" -> EditTextPreferenceDialog(
+                title = "Filters",
+                initialValue = settings.gravityFilter,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateGravityFilter(it); onDismiss() },
+                hint = "e.g. median:5,lowpass:2"
+            )
+            "gravityPayloadFormat" -> ListPreferenceDialog(
+                title = "Payload Format",
+                options = payloadFormatOptions,
+                currentValue = settings.gravityPayloadFormat,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateGravityPayloadFormat(it); onDismiss() }
+            )
+            "gravityPublishMode" -> ListPreferenceDialog(
+                title = "Publish Mode",
+                options = publishModeOptions,
+                currentValue = settings.gravityPublishMode,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateGravityPublishMode(it); onDismiss() }
+            )
             "lightSensorTopic" -> EditTextPreferenceDialog(
                 title = "Light Sensor Topic",
                 initialValue = settings.lightSensorTopic,
@@ -846,6 +1028,35 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
                 onSave = { settingsViewModel.updateLightSensorRounding(it); onDismiss() },
                 keyboardType = KeyboardType.Number
             )
+            "lightSensorDeadband" -> EditTextPreferenceDialog(
+                title = "Deadband (lx)",
+                initialValue = settings.lightSensorDeadband,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateLightSensorDeadband(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal,
+                hint = "0 publishes every change"
+            )
+            "lightSensorFilter" -> EditTextPreferenceDialog(
+                title = "Filters",
+                initialValue = settings.lightSensorFilter,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateLightSensorFilter(it); onDismiss() },
+                hint = "e.g. median:5,lowpass:2"
+            )
+            "lightSensorPayloadFormat" -> ListPreferenceDialog(
+                title = "Payload Format",
+                options = payloadFormatOptions,
+                currentValue = settings.lightSensorPayloadFormat,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateLightSensorPayloadFormat(it); onDismiss() }
+            )
+            "lightSensorPublishMode" -> ListPreferenceDialog(
+                title = "Publish Mode",
+                options = publishModeOptions,
+                currentValue = settings.lightSensorPublishMode,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateLightSensorPublishMode(it); onDismiss() }
+            )
             "temperatureSensorTopic" -> EditTextPreferenceDialog(
                 title = "Temperature Sensor Topic",
                 initialValue = settings.temperatureSensorTopic,
@@ -860,6 +1071,35 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
                 onSave = { settingsViewModel.updateTemperatureSensorRounding(it); onDismiss() },
                 keyboardType = KeyboardType.Number
             )
+            "temperatureSensorDeadband" -> EditTextPreferenceDialog(
+                title = "Deadband (°C)",
+                initialValue = settings.temperatureSensorDeadband,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateTemperatureSensorDeadband(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal,
+                hint = "0 publishes every change"
+            )
+            "temperatureSensorFilter" -> EditTextPreferenceDialog(
+                title = "Filters",
+                initialValue = settings.temperatureSensorFilter,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateTemperatureSensorFilter(it); onDismiss() },
+                hint = "e.g. median:5,lowpass:2"
+            )
+            "temperatureSensorPayloadFormat" -> ListPreferenceDialog(
+                title = "Payload Format",
+                options = payloadFormatOptions,
+                currentValue = settings.temperatureSensorPayloadFormat,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateTemperatureSensorPayloadFormat(it); onDismiss() }
+            )
+            "temperatureSensorPublishMode" -> ListPreferenceDialog(
+                title = "Publish Mode",
+                options = publishModeOptions,
+                currentValue = settings.temperatureSensorPublishMode,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateTemperatureSensorPublishMode(it); onDismiss() }
+            )
             "accelerometerSamplingPeriod" -> ListPreferenceDialog(
                 title = "Accelerometer Sampling Period",
                 options = samplingPeriodOptions,
@@ -895,6 +1135,173 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
                 onDismiss = onDismiss,
                 onSave = { settingsViewModel.updateTemperatureSensorSamplingPeriod(it); onDismiss() }
             )
+            "relativeDeadbandPercent" -> EditTextPreferenceDialog(
+                title = "Relative Deadband (%)",
+                initialValue = settings.relativeDeadbandPercent,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateRelativeDeadbandPercent(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal,
+                hint = "0 disables the relative deadband"
+            )
+            "hysteresisPercent" -> EditTextPreferenceDialog(
+                title = "Hysteresis (% of Deadband)",
+                initialValue = settings.hysteresisPercent,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateHysteresisPercent(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal
+            )
+            "minPublishIntervalMs" -> EditTextPreferenceDialog(
+                title = "Minimum Interval (ms)",
+                initialValue = settings.minPublishIntervalMs,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateMinPublishIntervalMs(it); onDismiss() },
+                keyboardType = KeyboardType.Number,
+                hint = "0 disables the rate limit"
+            )
+            "heartbeatSeconds" -> EditTextPreferenceDialog(
+                title = "Heartbeat (s)",
+                initialValue = settings.heartbeatSeconds,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateHeartbeatSeconds(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal,
+                hint = "0 disables the heartbeat"
+            )
+            "aggregationWindowMs" -> EditTextPreferenceDialog(
+                title = "Aggregation Window (ms)",
+                initialValue = settings.aggregationWindowMs,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateAggregationWindowMs(it); onDismiss() },
+                keyboardType = KeyboardType.Number,
+                hint = "0 publishes raw values"
+            )
+            "aggregationStepMs" -> EditTextPreferenceDialog(
+                title = "Sliding Step (ms)",
+                initialValue = settings.aggregationStepMs,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateAggregationStepMs(it); onDismiss() },
+                keyboardType = KeyboardType.Number,
+                hint = "0 uses tumbling windows"
+            )
+            "batchWindowMs" -> EditTextPreferenceDialog(
+                title = "Batch Window (ms)",
+                initialValue = settings.batchWindowMs,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateBatchWindowMs(it); onDismiss() },
+                keyboardType = KeyboardType.Number,
+                hint = "0 disables time-based batching"
+            )
+            "batchMaxSamples" -> EditTextPreferenceDialog(
+                title = "Batch Size (Samples)",
+                initialValue = settings.batchMaxSamples,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateBatchMaxSamples(it); onDismiss() },
+                keyboardType = KeyboardType.Number,
+                hint = "0 disables count-based batching"
+            )
+            "queueDepth" -> EditTextPreferenceDialog(
+                title = "Queue Depth (Samples)",
+                initialValue = settings.queueDepth,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateQueueDepth(it); onDismiss() },
+                keyboardType = KeyboardType.Number
+            )
+            "queueOverflowPolicy" -> ListPreferenceDialog(
+                title = "When the Queue Is Full",
+                options = queueOverflowOptions,
+                currentValue = settings.queueOverflowPolicy,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateQueueOverflowPolicy(it); onDismiss() }
+            )
+            "offlineStoreKb" -> EditTextPreferenceDialog(
+                title = "Offline Buffer (KB)",
+                initialValue = settings.offlineStoreKb,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateOfflineStoreKb(it); onDismiss() },
+                keyboardType = KeyboardType.Number,
+                hint = "0 disables the offline buffer"
+            )
+            "offlineDrainRate" -> EditTextPreferenceDialog(
+                title = "Replay Rate (Messages/s)",
+                initialValue = settings.offlineDrainRate,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateOfflineDrainRate(it); onDismiss() },
+                keyboardType = KeyboardType.Number
+            )
+            "qos0Window" -> EditTextPreferenceDialog(
+                title = "QoS 0 Window (Messages)",
+                initialValue = settings.qos0Window,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateQos0Window(it); onDismiss() },
+                keyboardType = KeyboardType.Number
+            )
+            "qos1Window" -> EditTextPreferenceDialog(
+                title = "QoS 1 Window (Messages)",
+                initialValue = settings.qos1Window,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateQos1Window(it); onDismiss() },
+                keyboardType = KeyboardType.Number
+            )
+            "windowPolicy" -> ListPreferenceDialog(
+                title = "When the Window Is Full",
+                options = windowPolicyOptions,
+                currentValue = settings.windowPolicy,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateWindowPolicy(it); onDismiss() }
+            )
+            "writeCoalescingMs" -> EditTextPreferenceDialog(
+                title = "Write Coalescing Window (ms)",
+                initialValue = settings.writeCoalescingMs,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateWriteCoalescingMs(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal
+            )
+            "writeCoalescingBytes" -> EditTextPreferenceDialog(
+                title = "Write Coalescing Limit (Bytes)",
+                initialValue = settings.writeCoalescingBytes,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateWriteCoalescingBytes(it); onDismiss() },
+                keyboardType = KeyboardType.Number
+            )
+            "diagnosticsTopic" -> EditTextPreferenceDialog(
+                title = "Diagnostics Topic",
+                initialValue = settings.diagnosticsTopic,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateDiagnosticsTopic(it); onDismiss() }
+            )
+            "diagnosticsIntervalS" -> EditTextPreferenceDialog(
+                title = "Diagnostics Interval (s)",
+                initialValue = settings.diagnosticsIntervalS,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateDiagnosticsIntervalS(it); onDismiss() },
+                keyboardType = KeyboardType.Number
+            )
+            "orientationTopic" -> EditTextPreferenceDialog(
+                title = "Orientation Topic",
+                initialValue = settings.orientationTopic,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateOrientationTopic(it); onDismiss() }
+            )
+            "orientationRateHz" -> EditTextPreferenceDialog(
+                title = "Orientation Rate (Hz)",
+                initialValue = settings.orientationRateHz,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateOrientationRateHz(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal
+            )
+            "orientationAlgorithm" -> ListPreferenceDialog(
+                title = "Fusion Filter",
+                options = orientationAlgorithmOptions,
+                currentValue = settings.orientationAlgorithm,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateOrientationAlgorithm(it); onDismiss() }
+            )
+            "orientationGain" -> EditTextPreferenceDialog(
+                title = "Filter Gain",
+                initialValue = settings.orientationGain,
+                onDismiss = onDismiss,
+                onSave = { settingsViewModel.updateOrientationGain(it); onDismiss() },
+                keyboardType = KeyboardType.Decimal
+            )
             "haDiscoveryPrefix" -> EditTextPreferenceDialog(
                 title = "HA Discovery Prefix",
                 initialValue = settings.haDiscoveryPrefix,
@@ -973,6 +1380,36 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
             description = "Precision of the published sensor values.",
             summary = settings.accelerometerRounding
         ) { launchDialog("accelerometerRounding") }
+        EditTextPreference(
+            title = "Deadband (m/s²)",
+            description = "Only publish when a value has moved by more than this since it was last published.",
+            summary = settings.accelerometerDeadband.let { if ((it.toFloatOrNull() ?: 0f) > 0f) "$it m/s²" else "Disabled" }
+        ) { launchDialog("accelerometerDeadband") }
+        EditTextPreference(
+            title = "Filters",
+            description = FILTER_DESCRIPTION,
+            summary = settings.accelerometerFilter.ifBlank { "None" }
+        ) { launchDialog("accelerometerFilter") }
+        ListPreference(
+            title = "Payload Format",
+            description = PAYLOAD_FORMAT_DESCRIPTION,
+            summary = payloadFormatOptions[settings.accelerometerPayloadFormat] ?: "JSON"
+        ) { launchDialog("accelerometerPayloadFormat") }
+        ListPreference(
+            title = "Publish Mode",
+            description = PUBLISH_MODE_DESCRIPTION,
+            summary = publishModeOptions[settings.accelerometerPublishMode] ?: "Every sample"
+        ) { launchDialog("accelerometerPublishMode") }
+        EditTextPreference(
+            title = "Spectrum Block Size (Samples)",
+            description = "Publish the vibration spectrum of each block of this many samples instead of raw values: the strongest frequencies, the energy per band and the peak amplitude. Takes precedence over aggregation.",
+            summary = settings.accelerometerSpectrumBlockSize.let { if ((it.toIntOrNull() ?: 0) > 0) "$it samples" else "Disabled" }
+        ) { launchDialog("accelerometerSpectrumBlockSize") }
+        EditTextPreference(
+            title = "Spectrum Bands",
+            description = "Number of equal-width frequency bands the spectrum energy is reported in.",
+            summary = settings.accelerometerSpectrumBands
+        ) { launchDialog("accelerometerSpectrumBands") }
         ListPreference(
             title = "Sampling Period",
             description = "Determines how frequently sensor data is read and published.",
@@ -1007,6 +1444,26 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
             description = "Precision of the published gyroscope values.",
             summary = settings.gyroscopeRounding
         ) { launchDialog("gyroscopeRounding") }
+        EditTextPreference(
+            title = "Deadband (rad/s)",
+            description = "Only publish when a value has moved by more than this since it was last published.",
+            summary = settings.gyroscopeDeadband.let { if ((it.toFloatOrNull() ?: 0f) > 0f) "$it rad/s" else "Disabled" }
+        ) { launchDialog("gyroscopeDeadband") }
+        EditTextPreference(
+            title = "Filters",
+            description = FILTER_DESCRIPTION,
+            summary = settings.gyroscopeFilter.ifBlank { "None" }
+        ) { launchDialog("gyroscopeFilter") }
+        ListPreference(
+            title = "Payload Format",
+            description = PAYLOAD_FORMAT_DESCRIPTION,
+            summary = payloadFormatOptions[settings.gyroscopePayloadFormat] ?: "JSON"
+        ) { launchDialog("gyroscopePayloadFormat") }
+        ListPreference(
+            title = "Publish Mode",
+            description = PUBLISH_MODE_DESCRIPTION,
+            summary = publishModeOptions[settings.gyroscopePublishMode] ?: "Every sample"
+        ) { launchDialog("gyroscopePublishMode") }
         ListPreference(
             title = "Sampling Period",
             description = "Determines how frequently gyroscope data is read.",
@@ -1041,6 +1498,26 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
             description = "Precision of the published gravity values.",
             summary = settings.gravityRounding
         ) { launchDialog("gravityRounding") }
+        EditTextPreference(
+            title = "Deadband (m/s²)",
+            description = "Only publish when a value has moved by more than this since it was last published.",
+            summary = settings.gravityDeadband.let { if ((it.toFloatOrNull() ?: 0f) > 0f) "$it m/s²" else "Disabled" }
+        ) { launchDialog("gravityDeadband") }
+        EditTextPreference(
+            title = "Filters",
+            description = FILTER_DESCRIPTION,
+            summary = settings.gravityFilter.ifBlank { "None" }
+        ) { launchDialog("gravityFilter") }
+        ListPreference(
+            title = "Payload Format",
+            description = PAYLOAD_FORMAT_DESCRIPTION,
+            summary = payloadFormatOptions[settings.gravityPayloadFormat] ?: "JSON"
+        ) { launchDialog("gravityPayloadFormat") }
+        ListPreference(
+            title = "Publish Mode",
+            description = PUBLISH_MODE_DESCRIPTION,
+            summary = publishModeOptions[settings.gravityPublishMode] ?: "Every sample"
+        ) { launchDialog("gravityPublishMode") }
         ListPreference(
             title = "Sampling Period",
             description = "Determines how frequently gravity data is read.",
@@ -1060,6 +1537,26 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
             description = "Precision of the published light intensity values.",
             summary = settings.lightSensorRounding
         ) { launchDialog("lightSensorRounding") }
+        EditTextPreference(
+            title = "Deadband (lx)",
+            description = "Only publish when a value has moved by more than this since it was last published.",
+            summary = settings.lightSensorDeadband.let { if ((it.toFloatOrNull() ?: 0f) > 0f) "$it lx" else "Disabled" }
+        ) { launchDialog("lightSensorDeadband") }
+        EditTextPreference(
+            title = "Filters",
+            description = FILTER_DESCRIPTION,
+            summary = settings.lightSensorFilter.ifBlank { "None" }
+        ) { launchDialog("lightSensorFilter") }
+        ListPreference(
+            title = "Payload Format",
+            description = PAYLOAD_FORMAT_DESCRIPTION,
+            summary = payloadFormatOptions[settings.lightSensorPayloadFormat] ?: "JSON"
+        ) { launchDialog("lightSensorPayloadFormat") }
+        ListPreference(
+            title = "Publish Mode",
+            description = PUBLISH_MODE_DESCRIPTION,
+            summary = publishModeOptions[settings.lightSensorPublishMode] ?: "Every sample"
+        ) { launchDialog("lightSensorPublishMode") }
         ListPreference(
             title = "Sampling Period",
             description = "Determines how frequently light data is read.",
@@ -1079,6 +1576,26 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
             description = "Precision of the published temperature values.",
             summary = settings.temperatureSensorRounding
         ) { launchDialog("temperatureSensorRounding") }
+        EditTextPreference(
+            title = "Deadband (°C)",
+            description = "Only publish when a value has moved by more than this since it was last published.",
+            summary = settings.temperatureSensorDeadband.let { if ((it.toFloatOrNull() ?: 0f) > 0f) "$it °C" else "Disabled" }
+        ) { launchDialog("temperatureSensorDeadband") }
+        EditTextPreference(
+            title = "Filters",
+            description = FILTER_DESCRIPTION,
+            summary = settings.temperatureSensorFilter.ifBlank { "None" }
+        ) { launchDialog("temperatureSensorFilter") }
+        ListPreference(
+            title = "Payload Format",
+            description = PAYLOAD_FORMAT_DESCRIPTION,
+            summary = payloadFormatOptions[settings.temperatureSensorPayloadFormat] ?: "JSON"
+        ) { launchDialog("temperatureSensorPayloadFormat") }
+        ListPreference(
+            title = "Publish Mode",
+            description = PUBLISH_MODE_DESCRIPTION,
+            summary = publishModeOptions[settings.temperatureSensorPublishMode] ?: "Every sample"
+        ) { launchDialog("temperatureSensorPublishMode") }
         ListPreference(
             title = "Sampling Period",
             description = "Determines how frequently temperature data is read.",
@@ -1087,6 +1604,159 @@ fun SettingsScreen(settingsViewModel: SettingsViewModel) {
 
         HorizontalDivider(modifier = Modifier.padding(vertical = 8.dp))
 
+        SettingsCategory(title = "Change Detection")
+        EditTextPreference(
+            title = "Relative Deadband (%)",
+            description = "Only publish when a value has moved by more than this percentage of its last published value. The larger of this and the sensor's deadband applies.",
+            summary = settings.relativeDeadbandPercent.let { if ((it.toFloatOrNull() ?: 0f) > 0f) "$it %" else "Disabled" }
+        ) { launchDialog("relativeDeadbandPercent") }
+        EditTextPreference(
+            title = "Hysteresis (% of Deadband)",
+            description = "Extra movement needed when a value turns back, so noise around a threshold does not publish on every wiggle.",
+            summary = settings.hysteresisPercent.let { if ((it.toFloatOrNull() ?: 0f) > 0f) "$it %" else "Disabled" }
+        ) { launchDialog("hysteresisPercent") }
+        EditTextPreference(
+            title = "Minimum Interval (ms)",
+            description = "Shortest time between two messages of the same sensor. Changes in between are held back.",
+            summary = settings.minPublishIntervalMs.let { if ((it.toIntOrNull() ?: 0) > 0) "$it ms" else "Disabled" }
+        ) { launchDialog("minPublishIntervalMs") }
+        EditTextPreference(
+            title = "Heartbeat (s)",
+            description = "Republish the current value when a sensor has been silent this long, even if it has not changed.",
+            summary = settings.heartbeatSeconds.let { if ((it.toFloatOrNull() ?: 0f) > 0f) "$it s" else "Disabled" }
+        ) { launchDialog("heartbeatSeconds") }
+
+        HorizontalDivider(modifier = Modifier.padding(vertical = 8.dp))
+
+        SettingsCategory(title = "Aggregation")
+        EditTextPreference(
+            title = "Aggregation Window (ms)",
+            description = "Publish the mean, min, max, RMS and standard deviation of each value over this window instead of raw values. Replaces change detection and batching.",
+            summary = settings.aggregationWindowMs.let { if ((it.toIntOrNull() ?: 0) > 0) "$it ms" else "Disabled" }
+        ) { launchDialog("aggregationWindowMs") }
+        EditTextPreference(
+            title = "Sliding Step (ms)",
+            description = "Publish a window this often, so consecutive windows overlap. 0 publishes each window once, without overlap.",
+            summary = settings.aggregationStepMs.let { if ((it.toIntOrNull() ?: 0) > 0) "$it ms" else "Tumbling windows" }
+        ) { launchDialog("aggregationStepMs") }
+
+        HorizontalDivider(modifier = Modifier.padding(vertical = 8.dp))
+
+        SettingsCategory(title = "Batching")
+        EditTextPreference(
+            title = "Batch Window (ms)",
+            description = "Collect samples for this long and publish them as one timestamped array ({\"samples\":[...]}). 0 disables time-based batching.",
+            summary = settings.batchWindowMs.let { if ((it.toIntOrNull() ?: 0) > 0) "$it ms" else "Disabled" }
+        ) { launchDialog("batchWindowMs") }
+        EditTextPreference(
+            title = "Batch Size (Samples)",
+            description = "Publish a batch once it holds this many samples. 0 disables count-based batching.",
+            summary = settings.batchMaxSamples.let { if ((it.toIntOrNull() ?: 0) > 0) it else "Disabled" }
+        ) { launchDialog("batchMaxSamples") }
+
+        HorizontalDivider(modifier = Modifier.padding(vertical = 8.dp))
+
+        SettingsCategory(title = "Publish Queue")
+        EditTextPreference(
+            title = "Queue Depth (Samples)",
+            description = "Samples each sensor may have waiting for the MQTT connection. Applied when the MQTT service starts.",
+            summary = settings.queueDepth
+        ) { launchDialog("queueDepth") }
+        ListPreference(
+            title = "When the Queue Is Full",
+            description = "Which samples to drop when the connection cannot keep up. Drops are reported in the MQTT log.",
+            summary = queueOverflowOptions[settings.queueOverflowPolicy] ?: "Drop newest"
+        ) { launchDialog("queueOverflowPolicy") }
+        EditTextPreference(
+            title = "Offline Buffer (KB)",
+            description = "Messages published while the broker is unreachable are kept in a file of this size, even across restarts, and sent once the connection is back. The oldest are discarded when it is full. Applied when the MQTT service starts.",
+            summary = settings.offlineStoreKb.let { if ((it.toIntOrNull() ?: 0) > 0) "$it KB" else "Disabled" }
+        ) { launchDialog("offlineStoreKb") }
+        EditTextPreference(
+            title = "Replay Rate (Messages/s)",
+            description = "How fast buffered messages are sent after reconnecting, alongside live data. Applied when the MQTT service starts.",
+            summary = settings.offlineDrainRate
+        ) { launchDialog("offlineDrainRate") }
+        EditTextPreference(
+            title = "QoS 0 Window (Messages)",
+            description = "Sensor messages that may be on their way to the broker at once. Applied when the MQTT service starts.",
+            summary = settings.qos0Window
+        ) { launchDialog("qos0Window") }
+        EditTextPreference(
+            title = "QoS 1 Window (Messages)",
+            description = "Status and discovery messages that may be waiting for the broker's acknowledgement at once. Applied when the MQTT service starts.",
+            summary = settings.qos1Window
+        ) { launchDialog("qos1Window") }
+        ListPreference(
+            title = "When the Window Is Full",
+            description = "Reject new messages, so that sensors retry with fresh values, or hold them back until the broker catches up. Losses and acknowledgement times are reported in the MQTT log. Applied when the MQTT service starts.",
+            summary = windowPolicyOptions[settings.windowPolicy] ?: "Reject"
+        ) { launchDialog("windowPolicy") }
+        EditTextPreference(
+            title = "Write Coalescing Window (ms)",
+            description = "Gather the messages published within this time into one network write, which saves battery at high sample rates. Messages are delayed by at most the window; 0 writes each one at once. Applied when the MQTT service starts.",
+            summary = settings.writeCoalescingMs
+        ) { launchDialog("writeCoalescingMs") }
+        EditTextPreference(
+            title = "Write Coalescing Limit (Bytes)",
+            description = "Write the gathered messages early once they add up to this size. Applied when the MQTT service starts.",
+            summary = settings.writeCoalescingBytes
+        ) { launchDialog("writeCoalescingBytes") }
+        EditTextPreference(
+            title = "Diagnostics Topic",
+            description = "Topic of the retained diagnostics message: counters, queue depths and latency percentiles of the native client and sensor pipeline, as JSON. Applied when the MQTT service starts.",
+            summary = settings.diagnosticsTopic
+        ) { launchDialog("diagnosticsTopic") }
+        EditTextPreference(
+            title = "Diagnostics Interval (s)",
+            description = "How often the diagnostics message is published while connected; 0 turns it off. Applied when the MQTT service starts.",
+            summary = settings.diagnosticsIntervalS
+        ) { launchDialog("diagnosticsIntervalS") }
+
+        HorizontalDivider(modifier = Modifier.padding(vertical = 8.dp))
+
+        SettingsCategory(title = "Sensor Input")
+        SwitchPreference(
+            title = "Native Sensor Ingestion",
+            summary = settings.isNativeSensorIngestionEnabled.let { if (it) "Enabled" else "Disabled" },
+            description = "Read sensors directly in native code instead of through Android's Java sensor listeners. Uses less CPU at high sampling rates, but live readings are not shown in the app.",
+            isChecked = settings.isNativeSensorIngestionEnabled,
+            onCheckedChange = { settingsViewModel.updateNativeSensorIngestionEnabled(it) }
+        )
+
+        HorizontalDivider(modifier = Modifier.padding(vertical = 8.dp))
+
+        SettingsCategory(title = "Orientation")
+        EditTextPreference(
+            title = "Orientation Rate (Hz)",
+            description = "Fuse the gyroscope and gravity sensors into the device orientation on the phone and publish it as a quaternion and roll, pitch and yaw in degrees this many times a second; 0 turns it off. The gravity sensor must be enabled, and the gyroscope too for yaw and quick turns. Applied when the MQTT service starts.",
+            summary = settings.orientationRateHz
+        ) { launchDialog("orientationRateHz") }
+        EditTextPreference(
+            title = "Orientation Topic",
+            description = "Topic of the orientation messages. Applied when the MQTT service starts.",
+            summary = settings.orientationTopic
+        ) { launchDialog("orientationTopic") }
+        ListPreference(
+            title = "Fusion Filter",
+            description = "Madgwick's gradient descent or Mahony's complementary filter. Without a magnetometer the yaw is relative to where fusion started and drifts slowly. Applied when the MQTT service starts.",
+            summary = orientationAlgorithmOptions[settings.orientationAlgorithm] ?: "Madgwick"
+        ) { launchDialog("orientationAlgorithm") }
+        EditTextPreference(
+            title = "Filter Gain",
+            description = "How strongly gravity corrects the gyroscope: Madgwick's beta or Mahony's proportional gain. Higher values follow tilt faster but pass on more vibration; 0 uses the default (0.1 and 0.5). Applied when the MQTT service starts.",
+            summary = settings.orientationGain
+        ) { launchDialog("orientationGain") }
+        SwitchPreference(
+            title = "Publish Only Orientation",
+            summary = settings.isOrientationOnlyEnabled.let { if (it) "Enabled" else "Disabled" },
+            description = "Stop publishing the accelerometer, gyroscope and gravity readings while the orientation is published, so one low-rate stream replaces three high-rate ones. Applied when the MQTT service starts.",
+            isChecked = settings.isOrientationOnlyEnabled,
+            onCheckedChange = { settingsViewModel.updateOrientationOnlyEnabled(it) }
+        )
+
+        HorizontalDivider(modifier = Modifier.padding(vertical = 8.dp))
+
         SettingsCategory(title = "Application")
         SwitchPreference(
             title = "Auto-start on boot",
@@ -0,0 +1,42 @@
+package com.opendevelopment.opensensor
+
+import android.content.Context
+import java.io.File
+
+/**
+ * The MQTT connection log, a fixed-size circular file written by the native client in the
+ * background (async_logger.h). Readers keep the offset returned by [readSince] and only get
+ * the lines appended after it.
+ */
+object MqttLog {
+    private const val FILE_NAME = "mqtt_log.ring"
+    private const val LEGACY_FILE_NAME = "mqtt_log.txt"
+
+    init {
+        System.loadLibrary("opensensor_native")
+    }
+
+    class Chunk(val lines: List<String>, val nextOffset: Long, val restarted: Boolean)
+
+    fun file(context: Context): File = File(context.filesDir, FILE_NAME)
+
+    /** Removes the plain-text log written by earlier versions. */
+    fun deleteLegacyFile(context: Context) {
+        File(context.filesDir, LEGACY_FILE_NAME).delete()
+    }
+
+    /**
+     * Lines appended since [offset], oldest first; pass 0 to get everything still in the file.
+     * [Chunk.restarted] is set if the file was recreated since [offset] was returned, in which
+     * case earlier lines no longer belong to it.
+     */
+    fun readSince(context: Context, offset: Long, maxBytes: Int = 64 * 1024): Chunk {
+        val next = LongArray(1)
+        val bytes = nativeReadSince(file(context).absolutePath, offset, maxBytes, next)
+            ?: return Chunk(emptyList(), offset, false)
+        val lines = String(bytes, Charsets.UTF_8).split('\n').filter { it.isNotEmpty() }
+        return Chunk(lines, next[0], next[0] < offset)
+    }
+
+    private external fun nativeReadSince(logFilePath: String, offset: Long, maxBytes: Int, nextOffset: LongArray): ByteArray?
+}
@@ -91,7 +91,9 @@ class MqttService : Service() {
         startForeground(notificationId, createNotification())
 
         settingsDataStore = SettingsDataStore(this)
-        val logFile = File(filesDir, "mqtt_log.txt")
+        val logFile = MqttLog.file(this)
+        MqttLog.deleteLegacyFile(this)
+        val offlineStoreFile = File(filesDir, "offline_store.bin")
 
         val filter = IntentFilter(ACTION_REQUEST_STATUS)
         ContextCompat.registerReceiver(this, statusRequestReceiver, filter, ContextCompat.RECEIVER_NOT_EXPORTED)
@@ -106,7 +108,24 @@ class MqttService : Service() {
                 initialSettings.gyroscopeTopic,
                 initialSettings.gravityTopic,
                 initialSettings.lightSensorTopic,
-                initialSettings.temperatureSensorTopic
+                initialSettings.temperatureSensorTopic,
+                initialSettings.queueDepth.toIntOrNull() ?: 256,
+                initialSettings.queueOverflowPolicy,
+                offlineStoreFile.absolutePath,
+                initialSettings.offlineStoreKb.toIntOrNull() ?: 1024,
+                initialSettings.offlineDrainRate.toIntOrNull() ?: 50,
+                initialSettings.qos0Window.toIntOrNull() ?: 128,
+                initialSettings.qos1Window.toIntOrNull() ?: 32,
+                initialSettings.windowPolicy,
+                ((initialSettings.writeCoalescingMs.toFloatOrNull() ?: 0f) * 1000).toInt(),
+                initialSettings.writeCoalescingBytes.toIntOrNull() ?: 1400,
+                initialSettings.diagnosticsTopic,
+                initialSettings.diagnosticsIntervalS.toIntOrNull() ?: 0,
+                initialSettings.orientationTopic,
+                initialSettings.orientationAlgorithm,
+                initialSettings.orientationGain.toFloatOrNull() ?: 0f,
+                initialSettings.orientationRateHz.toFloatOrNull() ?: 0f,
+                initialSettings.isOrientationOnlyEnabled
             )
 
             // Observe connection settings
@@ -286,6 +305,24 @@ class MqttService : Service() {
             put("topic", availabilityTopic)
         }
 
+        // Aggregated payloads carry statistics per value and batched payloads an array of
+        // samples; point Home Assistant at the window mean or the newest sample
+        val isAggregating = (settings.aggregationWindowMs.toIntOrNull() ?: 0) > 0
+        val isBatching = (settings.batchWindowMs.toIntOrNull() ?: 0) > 0 || (settings.batchMaxSamples.toIntOrNull() ?: 0) > 0
+        fun valueTemplate(key: String): String {
+            return when {
+                isAggregating -> "{{ value_json.$key.mean }}"
+                isBatching -> "{{ value_json.samples[-1].$key }}"
+                else -> "{{ value_json.$key }}"
+            }
+        }
+
+        // Accelerometer spectra report the peak vibration amplitude per axis
+        val isAccelerometerSpectrum = (settings.accelerometerSpectrumBlockSize.toIntOrNull() ?: 0) > 0
+        fun accelerometerValueTemplate(axis: String): String {
+            return if (isAccelerometerSpectrum) "{{ value_json.$axis.peak }}" else valueTemplate(axis)
+        }
+
         // Helper to create sensor availability array
         fun getAvailability(sensorKey: String): JSONArray {
             return JSONArray().apply {
@@ -304,7 +341,7 @@ class MqttService : Service() {
                 put("name", "Accel ${axis.uppercase()}")
                 put("state_topic", settings.accelerometerTopic)
                 put("unit_of_measurement", "m/s²")
-                put("value_template", "{{ value_json.$axis }}")
+                put("value_template", accelerometerValueTemplate(axis))
                 put("unique_id", "${deviceId}_accel_$axis")
                 put("device", device)
                 put("availability", getAvailability("accel"))
@@ -321,7 +358,7 @@ class MqttService : Service() {
                 put("name", "Gyro ${axis.uppercase()}")
                 put("state_topic", settings.gyroscopeTopic)
                 put("unit_of_measurement", "rad/s")
-                put("value_template", "{{ value_json.$axis }}")
+                put("value_template", valueTemplate(axis))
                 put("unique_id", "${deviceId}_gyro_$axis")
                 put("device", device)
                 put("availability", getAvailability("gyro"))
@@ -338,7 +375,7 @@ class MqttService : Service() {
                 put("name", "Gravity ${axis.uppercase()}")
                 put("state_topic", settings.gravityTopic)
                 put("unit_of_measurement", "m/s²")
-                put("value_template", "{{ value_json.$axis }}")
+                put("value_template", valueTemplate(axis))
                 put("unique_id", "${deviceId}_gravity_$axis")
                 put("device", device)
                 put("availability", getAvailability("gravity"))
@@ -354,7 +391,7 @@ class MqttService : Service() {
             put("name", "Light")
             put("state_topic", settings.lightSensorTopic)
             put("unit_of_measurement", "lx")
-            put("value_template", "{{ value_json.value }}")
+            put("value_template", valueTemplate("value"))
             put("unique_id", "${deviceId}_light")
             put("device", device)
             put("availability", getAvailability("light"))
@@ -369,7 +406,7 @@ class MqttService : Service() {
             put("name", "Temperature")
             put("state_topic", settings.temperatureSensorTopic)
             put("unit_of_measurement", "°C")
-            put("value_template", "{{ value_json.value }}")
+            put("value_template", valueTemplate("value"))
             put("unique_id", "${deviceId}_temp")
             put("device", device)
             put("availability", getAvailability("temp"))
@@ -430,14 +467,32 @@ class MqttService : Service() {
         gyroscopeTopic: String,
         gravityTopic: String,
         lightSensorTopic: String,
-        temperatureSensorTopic: String
+        temperatureSensorTopic: String,
+        queueDepth: Int,
+        queueOverflowPolicy: Int,
+        offlineStorePath: String,
+        offlineStoreKb: Int,
+        offlineDrainRate: Int,
+        qos0Window: Int,
+        qos1Window: Int,
+        windowPolicy: Int,
+        writeCoalescingUs: Int,
+        writeCoalescingBytes: Int,
+        diagnosticsTopic: String,
+        diagnosticsIntervalS: Int,
+        orientationTopic: String,
+        orientationAlgorithm: Int,
+        orientationGain: Float,
+        orientationRateHz: Float,
+        orientationOnly: Boolean
     )
 
     private external fun nativeConnect(brokerUrl: String, clientId: String, username: String, password: String, willTopic: String, willPayload: String)
     private external fun nativeUpdateTopics(accelerometerTopic: String, gyroscopeTopic: String, gravityTopic: String, lightSensorTopic: String, temperatureSensorTopic: String)
     private external fun nativeDisconnect()
     private external fun nativeCleanup()
-    private external fun nativePublish(topic: String, payload: String, retain: Boolean, qos: Int = 0)
+    // False if the message was rejected, by the in-flight window or for lack of a connection
+    private external fun nativePublish(topic: String, payload: String, retain: Boolean, qos: Int = 0): Boolean
 
 
     companion object {
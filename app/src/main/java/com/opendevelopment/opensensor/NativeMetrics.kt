@@ -0,0 +1,38 @@
+package com.opendevelopment.opensensor
+
+import org.json.JSONObject
+
+/**
+ * Counters, gauges and latency histograms of the native client and sensor pipeline
+ * (metrics.h). They are process-wide and count from when the library was loaded.
+ */
+object NativeMetrics {
+    init {
+        System.loadLibrary("opensensor_native")
+    }
+
+    /** The current values as JSON, in the format of the diagnostics message. */
+    fun snapshot(): String = nativeSnapshot()
+
+    /** One line on what the MQTT client has sent so far, for the MQTT screen. */
+    fun summary(): String {
+        val json = JSONObject(snapshot())
+        val counters = json.getJSONObject("counters")
+        val gauges = json.getJSONObject("gauges")
+        val histograms = json.getJSONObject("histograms")
+        val puback = histograms.optJSONObject("mqtt.puback_us")
+        val age = histograms.optJSONObject("mqtt.sample_age_us")
+        var summary = "Sent ${counters.optLong("mqtt.publishes")} messages " +
+            "(${counters.optLong("mqtt.bytes") / 1024} kB), ${counters.optLong("mqtt.publish_errors")} failed, " +
+            "${gauges.optLong("mqtt.feed_queue_depth")} samples queued"
+        if (puback != null && puback.optLong("n") > 0L) {
+            summary += "; PUBACK p50 ${puback.optLong("p50") / 1000} ms, p99 ${puback.optLong("p99") / 1000} ms"
+        }
+        if (age != null && age.optLong("n") > 0L) {
+            summary += "; sample age p50 ${age.optLong("p50") / 1000} ms, p99 ${age.optLong("p99") / 1000} ms"
+        }
+        return summary
+    }
+
+    private external fun nativeSnapshot(): String
+}
@@ -0,0 +1,46 @@
+package com.opendevelopment.opensensor
+
+import android.content.Context
+import android.hardware.SensorManager
+
+/**
+ * Reads sensors in native code through an ASensorEventQueue on its own looper thread and hands
+ * the samples straight to the native processors, bypassing SensorEventListener and JNI.
+ *
+ * The sensor indices match SensorKind in sensor_source.h.
+ */
+object NativeSensorIngestion {
+    const val ACCELEROMETER = 0
+    const val GYROSCOPE = 1
+    const val GRAVITY = 2
+    const val LIGHT = 3
+    const val TEMPERATURE = 4
+
+    init {
+        System.loadLibrary("opensensor_native")
+    }
+
+    /** Converts a SensorManager.SENSOR_DELAY_* constant or a period in microseconds to microseconds. */
+    fun samplingPeriodUs(samplingPeriod: Int, minDelayUs: Int): Int = when (samplingPeriod) {
+        SensorManager.SENSOR_DELAY_FASTEST -> minDelayUs
+        SensorManager.SENSOR_DELAY_GAME -> 20_000
+        SensorManager.SENSOR_DELAY_UI -> 66_667
+        SensorManager.SENSOR_DELAY_NORMAL -> 200_000
+        else -> samplingPeriod
+    }
+
+    /** Nominal event rate for a sampling period, or 0 if the sensor does not report one. */
+    fun sampleRateHz(samplingPeriod: Int, minDelayUs: Int): Float {
+        val periodUs = samplingPeriodUs(samplingPeriod, minDelayUs)
+        return if (periodUs > 0) 1_000_000f / periodUs else 0f
+    }
+
+    /** Returns false if the sensor cannot be read natively; callers then fall back to a listener. */
+    fun enable(context: Context, sensor: Int, samplingPeriod: Int, minDelayUs: Int): Boolean =
+        nativeEnable(context.packageName, sensor, samplingPeriodUs(samplingPeriod, minDelayUs))
+
+    fun disable(sensor: Int) = nativeDisable(sensor)
+
+    private external fun nativeEnable(packageName: String, sensor: Int, samplingPeriodUs: Int): Boolean
+    private external fun nativeDisable(sensor: Int)
+}
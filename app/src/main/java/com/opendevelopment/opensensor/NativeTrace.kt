@@ -0,0 +1,38 @@
+package com.opendevelopment.opensensor
+
+import android.content.Context
+import java.io.File
+
+/**
+ * Sampled tracing of samples from the sensor to the broker (pipeline_trace.h). While running,
+ * one sample in [SAMPLE_EVERY] records the time it spends in each stage; stopping writes the
+ * most recent of them as a Chrome trace, to be opened in Perfetto (ui.perfetto.dev) or
+ * chrome://tracing.
+ */
+object NativeTrace {
+    const val SAMPLE_EVERY = 100
+
+    init {
+        System.loadLibrary("opensensor_native")
+    }
+
+    @Volatile
+    var running = false
+        private set
+
+    fun start() {
+        nativeStart(SAMPLE_EVERY)
+        running = true
+    }
+
+    /** Stops tracing and returns the trace file, or null if it could not be written. */
+    fun stop(context: Context): File? {
+        running = false
+        val directory = context.getExternalFilesDir(null) ?: context.filesDir
+        val file = File(directory, "trace-${System.currentTimeMillis()}.json")
+        return if (nativeStop(file.absolutePath)) file else null
+    }
+
+    private external fun nativeStart(sampleEvery: Int)
+    private external fun nativeStop(path: String): Boolean
+}
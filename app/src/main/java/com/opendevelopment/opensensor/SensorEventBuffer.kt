@@ -0,0 +1,62 @@
+package com.opendevelopment.opensensor
+
+import android.hardware.SensorEvent
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
+
+/**
+ * Packs three-axis sensor events into a direct buffer so native code can process many events
+ * per JNI call. Each record is (timestamp: Long, x: Float, y: Float, z: Float) padded to
+ * [RECORD_SIZE] bytes in native byte order, matching ThreeAxisEventRecord in native-lib.cpp.
+ *
+ * Only as many events are held back as arrive within [MAX_LATENCY_US], so slow sampling
+ * periods still hand over every event immediately.
+ *
+ * Events are added on the thread delivering them, while the services flush from their own
+ * scope when unregistering, so adding and flushing hold a lock; it is uncontended while events
+ * flow.
+ */
+class SensorEventBuffer(private val onFlush: (ByteBuffer, Int) -> Unit) {
+
+    private val lock = Any()
+    private val buffer: ByteBuffer = ByteBuffer.allocateDirect(CAPACITY * RECORD_SIZE).order(ByteOrder.nativeOrder())
+    private var count = 0
+
+    @Volatile
+    private var batchSize = 1
+
+    fun configure(samplingPeriod: Int, minDelayUs: Int) {
+        val periodUs = NativeSensorIngestion.samplingPeriodUs(samplingPeriod, minDelayUs)
+        batchSize = if (periodUs > 0) (MAX_LATENCY_US / periodUs).coerceIn(1, CAPACITY) else 1
+    }
+
+    fun add(event: SensorEvent) = synchronized(lock) {
+        val offset = count * RECORD_SIZE
+        buffer.putLong(offset, event.timestamp)
+        buffer.putFloat(offset + 8, event.values[0])
+        buffer.putFloat(offset + 12, event.values[1])
+        buffer.putFloat(offset + 16, event.values[2])
+        count++
+
+        if (count >= batchSize) {
+            flushLocked()
+        }
+    }
+
+    fun flush() = synchronized(lock) {
+        flushLocked()
+    }
+
+    private fun flushLocked() {
+        if (count > 0) {
+            onFlush(buffer, count)
+            count = 0
+        }
+    }
+
+    companion object {
+        const val CAPACITY = 64
+        const val RECORD_SIZE = 24
+        private const val MAX_LATENCY_US = 20_000
+    }
+}
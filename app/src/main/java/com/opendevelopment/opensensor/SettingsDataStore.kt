@@ -30,25 +30,72 @@ data class Settings(
     val accelerometerMultiplierY: String,
     val accelerometerMultiplierZ: String,
     val accelerometerRounding: String,
+    val accelerometerDeadband: String,
+    val accelerometerFilter: String,
+    val accelerometerPayloadFormat: Int,
+    val accelerometerPublishMode: Int,
+    val accelerometerSpectrumBlockSize: String,
+    val accelerometerSpectrumBands: String,
     val accelerometerSamplingPeriod: Int,
     val gyroscopeTopic: String,
     val gyroscopeMultiplierX: String,
     val gyroscopeMultiplierY: String,
     val gyroscopeMultiplierZ: String,
     val gyroscopeRounding: String,
+    val gyroscopeDeadband: String,
+    val gyroscopeFilter: String,
+    val gyroscopePayloadFormat: Int,
+    val gyroscopePublishMode: Int,
     val gyroscopeSamplingPeriod: Int,
     val gravityTopic: String,
     val gravityMultiplierX: String,
     val gravityMultiplierY: String,
     val gravityMultiplierZ: String,
     val gravityRounding: String,
+    val gravityDeadband: String,
+    val gravityFilter: String,
+    val gravityPayloadFormat: Int,
+    val gravityPublishMode: Int,
     val gravitySamplingPeriod: Int,
     val lightSensorTopic: String,
     val lightSensorRounding: String,
+    val lightSensorDeadband: String,
+    val lightSensorFilter: String,
+    val lightSensorPayloadFormat: Int,
+    val lightSensorPublishMode: Int,
     val lightSensorSamplingPeriod: Int,
     val temperatureSensorTopic: String,
     val temperatureSensorRounding: String,
+    val temperatureSensorDeadband: String,
+    val temperatureSensorFilter: String,
+    val temperatureSensorPayloadFormat: Int,
+    val temperatureSensorPublishMode: Int,
     val temperatureSensorSamplingPeriod: Int,
+    val relativeDeadbandPercent: String,
+    val hysteresisPercent: String,
+    val minPublishIntervalMs: String,
+    val heartbeatSeconds: String,
+    val aggregationWindowMs: String,
+    val aggregationStepMs: String,
+    val batchWindowMs: String,
+    val batchMaxSamples: String,
+    val queueDepth: String,
+    val queueOverflowPolicy: Int,
+    val offlineStoreKb: String,
+    val offlineDrainRate: String,
+    val qos0Window: String,
+    val qos1Window: String,
+    val windowPolicy: Int,
+    val writeCoalescingMs: String,
+    val writeCoalescingBytes: String,
+    val diagnosticsTopic: String,
+    val diagnosticsIntervalS: String,
+    val isNativeSensorIngestionEnabled: Boolean,
+    val orientationTopic: String,
+    val orientationRateHz: String,
+    val orientationAlgorithm: Int,
+    val orientationGain: String,
+    val isOrientationOnlyEnabled: Boolean,
     val isHaDiscoveryEnabled: Boolean,
     val haDiscoveryPrefix: String,
     val haDeviceName: String,
@@ -71,6 +118,12 @@ class SettingsDataStore(val context: Context) {
         val ACCELEROMETER_MULTIPLIER_Y = stringPreferencesKey("accelerometer_multiplier_y")
         val ACCELEROMETER_MULTIPLIER_Z = stringPreferencesKey("accelerometer_multiplier_z")
         val ACCELEROMETER_ROUNDING = stringPreferencesKey("accelerometer_rounding")
+        val ACCELEROMETER_DEADBAND = stringPreferencesKey("accelerometer_deadband")
+        val ACCELEROMETER_FILTER = stringPreferencesKey("accelerometer_filter")
+        val ACCELEROMETER_PAYLOAD_FORMAT = intPreferencesKey("accelerometer_payload_format")
+        val ACCELEROMETER_PUBLISH_MODE = intPreferencesKey("accelerometer_publish_mode")
+        val ACCELEROMETER_SPECTRUM_BLOCK_SIZE = stringPreferencesKey("accelerometer_spectrum_block_size")
+        val ACCELEROMETER_SPECTRUM_BANDS = stringPreferencesKey("accelerometer_spectrum_bands")
         val ACCELEROMETER_SAMPLING_PERIOD = intPreferencesKey("accelerometer_sampling_period")
 
         val GYROSCOPE_ENABLED = booleanPreferencesKey("gyroscope_enabled")
@@ -79,6 +132,10 @@ class SettingsDataStore(val context: Context) {
         val GYROSCOPE_MULTIPLIER_Y = stringPreferencesKey("gyroscope_multiplier_y")
         val GYROSCOPE_MULTIPLIER_Z = stringPreferencesKey("gyroscope_multiplier_z")
         val GYROSCOPE_ROUNDING = stringPreferencesKey("gyroscope_rounding")
+        val GYROSCOPE_DEADBAND = stringPreferencesKey("gyroscope_deadband")
+        val GYROSCOPE_FILTER = stringPreferencesKey("gyroscope_filter")
+        val GYROSCOPE_PAYLOAD_FORMAT = intPreferencesKey("gyroscope_payload_format")
+        val GYROSCOPE_PUBLISH_MODE = intPreferencesKey("gyroscope_publish_mode")
         val GYROSCOPE_SAMPLING_PERIOD = intPreferencesKey("gyroscope_sampling_period")
 
         val GRAVITY_ENABLED = booleanPreferencesKey("gravity_enabled")
@@ -87,18 +144,59 @@ class SettingsDataStore(val context: Context) {
         val GRAVITY_MULTIPLIER_Y = stringPreferencesKey("gravity_multiplier_y")
         val GRAVITY_MULTIPLIER_Z = stringPreferencesKey("gravity_multiplier_z")
         val GRAVITY_ROUNDING = stringPreferencesKey("gravity_rounding")
+        val GRAVITY_DEADBAND = stringPreferencesKey("gravity_deadband")
+        val GRAVITY_FILTER = stringPreferencesKey("gravity_filter")
+        val GRAVITY_PAYLOAD_FORMAT = intPreferencesKey("gravity_payload_format")
+        val GRAVITY_PUBLISH_MODE = intPreferencesKey("gravity_publish_mode")
         val GRAVITY_SAMPLING_PERIOD = intPreferencesKey("gravity_sampling_period")
 
         val LIGHT_SENSOR_ENABLED = booleanPreferencesKey("light_sensor_enabled")
         val LIGHT_SENSOR_TOPIC = stringPreferencesKey("light_sensor_topic")
         val LIGHT_SENSOR_ROUNDING = stringPreferencesKey("light_sensor_rounding")
+        val LIGHT_SENSOR_DEADBAND = stringPreferencesKey("light_sensor_deadband")
+        val LIGHT_SENSOR_FILTER = stringPreferencesKey("light_sensor_filter")
+        val LIGHT_SENSOR_PAYLOAD_FORMAT = intPreferencesKey("light_sensor_payload_format")
+        val LIGHT_SENSOR_PUBLISH_MODE = intPreferencesKey("light_sensor_publish_mode")
         val LIGHT_SENSOR_SAMPLING_PERIOD = intPreferencesKey("light_sensor_sampling_period")
 
         val TEMPERATURE_SENSOR_ENABLED = booleanPreferencesKey("temperature_sensor_enabled")
         val TEMPERATURE_SENSOR_TOPIC = stringPreferencesKey("temperature_sensor_topic")
         val TEMPERATURE_SENSOR_ROUNDING = stringPreferencesKey("temperature_sensor_rounding")
+        val TEMPERATURE_SENSOR_DEADBAND = stringPreferencesKey("temperature_sensor_deadband")
+        val TEMPERATURE_SENSOR_FILTER = stringPreferencesKey("temperature_sensor_filter")
+        val TEMPERATURE_SENSOR_PAYLOAD_FORMAT = intPreferencesKey("temperature_sensor_payload_format")
+        val TEMPERATURE_SENSOR_PUBLISH_MODE = intPreferencesKey("temperature_sensor_publish_mode")
         val TEMPERATURE_SENSOR_SAMPLING_PERIOD = intPreferencesKey("temperature_sensor_sampling_period")
 
+        val RELATIVE_DEADBAND_PERCENT = stringPreferencesKey("relative_deadband_percent")
+        val HYSTERESIS_PERCENT = stringPreferencesKey("hysteresis_percent")
+        val MIN_PUBLISH_INTERVAL_MS = stringPreferencesKey("min_publish_interval_ms")
+        val HEARTBEAT_SECONDS = stringPreferencesKey("heartbeat_seconds")
+
+        val AGGREGATION_WINDOW_MS = stringPreferencesKey("aggregation_window_ms")
+        val AGGREGATION_STEP_MS = stringPreferencesKey("aggregation_step_ms")
+
+        val BATCH_WINDOW_MS = stringPreferencesKey("batch_window_ms")
+        val BATCH_MAX_SAMPLES = stringPreferencesKey("batch_max_samples")
+
+        val QUEUE_DEPTH = stringPreferencesKey("queue_depth")
+        val OFFLINE_STORE_KB = stringPreferencesKey("offline_store_kb")
+        val OFFLINE_DRAIN_RATE = stringPreferencesKey("offline_drain_rate")
+        val QOS0_WINDOW = stringPreferencesKey("qos0_window")
+        val QOS1_WINDOW = stringPreferencesKey("qos1_window")
+        val WINDOW_POLICY = intPreferencesKey("window_policy")
+        val WRITE_COALESCING_MS = stringPreferencesKey("write_coalescing_ms")
+        val WRITE_COALESCING_BYTES = stringPreferencesKey("write_coalescing_bytes")
+        val DIAGNOSTICS_TOPIC = stringPreferencesKey("diagnostics_topic")
+        val DIAGNOSTICS_INTERVAL_S = stringPreferencesKey("diagnostics_interval_s")
+        val QUEUE_OVERFLOW_POLICY = intPreferencesKey("queue_overflow_policy")
+        val NATIVE_SENSOR_INGESTION = booleanPreferencesKey("native_sensor_ingestion")
+        val ORIENTATION_TOPIC = stringPreferencesKey("orientation_topic")
+        val ORIENTATION_RATE_HZ = stringPreferencesKey("orientation_rate_hz")
+        val ORIENTATION_ALGORITHM = intPreferencesKey("orientation_algorithm")
+        val ORIENTATION_GAIN = stringPreferencesKey("orientation_gain")
+        val ORIENTATION_ONLY = booleanPreferencesKey("orientation_only")
+
         val HA_DISCOVERY_ENABLED = booleanPreferencesKey("ha_discovery_enabled")
         val HA_DISCOVERY_PREFIX = stringPreferencesKey("ha_discovery_prefix")
         val HA_DEVICE_NAME = stringPreferencesKey("ha_device_name")
@@ -125,6 +223,12 @@ class SettingsDataStore(val context: Context) {
                 accelerometerMultiplierY = preferences[PreferenceKeys.ACCELEROMETER_MULTIPLIER_Y] ?: "1.0",
                 accelerometerMultiplierZ = preferences[PreferenceKeys.ACCELEROMETER_MULTIPLIER_Z] ?: "1.0",
                 accelerometerRounding = preferences[PreferenceKeys.ACCELEROMETER_ROUNDING] ?: "2",
+                accelerometerDeadband = preferences[PreferenceKeys.ACCELEROMETER_DEADBAND] ?: "0",
+                accelerometerFilter = preferences[PreferenceKeys.ACCELEROMETER_FILTER] ?: "",
+                accelerometerPayloadFormat = preferences[PreferenceKeys.ACCELEROMETER_PAYLOAD_FORMAT] ?: 0,
+                accelerometerPublishMode = preferences[PreferenceKeys.ACCELEROMETER_PUBLISH_MODE] ?: 0,
+                accelerometerSpectrumBlockSize = preferences[PreferenceKeys.ACCELEROMETER_SPECTRUM_BLOCK_SIZE] ?: "0",
+                accelerometerSpectrumBands = preferences[PreferenceKeys.ACCELEROMETER_SPECTRUM_BANDS] ?: "8",
                 accelerometerSamplingPeriod = preferences[PreferenceKeys.ACCELEROMETER_SAMPLING_PERIOD] ?: SensorManager.SENSOR_DELAY_NORMAL,
 
                 gyroscopeTopic = preferences[PreferenceKeys.GYROSCOPE_TOPIC] ?: "opensensor/sensor/gyroscope",
@@ -132,6 +236,10 @@ class SettingsDataStore(val context: Context) {
                 gyroscopeMultiplierY = preferences[PreferenceKeys.GYROSCOPE_MULTIPLIER_Y] ?: "1.0",
                 gyroscopeMultiplierZ = preferences[PreferenceKeys.GYROSCOPE_MULTIPLIER_Z] ?: "1.0",
                 gyroscopeRounding = preferences[PreferenceKeys.GYROSCOPE_ROUNDING] ?: "2",
+                gyroscopeDeadband = preferences[PreferenceKeys.GYROSCOPE_DEADBAND] ?: "0",
+                gyroscopeFilter = preferences[PreferenceKeys.GYROSCOPE_FILTER] ?: "",
+                gyroscopePayloadFormat = preferences[PreferenceKeys.GYROSCOPE_PAYLOAD_FORMAT] ?: 0,
+                gyroscopePublishMode = preferences[PreferenceKeys.GYROSCOPE_PUBLISH_MODE] ?: 0,
                 gyroscopeSamplingPeriod = preferences[PreferenceKeys.GYROSCOPE_SAMPLING_PERIOD] ?: SensorManager.SENSOR_DELAY_NORMAL,
 
                 gravityTopic = preferences[PreferenceKeys.GRAVITY_TOPIC] ?: "opensensor/sensor/gravity",
@@ -139,16 +247,55 @@ class SettingsDataStore(val context: Context) {
                 gravityMultiplierY = preferences[PreferenceKeys.GRAVITY_MULTIPLIER_Y] ?: "1.0",
                 gravityMultiplierZ = preferences[PreferenceKeys.GRAVITY_MULTIPLIER_Z] ?: "1.0",
                 gravityRounding = preferences[PreferenceKeys.GRAVITY_ROUNDING] ?: "2",
+                gravityDeadband = preferences[PreferenceKeys.GRAVITY_DEADBAND] ?: "0",
+                gravityFilter = preferences[PreferenceKeys.GRAVITY_FILTER] ?: "",
+                gravityPayloadFormat = preferences[PreferenceKeys.GRAVITY_PAYLOAD_FORMAT] ?: 0,
+                gravityPublishMode = preferences[PreferenceKeys.GRAVITY_PUBLISH_MODE] ?: 0,
                 gravitySamplingPeriod = preferences[PreferenceKeys.GRAVITY_SAMPLING_PERIOD] ?: SensorManager.SENSOR_DELAY_NORMAL,
 
                 lightSensorTopic = preferences[PreferenceKeys.LIGHT_SENSOR_TOPIC] ?: "opensensor/sensor/light",
                 lightSensorRounding = preferences[PreferenceKeys.LIGHT_SENSOR_ROUNDING] ?: "2",
+                lightSensorDeadband = preferences[PreferenceKeys.LIGHT_SENSOR_DEADBAND] ?: "0",
+                lightSensorFilter = preferences[PreferenceKeys.LIGHT_SENSOR_FILTER] ?: "",
+                lightSensorPayloadFormat = preferences[PreferenceKeys.LIGHT_SENSOR_PAYLOAD_FORMAT] ?: 0,
+                lightSensorPublishMode = preferences[PreferenceKeys.LIGHT_SENSOR_PUBLISH_MODE] ?: 1,
                 lightSensorSamplingPeriod = preferences[PreferenceKeys.LIGHT_SENSOR_SAMPLING_PERIOD] ?: SensorManager.SENSOR_DELAY_NORMAL,
 
                 temperatureSensorTopic = preferences[PreferenceKeys.TEMPERATURE_SENSOR_TOPIC] ?: "opensensor/sensor/temperature",
                 temperatureSensorRounding = preferences[PreferenceKeys.TEMPERATURE_SENSOR_ROUNDING] ?: "2",
+                temperatureSensorDeadband = preferences[PreferenceKeys.TEMPERATURE_SENSOR_DEADBAND] ?: "0",
+                temperatureSensorFilter = preferences[PreferenceKeys.TEMPERATURE_SENSOR_FILTER] ?: "",
+                temperatureSensorPayloadFormat = preferences[PreferenceKeys.TEMPERATURE_SENSOR_PAYLOAD_FORMAT] ?: 0,
+                temperatureSensorPublishMode = preferences[PreferenceKeys.TEMPERATURE_SENSOR_PUBLISH_MODE] ?: 1,
                 temperatureSensorSamplingPeriod = preferences[PreferenceKeys.TEMPERATURE_SENSOR_SAMPLING_PERIOD] ?: SensorManager.SENSOR_DELAY_NORMAL,
 
+                relativeDeadbandPercent = preferences[PreferenceKeys.RELATIVE_DEADBAND_PERCENT] ?: "0",
+                hysteresisPercent = preferences[PreferenceKeys.HYSTERESIS_PERCENT] ?: "0",
+                minPublishIntervalMs = preferences[PreferenceKeys.MIN_PUBLISH_INTERVAL_MS] ?: "0",
+                heartbeatSeconds = preferences[PreferenceKeys.HEARTBEAT_SECONDS] ?: "0",
+                aggregationWindowMs = preferences[PreferenceKeys.AGGREGATION_WINDOW_MS] ?: "0",
+                aggregationStepMs = preferences[PreferenceKeys.AGGREGATION_STEP_MS] ?: "0",
+                batchWindowMs = preferences[PreferenceKeys.BATCH_WINDOW_MS] ?: "0",
+                batchMaxSamples = preferences[PreferenceKeys.BATCH_MAX_SAMPLES] ?: "0",
+
+                queueDepth = preferences[PreferenceKeys.QUEUE_DEPTH] ?: "256",
+                queueOverflowPolicy = preferences[PreferenceKeys.QUEUE_OVERFLOW_POLICY] ?: 0,
+                offlineStoreKb = preferences[PreferenceKeys.OFFLINE_STORE_KB] ?: "1024",
+                offlineDrainRate = preferences[PreferenceKeys.OFFLINE_DRAIN_RATE] ?: "50",
+                qos0Window = preferences[PreferenceKeys.QOS0_WINDOW] ?: "128",
+                qos1Window = preferences[PreferenceKeys.QOS1_WINDOW] ?: "32",
+                windowPolicy = preferences[PreferenceKeys.WINDOW_POLICY] ?: 0,
+                writeCoalescingMs = preferences[PreferenceKeys.WRITE_COALESCING_MS] ?: "0",
+                writeCoalescingBytes = preferences[PreferenceKeys.WRITE_COALESCING_BYTES] ?: "1400",
+                diagnosticsTopic = preferences[PreferenceKeys.DIAGNOSTICS_TOPIC] ?: "opensensor/diagnostics",
+                diagnosticsIntervalS = preferences[PreferenceKeys.DIAGNOSTICS_INTERVAL_S] ?: "0",
+                isNativeSensorIngestionEnabled = preferences[PreferenceKeys.NATIVE_SENSOR_INGESTION] ?: false,
+                orientationTopic = preferences[PreferenceKeys.ORIENTATION_TOPIC] ?: "opensensor/sensor/orientation",
+                orientationRateHz = preferences[PreferenceKeys.ORIENTATION_RATE_HZ] ?: "0",
+                orientationAlgorithm = preferences[PreferenceKeys.ORIENTATION_ALGORITHM] ?: 0,
+                orientationGain = preferences[PreferenceKeys.ORIENTATION_GAIN] ?: "0",
+                isOrientationOnlyEnabled = preferences[PreferenceKeys.ORIENTATION_ONLY] ?: false,
+
                 isHaDiscoveryEnabled = preferences[PreferenceKeys.HA_DISCOVERY_ENABLED] ?: false,
                 haDiscoveryPrefix = preferences[PreferenceKeys.HA_DISCOVERY_PREFIX] ?: "homeassistant",
                 haDeviceName = preferences[PreferenceKeys.HA_DEVICE_NAME] ?: "OpenSensor",
@@ -217,6 +364,30 @@ class SettingsDataStore(val context: Context) {
         context.dataStore.edit { it[PreferenceKeys.ACCELEROMETER_ROUNDING] = rounding }
     }
 
+    suspend fun updateAccelerometerDeadband(deadband: String) {
+        context.dataStore.edit { it[PreferenceKeys.ACCELEROMETER_DEADBAND] = deadband }
+    }
+
+    suspend fun updateAccelerometerFilter(filter: String) {
+        context.dataStore.edit { it[PreferenceKeys.ACCELEROMETER_FILTER] = filter }
+    }
+
+    suspend fun updateAccelerometerPayloadFormat(format: Int) {
+        context.dataStore.edit { it[PreferenceKeys.ACCELEROMETER_PAYLOAD_FORMAT] = format }
+    }
+
+    suspend fun updateAccelerometerPublishMode(mode: Int) {
+        context.dataStore.edit { it[PreferenceKeys.ACCELEROMETER_PUBLISH_MODE] = mode }
+    }
+
+    suspend fun updateAccelerometerSpectrumBlockSize(blockSize: String) {
+        context.dataStore.edit { it[PreferenceKeys.ACCELEROMETER_SPECTRUM_BLOCK_SIZE] = blockSize }
+    }
+
+    suspend fun updateAccelerometerSpectrumBands(bands: String) {
+        context.dataStore.edit { it[PreferenceKeys.ACCELEROMETER_SPECTRUM_BANDS] = bands }
+    }
+
     suspend fun updateAccelerometerSamplingPeriod(samplingPeriod: Int) {
         context.dataStore.edit { it[PreferenceKeys.ACCELEROMETER_SAMPLING_PERIOD] = samplingPeriod }
     }
@@ -241,6 +412,22 @@ class SettingsDataStore(val context: Context) {
         context.dataStore.edit { it[PreferenceKeys.GYROSCOPE_ROUNDING] = rounding }
     }
 
+    suspend fun updateGyroscopeDeadband(deadband: String) {
+        context.dataStore.edit { it[PreferenceKeys.GYROSCOPE_DEADBAND] = deadband }
+    }
+
+    suspend fun updateGyroscopeFilter(filter: String) {
+        context.dataStore.edit { it[PreferenceKeys.GYROSCOPE_FILTER] = filter }
+    }
+
+    suspend fun updateGyroscopePayloadFormat(format: Int) {
+        context.dataStore.edit { it[PreferenceKeys.GYROSCOPE_PAYLOAD_FORMAT] = format }
+    }
+
+    suspend fun updateGyroscopePublishMode(mode: Int) {
+        context.dataStore.edit { it[PreferenceKeys.GYROSCOPE_PUBLISH_MODE] = mode }
+    }
+
     suspend fun updateGyroscopeSamplingPeriod(samplingPeriod: Int) {
         context.dataStore.edit { it[PreferenceKeys.GYROSCOPE_SAMPLING_PERIOD] = samplingPeriod }
     }
@@ -265,6 +452,22 @@ class SettingsDataStore(val context: Context) {
         context.dataStore.edit { it[PreferenceKeys.GRAVITY_ROUNDING] = rounding }
     }
 
+    suspend fun updateGravityDeadband(deadband: String) {
+        context.dataStore.edit { it[PreferenceKeys.GRAVITY_DEADBAND] = deadband }
+    }
+
+    suspend fun updateGravityFilter(filter: String) {
+        context.dataStore.edit { it[PreferenceKeys.GRAVITY_FILTER] = filter }
+    }
+
+    suspend fun updateGravityPayloadFormat(format: Int) {
+        context.dataStore.edit { it[PreferenceKeys.GRAVITY_PAYLOAD_FORMAT] = format }
+    }
+
+    suspend fun updateGravityPublishMode(mode: Int) {
+        context.dataStore.edit { it[PreferenceKeys.GRAVITY_PUBLISH_MODE] = mode }
+    }
+
     suspend fun updateGravitySamplingPeriod(samplingPeriod: Int) {
         context.dataStore.edit { it[PreferenceKeys.GRAVITY_SAMPLING_PERIOD] = samplingPeriod }
     }
@@ -277,6 +480,22 @@ class SettingsDataStore(val context: Context) {
         context.dataStore.edit { it[PreferenceKeys.LIGHT_SENSOR_ROUNDING] = rounding }
     }
 
+    suspend fun updateLightSensorDeadband(deadband: String) {
+        context.dataStore.edit { it[PreferenceKeys.LIGHT_SENSOR_DEADBAND] = deadband }
+    }
+
+    suspend fun updateLightSensorFilter(filter: String) {
+        context.dataStore.edit { it[PreferenceKeys.LIGHT_SENSOR_FILTER] = filter }
+    }
+
+    suspend fun updateLightSensorPayloadFormat(format: Int) {
+        context.dataStore.edit { it[PreferenceKeys.LIGHT_SENSOR_PAYLOAD_FORMAT] = format }
+    }
+
+    suspend fun updateLightSensorPublishMode(mode: Int) {
+        context.dataStore.edit { it[PreferenceKeys.LIGHT_SENSOR_PUBLISH_MODE] = mode }
+    }
+
     suspend fun updateLightSensorSamplingPeriod(samplingPeriod: Int) {
         context.dataStore.edit { it[PreferenceKeys.LIGHT_SENSOR_SAMPLING_PERIOD] = samplingPeriod }
     }
@@ -289,10 +508,126 @@ class SettingsDataStore(val context: Context) {
         context.dataStore.edit { it[PreferenceKeys.TEMPERATURE_SENSOR_ROUNDING] = rounding }
     }
 
+    suspend fun updateTemperatureSensorDeadband(deadband: String) {
+        context.dataStore.edit { it[PreferenceKeys.TEMPERATURE_SENSOR_DEADBAND] = deadband }
+    }
+
+    suspend fun updateTemperatureSensorFilter(filter: String) {
+        context.dataStore.edit { it[PreferenceKeys.TEMPERATURE_SENSOR_FILTER] = filter }
+    }
+
+    suspend fun updateTemperatureSensorPayloadFormat(format: Int) {
+        context.dataStore.edit { it[PreferenceKeys.TEMPERATURE_SENSOR_PAYLOAD_FORMAT] = format }
+    }
+
+    suspend fun updateTemperatureSensorPublishMode(mode: Int) {
+        context.dataStore.edit { it[PreferenceKeys.TEMPERATURE_SENSOR_PUBLISH_MODE] = mode }
+    }
+
     suspend fun updateTemperatureSensorSamplingPeriod(samplingPeriod: Int) {
         context.dataStore.edit { it[PreferenceKeys.TEMPERATURE_SENSOR_SAMPLING_PERIOD] = samplingPeriod }
     }
 
+    suspend fun updateRelativeDeadbandPercent(percent: String) {
+        context.dataStore.edit { it[PreferenceKeys.RELATIVE_DEADBAND_PERCENT] = percent }
+    }
+
+    suspend fun updateHysteresisPercent(percent: String) {
+        context.dataStore.edit { it[PreferenceKeys.HYSTERESIS_PERCENT] = percent }
+    }
+
+    suspend fun updateMinPublishIntervalMs(intervalMs: String) {
+        context.dataStore.edit { it[PreferenceKeys.MIN_PUBLISH_INTERVAL_MS] = intervalMs }
+    }
+
+    suspend fun updateHeartbeatSeconds(seconds: String) {
+        context.dataStore.edit { it[PreferenceKeys.HEARTBEAT_SECONDS] = seconds }
+    }
+
+    suspend fun updateAggregationWindowMs(windowMs: String) {
+        context.dataStore.edit { it[PreferenceKeys.AGGREGATION_WINDOW_MS] = windowMs }
+    }
+
+    suspend fun updateAggregationStepMs(stepMs: String) {
+        context.dataStore.edit { it[PreferenceKeys.AGGREGATION_STEP_MS] = stepMs }
+    }
+
+    suspend fun updateBatchWindowMs(windowMs: String) {
+        context.dataStore.edit { it[PreferenceKeys.BATCH_WINDOW_MS] = windowMs }
+    }
+
+    suspend fun updateBatchMaxSamples(maxSamples: String) {
+        context.dataStore.edit { it[PreferenceKeys.BATCH_MAX_SAMPLES] = maxSamples }
+    }
+
+    suspend fun updateQueueDepth(depth: String) {
+        context.dataStore.edit { it[PreferenceKeys.QUEUE_DEPTH] = depth }
+    }
+
+    suspend fun updateQueueOverflowPolicy(policy: Int) {
+        context.dataStore.edit { it[PreferenceKeys.QUEUE_OVERFLOW_POLICY] = policy }
+    }
+
+    suspend fun updateOfflineStoreKb(kb: String) {
+        context.dataStore.edit { it[PreferenceKeys.OFFLINE_STORE_KB] = kb }
+    }
+
+    suspend fun updateOfflineDrainRate(rate: String) {
+        context.dataStore.edit { it[PreferenceKeys.OFFLINE_DRAIN_RATE] = rate }
+    }
+
+    suspend fun updateQos0Window(window: String) {
+        context.dataStore.edit { it[PreferenceKeys.QOS0_WINDOW] = window }
+    }
+
+    suspend fun updateQos1Window(window: String) {
+        context.dataStore.edit { it[PreferenceKeys.QOS1_WINDOW] = window }
+    }
+
+    suspend fun updateWindowPolicy(policy: Int) {
+        context.dataStore.edit { it[PreferenceKeys.WINDOW_POLICY] = policy }
+    }
+
+    suspend fun updateWriteCoalescingMs(window: String) {
+        context.dataStore.edit { it[PreferenceKeys.WRITE_COALESCING_MS] = window }
+    }
+
+    suspend fun updateWriteCoalescingBytes(bytes: String) {
+        context.dataStore.edit { it[PreferenceKeys.WRITE_COALESCING_BYTES] = bytes }
+    }
+
+    suspend fun updateDiagnosticsTopic(topic: String) {
+        context.dataStore.edit { it[PreferenceKeys.DIAGNOSTICS_TOPIC] = topic }
+    }
+
+    suspend fun updateDiagnosticsIntervalS(interval: String) {
+        context.dataStore.edit { it[PreferenceKeys.DIAGNOSTICS_INTERVAL_S] = interval }
+    }
+
+    suspend fun updateNativeSensorIngestionEnabled(enabled: Boolean) {
+        context.dataStore.edit { it[PreferenceKeys.NATIVE_SENSOR_INGESTION] = enabled }
+    }
+
+    suspend fun updateOrientationTopic(topic: String) {
+        context.dataStore.edit { it[PreferenceKeys.ORIENTATION_TOPIC] = topic }
+    }
+
+    suspend fun updateOrientationRateHz(rate: String) {
+        context.dataStore.edit { it[PreferenceKeys.ORIENTATION_RATE_HZ] = rate }
+    }
+
+    suspend fun updateOrientationAlgorithm(algorithm: Int) {
+        context.dataStore.edit { it[PreferenceKeys.ORIENTATION_ALGORITHM] = algorithm }
+    }
+
+    suspend fun updateOrientationGain(gain: String) {
+        context.dataStore.edit { it[PreferenceKeys.ORIENTATION_GAIN] = gain }
+    }
+
+    suspend fun updateOrientationOnlyEnabled(enabled: Boolean) {
+        context.dataStore.edit { it[PreferenceKeys.ORIENTATION_ONLY] = enabled }
+    }
+
     suspend fun updateHaDiscoveryEnabled(enabled: Boolean) {
         context.dataStore.edit { it[PreferenceKeys.HA_DISCOVERY_ENABLED] = enabled }
     }
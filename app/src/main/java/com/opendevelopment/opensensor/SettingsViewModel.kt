@@ -34,25 +34,72 @@ class SettingsViewModel(private val settingsDataStore: SettingsDataStore) : View
             accelerometerMultiplierY = "1.0",
             accelerometerMultiplierZ = "1.0",
             accelerometerRounding = "2",
+            accelerometerDeadband = "0",
+            accelerometerFilter = "",
+            accelerometerPayloadFormat = 0,
+            accelerometerPublishMode = 0,
+            accelerometerSpectrumBlockSize = "0",
+            accelerometerSpectrumBands = "8",
             accelerometerSamplingPeriod = SensorManager.SENSOR_DELAY_NORMAL,
             gyroscopeTopic = "opensensor/sensor/gyroscope",
             gyroscopeMultiplierX = "1.0",
             gyroscopeMultiplierY = "1.0",
             gyroscopeMultiplierZ = "1.0",
             gyroscopeRounding = "2",
+            gyroscopeDeadband = "0",
+            gyroscopeFilter = "",
+            gyroscopePayloadFormat = 0,
+            gyroscopePublishMode = 0,
             gyroscopeSamplingPeriod = SensorManager.SENSOR_DELAY_NORMAL,
             gravityTopic = "opensensor/sensor/gravity",
             gravityMultiplierX = "1.0",
             gravityMultiplierY = "1.0",
             gravityMultiplierZ = "1.0",
             gravityRounding = "2",
+            gravityDeadband = "0",
+            gravityFilter = "",
+            gravityPayloadFormat = 0,
+            gravityPublishMode = 0,
             gravitySamplingPeriod = SensorManager.SENSOR_DELAY_NORMAL,
             lightSensorTopic = "opensensor/sensor/light",
             lightSensorRounding = "2",
+            lightSensorDeadband = "0",
+            lightSensorFilter = "",
+            lightSensorPayloadFormat = 0,
+            lightSensorPublishMode = 1,
             lightSensorSamplingPeriod = SensorManager.SENSOR_DELAY_NORMAL,
             temperatureSensorTopic = "opensensor/sensor/temperature",
             temperatureSensorRounding = "2",
+            temperatureSensorDeadband = "0",
+            temperatureSensorFilter = "",
+            temperatureSensorPayloadFormat = 0,
+            temperatureSensorPublishMode = 1,
             temperatureSensorSamplingPeriod = SensorManager.SENSOR_DELAY_NORMAL,
+            relativeDeadbandPercent = "0",
+            hysteresisPercent = "0",
+            minPublishIntervalMs = "0",
+            heartbeatSeconds = "0",
+            aggregationWindowMs = "0",
+            aggregationStepMs = "0",
+            batchWindowMs = "0",
+            batchMaxSamples = "0",
+            queueDepth = "256",
+            queueOverflowPolicy = 0,
+            offlineStoreKb = "1024",
+            offlineDrainRate = "50",
+            qos0Window = "128",
+            qos1Window = "32",
+            windowPolicy = 0,
+            writeCoalescingMs = "0",
+            writeCoalescingBytes = "1400",
+            diagnosticsTopic = "opensensor/diagnostics",
+            diagnosticsIntervalS = "0",
+            isNativeSensorIngestionEnabled = false,
+            orientationTopic = "opensensor/sensor/orientation",
+            orientationRateHz = "0",
+            orientationAlgorithm = 0,
+            orientationGain = "0",
+            isOrientationOnlyEnabled = false,
             isHaDiscoveryEnabled = false,
             haDiscoveryPrefix = "homeassistant",
             haDeviceName = "OpenSensor",
@@ -129,25 +176,72 @@ class SettingsViewModel(private val settingsDataStore: SettingsDataStore) : View
     fun updateAccelerometerMultiplierY(multiplier: String) { viewModelScope.launch { settingsDataStore.updateAccelerometerMultiplierY(multiplier) } }
     fun updateAccelerometerMultiplierZ(multiplier: String) { viewModelScope.launch { settingsDataStore.updateAccelerometerMultiplierZ(multiplier) } }
     fun updateAccelerometerRounding(rounding: String) { viewModelScope.launch { settingsDataStore.updateAccelerometerRounding(rounding) } }
+    fun updateAccelerometerDeadband(deadband: String) { viewModelScope.launch { settingsDataStore.updateAccelerometerDeadband(deadband) } }
+    fun updateAccelerometerFilter(filter: String) { viewModelScope.launch { settingsDataStore.updateAccelerometerFilter(filter) } }
+    fun updateAccelerometerPayloadFormat(format: Int) { viewModelScope.launch { settingsDataStore.updateAccelerometerPayloadFormat(format) } }
+    fun updateAccelerometerPublishMode(mode: Int) { viewModelScope.launch { settingsDataStore.updateAccelerometerPublishMode(mode) } }
+    fun updateAccelerometerSpectrumBlockSize(blockSize: String) { viewModelScope.launch { settingsDataStore.updateAccelerometerSpectrumBlockSize(blockSize) } }
+    fun updateAccelerometerSpectrumBands(bands: String) { viewModelScope.launch { settingsDataStore.updateAccelerometerSpectrumBands(bands) } }
     fun updateAccelerometerSamplingPeriod(samplingPeriod: Int) { viewModelScope.launch { settingsDataStore.updateAccelerometerSamplingPeriod(samplingPeriod) } }
     fun updateGyroscopeTopic(topic: String) { viewModelScope.launch { settingsDataStore.updateGyroscopeTopic(topic) } }
     fun updateGyroscopeMultiplierX(multiplier: String) { viewModelScope.launch { settingsDataStore.updateGyroscopeMultiplierX(multiplier) } }
     fun updateGyroscopeMultiplierY(multiplier: String) { viewModelScope.launch { settingsDataStore.updateGyroscopeMultiplierY(multiplier) } }
     fun updateGyroscopeMultiplierZ(multiplier: String) { viewModelScope.launch { settingsDataStore.updateGyroscopeMultiplierZ(multiplier) } }
     fun updateGyroscopeRounding(rounding: String) { viewModelScope.launch { settingsDataStore.updateGyroscopeRounding(rounding) } }
+    fun updateGyroscopeDeadband(deadband: String) { viewModelScope.launch { settingsDataStore.updateGyroscopeDeadband(deadband) } }
+    fun updateGyroscopeFilter(filter: String) { viewModelScope.launch { settingsDataStore.updateGyroscopeFilter(filter) } }
+    fun updateGyroscopePayloadFormat(format: Int) { viewModelScope.launch { settingsDataStore.updateGyroscopePayloadFormat(format) } }
+    fun updateGyroscopePublishMode(mode: Int) { viewModelScope.launch { settingsDataStore.updateGyroscopePublishMode(mode) } }
     fun updateGyroscopeSamplingPeriod(samplingPeriod: Int) { viewModelScope.launch { settingsDataStore.updateGyroscopeSamplingPeriod(samplingPeriod) } }
     fun updateGravityTopic(topic: String) { viewModelScope.launch { settingsDataStore.updateGravityTopic(topic) } }
     fun updateGravityMultiplierX(multiplier: String) { viewModelScope.launch { settingsDataStore.updateGravityMultiplierX(multiplier) } }
     fun updateGravityMultiplierY(multiplier: String) { viewModelScope.launch { settingsDataStore.updateGravityMultiplierY(multiplier) } }
     fun updateGravityMultiplierZ(multiplier: String) { viewModelScope.launch { settingsDataStore.updateGravityMultiplierZ(multiplier) } }
     fun updateGravityRounding(rounding: String) { viewModelScope.launch { settingsDataStore.updateGravityRounding(rounding) } }
+    fun updateGravityDeadband(deadband: String) { viewModelScope.launch { settingsDataStore.updateGravityDeadband(deadband) } }
+    fun updateGravityFilter(filter: String) { viewModelScope.launch { settingsDataStore.updateGravityFilter(filter) } }
+    fun updateGravityPayloadFormat(format: Int) { viewModelScope.launch { settingsDataStore.updateGravityPayloadFormat(format) } }
+    fun updateGravityPublishMode(mode: Int) { viewModelScope.launch { settingsDataStore.updateGravityPublishMode(mode) } }
     fun updateGravitySamplingPeriod(samplingPeriod: Int) { viewModelScope.launch { settingsDataStore.updateGravitySamplingPeriod(samplingPeriod) } }
     fun updateLightSensorTopic(topic: String) { viewModelScope.launch { settingsDataStore.updateLightSensorTopic(topic) } }
     fun updateLightSensorRounding(rounding: String) { viewModelScope.launch { settingsDataStore.updateLightSensorRounding(rounding) } }
+    fun updateLightSensorDeadband(deadband: String) { viewModelScope.launch { settingsDataStore.updateLightSensorDeadband(deadband) } }
+    fun updateLightSensorFilter(filter: String) { viewModelScope.launch { settingsDataStore.updateLightSensorFilter(filter) } }
+    fun updateLightSensorPayloadFormat(format: Int) { viewModelScope.launch { settingsDataStore.updateLightSensorPayloadFormat(format) } }
+    fun updateLightSensorPublishMode(mode: Int) { viewModelScope.launch { settingsDataStore.updateLightSensorPublishMode(mode) } }
     fun updateLightSensorSamplingPeriod(samplingPeriod: Int) { viewModelScope.launch { settingsDataStore.updateLightSensorSamplingPeriod(samplingPeriod) } }
     fun updateTemperatureSensorTopic(topic: String) { viewModelScope.launch { settingsDataStore.updateTemperatureSensorTopic(topic) } }
     fun updateTemperatureSensorRounding(rounding: String) { viewModelScope.launch { settingsDataStore.updateTemperatureSensorRounding(rounding) } }
+    fun updateTemperatureSensorDeadband(deadband: String) { viewModelScope.launch { settingsDataStore.updateTemperatureSensorDeadband(deadband) } }
+    fun updateTemperatureSensorFilter(filter: String) { viewModelScope.launch { settingsDataStore.updateTemperatureSensorFilter(filter) } }
+    fun updateTemperatureSensorPayloadFormat(format: Int) { viewModelScope.launch { settingsDataStore.updateTemperatureSensorPayloadFormat(format) } }
+    fun updateTemperatureSensorPublishMode(mode: Int) { viewModelScope.launch { settingsDataStore.updateTemperatureSensorPublishMode(mode) } }
     fun updateTemperatureSensorSamplingPeriod(samplingPeriod: Int) { viewModelScope.launch { settingsDataStore.updateTemperatureSensorSamplingPeriod(samplingPeriod) } }
+    fun updateRelativeDeadbandPercent(percent: String) { viewModelScope.launch { settingsDataStore.updateRelativeDeadbandPercent(percent) } }
+    fun updateHysteresisPercent(percent: String) { viewModelScope.launch { settingsDataStore.updateHysteresisPercent(percent) } }
+    fun updateMinPublishIntervalMs(intervalMs: String) { viewModelScope.launch { settingsDataStore.updateMinPublishIntervalMs(intervalMs) } }
+    fun updateHeartbeatSeconds(seconds: String) { viewModelScope.launch { settingsDataStore.updateHeartbeatSeconds(seconds) } }
+    fun updateAggregationWindowMs(windowMs: String) { viewModelScope.launch { settingsDataStore.updateAggregationWindowMs(windowMs) } }
+    fun updateAggregationStepMs(stepMs: String) { viewModelScope.launch { settingsDataStore.updateAggregationStepMs(stepMs) } }
+    fun updateBatchWindowMs(windowMs: String) { viewModelScope.launch { settingsDataStore.updateBatchWindowMs(windowMs) } }
+    fun updateBatchMaxSamples(maxSamples: String) { viewModelScope.launch { settingsDataStore.updateBatchMaxSamples(maxSamples) } }
+    fun updateQueueDepth(depth: String) { viewModelScope.launch { settingsDataStore.updateQueueDepth(depth) } }
+    fun updateQueueOverflowPolicy(policy: Int) { viewModelScope.launch { settingsDataStore.updateQueueOverflowPolicy(policy) } }
+    fun updateOfflineStoreKb(kb: String) { viewModelScope.launch { settingsDataStore.updateOfflineStoreKb(kb) } }
+    fun updateOfflineDrainRate(rate: String) { viewModelScope.launch { settingsDataStore.updateOfflineDrainRate(rate) } }
+    fun updateQos0Window(window: String) { viewModelScope.launch { settingsDataStore.updateQos0Window(window) } }
+    fun updateQos1Window(window: String) { viewModelScope.launch { settingsDataStore.updateQos1Window(window) } }
+    fun updateWindowPolicy(policy: Int) { viewModelScope.launch { settingsDataStore.updateWindowPolicy(policy) } }
+    fun updateWriteCoalescingMs(window: String) { viewModelScope.launch { settingsDataStore.updateWriteCoalescingMs(window) } }
+    fun updateWriteCoalescingBytes(bytes: String) { viewModelScope.launch { settingsDataStore.updateWriteCoalescingBytes(bytes) } }
+    fun updateDiagnosticsTopic(topic: String) { viewModelScope.launch { settingsDataStore.updateDiagnosticsTopic(topic) } }
+    fun updateDiagnosticsIntervalS(interval: String) { viewModelScope.launch { settingsDataStore.updateDiagnosticsIntervalS(interval) } }
+    fun updateNativeSensorIngestionEnabled(enabled: Boolean) { viewModelScope.launch { settingsDataStore.updateNativeSensorIngestionEnabled(enabled) } }
+    fun updateOrientationTopic(topic: String) { viewModelScope.launch { settingsDataStore.updateOrientationTopic(topic) } }
+    fun updateOrientationRateHz(rate: String) { viewModelScope.launch { settingsDataStore.updateOrientationRateHz(rate) } }
+    fun updateOrientationAlgorithm(algorithm: Int) { viewModelScope.launch { settingsDataStore.updateOrientationAlgorithm(algorithm) } }
+    fun updateOrientationGain(gain: String) { viewModelScope.launch { settingsDataStore.updateOrientationGain(gain) } }
+    fun updateOrientationOnlyEnabled(enabled: Boolean) { viewModelScope.launch { settingsDataStore.updateOrientationOnlyEnabled(enabled) } }
 
     fun updateHaDiscoveryEnabled(enabled: Boolean) { viewModelScope.launch { settingsDataStore.updateHaDiscoveryEnabled(enabled) } }
     fun updateHaDiscoveryPrefix(prefix: String) { viewModelScope.launch { settingsDataStore.updateHaDiscoveryPrefix(prefix) } }
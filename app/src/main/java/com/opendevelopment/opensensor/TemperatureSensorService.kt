@@ -36,12 +36,22 @@ class TemperatureSensorService : Service(), SensorEventListener {
     private lateinit var sensorManager: SensorManager
     private var temperatureSensor: Sensor? = null
     private var isStarted = false
+    private var isNativeIngestion = false
     private lateinit var settingsDataStore: SettingsDataStore
 
     private data class TemperatureSensorConfig(
         val isEnabled: Boolean,
         val rounding: Int,
-        val samplingPeriod: Int
+        val samplingPeriod: Int,
+        val batchWindowMs: Int,
+        val batchMaxSamples: Int,
+        val changeDetection: ChangeDetectionConfig,
+        val aggregationWindowMs: Int,
+        val aggregationStepMs: Int,
+        val payloadFormat: Int,
+        val publishMode: Int,
+        val filter: String,
+        val nativeIngestion: Boolean
     )
 
     override fun onCreate() {
@@ -61,7 +71,16 @@ class TemperatureSensorService : Service(), SensorEventListener {
                     TemperatureSensorConfig(
                         s.isTemperatureSensorEnabled,
                         s.temperatureSensorRounding.toIntOrNull() ?: 2,
-                        s.temperatureSensorSamplingPeriod
+                        s.temperatureSensorSamplingPeriod,
+                        s.batchWindowMs.toIntOrNull() ?: 0,
+                        s.batchMaxSamples.toIntOrNull() ?: 0,
+                        ChangeDetectionConfig.from(s, s.temperatureSensorDeadband),
+                        s.aggregationWindowMs.toIntOrNull() ?: 0,
+                        s.aggregationStepMs.toIntOrNull() ?: 0,
+                        s.temperatureSensorPayloadFormat,
+                        s.temperatureSensorPublishMode,
+                        s.temperatureSensorFilter,
+                        s.isNativeSensorIngestionEnabled
                     )
                 }
                 .distinctUntilChanged()
@@ -71,8 +90,10 @@ class TemperatureSensorService : Service(), SensorEventListener {
                         return@collect
                     }
 
-                    updateSettings(config.rounding)
-                    start(config.samplingPeriod)
+                    updateSettings(config.rounding, config.batchWindowMs, config.batchMaxSamples, config.changeDetection,
+                        config.aggregationWindowMs, config.aggregationStepMs, config.payloadFormat, config.publishMode)
+                    updateFilters(config.filter, config.samplingPeriod)
+                    start(config.samplingPeriod, config.nativeIngestion)
                     _isTemperatureSensorEnabled.value = isStarted
 
                     if (!isStarted) {
@@ -89,13 +110,17 @@ class TemperatureSensorService : Service(), SensorEventListener {
         return START_STICKY
     }
 
-    private fun start(samplingPeriod: Int) {
+    private fun start(samplingPeriod: Int, nativeIngestion: Boolean) {
         Log.d(tag, "Starting temperature sensor listener with sampling period: $samplingPeriod")
         if (isStarted) {
-            sensorManager.unregisterListener(this)
+            unregister()
         }
         if (temperatureSensor != null) {
-            sensorManager.registerListener(this, temperatureSensor, samplingPeriod)
+            isNativeIngestion = nativeIngestion &&
+                NativeSensorIngestion.enable(this, NativeSensorIngestion.TEMPERATURE, samplingPeriod, temperatureSensor?.minDelay ?: 0)
+            if (!isNativeIngestion) {
+                sensorManager.registerListener(this, temperatureSensor, samplingPeriod)
+            }
             isStarted = true
         } else {
             Log.e(tag, "Temperature sensor not available on this device.")
@@ -107,13 +132,35 @@ class TemperatureSensorService : Service(), SensorEventListener {
     private fun stop() {
         if (isStarted) {
             Log.d(tag, "Stopping temperature sensor listener.")
-            sensorManager.unregisterListener(this)
+            unregister()
             isStarted = false
         }
     }
 
-    private fun updateSettings(rounding: Int) {
-        nativeUpdateTemperatureSensorSettings(rounding)
+    private fun unregister() {
+        if (isNativeIngestion) {
+            NativeSensorIngestion.disable(NativeSensorIngestion.TEMPERATURE)
+            isNativeIngestion = false
+        } else {
+            sensorManager.unregisterListener(this)
+        }
+    }
+
+    private fun updateSettings(rounding: Int, batchWindowMs: Int, batchMaxSamples: Int, changeDetection: ChangeDetectionConfig,
+                               aggregationWindowMs: Int, aggregationStepMs: Int, payloadFormat: Int, publishMode: Int) {
+        nativeUpdateTemperatureSensorSettings(
+            rounding, batchWindowMs, batchMaxSamples,
+            changeDetection.deadband, changeDetection.relativeDeadbandPercent, changeDetection.hysteresisPercent,
+            changeDetection.minIntervalMs, changeDetection.heartbeatMs,
+            aggregationWindowMs, aggregationStepMs, payloadFormat, publishMode
+        )
+    }
+
+    private fun updateFilters(filter: String, samplingPeriod: Int) {
+        val sampleRateHz = NativeSensorIngestion.sampleRateHz(samplingPeriod, temperatureSensor?.minDelay ?: 0)
+        if (!nativeUpdateTemperatureSensorFilters(filter, sampleRateHz)) {
+            Log.w(tag, "Invalid filter chain \"$filter\" at $sampleRateHz Hz, filtering disabled")
+        }
     }
 
     override fun onSensorChanged(event: SensorEvent?) {
@@ -126,7 +173,7 @@ class TemperatureSensorService : Service(), SensorEventListener {
             }
 
             // Process data in C++
-            nativeProcessTemperatureSensorData(value)
+            nativeProcessTemperatureSensorData(value, event.timestamp)
         }
     }
 
@@ -190,6 +237,11 @@ class TemperatureSensorService : Service(), SensorEventListener {
         val isTemperatureSensorEnabled = _isTemperatureSensorEnabled.asStateFlow()
     }
 
-    private external fun nativeUpdateTemperatureSensorSettings(rounding: Int)
-    private external fun nativeProcessTemperatureSensorData(value: Float)
+    private external fun nativeUpdateTemperatureSensorSettings(
+        rounding: Int, batchWindowMs: Int, batchMaxSamples: Int,
+        deadband: Float, relativeDeadbandPercent: Float, hysteresisPercent: Float, minIntervalMs: Int, heartbeatMs: Int,
+        aggregationWindowMs: Int, aggregationStepMs: Int, payloadFormat: Int, publishMode: Int
+    )
+    private external fun nativeUpdateTemperatureSensorFilters(spec: String, sampleRateHz: Float): Boolean
+    private external fun nativeProcessTemperatureSensorData(value: Float, timestampNs: Long)
 }